@@ -0,0 +1,415 @@
+#include "ap_inventory.h"
+#include <string.h>
+#include "table_hash.h"
+
+// Suite selector OUIs of the RSN and WPA elements
+static const uint8_t rsn_oui[3] = { 0x00, 0x0F, 0xAC };
+static const uint8_t wpa_oui[3] = { 0x00, 0x50, 0xF2 };
+
+InventoryConfig ap_inventory_default_config() {
+    InventoryConfig config;
+    config.report_interval_ms = 5000;
+    config.ap_timeout_ms = 60000;
+    config.probe_timeout_ms = 120000;
+    config.rssi_change_db = 10;
+    return config;
+}
+
+// Hidden networks advertise an empty SSID or one of zero bytes
+static bool ssid_hidden(ByteSpan ssid) {
+    for (size_t i = 0; i < ssid.len; i++) {
+        if (ssid.data[i] != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static inline int16_t rssi_fixed(int8_t rssi) {
+    return (int16_t)(rssi * (1 << INVENTORY_RSSI_SHIFT));
+}
+
+static inline uint16_t load_le16(const uint8_t* p) {
+    return (uint16_t)(p[0] | p[1] << 8);
+}
+
+// Cipher and AKM suites of an RSN or WPA element, starting at the group cipher
+static uint16_t parse_suites(const uint8_t* p, size_t len, const uint8_t* oui, bool rsn) {
+    uint16_t security = 0;
+    if (len < 6) {
+        return security;
+    }
+    p += 4;
+    len -= 4;
+
+    size_t count = load_le16(p);
+    p += 2;
+    len -= 2;
+    for (size_t i = 0; i < count && len >= 4; i++, p += 4, len -= 4) {
+        if (memcmp(p, oui, 3) != 0) {
+            continue;
+        }
+        switch (p[3]) {
+            case 2: security |= INVENTORY_SEC_TKIP; break;
+            case 4: case 10: security |= INVENTORY_SEC_CCMP; break;
+            case 8: case 9: security |= INVENTORY_SEC_GCMP; break;
+            default: break;
+        }
+    }
+
+    if (len < 2) {
+        return security;
+    }
+    count = load_le16(p);
+    p += 2;
+    len -= 2;
+    for (size_t i = 0; i < count && len >= 4; i++, p += 4, len -= 4) {
+        if (memcmp(p, oui, 3) != 0) {
+            continue;
+        }
+        uint8_t akm = p[3];
+        if (!rsn) {
+            security |= akm == 1 ? INVENTORY_SEC_ENTERPRISE : 0;
+            continue;
+        }
+        switch (akm) {
+            case 1: case 3: case 5:             // 802.1X, FT, SHA-256
+                security |= INVENTORY_SEC_WPA2 | INVENTORY_SEC_ENTERPRISE;
+                break;
+            case 2: case 4: case 6:             // PSK, FT, SHA-256
+                security |= INVENTORY_SEC_WPA2;
+                break;
+            case 8: case 9: case 18: case 24: case 25:  // SAE, FT-SAE, OWE, SAE-EXT
+                security |= INVENTORY_SEC_WPA3;
+                break;
+            case 11: case 12: case 13:          // Suite B
+                security |= INVENTORY_SEC_WPA3 | INVENTORY_SEC_ENTERPRISE;
+                break;
+            default:
+                break;
+        }
+    }
+
+    if (rsn && len >= 2) {
+        uint16_t caps = load_le16(p);
+        if (caps & 0x0080) security |= INVENTORY_SEC_PMF_CAPABLE;
+        if (caps & 0x0040) security |= INVENTORY_SEC_PMF_REQUIRED;
+    }
+    return security;
+}
+
+uint16_t ap_inventory_security(const ParsedFrame& frame) {
+    uint16_t security = 0;
+    if (frame.capability & 0x0010) {
+        security |= INVENTORY_SEC_PRIVACY;
+    }
+    // Version field first in RSN, OUI, type and version in WPA
+    if (frame.rsn.len >= 2) {
+        security |= parse_suites(frame.rsn.data + 2, frame.rsn.len - 2, rsn_oui, true);
+    }
+    if (frame.wpa.len >= 6) {
+        security |= INVENTORY_SEC_WPA | parse_suites(frame.wpa.data + 6, frame.wpa.len - 6, wpa_oui, false);
+    }
+    return security;
+}
+
+ApInventory::ApInventory(const InventoryConfig& config)
+    : cfg(config), last_report_us(0), frame_count(0), delta_count(0), overflow_count(0) {
+    publish_stats();
+}
+
+bool ApInventory::update(const ParsedFrame& frame, int8_t rssi, uint8_t channel, int64_t now_us) {
+    if (frame.type != IEEE80211_TYPE_MGMT) {
+        return false;
+    }
+    switch (frame.subtype) {
+        case IEEE80211_MGMT_BEACON:
+        case IEEE80211_MGMT_PROBE_RESP:
+            update_ap(frame, rssi, channel, now_us);
+            break;
+        case IEEE80211_MGMT_PROBE_REQ:
+            update_probe(frame, rssi, now_us);
+            break;
+        default:
+            return false;
+    }
+    frame_count++;
+    publish_stats();
+    return true;
+}
+
+void ApInventory::update_ap(const ParsedFrame& frame, int8_t rssi, uint8_t channel, int64_t now_us) {
+    const uint8_t* bssid = frame.bssid;
+    if (bssid == nullptr || !mac_unicast(bssid)) {
+        return;
+    }
+
+    uint32_t hash = mac_hash(bssid);
+    size_t slot = aps.find(hash, [hash, bssid](const ApRecord& record) {
+        return record.hash == hash && mac_equal(record.bssid, bssid);
+    });
+    ApRecord* record;
+    bool created = !aps.occupied(slot);
+    if (created) {
+        record = aps.insert(slot);
+        if (record == nullptr) {
+            overflow_count++;
+            return;
+        }
+        record->hash = hash;
+        memcpy(record->bssid, bssid, 6);
+        record->ssid = SSID_NONE;
+        record->security = 0;
+        record->beacon_interval = 0;
+        record->capability = 0;
+        record->channel = 0;
+        record->flags = 0;
+        record->rssi_ewma = rssi_fixed(rssi);
+        record->reported_rssi_ewma = record->rssi_ewma;
+        record->beacons = 0;
+        record->probe_responses = 0;
+        record->first_seen_us = now_us;
+        record->changes = 0;
+        record->reported = false;
+    } else {
+        record = &aps.at_slot(slot);
+        record->rssi_ewma += (rssi_fixed(rssi) - record->rssi_ewma) >> INVENTORY_RSSI_ALPHA;
+    }
+
+    uint8_t changes = 0;
+    bool beacon = frame.subtype == IEEE80211_MGMT_BEACON;
+    if (!ssid_hidden(frame.ssid)) {
+        if (!ssids.equals(record->ssid, frame.ssid.data, frame.ssid.len)) {
+            // A full arena keeps the old name; the arena counts the overflow
+            uint16_t id = ssids.intern(frame.ssid.data, frame.ssid.len);
+            if (id != SSID_NONE) {
+                ssids.release(record->ssid);
+                record->ssid = id;
+                changes |= INVENTORY_CHANGE_SSID;
+            }
+        }
+        if (beacon && (record->flags & INVENTORY_AP_HIDDEN)) {
+            record->flags &= ~INVENTORY_AP_HIDDEN;
+            changes |= INVENTORY_CHANGE_SSID;
+        }
+    } else if (beacon && !(record->flags & INVENTORY_AP_HIDDEN)) {
+        // Keep a name learned from a probe response; it is the useful part of a hidden network
+        record->flags |= INVENTORY_AP_HIDDEN;
+        changes |= INVENTORY_CHANGE_SSID;
+    }
+
+    uint8_t ap_channel = frame.ds_channel ? frame.ds_channel : channel;
+    if (ap_channel != record->channel) {
+        record->channel = ap_channel;
+        changes |= INVENTORY_CHANGE_CHANNEL;
+    }
+
+    // A truncated frame may have lost its RSN or WPA element, so only a
+    // complete one can change what is already known
+    if (created || !frame.ies_truncated) {
+        uint16_t security = ap_inventory_security(frame);
+        if (security != record->security) {
+            record->security = security;
+            changes |= INVENTORY_CHANGE_SECURITY;
+        }
+    }
+    if (frame.beacon_interval != record->beacon_interval) {
+        record->beacon_interval = frame.beacon_interval;
+        changes |= INVENTORY_CHANGE_INTERVAL;
+    }
+    record->capability = frame.capability;
+
+    if (beacon) {
+        record->beacons++;
+    } else {
+        record->probe_responses++;
+    }
+    record->last_seen_us = now_us;
+    // A record not yet reported goes out whole as new
+    if (record->reported) {
+        record->changes |= changes;
+    }
+}
+
+void ApInventory::update_probe(const ParsedFrame& frame, int8_t rssi, int64_t now_us) {
+    const uint8_t* mac = frame.transmitter;
+    if (mac == nullptr || !mac_unicast(mac)) {
+        return;
+    }
+
+    ByteSpan ssid = frame.ssid;
+    if (ssid_hidden(ssid)) {
+        ssid.len = 0;
+    }
+    uint32_t hash = fnv1a(ssid.data, ssid.len, mac_hash(mac));
+
+    const SsidArena& names = ssids;
+    size_t slot = probes.find(hash, [hash, mac, ssid, &names](const ProbeRecord& record) {
+        return record.hash == hash && mac_equal(record.mac, mac) && names.equals(record.ssid, ssid.data, ssid.len);
+    });
+    ProbeRecord* record;
+    if (!probes.occupied(slot)) {
+        uint16_t id = ssids.intern(ssid.data, ssid.len);
+        if (ssid.len && id == SSID_NONE) {
+            return;
+        }
+        record = probes.insert(slot);
+        if (record == nullptr) {
+            ssids.release(id);
+            overflow_count++;
+            return;
+        }
+        record->hash = hash;
+        memcpy(record->mac, mac, 6);
+        record->ssid = id;
+        record->rssi_ewma = rssi_fixed(rssi);
+        record->requests = 0;
+        record->first_seen_us = now_us;
+        record->reported = false;
+    } else {
+        record = &probes.at_slot(slot);
+        record->rssi_ewma += (rssi_fixed(rssi) - record->rssi_ewma) >> INVENTORY_RSSI_ALPHA;
+    }
+    record->requests++;
+    record->last_seen_us = now_us;
+}
+
+size_t ApInventory::poll(int64_t now_us, inventory_delta_cb_t on_delta, void* ctx) {
+    if (now_us - last_report_us < (int64_t)cfg.report_interval_ms * 1000) {
+        return 0;
+    }
+    return collect(now_us, on_delta, ctx);
+}
+
+size_t ApInventory::collect(int64_t now_us, inventory_delta_cb_t on_delta, void* ctx) {
+    size_t reported = 0;
+    last_report_us = now_us;
+
+    const int64_t ap_timeout_us = (int64_t)cfg.ap_timeout_ms * 1000;
+    const int32_t rssi_threshold = cfg.rssi_change_db * (1 << INVENTORY_RSSI_SHIFT);
+    // Removing a record moves the last one into its place, to be visited next
+    for (size_t i = 0; i < aps.size();) {
+        ApRecord& record = aps[i];
+        InventoryDelta delta = {};
+        delta.ap = &record;
+        delta.ssid = ssids.data(record.ssid);
+        delta.ssid_len = ssids.length(record.ssid);
+        bool gone = now_us - record.last_seen_us > ap_timeout_us;
+        if (gone) {
+            delta.kind = INVENTORY_AP_GONE;
+        } else if (!record.reported) {
+            delta.kind = INVENTORY_AP_NEW;
+        } else {
+            int32_t moved = record.rssi_ewma - record.reported_rssi_ewma;
+            if (rssi_threshold && (moved >= rssi_threshold || -moved >= rssi_threshold)) {
+                record.changes |= INVENTORY_CHANGE_RSSI;
+            }
+            if (record.changes == 0) {
+                i++;
+                continue;
+            }
+            delta.kind = INVENTORY_AP_CHANGED;
+            delta.changes = record.changes;
+        }
+
+        // A record that comes and goes between two reports is never seen
+        if (!gone || record.reported) {
+            on_delta(delta, ctx);
+            reported++;
+        }
+        if (gone) {
+            ssids.release(record.ssid);
+            aps.remove(&record);
+        } else {
+            record.reported = true;
+            record.changes = 0;
+            record.reported_rssi_ewma = record.rssi_ewma;
+            i++;
+        }
+    }
+
+    const int64_t probe_timeout_us = (int64_t)cfg.probe_timeout_ms * 1000;
+    for (size_t i = 0; i < probes.size();) {
+        ProbeRecord& record = probes[i];
+        bool gone = now_us - record.last_seen_us > probe_timeout_us;
+        if (!gone && record.reported) {
+            i++;
+            continue;
+        }
+
+        if (!gone || record.reported) {
+            InventoryDelta delta = {};
+            delta.kind = gone ? INVENTORY_PROBE_GONE : INVENTORY_PROBE_NEW;
+            delta.probe = &record;
+            delta.ssid = ssids.data(record.ssid);
+            delta.ssid_len = ssids.length(record.ssid);
+            on_delta(delta, ctx);
+            reported++;
+        }
+        if (gone) {
+            ssids.release(record.ssid);
+            probes.remove(&record);
+        } else {
+            record.reported = true;
+            i++;
+        }
+    }
+
+    delta_count += reported;
+    publish_stats();
+    return reported;
+}
+
+void ApInventory::report_all() {
+    for (size_t i = 0; i < aps.size(); i++) {
+        aps[i].reported = false;
+        aps[i].changes = 0;
+    }
+    for (size_t i = 0; i < probes.size(); i++) {
+        probes[i].reported = false;
+    }
+    // The next poll reports at once
+    last_report_us = INT64_MIN / 2;
+}
+
+const ApRecord* ApInventory::find_ap(const uint8_t* bssid) const {
+    uint32_t hash = mac_hash(bssid);
+    size_t slot = aps.find(hash, [hash, bssid](const ApRecord& record) {
+        return record.hash == hash && mac_equal(record.bssid, bssid);
+    });
+    return aps.occupied(slot) ? &aps.at_slot(slot) : nullptr;
+}
+
+void ApInventory::clear() {
+    for (size_t i = 0; i < aps.size(); i++) {
+        ssids.release(aps[i].ssid);
+    }
+    for (size_t i = 0; i < probes.size(); i++) {
+        ssids.release(probes[i].ssid);
+    }
+    aps.clear();
+    probes.clear();
+    publish_stats();
+}
+
+void ApInventory::publish_stats() {
+    published[0].store((uint32_t)aps.size(), std::memory_order_relaxed);
+    published[1].store((uint32_t)probes.size(), std::memory_order_relaxed);
+    published[2].store((uint32_t)ssids.size(), std::memory_order_relaxed);
+    published[3].store((uint32_t)ssids.bytes_used(), std::memory_order_relaxed);
+    published[4].store(frame_count, std::memory_order_relaxed);
+    published[5].store(delta_count, std::memory_order_relaxed);
+    published[6].store(overflow_count + ssids.overflows(), std::memory_order_relaxed);
+}
+
+InventoryStats ApInventory::get_stats() const {
+    InventoryStats stats;
+    stats.aps = published[0].load(std::memory_order_relaxed);
+    stats.probes = published[1].load(std::memory_order_relaxed);
+    stats.ssids = published[2].load(std::memory_order_relaxed);
+    stats.ssid_bytes = published[3].load(std::memory_order_relaxed);
+    stats.frames = published[4].load(std::memory_order_relaxed);
+    stats.deltas = published[5].load(std::memory_order_relaxed);
+    stats.overflows = published[6].load(std::memory_order_relaxed);
+    return stats;
+}
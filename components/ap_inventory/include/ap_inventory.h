@@ -0,0 +1,199 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include "fixed_table.h"
+#include "ieee80211_parser.h"
+#include "ssid_arena.h"
+
+// Access points and probing (station, SSID) pairs tracked at once; powers of two
+#ifndef INVENTORY_AP_CAPACITY
+#define INVENTORY_AP_CAPACITY       256
+#endif
+#ifndef INVENTORY_PROBE_CAPACITY
+#define INVENTORY_PROBE_CAPACITY    256
+#endif
+
+// RSSI EWMA: fixed point with 4 fractional bits, weight 1/8 for each new sample
+#define INVENTORY_RSSI_SHIFT        4
+#define INVENTORY_RSSI_ALPHA        3
+
+// Security summary of an AP, from its capability field and RSN/WPA elements
+#define INVENTORY_SEC_PRIVACY       0x0001  // Privacy capability; WEP when no WPA flag is set
+#define INVENTORY_SEC_WPA           0x0002  // WPA vendor element
+#define INVENTORY_SEC_WPA2          0x0004  // RSN with a PSK or 802.1X AKM
+#define INVENTORY_SEC_WPA3          0x0008  // RSN with a SAE, OWE or Suite B AKM
+#define INVENTORY_SEC_ENTERPRISE    0x0010  // An 802.1X AKM
+#define INVENTORY_SEC_PMF_CAPABLE   0x0020  // Management frame protection capable
+#define INVENTORY_SEC_PMF_REQUIRED  0x0040  // Management frame protection required
+#define INVENTORY_SEC_TKIP          0x0100  // Pairwise ciphers offered
+#define INVENTORY_SEC_CCMP          0x0200
+#define INVENTORY_SEC_GCMP          0x0400
+
+// AP attributes whose change is reported
+#define INVENTORY_CHANGE_SSID       0x01
+#define INVENTORY_CHANGE_CHANNEL    0x02
+#define INVENTORY_CHANGE_SECURITY   0x04
+#define INVENTORY_CHANGE_INTERVAL   0x08
+#define INVENTORY_CHANGE_RSSI       0x10
+
+// AP flags
+#define INVENTORY_AP_HIDDEN         0x01    // Beacons carry an empty SSID; the name, if known, came from a probe response
+
+struct ApRecord {
+    uint8_t bssid[6];
+    uint16_t ssid;              // SsidArena id, SSID_NONE if unknown
+    uint16_t security;          // INVENTORY_SEC_x
+    uint16_t beacon_interval;   // TU
+    uint16_t capability;
+    uint8_t channel;            // DS parameter set, else the channel it was heard on
+    uint8_t flags;              // INVENTORY_AP_x
+    int16_t rssi_ewma;          // dBm << INVENTORY_RSSI_SHIFT
+    uint32_t beacons;
+    uint32_t probe_responses;
+    int64_t first_seen_us;
+    int64_t last_seen_us;
+
+    // Bookkeeping
+    uint32_t hash;
+    int16_t reported_rssi_ewma; // rssi_ewma when last reported
+    uint8_t changes;            // INVENTORY_CHANGE_x not yet reported
+    bool reported;              // Reported as new
+
+    int rssi_average() const { return rssi_ewma / (1 << INVENTORY_RSSI_SHIFT); }
+};
+
+struct ProbeRecord {
+    uint8_t mac[6];             // Station sending the probe requests
+    uint16_t ssid;              // SsidArena id, SSID_NONE for wildcard probes
+    int16_t rssi_ewma;          // dBm << INVENTORY_RSSI_SHIFT
+    uint32_t requests;
+    int64_t first_seen_us;
+    int64_t last_seen_us;
+
+    // Bookkeeping
+    uint32_t hash;
+    bool reported;
+
+    int rssi_average() const { return rssi_ewma / (1 << INVENTORY_RSSI_SHIFT); }
+};
+
+enum InventoryDeltaKind {
+    INVENTORY_AP_NEW,
+    INVENTORY_AP_CHANGED,
+    INVENTORY_AP_GONE,
+    INVENTORY_PROBE_NEW,
+    INVENTORY_PROBE_GONE,
+};
+
+// One change to report. Pointers are only valid during the callback.
+struct InventoryDelta {
+    InventoryDeltaKind kind;
+    uint8_t changes;            // INVENTORY_CHANGE_x, for INVENTORY_AP_CHANGED
+    const ApRecord* ap;         // AP deltas, else nullptr
+    const ProbeRecord* probe;   // Probe deltas, else nullptr
+    const uint8_t* ssid;        // nullptr when unknown or wildcard
+    uint8_t ssid_len;
+};
+
+typedef void (*inventory_delta_cb_t)(const InventoryDelta& delta, void* ctx);
+
+struct InventoryConfig {
+    uint32_t report_interval_ms;    // Least time between two reports from poll()
+    uint32_t ap_timeout_ms;         // An AP not heard for this long is reported gone
+    uint32_t probe_timeout_ms;      // Same for a (station, SSID) pair
+    uint8_t rssi_change_db;         // Report an AP whose RSSI average moved this much, 0 = never
+};
+
+// 5 s reports, APs gone after 60 s and probes after 120 s, RSSI changes of 10 dB
+InventoryConfig ap_inventory_default_config();
+
+struct InventoryStats {
+    uint32_t aps;               // Tracked now
+    uint32_t probes;
+    uint32_t ssids;             // Distinct SSIDs interned
+    uint32_t ssid_bytes;
+    uint32_t frames;            // Beacons and probes absorbed
+    uint32_t deltas;            // Deltas reported
+    uint32_t overflows;         // New APs, probes or SSIDs that did not fit
+};
+
+// Inventory of access points and probe requests built from management frames.
+//
+// Beacons and probe responses are merged per BSSID into one record holding
+// the SSID, channel, security summary, beacon interval, RSSI average and
+// counts. Probe requests are merged per (station, SSID). SSIDs are interned
+// in a fixed SsidArena. Instead of every frame, only deltas leave the
+// inventory: new records, changed AP attributes and records that went
+// quiet, at most once per report interval.
+//
+// Everything is preallocated in the object, which can be placed anywhere,
+// including PSRAM. Pure logic with no ESP-IDF dependencies; calls must be
+// serialized by the caller, normally by making them all from a frame sink.
+// get_stats() may be called from any task.
+class ApInventory {
+public:
+    explicit ApInventory(const InventoryConfig& config = ap_inventory_default_config());
+
+    ApInventory(const ApInventory&) = delete;
+    ApInventory& operator=(const ApInventory&) = delete;
+
+    // Absorb a beacon, probe response or probe request heard at `rssi` on
+    // `channel`. Returns false for any other frame.
+    bool update(const ParsedFrame& frame, int8_t rssi, uint8_t channel, int64_t now_us);
+
+    // Report deltas through `on_delta` if the report interval has passed.
+    // Returns the number reported.
+    size_t poll(int64_t now_us, inventory_delta_cb_t on_delta, void* ctx);
+
+    // Report deltas now: new records, AP changes, then records that timed
+    // out, which are removed
+    size_t collect(int64_t now_us, inventory_delta_cb_t on_delta, void* ctx);
+
+    // Report every record as new at the next report, e.g. for a client that just connected
+    void report_all();
+
+    const ApRecord* find_ap(const uint8_t* bssid) const;
+
+    // SSID bytes of an id from a record
+    const uint8_t* ssid_data(uint16_t id) const { return ssids.data(id); }
+    uint8_t ssid_length(uint16_t id) const { return ssids.length(id); }
+
+    // Forget everything without reporting it
+    void clear();
+
+    InventoryStats get_stats() const;
+
+    static constexpr size_t footprint() { return sizeof(ApInventory); }
+
+private:
+    // Records carry their hash; a probe's covers its SSID, which lives in the arena
+    template <typename Record>
+    struct RecordHash {
+        uint32_t operator()(const Record& record) const { return record.hash; }
+    };
+    typedef FixedTable<ApRecord, INVENTORY_AP_CAPACITY, RecordHash<ApRecord>> ApTable;
+    typedef FixedTable<ProbeRecord, INVENTORY_PROBE_CAPACITY, RecordHash<ProbeRecord>> ProbeTable;
+
+    void update_ap(const ParsedFrame& frame, int8_t rssi, uint8_t channel, int64_t now_us);
+    void update_probe(const ParsedFrame& frame, int8_t rssi, int64_t now_us);
+
+    // Make the counters readable from other tasks
+    void publish_stats();
+
+    InventoryConfig cfg;
+    ApTable aps;
+    ProbeTable probes;
+    SsidArena ssids;
+    int64_t last_report_us;
+    uint32_t frame_count;
+    uint32_t delta_count;
+    uint32_t overflow_count;
+
+    // Copies of the counters for get_stats()
+    std::atomic<uint32_t> published[7];
+};
+
+// Security summary (INVENTORY_SEC_x) of a beacon or probe response
+uint16_t ap_inventory_security(const ParsedFrame& frame);
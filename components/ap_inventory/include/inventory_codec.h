@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "ap_inventory.h"
+
+// Compact binary inventory delta batches, sent over the same BLE
+// characteristic as telemetry and told apart by their magic byte.
+//
+//   offset  size  field
+//   0       1     magic (INVENTORY_MAGIC)
+//   1       1     version (INVENTORY_VERSION)
+//   2       2     batch sequence number, little endian, +1 per batch
+//   4       1     delta count
+//   5       ...   deltas
+//
+// Every delta starts with its kind (InventoryDeltaKind) and an address:
+//
+//   AP_NEW, AP_CHANGED   1 kind, 6 BSSID, 1 changes (INVENTORY_CHANGE_x),
+//                        1 channel, 2 security (INVENTORY_SEC_x),
+//                        2 beacon interval (TU), 1 -RSSI average, 1 flags,
+//                        varint beacons, 1 SSID length, SSID
+//   AP_GONE              1 kind, 6 BSSID
+//   PROBE_NEW            1 kind, 6 station, 1 -RSSI average, varint
+//                        requests, 1 SSID length (0 = wildcard), SSID
+//   PROBE_GONE           1 kind, 6 station, 1 SSID length, SSID
+//
+// Multi-byte fields are little endian. This header has no ESP-IDF dependencies.
+
+#define INVENTORY_MAGIC             0xA6
+#define INVENTORY_VERSION           1
+#define INVENTORY_HEADER_SIZE       5
+#define INVENTORY_MAX_DELTA_SIZE    (1 + 6 + 1 + 1 + 2 + 2 + 1 + 1 + 5 + 1 + IEEE80211_MAX_SSID_LEN)
+
+// Largest batch the encoder can build (BLE 4.2+ maximum ATT MTU minus the 3-byte ATT header)
+#define INVENTORY_MAX_BATCH         514
+
+class InventoryEncoder {
+public:
+    // `batch_limit` is the largest batch to emit, normally the negotiated MTU - 3
+    explicit InventoryEncoder(size_t batch_limit = INVENTORY_MAX_BATCH);
+
+    // Change the batch size limit; takes effect from the next batch
+    void set_batch_limit(size_t limit);
+    size_t batch_limit() const { return limit; }
+
+    // Append a delta to the current batch. Returns false if it does not
+    // fit; finish() the batch and append again.
+    bool append(const InventoryDelta& delta);
+
+    // Close the current batch. Returns its length and points `out` at it; the
+    // bytes stay valid until the next append(). Returns 0 for an empty batch.
+    size_t finish(const uint8_t** out);
+
+    bool empty() const { return count == 0; }
+    uint8_t delta_count() const { return count; }
+
+private:
+    uint8_t buffer[INVENTORY_MAX_BATCH];
+    size_t limit;
+    size_t pending_limit;
+    size_t used;
+    uint8_t count;
+    uint16_t sequence;
+    bool open;
+};
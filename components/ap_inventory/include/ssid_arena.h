@@ -0,0 +1,71 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Bytes of SSID text the arena can hold
+#ifndef SSID_ARENA_BYTES
+#define SSID_ARENA_BYTES        4096
+#endif
+
+// Distinct SSIDs the arena can hold
+#ifndef SSID_ARENA_ENTRIES
+#define SSID_ARENA_ENTRIES      256
+#endif
+
+// Id of the empty SSID, and of one that could not be stored
+#define SSID_NONE               0xFFFF
+
+// Reference-counted SSID strings in one fixed buffer.
+//
+// Every distinct SSID is stored once and named by a 16-bit id, so tables
+// keyed by network name hold two bytes instead of 33. Ids stay valid while
+// they have references. When the buffer runs out, live strings are moved
+// down over the ones that were released; if that is still not enough,
+// intern() returns SSID_NONE and counts an overflow.
+//
+// Pure logic with no ESP-IDF dependencies. Calls must be serialized by the caller.
+class SsidArena {
+public:
+    SsidArena();
+
+    SsidArena(const SsidArena&) = delete;
+    SsidArena& operator=(const SsidArena&) = delete;
+
+    // Id of `ssid` with one more reference, adding it if new. SSID_NONE for
+    // an empty SSID or when the arena is full.
+    uint16_t intern(const uint8_t* ssid, size_t len);
+
+    // Add or drop a reference; the SSID is forgotten with its last one.
+    // SSID_NONE is ignored.
+    void retain(uint16_t id);
+    void release(uint16_t id);
+
+    // Bytes and length of an SSID; nullptr and 0 for SSID_NONE
+    const uint8_t* data(uint16_t id) const;
+    uint8_t length(uint16_t id) const;
+
+    bool equals(uint16_t id, const uint8_t* ssid, size_t len) const;
+
+    size_t size() const { return live_count; }
+    size_t bytes_used() const { return live_bytes; }
+    uint32_t overflows() const { return overflow_count; }
+
+private:
+    struct Entry {
+        uint32_t hash;
+        uint16_t offset;
+        uint16_t refs;      // 0 = free
+        uint8_t len;
+    };
+
+    // Move the live strings to the front of the buffer
+    void compact();
+
+    Entry entries[SSID_ARENA_ENTRIES];
+    uint8_t bytes[SSID_ARENA_BYTES];
+    size_t used_bytes;      // End of the last string written
+    size_t live_bytes;
+    size_t live_count;
+    uint32_t overflow_count;
+};
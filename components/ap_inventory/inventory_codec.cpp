@@ -0,0 +1,118 @@
+#include "inventory_codec.h"
+#include <string.h>
+
+#define MIN_BATCH_LIMIT     (INVENTORY_HEADER_SIZE + INVENTORY_MAX_DELTA_SIZE)
+
+static size_t clamp_limit(size_t limit) {
+    if (limit < MIN_BATCH_LIMIT) return MIN_BATCH_LIMIT;
+    if (limit > INVENTORY_MAX_BATCH) return INVENTORY_MAX_BATCH;
+    return limit;
+}
+
+static size_t put_varint(uint8_t* p, uint32_t v) {
+    size_t n = 0;
+    while (v >= 0x80) {
+        p[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+static inline uint8_t negated_rssi(int rssi) {
+    return (uint8_t)(rssi > 0 ? 0 : (rssi < -127 ? 127 : -rssi));
+}
+
+static size_t put_ssid(uint8_t* p, const InventoryDelta& delta) {
+    uint8_t len = delta.ssid ? delta.ssid_len : 0;
+    if (len > IEEE80211_MAX_SSID_LEN) {
+        len = IEEE80211_MAX_SSID_LEN;
+    }
+    p[0] = len;
+    memcpy(p + 1, delta.ssid, len);
+    return 1 + len;
+}
+
+InventoryEncoder::InventoryEncoder(size_t batch_limit)
+    : limit(clamp_limit(batch_limit)), pending_limit(limit), used(0), count(0), sequence(0), open(false) {
+}
+
+void InventoryEncoder::set_batch_limit(size_t new_limit) {
+    pending_limit = clamp_limit(new_limit);
+}
+
+bool InventoryEncoder::append(const InventoryDelta& delta) {
+    if (!open) {
+        limit = pending_limit;
+        buffer[0] = INVENTORY_MAGIC;
+        buffer[1] = INVENTORY_VERSION;
+        buffer[2] = (uint8_t)sequence;
+        buffer[3] = (uint8_t)(sequence >> 8);
+        buffer[4] = 0;
+        used = INVENTORY_HEADER_SIZE;
+        count = 0;
+        open = true;
+    }
+    if (count == UINT8_MAX) {
+        return false;
+    }
+
+    uint8_t encoded[INVENTORY_MAX_DELTA_SIZE];
+    size_t n = 0;
+    encoded[n++] = (uint8_t)delta.kind;
+    switch (delta.kind) {
+        case INVENTORY_AP_NEW:
+        case INVENTORY_AP_CHANGED: {
+            const ApRecord& ap = *delta.ap;
+            memcpy(encoded + n, ap.bssid, 6);
+            n += 6;
+            encoded[n++] = delta.changes;
+            encoded[n++] = ap.channel;
+            encoded[n++] = (uint8_t)ap.security;
+            encoded[n++] = (uint8_t)(ap.security >> 8);
+            encoded[n++] = (uint8_t)ap.beacon_interval;
+            encoded[n++] = (uint8_t)(ap.beacon_interval >> 8);
+            encoded[n++] = negated_rssi(ap.rssi_average());
+            encoded[n++] = ap.flags;
+            n += put_varint(encoded + n, ap.beacons);
+            n += put_ssid(encoded + n, delta);
+            break;
+        }
+        case INVENTORY_AP_GONE:
+            memcpy(encoded + n, delta.ap->bssid, 6);
+            n += 6;
+            break;
+        case INVENTORY_PROBE_NEW:
+            memcpy(encoded + n, delta.probe->mac, 6);
+            n += 6;
+            encoded[n++] = negated_rssi(delta.probe->rssi_average());
+            n += put_varint(encoded + n, delta.probe->requests);
+            n += put_ssid(encoded + n, delta);
+            break;
+        case INVENTORY_PROBE_GONE:
+            memcpy(encoded + n, delta.probe->mac, 6);
+            n += 6;
+            n += put_ssid(encoded + n, delta);
+            break;
+    }
+
+    if (used + n > limit) {
+        return false;
+    }
+    memcpy(buffer + used, encoded, n);
+    used += n;
+    count++;
+    return true;
+}
+
+size_t InventoryEncoder::finish(const uint8_t** out) {
+    if (!open || count == 0) {
+        return 0;
+    }
+    buffer[4] = count;
+    *out = buffer;
+    sequence++;
+    open = false;
+    count = 0;
+    return used;
+}
@@ -0,0 +1,112 @@
+#include "ssid_arena.h"
+#include <string.h>
+#include "table_hash.h"
+
+static_assert(SSID_ARENA_ENTRIES < SSID_NONE, "SSID_ARENA_ENTRIES too large for 16-bit ids");
+static_assert(SSID_ARENA_BYTES <= 0xFFFF, "SSID_ARENA_BYTES too large for 16-bit offsets");
+
+SsidArena::SsidArena()
+    : used_bytes(0), live_bytes(0), live_count(0), overflow_count(0) {
+    memset(entries, 0, sizeof(entries));
+}
+
+uint16_t SsidArena::intern(const uint8_t* ssid, size_t len) {
+    if (len == 0 || len > 0xFF) {
+        return SSID_NONE;
+    }
+
+    uint32_t hash = fnv1a(ssid, len);
+    size_t free_entry = SSID_ARENA_ENTRIES;
+    for (size_t i = 0; i < SSID_ARENA_ENTRIES; i++) {
+        Entry& entry = entries[i];
+        if (entry.refs == 0) {
+            if (free_entry == SSID_ARENA_ENTRIES) {
+                free_entry = i;
+            }
+        } else if (entry.hash == hash && entry.len == len && memcmp(bytes + entry.offset, ssid, len) == 0) {
+            entry.refs++;
+            return (uint16_t)i;
+        }
+    }
+
+    if (free_entry == SSID_ARENA_ENTRIES || live_bytes + len > SSID_ARENA_BYTES) {
+        overflow_count++;
+        return SSID_NONE;
+    }
+    if (used_bytes + len > SSID_ARENA_BYTES) {
+        compact();
+    }
+
+    Entry& entry = entries[free_entry];
+    entry.hash = hash;
+    entry.offset = (uint16_t)used_bytes;
+    entry.refs = 1;
+    entry.len = (uint8_t)len;
+    memcpy(bytes + used_bytes, ssid, len);
+    used_bytes += len;
+    live_bytes += len;
+    live_count++;
+    return (uint16_t)free_entry;
+}
+
+void SsidArena::retain(uint16_t id) {
+    if (id < SSID_ARENA_ENTRIES && entries[id].refs) {
+        entries[id].refs++;
+    }
+}
+
+void SsidArena::release(uint16_t id) {
+    if (id >= SSID_ARENA_ENTRIES || entries[id].refs == 0) {
+        return;
+    }
+    if (--entries[id].refs == 0) {
+        live_bytes -= entries[id].len;
+        live_count--;
+        if (live_count == 0) {
+            used_bytes = 0;
+        }
+    }
+}
+
+const uint8_t* SsidArena::data(uint16_t id) const {
+    return id < SSID_ARENA_ENTRIES && entries[id].refs ? bytes + entries[id].offset : nullptr;
+}
+
+uint8_t SsidArena::length(uint16_t id) const {
+    return id < SSID_ARENA_ENTRIES && entries[id].refs ? entries[id].len : 0;
+}
+
+bool SsidArena::equals(uint16_t id, const uint8_t* ssid, size_t len) const {
+    if (id >= SSID_ARENA_ENTRIES || entries[id].refs == 0) {
+        return len == 0;
+    }
+    return entries[id].len == len && memcmp(bytes + entries[id].offset, ssid, len) == 0;
+}
+
+void SsidArena::compact() {
+    // Take the live strings in offset order and slide each one down. They
+    // only move towards the front, so none is overwritten before it has
+    // been moved, and a moved one ends below `floor`. Rare, so quadratic is fine.
+    size_t write = 0;
+    size_t floor = 0;
+    while (1) {
+        size_t next = SSID_ARENA_ENTRIES;
+        for (size_t i = 0; i < SSID_ARENA_ENTRIES; i++) {
+            if (entries[i].refs && entries[i].offset >= floor &&
+                (next == SSID_ARENA_ENTRIES || entries[i].offset < entries[next].offset)) {
+                next = i;
+            }
+        }
+        if (next == SSID_ARENA_ENTRIES) {
+            break;
+        }
+        Entry& entry = entries[next];
+        floor = entry.offset + entry.len;
+        if (entry.offset != write) {
+            memmove(bytes + write, bytes + entry.offset, entry.len);
+            entry.offset = (uint16_t)write;
+        }
+        write += entry.len;
+    }
+    used_bytes = write;
+}
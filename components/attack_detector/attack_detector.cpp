@@ -0,0 +1,379 @@
+#include "attack_detector.h"
+#include <string.h>
+#include "table_hash.h"
+
+static const uint8_t zero_mac[6] = { 0 };
+
+AttackDetectorConfig attack_detector_default_config() {
+    AttackDetectorConfig config;
+    config.window_ms = 1000;
+    config.deauth_threshold = 20;
+    config.deauth_total_threshold = 50;
+    config.beacon_threshold = 50;
+    config.new_bssid_threshold = 50;
+    config.probe_threshold = 100;
+    config.probe_total_threshold = 500;
+    config.holdoff_ms = 10000;
+    return config;
+}
+
+static inline bool mac_usable(const uint8_t* mac) {
+    return mac != nullptr && mac_unicast(mac);
+}
+
+// Both halves of the hash mixed down; MAC hashes vary most in their high
+// bits, SSID hashes in their low ones
+static inline size_t set_index(uint32_t hash, size_t sets) {
+    return (size_t)((hash ^ hash >> 16) * 0x9E3779B1u >> 16) & (sets - 1);
+}
+
+// FNV-1a; never 0, which marks an unused SSID entry
+static uint32_t ssid_hash(ByteSpan ssid) {
+    uint32_t hash = fnv1a(ssid.data, ssid.len);
+    return hash ? hash : 1;
+}
+
+// Hidden networks advertise an empty SSID or one of zero bytes
+static bool ssid_hidden(ByteSpan ssid) {
+    for (size_t i = 0; i < ssid.len; i++) {
+        if (ssid.data[i] != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint8_t attack_security_class(const ParsedFrame& frame) {
+    if (frame.rsn.len) {
+        return ATTACK_SECURITY_RSN;
+    }
+    if (frame.wpa.len) {
+        return ATTACK_SECURITY_WPA;
+    }
+    return (frame.capability & 0x0010) ? ATTACK_SECURITY_WEP : ATTACK_SECURITY_OPEN;
+}
+
+const char* attack_kind_name(AttackKind kind) {
+    switch (kind) {
+        case ATTACK_DEAUTH_FLOOD: return "deauth flood";
+        case ATTACK_BEACON_FLOOD: return "beacon flood";
+        case ATTACK_EVIL_TWIN: return "evil twin";
+        case ATTACK_PROBE_STORM: return "probe storm";
+        default: return "unknown";
+    }
+}
+
+void WindowCounter::reset(int64_t now_us) {
+    bucket_start_us = now_us;
+    total = 0;
+    memset(buckets, 0, sizeof(buckets));
+    head = 0;
+}
+
+uint32_t WindowCounter::add(int64_t now_us, int64_t bucket_us) {
+    int64_t elapsed = now_us - bucket_start_us;
+    if (elapsed >= bucket_us) {
+        int64_t advance = elapsed / bucket_us;
+        if (advance >= ATTACK_DETECTOR_BUCKETS) {
+            reset(now_us);
+        } else {
+            // Buckets that fell out of the window
+            for (int64_t i = 0; i < advance; i++) {
+                head = (uint8_t)((head + 1) % ATTACK_DETECTOR_BUCKETS);
+                total -= buckets[head];
+                buckets[head] = 0;
+            }
+            bucket_start_us += advance * bucket_us;
+        }
+    }
+    if (buckets[head] != UINT16_MAX) {
+        buckets[head]++;
+        total++;
+    }
+    return total;
+}
+
+AttackDetector::AttackDetector(const AttackDetectorConfig& config)
+    : cfg(config) {
+    if (cfg.window_ms < ATTACK_DETECTOR_BUCKETS) {
+        cfg.window_ms = ATTACK_DETECTOR_BUCKETS;
+    }
+    window_us = (int64_t)cfg.window_ms * 1000;
+    bucket_us = window_us / ATTACK_DETECTOR_BUCKETS;
+    clear();
+}
+
+void AttackDetector::clear() {
+    for (size_t i = 0; i < ATTACK_DETECTOR_KEY_CAPACITY; i++) {
+        keys[i].kind = COUNTER_NONE;
+    }
+    for (size_t i = 0; i < ATTACK_DETECTOR_SSID_CAPACITY; i++) {
+        ssids[i].ssid_hash = 0;
+    }
+    Totals* totals[] = { &deauth_total, &new_bssids, &probe_total };
+    for (Totals* t : totals) {
+        t->counter.reset(0);
+        t->alerted_us = INT64_MIN;
+    }
+    stats = AttackDetectorStats();
+    publish_stats();
+}
+
+AttackDetector::KeyEntry* AttackDetector::find_key(CounterKind kind, const uint8_t* mac, int64_t now_us,
+                                                   bool* created) {
+    KeyEntry* set = &keys[set_index(mac_hash(mac, kind), KEY_SETS) * ATTACK_DETECTOR_WAYS];
+    KeyEntry* victim = nullptr;
+    for (size_t way = 0; way < ATTACK_DETECTOR_WAYS; way++) {
+        KeyEntry* entry = &set[way];
+        if (entry->kind == kind && mac_equal(entry->mac, mac)) {
+            *created = false;
+            return entry;
+        }
+        // An unused entry, else the one heard from longest ago
+        if (victim == nullptr || (victim->kind != COUNTER_NONE &&
+                                  (entry->kind == COUNTER_NONE || entry->last_us < victim->last_us))) {
+            victim = entry;
+        }
+    }
+
+    if (victim->kind != COUNTER_NONE && now_us - victim->last_us < window_us) {
+        stats.evictions++;
+    }
+    memcpy(victim->mac, mac, 6);
+    victim->kind = kind;
+    victim->last_us = now_us;
+    victim->alerted_us = INT64_MIN;
+    victim->counter.reset(now_us);
+    *created = true;
+    return victim;
+}
+
+bool AttackDetector::raise(AttackAlert& alert, int64_t* alerted_us, int64_t now_us,
+                           attack_alert_cb_t on_alert, void* ctx) {
+    if (*alerted_us != INT64_MIN && now_us - *alerted_us < (int64_t)cfg.holdoff_ms * 1000) {
+        stats.suppressed++;
+        return false;
+    }
+    *alerted_us = now_us;
+    stats.alerts[alert.kind]++;
+    if (on_alert) {
+        on_alert(alert, ctx);
+    }
+    return true;
+}
+
+size_t AttackDetector::update(const ParsedFrame& frame, int8_t rssi, uint8_t channel, int64_t now_us,
+                              attack_alert_cb_t on_alert, void* ctx) {
+    if (frame.type != IEEE80211_TYPE_MGMT || frame.transmitter == nullptr) {
+        return 0;
+    }
+
+    AttackAlert alert;
+    memset(&alert, 0, sizeof(alert));
+    alert.rssi = rssi;
+    alert.channel = frame.ds_channel ? frame.ds_channel : channel;
+    alert.timestamp_us = now_us;
+
+    size_t raised = 0;
+    switch (frame.subtype) {
+        case IEEE80211_MGMT_DEAUTH:
+        case IEEE80211_MGMT_DISASSOC:
+            raised = check_deauth(frame, alert, now_us, on_alert, ctx);
+            break;
+        case IEEE80211_MGMT_BEACON:
+            raised = check_beacon(frame, alert, now_us, on_alert, ctx);
+            raised += check_twin(frame, alert, now_us, on_alert, ctx);
+            break;
+        case IEEE80211_MGMT_PROBE_RESP:
+            raised = check_twin(frame, alert, now_us, on_alert, ctx);
+            break;
+        case IEEE80211_MGMT_PROBE_REQ:
+            raised = check_probe(frame, alert, now_us, on_alert, ctx);
+            break;
+        default:
+            break;
+    }
+    stats.frames++;
+    publish_stats();
+    return raised;
+}
+
+size_t AttackDetector::check_deauth(const ParsedFrame& frame, AttackAlert& alert, int64_t now_us,
+                                    attack_alert_cb_t on_alert, void* ctx) {
+    size_t raised = 0;
+    const uint8_t* key = mac_usable(frame.bssid) ? frame.bssid : frame.transmitter;
+    alert.kind = ATTACK_DEAUTH_FLOOD;
+    alert.detail = frame.reason_code;
+
+    bool created;
+    KeyEntry* entry = find_key(COUNTER_DEAUTH, key, now_us, &created);
+    entry->last_us = now_us;
+    uint32_t count = entry->counter.add(now_us, bucket_us);
+    if (cfg.deauth_threshold && count >= cfg.deauth_threshold) {
+        memcpy(alert.mac, frame.transmitter, 6);
+        memcpy(alert.bssid, frame.bssid ? frame.bssid : zero_mac, 6);
+        alert.count = (uint16_t)count;
+        raised += raise(alert, &entry->alerted_us, now_us, on_alert, ctx);
+    }
+
+    // Floods with a random address per frame only add up overall
+    count = deauth_total.counter.add(now_us, bucket_us);
+    if (cfg.deauth_total_threshold && count >= cfg.deauth_total_threshold) {
+        memcpy(alert.mac, zero_mac, 6);
+        memcpy(alert.bssid, zero_mac, 6);
+        alert.count = (uint16_t)count;
+        raised += raise(alert, &deauth_total.alerted_us, now_us, on_alert, ctx);
+    }
+    return raised;
+}
+
+size_t AttackDetector::check_beacon(const ParsedFrame& frame, AttackAlert& alert, int64_t now_us,
+                                    attack_alert_cb_t on_alert, void* ctx) {
+    if (!mac_usable(frame.bssid)) {
+        return 0;
+    }
+    size_t raised = 0;
+    alert.kind = ATTACK_BEACON_FLOOD;
+
+    bool created;
+    KeyEntry* entry = find_key(COUNTER_BEACON, frame.bssid, now_us, &created);
+    entry->last_us = now_us;
+    uint32_t count = entry->counter.add(now_us, bucket_us);
+    if (cfg.beacon_threshold && count >= cfg.beacon_threshold) {
+        memcpy(alert.mac, frame.transmitter, 6);
+        memcpy(alert.bssid, frame.bssid, 6);
+        alert.count = (uint16_t)count;
+        raised += raise(alert, &entry->alerted_us, now_us, on_alert, ctx);
+    }
+
+    // BSSIDs the table did not know; known APs stay put while there is room
+    if (created) {
+        count = new_bssids.counter.add(now_us, bucket_us);
+        if (cfg.new_bssid_threshold && count >= cfg.new_bssid_threshold) {
+            memcpy(alert.mac, zero_mac, 6);
+            memcpy(alert.bssid, zero_mac, 6);
+            alert.count = (uint16_t)count;
+            raised += raise(alert, &new_bssids.alerted_us, now_us, on_alert, ctx);
+        }
+    }
+    return raised;
+}
+
+size_t AttackDetector::check_twin(const ParsedFrame& frame, AttackAlert& alert, int64_t now_us,
+                                  attack_alert_cb_t on_alert, void* ctx) {
+    if (!mac_usable(frame.bssid) || ssid_hidden(frame.ssid)) {
+        return 0;
+    }
+    uint32_t hash = ssid_hash(frame.ssid);
+    uint8_t security = attack_security_class(frame);
+
+    SsidEntry* set = &ssids[set_index(hash, SSID_SETS) * ATTACK_DETECTOR_WAYS];
+    SsidEntry* victim = nullptr;
+    for (size_t way = 0; way < ATTACK_DETECTOR_WAYS; way++) {
+        SsidEntry* entry = &set[way];
+        if (entry->ssid_hash == hash && entry->ssid_len == frame.ssid.len &&
+            memcmp(entry->ssid, frame.ssid.data, frame.ssid.len) == 0) {
+            if (mac_equal(entry->bssid, frame.bssid)) {
+                // A truncated frame may have lost its security elements
+                if (!frame.ies_truncated) {
+                    entry->security = security;
+                }
+                entry->last_us = now_us;
+                return 0;
+            }
+            if (frame.ies_truncated || security == entry->security) {
+                return 0;
+            }
+            alert.kind = ATTACK_EVIL_TWIN;
+            memcpy(alert.mac, frame.bssid, 6);
+            memcpy(alert.bssid, entry->bssid, 6);
+            alert.count = 1;
+            alert.detail = (uint16_t)(security << 8 | entry->security);
+            return raise(alert, &entry->alerted_us, now_us, on_alert, ctx) ? 1 : 0;
+        }
+        if (victim == nullptr || (victim->ssid_hash != 0 &&
+                                  (entry->ssid_hash == 0 || entry->last_us < victim->last_us))) {
+            victim = entry;
+        }
+    }
+
+    if (victim->ssid_hash != 0 && now_us - victim->last_us < window_us) {
+        stats.evictions++;
+    }
+    victim->ssid_hash = hash;
+    victim->ssid_len = (uint8_t)frame.ssid.len;
+    memcpy(victim->ssid, frame.ssid.data, frame.ssid.len);
+    memcpy(victim->bssid, frame.bssid, 6);
+    victim->security = security;
+    victim->last_us = now_us;
+    victim->alerted_us = INT64_MIN;
+    return 0;
+}
+
+size_t AttackDetector::check_probe(const ParsedFrame& frame, AttackAlert& alert, int64_t now_us,
+                                   attack_alert_cb_t on_alert, void* ctx) {
+    size_t raised = 0;
+    alert.kind = ATTACK_PROBE_STORM;
+
+    if (mac_usable(frame.transmitter)) {
+        bool created;
+        KeyEntry* entry = find_key(COUNTER_PROBE, frame.transmitter, now_us, &created);
+        entry->last_us = now_us;
+        uint32_t count = entry->counter.add(now_us, bucket_us);
+        if (cfg.probe_threshold && count >= cfg.probe_threshold) {
+            memcpy(alert.mac, frame.transmitter, 6);
+            memcpy(alert.bssid, frame.bssid ? frame.bssid : zero_mac, 6);
+            alert.count = (uint16_t)count;
+            raised += raise(alert, &entry->alerted_us, now_us, on_alert, ctx);
+        }
+    }
+
+    uint32_t count = probe_total.counter.add(now_us, bucket_us);
+    if (cfg.probe_total_threshold && count >= cfg.probe_total_threshold) {
+        memcpy(alert.mac, zero_mac, 6);
+        memcpy(alert.bssid, zero_mac, 6);
+        alert.count = (uint16_t)count;
+        raised += raise(alert, &probe_total.alerted_us, now_us, on_alert, ctx);
+    }
+    return raised;
+}
+
+void AttackDetector::publish_stats() {
+    const uint32_t* words = reinterpret_cast<const uint32_t*>(&stats);
+    for (size_t i = 0; i < sizeof(published) / sizeof(published[0]); i++) {
+        published[i].store(words[i], std::memory_order_relaxed);
+    }
+}
+
+AttackDetectorStats AttackDetector::get_stats() const {
+    AttackDetectorStats copy;
+    uint32_t* words = reinterpret_cast<uint32_t*>(&copy);
+    for (size_t i = 0; i < sizeof(published) / sizeof(published[0]); i++) {
+        words[i] = published[i].load(std::memory_order_relaxed);
+    }
+    return copy;
+}
+
+size_t attack_alert_encode(const AttackAlert& alert, uint8_t* out, size_t capacity) {
+    if (capacity < ATTACK_ALERT_SIZE) {
+        return 0;
+    }
+    int rssi = alert.rssi < 0 ? -alert.rssi : 0;
+    uint32_t timestamp = (uint32_t)alert.timestamp_us;
+    out[0] = ATTACK_ALERT_MAGIC;
+    out[1] = ATTACK_ALERT_VERSION;
+    out[2] = (uint8_t)alert.kind;
+    out[3] = alert.channel;
+    out[4] = (uint8_t)(rssi > 255 ? 255 : rssi);
+    out[5] = (uint8_t)alert.count;
+    out[6] = (uint8_t)(alert.count >> 8);
+    out[7] = (uint8_t)alert.detail;
+    out[8] = (uint8_t)(alert.detail >> 8);
+    memcpy(out + 9, alert.mac, 6);
+    memcpy(out + 15, alert.bssid, 6);
+    out[21] = (uint8_t)timestamp;
+    out[22] = (uint8_t)(timestamp >> 8);
+    out[23] = (uint8_t)(timestamp >> 16);
+    out[24] = (uint8_t)(timestamp >> 24);
+    return ATTACK_ALERT_SIZE;
+}
@@ -0,0 +1,218 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include "ieee80211_parser.h"
+
+// Counters tracked at once, per (kind, address) and per SSID. Tables are
+// 4-way set associative; capacities must be powers of two.
+#ifndef ATTACK_DETECTOR_KEY_CAPACITY
+#define ATTACK_DETECTOR_KEY_CAPACITY    256
+#endif
+#ifndef ATTACK_DETECTOR_SSID_CAPACITY
+#define ATTACK_DETECTOR_SSID_CAPACITY   128
+#endif
+#define ATTACK_DETECTOR_WAYS            4
+
+// Buckets a sliding window is split into; counts age out one bucket at a time
+#define ATTACK_DETECTOR_BUCKETS         8
+
+enum AttackKind {
+    ATTACK_DEAUTH_FLOOD = 1,    // Deauthentication/disassociation frames of one BSSID, or of all
+    ATTACK_BEACON_FLOOD,        // Beacons of one BSSID too fast, or too many new BSSIDs
+    ATTACK_EVIL_TWIN,           // An SSID advertised by another BSSID with other security
+    ATTACK_PROBE_STORM,         // Probe requests of one station, or of all
+};
+
+// Security class of an SSID's advertisement, compared by the evil twin check
+#define ATTACK_SECURITY_OPEN    0
+#define ATTACK_SECURITY_WEP     1
+#define ATTACK_SECURITY_WPA     2
+#define ATTACK_SECURITY_RSN     3
+
+// One alert. An all-zero `mac` means the count is over all addresses.
+struct AttackAlert {
+    AttackKind kind;
+    uint8_t mac[6];             // Transmitter: deauth/beacon source, twin BSSID, probing station
+    uint8_t bssid[6];           // BSSID of the frame; for an evil twin, the BSSID first seen with the SSID
+    uint16_t count;             // Frames (or new BSSIDs) in the window when the alert fired
+    uint16_t detail;            // Deauth: reason code. Evil twin: twin << 8 | original ATTACK_SECURITY_x
+    int8_t rssi;
+    uint8_t channel;
+    int64_t timestamp_us;       // Receive time of the frame that raised the alert
+};
+
+typedef void (*attack_alert_cb_t)(const AttackAlert& alert, void* ctx);
+
+struct AttackDetectorConfig {
+    uint32_t window_ms;             // Sliding window of every rate counter
+    uint16_t deauth_threshold;      // Deauth + disassoc frames per BSSID (or transmitter) in a window
+    uint16_t deauth_total_threshold;// Same over all addresses, for floods with random addresses
+    uint16_t beacon_threshold;      // Beacons of one BSSID in a window
+    uint16_t new_bssid_threshold;   // BSSIDs first heard in a window
+    uint16_t probe_threshold;       // Probe requests of one station in a window
+    uint16_t probe_total_threshold; // Same over all stations
+    uint32_t holdoff_ms;            // Least time between two alerts of one kind about one address
+};
+
+// 1 s window; 20 deauths per BSSID or 50 in total, 50 beacons per BSSID or
+// 50 new BSSIDs, 100 probe requests per station or 500 in total; 10 s holdoff
+AttackDetectorConfig attack_detector_default_config();
+
+struct AttackDetectorStats {
+    uint32_t frames;            // Management frames inspected
+    uint32_t alerts[ATTACK_PROBE_STORM + 1];    // Alerts raised, by AttackKind
+    uint32_t suppressed;        // Alerts held back by the holdoff
+    uint32_t evictions;         // Active counters replaced for lack of room
+};
+
+// Rate counter over a sliding window of ATTACK_DETECTOR_BUCKETS buckets.
+// Adding is O(ATTACK_DETECTOR_BUCKETS) at worst, when buckets age out.
+struct WindowCounter {
+    int64_t bucket_start_us;    // Start of buckets[head]
+    uint32_t total;
+    uint16_t buckets[ATTACK_DETECTOR_BUCKETS];
+    uint8_t head;
+
+    void reset(int64_t now_us);
+
+    // Count one event at `now_us`; returns the count in the window
+    uint32_t add(int64_t now_us, int64_t bucket_us);
+};
+
+// Detection of common 802.11 attacks on the management stream.
+//
+// Every management frame updates a handful of sliding-window counters, kept
+// per BSSID, per transmitter and overall: deauthentication/disassociation
+// floods, beacon floods (one BSSID beaconing too fast, or bursts of new
+// BSSIDs), evil twins (an SSID advertised by a second BSSID with different
+// security) and probe request storms. Crossing a threshold raises a compact
+// AttackAlert instead of forwarding frames; an alert is repeated at most
+// once per holdoff while the condition lasts.
+//
+// Counters live in fixed set-associative tables: a lookup touches one set
+// of ATTACK_DETECTOR_WAYS entries, and an address not heard within the
+// window makes room for a new one. Nothing allocates after construction,
+// so the footprint is sizeof(AttackDetector) and the object can be placed
+// anywhere, including PSRAM.
+//
+// Pure logic with no ESP-IDF dependencies; update() must be serialized by the
+// caller, normally by calling it from a frame sink. get_stats() may be called
+// from any task.
+class AttackDetector {
+public:
+    explicit AttackDetector(const AttackDetectorConfig& config = attack_detector_default_config());
+
+    AttackDetector(const AttackDetector&) = delete;
+    AttackDetector& operator=(const AttackDetector&) = delete;
+
+    // Inspect a frame heard at `rssi` on `channel` and received at `now_us`;
+    // alerts go to `on_alert`. Returns the number raised.
+    size_t update(const ParsedFrame& frame, int8_t rssi, uint8_t channel, int64_t now_us,
+                  attack_alert_cb_t on_alert, void* ctx);
+
+    // Forget all counters and holdoffs
+    void clear();
+
+    AttackDetectorStats get_stats() const;
+
+    static constexpr size_t footprint() { return sizeof(AttackDetector); }
+
+private:
+    // Counter kinds sharing the address table
+    enum CounterKind : uint8_t {
+        COUNTER_NONE,
+        COUNTER_DEAUTH,         // Keyed by BSSID, else transmitter
+        COUNTER_BEACON,         // Keyed by BSSID
+        COUNTER_PROBE,          // Keyed by transmitter
+    };
+
+    struct KeyEntry {
+        uint8_t mac[6];
+        CounterKind kind;
+        int64_t last_us;
+        int64_t alerted_us;
+        WindowCounter counter;
+    };
+
+    struct SsidEntry {
+        uint32_t ssid_hash;     // 0 when unused
+        uint8_t bssid[6];       // First BSSID heard with the SSID
+        uint8_t security;       // ATTACK_SECURITY_x it advertised
+        uint8_t ssid_len;
+        uint8_t ssid[IEEE80211_MAX_SSID_LEN];   // Compared once the hashes match
+        int64_t last_us;
+        int64_t alerted_us;
+    };
+
+    struct Totals {
+        WindowCounter counter;
+        int64_t alerted_us;
+    };
+
+    static const size_t KEY_SETS = ATTACK_DETECTOR_KEY_CAPACITY / ATTACK_DETECTOR_WAYS;
+    static const size_t SSID_SETS = ATTACK_DETECTOR_SSID_CAPACITY / ATTACK_DETECTOR_WAYS;
+
+    static_assert((KEY_SETS & (KEY_SETS - 1)) == 0, "ATTACK_DETECTOR_KEY_CAPACITY must be a power of 2");
+    static_assert((SSID_SETS & (SSID_SETS - 1)) == 0, "ATTACK_DETECTOR_SSID_CAPACITY must be a power of 2");
+
+    // Counter of (kind, mac), created if absent; `created` tells which
+    KeyEntry* find_key(CounterKind kind, const uint8_t* mac, int64_t now_us, bool* created);
+
+    // Raise an alert unless one for the same condition is in its holdoff
+    bool raise(AttackAlert& alert, int64_t* alerted_us, int64_t now_us,
+               attack_alert_cb_t on_alert, void* ctx);
+
+    size_t check_deauth(const ParsedFrame& frame, AttackAlert& alert, int64_t now_us,
+                        attack_alert_cb_t on_alert, void* ctx);
+    size_t check_beacon(const ParsedFrame& frame, AttackAlert& alert, int64_t now_us,
+                        attack_alert_cb_t on_alert, void* ctx);
+    size_t check_twin(const ParsedFrame& frame, AttackAlert& alert, int64_t now_us,
+                      attack_alert_cb_t on_alert, void* ctx);
+    size_t check_probe(const ParsedFrame& frame, AttackAlert& alert, int64_t now_us,
+                       attack_alert_cb_t on_alert, void* ctx);
+
+    // Make the counters readable from other tasks
+    void publish_stats();
+
+    AttackDetectorConfig cfg;
+    int64_t bucket_us;
+    int64_t window_us;
+    KeyEntry keys[ATTACK_DETECTOR_KEY_CAPACITY];
+    SsidEntry ssids[ATTACK_DETECTOR_SSID_CAPACITY];
+    Totals deauth_total;
+    Totals new_bssids;
+    Totals probe_total;
+    AttackDetectorStats stats;
+
+    // Copy of `stats` for get_stats(), one word per counter
+    std::atomic<uint32_t> published[sizeof(AttackDetectorStats) / sizeof(uint32_t)];
+};
+
+// Security class (ATTACK_SECURITY_x) of a beacon or probe response
+uint8_t attack_security_class(const ParsedFrame& frame);
+
+// Short name of an alert kind, for logs
+const char* attack_kind_name(AttackKind kind);
+
+// Alerts sent over the BLE link, one per notification, told apart from
+// telemetry by their magic byte:
+//
+//   offset  size  field
+//   0       1     magic (ATTACK_ALERT_MAGIC)
+//   1       1     version (ATTACK_ALERT_VERSION)
+//   2       1     kind (AttackKind)
+//   3       1     channel
+//   4       1     -RSSI
+//   5       2     count, little endian
+//   7       2     detail, little endian
+//   9       6     mac
+//   15      6     bssid
+//   21      4     timestamp (us), little endian, low 32 bits
+#define ATTACK_ALERT_MAGIC      0xA7
+#define ATTACK_ALERT_VERSION    1
+#define ATTACK_ALERT_SIZE       25
+
+// Encode an alert into `out`; returns ATTACK_ALERT_SIZE, or 0 if `capacity` is too small
+size_t attack_alert_encode(const AttackAlert& alert, uint8_t* out, size_t capacity);
@@ -1,50 +1,271 @@
 #include "bluetooth_comm.h"
 #include "esp_log.h"
 #include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_bt.h"
+#include "esp_bt_main.h"
+#include "esp_gap_ble_api.h"
+#include "esp_gatts_api.h"
+#include "esp_gatt_common_api.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
+#include "pipeline_runtime.h"
+#include <new>
 #include <string.h>
 
 const char* BluetoothComm::TAG = "BLUETOOTH_COMM";
 
-BluetoothComm::BluetoothComm() 
-    : device_name("ESP32_Sniffer"), connected(false), conn_id(0), 
-      service_handle(0), char_handle(0), gatts_if(0) {
+BluetoothComm* BluetoothComm::active_instance = nullptr;
+
+#define SNIFFER_APP_ID          0x55
+
+// Attribute table layout
+enum {
+    SNIFFER_IDX_SVC,
+    SNIFFER_IDX_CHAR_DECL,
+    SNIFFER_IDX_CHAR_VALUE,
+    SNIFFER_IDX_CHAR_CCCD,
+    SNIFFER_IDX_COUNT,
+};
+
+static const uint16_t primary_service_uuid = ESP_GATT_UUID_PRI_SERVICE;
+static const uint16_t char_declaration_uuid = ESP_GATT_UUID_CHAR_DECLARE;
+static const uint16_t char_client_config_uuid = ESP_GATT_UUID_CHAR_CLIENT_CONFIG;
+static const uint16_t sniffer_service_uuid = SNIFFER_SERVICE_UUID;
+static const uint16_t sniffer_char_uuid = SNIFFER_CHAR_UUID;
+static const uint8_t sniffer_char_props = ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_WRITE |
+                                          ESP_GATT_CHAR_PROP_BIT_NOTIFY;
+static const uint8_t sniffer_char_initial[1] = { 0 };
+static const uint8_t sniffer_cccd_initial[2] = { 0, 0 };
+
+static const esp_gatts_attr_db_t sniffer_gatt_db[SNIFFER_IDX_COUNT] = {
+    // Service declaration
+    {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t*)&primary_service_uuid, ESP_GATT_PERM_READ,
+      sizeof(uint16_t), sizeof(sniffer_service_uuid), (uint8_t*)&sniffer_service_uuid}},
+
+    // Characteristic declaration
+    {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t*)&char_declaration_uuid, ESP_GATT_PERM_READ,
+      sizeof(uint8_t), sizeof(uint8_t), (uint8_t*)&sniffer_char_props}},
+
+    // Characteristic value carrying notifications, and commands written by the app
+    {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t*)&sniffer_char_uuid, ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE,
+      TX_QUEUE_MAX_MESSAGE, sizeof(sniffer_char_initial), (uint8_t*)sniffer_char_initial}},
+
+    // Client characteristic configuration (notification enable)
+    {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t*)&char_client_config_uuid,
+      ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE,
+      sizeof(uint16_t), sizeof(sniffer_cccd_initial), (uint8_t*)sniffer_cccd_initial}},
+};
+
+static esp_ble_adv_data_t sniffer_adv_data = {
+    .set_scan_rsp = false,
+    .include_name = true,
+    .include_txpower = false,
+    .min_interval = 0x0006,
+    .max_interval = 0x0010,
+    .appearance = 0x00,
+    .manufacturer_len = 0,
+    .p_manufacturer_data = nullptr,
+    .service_data_len = 0,
+    .p_service_data = nullptr,
+    .service_uuid_len = 0,
+    .p_service_uuid = nullptr,
+    .flag = (ESP_BLE_ADV_FLAG_GEN_DISC | ESP_BLE_ADV_FLAG_BREDR_NOT_SPT),
+};
+
+static esp_ble_adv_params_t sniffer_adv_params = {
+    .adv_int_min = 0x20,
+    .adv_int_max = 0x40,
+    .adv_type = ADV_TYPE_IND,
+    .own_addr_type = BLE_ADDR_TYPE_PUBLIC,
+    .peer_addr = {0},
+    .peer_addr_type = BLE_ADDR_TYPE_PUBLIC,
+    .channel_map = ADV_CHNL_ALL,
+    .adv_filter_policy = ADV_FILTER_ALLOW_SCAN_ANY_CON_ANY,
+};
+
+// TxQueue critical section backed by a FreeRTOS spinlock
+class MuxTxLock : public TxLock {
+public:
+    MuxTxLock() : mux(portMUX_INITIALIZER_UNLOCKED) {}
+    void lock() override { portENTER_CRITICAL(&mux); }
+    void unlock() override { portEXIT_CRITICAL(&mux); }
+
+private:
+    portMUX_TYPE mux;
+};
+
+// Sends queued messages as GATT notifications on the sniffer characteristic
+class GattNotifyTransport : public TxTransport {
+public:
+    GattNotifyTransport() : gatts_if(ESP_GATT_IF_NONE), conn_id(0), attr_handle(0), max_len(0) {}
+
+    void bind(esp_gatt_if_t iface, uint16_t conn, uint16_t handle, size_t mtu_payload) {
+        gatts_if = iface;
+        conn_id = conn;
+        attr_handle = handle;
+        max_len = mtu_payload;
+    }
+
+    tx_result_t send(const uint8_t* data, size_t len) override {
+        if (len > max_len) {
+            return TX_FAILED;
+        }
+        esp_err_t ret = esp_ble_gatts_send_indicate(gatts_if, conn_id, attr_handle,
+                                                    (uint16_t)len, (uint8_t*)data, false);
+        // The host stack refuses notifications while its buffers are full
+        return ret == ESP_OK ? TX_SENT : TX_BUSY;
+    }
+
+private:
+    esp_gatt_if_t gatts_if;
+    uint16_t conn_id;
+    uint16_t attr_handle;
+    size_t max_len;
+};
+
+BluetoothComm::BluetoothComm()
+    : device_name("ESP32_Sniffer"), connected(false), notify_enabled(false), conn_id(0),
+      advertising_requested(false), service_handle(0), char_handle(0), cccd_handle(0),
+      gatts_if(ESP_GATT_IF_NONE), tx_lock(nullptr), tx_queue(nullptr), transport(nullptr),
+      tx_pump(nullptr), tx_task_handle(nullptr), link_events(0), link_congested(false),
+      telemetry(DEFAULT_MTU - 3), telemetry_stats(), flush_timer(nullptr), mtu(DEFAULT_MTU), batch_cap(0),
+      command_handler(nullptr), command_ctx(nullptr) {
     memset(&remote_addr, 0, sizeof(remote_addr));
-    data_queue = xQueueCreate(10, sizeof(uint8_t*));
+    telemetry_lock = xSemaphoreCreateMutex();
 }
 
 BluetoothComm::~BluetoothComm() {
-    if (data_queue) {
-        vQueueDelete(data_queue);
+    if (flush_timer) {
+        xTimerDelete(flush_timer, portMAX_DELAY);
+    }
+    if (tx_task_handle) {
+        pipeline_unregister_task(tx_task_handle);
+        vTaskDelete(tx_task_handle);
+    }
+    if (active_instance == this) {
+        active_instance = nullptr;
+    }
+    delete tx_pump;
+    delete transport;
+    delete tx_queue;
+    delete tx_lock;
+    if (telemetry_lock) {
+        vSemaphoreDelete(telemetry_lock);
     }
 }
 
 esp_err_t BluetoothComm::init() {
-    ESP_LOGI(TAG, "Initializing Bluetooth communication (simplified version)");
-    
-    // For now, just log that Bluetooth is initialized
-    // In a full implementation, this would initialize the Bluetooth stack
+    ESP_LOGI(TAG, "Initializing Bluetooth communication");
+
+    // Outgoing path: bounded queue, pump and the task driving it
+    tx_lock = new (std::nothrow) MuxTxLock();
+    tx_queue = tx_lock ? new (std::nothrow) TxQueue(TX_QUEUE_BUDGET, tx_lock) : nullptr;
+    transport = new (std::nothrow) GattNotifyTransport();
+    tx_pump = (tx_queue && transport) ? new (std::nothrow) TxPump(*tx_queue, *transport) : nullptr;
+    if (tx_pump == nullptr || !tx_queue->valid() || telemetry_lock == nullptr) {
+        ESP_LOGE(TAG, "Failed to allocate transmit queue");
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Periodic flush so partial telemetry batches never wait long
+    flush_timer = xTimerCreate("bt_flush", pdMS_TO_TICKS(TELEMETRY_FLUSH_MS), pdTRUE,
+                               this, &BluetoothComm::flush_timer_callback);
+    if (flush_timer == nullptr) {
+        ESP_LOGE(TAG, "Failed to create telemetry flush timer");
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (pipeline_create_task(PIPELINE_STAGE_EXPORT, &BluetoothComm::tx_task, "bt_tx", TX_TASK_STACK, this,
+                             TX_TASK_PRIORITY, &tx_task_handle) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create TX task");
+        return ESP_ERR_NO_MEM;
+    }
+
+    active_instance = this;
+
+    // BLE only: give the Classic BT controller memory back to the heap
+    ESP_ERROR_CHECK(esp_bt_controller_mem_release(ESP_BT_MODE_CLASSIC_BT));
+
+    esp_bt_controller_config_t bt_cfg = BT_CONTROLLER_INIT_CONFIG_DEFAULT();
+    esp_err_t ret = esp_bt_controller_init(&bt_cfg);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Controller init failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    ret = esp_bt_controller_enable(ESP_BT_MODE_BLE);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Controller enable failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    ret = esp_bluedroid_init();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Bluedroid init failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    ret = esp_bluedroid_enable();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Bluedroid enable failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    // The callbacks need the real Bluedroid signatures; forward to the opaque handlers
+    ESP_ERROR_CHECK(esp_ble_gatts_register_callback(
+        [](esp_gatts_cb_event_t event, esp_gatt_if_t iface, esp_ble_gatts_cb_param_t* param) {
+            gatts_event_handler(event, iface, param);
+        }));
+    ESP_ERROR_CHECK(esp_ble_gap_register_callback(
+        [](esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t* param) {
+            gap_event_handler(event, param);
+        }));
+    ESP_ERROR_CHECK(esp_ble_gatts_app_register(SNIFFER_APP_ID));
+
+    ret = esp_ble_gatt_set_local_mtu(LOCAL_MTU);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to set local MTU: %s", esp_err_to_name(ret));
+    }
+
+    xTimerStart(flush_timer, portMAX_DELAY);
+
     ESP_LOGI(TAG, "Bluetooth communication initialized successfully");
     return ESP_OK;
 }
 
 esp_err_t BluetoothComm::start_advertising() {
-    ESP_LOGI(TAG, "Starting BLE advertising (simplified version)");
-    
-    // For now, just log that advertising would start
-    // In a full implementation, this would start BLE advertising
-    ESP_LOGI(TAG, "BLE advertising started (simulated)");
-    return ESP_OK;
+    ESP_LOGI(TAG, "Starting BLE advertising as '%s'", device_name.c_str());
+    advertising_requested = true;
+
+    // Before the GATT app is registered, the registration event picks this up
+    if (gatts_if == ESP_GATT_IF_NONE) {
+        return ESP_OK;
+    }
+    return configure_advertising();
 }
 
 esp_err_t BluetoothComm::stop_advertising() {
-    ESP_LOGI(TAG, "Stopping BLE advertising (simplified version)");
-    
-    // For now, just log that advertising would stop
-    ESP_LOGI(TAG, "BLE advertising stopped (simulated)");
-    return ESP_OK;
+    ESP_LOGI(TAG, "Stopping BLE advertising");
+    advertising_requested = false;
+
+    if (gatts_if == ESP_GATT_IF_NONE) {
+        return ESP_OK;
+    }
+    return esp_ble_gap_stop_advertising();
+}
+
+esp_err_t BluetoothComm::configure_advertising() {
+    esp_err_t ret = esp_ble_gap_set_device_name(device_name.c_str());
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to set device name: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    // Advertising itself starts on ESP_GAP_BLE_ADV_DATA_SET_COMPLETE_EVT
+    ret = esp_ble_gap_config_adv_data(&sniffer_adv_data);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to configure advertising data: %s", esp_err_to_name(ret));
+    }
+    return ret;
 }
 
 esp_err_t BluetoothComm::send_data(const uint8_t* data, size_t len) {
@@ -52,30 +273,206 @@ esp_err_t BluetoothComm::send_data(const uint8_t* data, size_t len) {
         ESP_LOGW(TAG, "Not connected, cannot send data");
         return ESP_ERR_INVALID_STATE;
     }
-    
-    // For now, just log the data that would be sent
-    ESP_LOGI(TAG, "Would send %d bytes via Bluetooth", len);
-    
-    // Log first few bytes for debugging
-    if (len > 0) {
-        ESP_LOG_BUFFER_HEX(TAG, data, len > 16 ? 16 : len);
+
+    // Split into notification-sized chunks, queued together or not at all so
+    // that a full queue never leaves a truncated message behind; control
+    // traffic is never shed
+    if (!tx_queue->push_split(data, len, mtu - 3, TX_PRIORITY_CONTROL)) {
+        return ESP_ERR_NO_MEM;
     }
-    
+    xTaskNotifyGive(tx_task_handle);
+
     return ESP_OK;
 }
 
 esp_err_t BluetoothComm::send_packet_info(uint8_t channel, int8_t rssi, uint16_t length, uint8_t packet_type) {
+    return send_packet_info(channel, rssi, length, packet_type, esp_timer_get_time());
+}
+
+esp_err_t BluetoothComm::send_packet_info(uint8_t channel, int8_t rssi, uint16_t length, uint8_t packet_type,
+                                          int64_t timestamp_us) {
+    TelemetryRecord record = {};
+    record.timestamp_us = (uint32_t)timestamp_us;
+    record.length = length;
+    record.rssi = rssi;
+    record.channel = channel;
+    record.type = packet_type;
+    return send_packet_record(record);
+}
+
+esp_err_t BluetoothComm::send_packet_record(const TelemetryRecord& record) {
     if (!connected) {
         return ESP_ERR_INVALID_STATE;
     }
-    
-    // For now, just log the packet info that would be sent
-    ESP_LOGI(TAG, "Would send packet info: Channel=%d, RSSI=%d, Length=%d, Type=%d",
-             channel, rssi, length, packet_type);
-    
+
+    esp_err_t ret = ESP_OK;
+    xSemaphoreTake(telemetry_lock, portMAX_DELAY);
+    if (!telemetry.append(record)) {
+        // Batch is full: ship it and start the next one with this record
+        ret = send_pending_batch();
+        telemetry.append(record);
+    }
+    telemetry_stats.records++;
+
+    // Ship as soon as another record might not fit
+    if (telemetry.size() + TELEMETRY_MAX_RECORD_SIZE > telemetry.batch_limit()) {
+        ret = send_pending_batch();
+    }
+    xSemaphoreGive(telemetry_lock);
+
+    return ret;
+}
+
+esp_err_t BluetoothComm::flush_telemetry() {
+    xSemaphoreTake(telemetry_lock, portMAX_DELAY);
+    esp_err_t ret = send_pending_batch();
+    xSemaphoreGive(telemetry_lock);
+    return ret;
+}
+
+esp_err_t BluetoothComm::send_pending_batch() {
+    const uint8_t* batch;
+    size_t len = telemetry.finish(&batch);
+    if (len == 0) {
+        return ESP_OK;
+    }
+
+    // Telemetry is sheddable: under backpressure the oldest batches go first
+    if (!connected || !tx_queue->push(batch, len, TX_PRIORITY_TELEMETRY)) {
+        telemetry_stats.send_failures++;
+        return ESP_ERR_NO_MEM;
+    }
+    telemetry_stats.batches++;
+    telemetry_stats.bytes += len;
+    xTaskNotifyGive(tx_task_handle);
+    return ESP_OK;
+}
+
+void BluetoothComm::flush_timer_callback(TimerHandle_t timer) {
+    BluetoothComm* comm = static_cast<BluetoothComm*>(pvTimerGetTimerID(timer));
+
+    // Never block the timer service task; a busy lock means a send is in progress
+    if (xSemaphoreTake(comm->telemetry_lock, 0) == pdTRUE) {
+        if (!comm->telemetry.empty()) {
+            comm->send_pending_batch();
+        }
+        xSemaphoreGive(comm->telemetry_lock);
+    }
+}
+
+void BluetoothComm::tx_task(void* arg) {
+    BluetoothComm* comm = static_cast<BluetoothComm*>(arg);
+
+    while (1) {
+        // Woken by new messages and by the end of congestion; the timeout
+        // retries sends the host stack refused while busy
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(20));
+
+        comm->apply_link_events();
+        if (!comm->connected || !comm->notify_enabled) {
+            continue;
+        }
+        comm->tx_pump->set_congested(comm->link_congested);
+        comm->tx_pump->pump(SIZE_MAX);
+    }
+}
+
+void BluetoothComm::post_link_event(uint32_t event) {
+    link_events.fetch_or(event);
+    if (tx_task_handle) {
+        xTaskNotifyGive(tx_task_handle);
+    }
+}
+
+void BluetoothComm::apply_link_events() {
+    uint32_t events = link_events.exchange(0);
+    if (events & LINK_EVENT_RESET) {
+        // The message in flight belonged to the old connection
+        tx_pump->discard_pending();
+    }
+    if (events & LINK_EVENT_REBIND) {
+        transport->bind(gatts_if, conn_id, char_handle, mtu - 3);
+    }
+}
+
+void BluetoothComm::set_mtu(uint16_t new_mtu) {
+    if (new_mtu < DEFAULT_MTU) {
+        new_mtu = DEFAULT_MTU;
+    }
+    if (new_mtu > TX_QUEUE_MAX_MESSAGE + 3) {
+        new_mtu = TX_QUEUE_MAX_MESSAGE + 3;
+    }
+    mtu = new_mtu;
+    update_batch_limit();
+    post_link_event(LINK_EVENT_REBIND);
+    ESP_LOGI(TAG, "MTU set to %d, telemetry batches up to %d bytes", new_mtu, new_mtu - 3);
+}
+
+uint16_t BluetoothComm::get_mtu() const {
+    return mtu;
+}
+
+void BluetoothComm::update_batch_limit() {
+    size_t limit = mtu - 3;
+    uint16_t cap = batch_cap;
+    if (cap && cap < limit) {
+        limit = cap;
+    }
+    xSemaphoreTake(telemetry_lock, portMAX_DELAY);
+    telemetry.set_batch_limit(limit);
+    xSemaphoreGive(telemetry_lock);
+}
+
+void BluetoothComm::set_telemetry_batch_limit(uint16_t bytes) {
+    // Smaller batches could not hold a single record
+    if (bytes && bytes < TELEMETRY_HEADER_SIZE + TELEMETRY_MAX_RECORD_SIZE) {
+        bytes = TELEMETRY_HEADER_SIZE + TELEMETRY_MAX_RECORD_SIZE;
+    }
+    batch_cap = bytes;
+    update_batch_limit();
+    ESP_LOGI(TAG, "Telemetry batch cap set to %d bytes", bytes);
+}
+
+esp_err_t BluetoothComm::set_telemetry_flush_ms(uint32_t ms) {
+    if (flush_timer == nullptr || ms == 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (xTimerChangePeriod(flush_timer, pdMS_TO_TICKS(ms), pdMS_TO_TICKS(100)) != pdPASS) {
+        return ESP_ERR_TIMEOUT;
+    }
+    ESP_LOGI(TAG, "Telemetry flush interval set to %lu ms", ms);
     return ESP_OK;
 }
 
+void BluetoothComm::set_tx_queue_budget(size_t bytes) {
+    if (tx_queue) {
+        tx_queue->set_byte_budget(bytes);
+        ESP_LOGI(TAG, "Transmit queue budget set to %lu bytes", tx_queue->stats().byte_budget);
+    }
+}
+
+void BluetoothComm::set_command_handler(bt_command_cb_t handler, void* ctx) {
+    command_ctx = ctx;
+    command_handler = handler;
+}
+
+TelemetryStats BluetoothComm::get_telemetry_stats() const {
+    xSemaphoreTake(telemetry_lock, portMAX_DELAY);
+    TelemetryStats stats = telemetry_stats;
+    xSemaphoreGive(telemetry_lock);
+    return stats;
+}
+
+BluetoothTxStats BluetoothComm::get_tx_stats() const {
+    BluetoothTxStats stats = {};
+    if (tx_queue) {
+        stats.queue = tx_queue->stats();
+        stats.pump = tx_pump->stats();
+        stats.congested = link_congested;
+    }
+    return stats;
+}
+
 bool BluetoothComm::is_connected() const {
     return connected;
 }
@@ -83,4 +480,128 @@ bool BluetoothComm::is_connected() const {
 void BluetoothComm::set_device_name(const std::string& name) {
     device_name = name;
     ESP_LOGI(TAG, "Device name set to: %s", device_name.c_str());
-} 
\ No newline at end of file
+
+    if (gatts_if != ESP_GATT_IF_NONE) {
+        esp_ble_gap_set_device_name(device_name.c_str());
+    }
+}
+
+void BluetoothComm::gap_event_handler(int event, void* arg) {
+    BluetoothComm* comm = active_instance;
+    esp_ble_gap_cb_param_t* param = static_cast<esp_ble_gap_cb_param_t*>(arg);
+    if (comm == nullptr) {
+        return;
+    }
+
+    switch (event) {
+        case ESP_GAP_BLE_ADV_DATA_SET_COMPLETE_EVT:
+            if (comm->advertising_requested) {
+                esp_ble_gap_start_advertising(&sniffer_adv_params);
+            }
+            break;
+        case ESP_GAP_BLE_ADV_START_COMPLETE_EVT:
+            if (param->adv_start_cmpl.status == ESP_BT_STATUS_SUCCESS) {
+                ESP_LOGI(TAG, "BLE advertising started");
+            } else {
+                ESP_LOGE(TAG, "BLE advertising failed to start: %d", param->adv_start_cmpl.status);
+            }
+            break;
+        case ESP_GAP_BLE_ADV_STOP_COMPLETE_EVT:
+            ESP_LOGI(TAG, "BLE advertising stopped");
+            break;
+        default:
+            break;
+    }
+}
+
+void BluetoothComm::gatts_event_handler(int event, esp_gatt_if_t iface, void* arg) {
+    BluetoothComm* comm = active_instance;
+    esp_ble_gatts_cb_param_t* param = static_cast<esp_ble_gatts_cb_param_t*>(arg);
+    if (comm == nullptr) {
+        return;
+    }
+
+    switch (event) {
+        case ESP_GATTS_REG_EVT:
+            if (param->reg.status != ESP_GATT_OK) {
+                ESP_LOGE(TAG, "GATT app registration failed: %d", param->reg.status);
+                break;
+            }
+            comm->gatts_if = iface;
+            esp_ble_gatts_create_attr_tab(sniffer_gatt_db, iface, SNIFFER_IDX_COUNT, 0);
+            if (comm->advertising_requested) {
+                comm->configure_advertising();
+            }
+            break;
+
+        case ESP_GATTS_CREAT_ATTR_TAB_EVT:
+            if (param->add_attr_tab.status != ESP_GATT_OK ||
+                param->add_attr_tab.num_handle != SNIFFER_IDX_COUNT) {
+                ESP_LOGE(TAG, "Failed to create attribute table: %d", param->add_attr_tab.status);
+                break;
+            }
+            comm->service_handle = param->add_attr_tab.handles[SNIFFER_IDX_SVC];
+            comm->char_handle = param->add_attr_tab.handles[SNIFFER_IDX_CHAR_VALUE];
+            comm->cccd_handle = param->add_attr_tab.handles[SNIFFER_IDX_CHAR_CCCD];
+            esp_ble_gatts_start_service(comm->service_handle);
+            break;
+
+        case ESP_GATTS_CONNECT_EVT:
+            comm->conn_id = param->connect.conn_id;
+            memcpy(comm->remote_addr, param->connect.remote_bda, sizeof(comm->remote_addr));
+            comm->set_mtu(DEFAULT_MTU);
+            comm->connected = true;
+            ESP_LOGI(TAG, "Client connected: %02x:%02x:%02x:%02x:%02x:%02x",
+                     comm->remote_addr[0], comm->remote_addr[1], comm->remote_addr[2],
+                     comm->remote_addr[3], comm->remote_addr[4], comm->remote_addr[5]);
+            break;
+
+        case ESP_GATTS_DISCONNECT_EVT:
+            ESP_LOGI(TAG, "Client disconnected, reason 0x%x", param->disconnect.reason);
+            comm->connected = false;
+            comm->notify_enabled = false;
+            comm->link_congested = false;
+            comm->tx_queue->clear();
+            comm->post_link_event(LINK_EVENT_RESET);
+
+            // A partial batch was sized for this connection's MTU and would
+            // not fit the next one's until its own MTU exchange
+            comm->set_mtu(DEFAULT_MTU);
+            xSemaphoreTake(comm->telemetry_lock, portMAX_DELAY);
+            comm->telemetry.reset();
+            xSemaphoreGive(comm->telemetry_lock);
+            if (comm->advertising_requested) {
+                esp_ble_gap_start_advertising(&sniffer_adv_params);
+            }
+            break;
+
+        case ESP_GATTS_MTU_EVT:
+            comm->set_mtu(param->mtu.mtu);
+            break;
+
+        case ESP_GATTS_WRITE_EVT:
+            if (param->write.handle == comm->cccd_handle && param->write.len == 2) {
+                bool enable = (param->write.value[0] & 0x01) != 0;
+                comm->notify_enabled = enable;
+                ESP_LOGI(TAG, "Notifications %s", enable ? "enabled" : "disabled");
+                if (enable) {
+                    xTaskNotifyGive(comm->tx_task_handle);
+                }
+            } else if (param->write.handle == comm->char_handle && !param->write.is_prep &&
+                       comm->command_handler) {
+                comm->command_handler(param->write.value, param->write.len, comm->command_ctx);
+            }
+            break;
+
+        case ESP_GATTS_CONGEST_EVT:
+            // Backpressure from the link: the TX task stops until it clears
+            comm->link_congested = param->congest.congested;
+            if (!param->congest.congested) {
+                xTaskNotifyGive(comm->tx_task_handle);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
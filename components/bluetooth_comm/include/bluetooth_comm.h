@@ -1,13 +1,40 @@
 #pragma once
 
+#include <atomic>
 #include <string>
 #include "esp_err.h"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "freertos/timers.h"
+#include "telemetry_codec.h"
+#include "tx_queue.h"
 
 // Forward declarations to avoid including complex Bluetooth headers
-typedef uint16_t esp_gatt_if_t;
+typedef uint8_t esp_gatt_if_t;
+class GattNotifyTransport;
+class MuxTxLock;
+
+// Batched telemetry counters
+struct TelemetryStats {
+    uint32_t records;         // Records accepted into batches
+    uint32_t batches;         // Batches handed to the link
+    uint32_t bytes;           // Batch bytes handed to the link
+    uint32_t send_failures;   // Batches the link rejected
+};
+
+// Transmit path counters
+struct BluetoothTxStats {
+    TxQueueStats queue;
+    TxPumpStats pump;
+    bool congested;
+};
+
+// Command written to the characteristic by the app, run in the Bluetooth
+// host task. `data` is only valid during the call and is not terminated.
+typedef void (*bt_command_cb_t)(const uint8_t* data, size_t len, void* ctx);
 
 class BluetoothComm {
 public:
@@ -23,11 +50,46 @@ public:
     // Stop advertising
     esp_err_t stop_advertising();
     
-    // Send data to connected Android app
+    // Send data to connected Android app. Data longer than the MTU allows is
+    // split into several notifications. Never blocks on the radio.
     esp_err_t send_data(const uint8_t* data, size_t len);
     
-    // Send packet information
+    // Send packet information (batched, timestamped with the current time)
     esp_err_t send_packet_info(uint8_t channel, int8_t rssi, uint16_t length, uint8_t packet_type);
+
+    // Same, timestamped with the frame's receive time (FrameView::timestamp_us)
+    esp_err_t send_packet_info(uint8_t channel, int8_t rssi, uint16_t length, uint8_t packet_type,
+                               int64_t timestamp_us);
+
+    // Queue a frame record into the current telemetry batch. Batches are sent
+    // when they reach the MTU or after TELEMETRY_FLUSH_MS, whichever comes first.
+    esp_err_t send_packet_record(const TelemetryRecord& record);
+
+    // Send the pending telemetry batch now
+    esp_err_t flush_telemetry();
+
+    // Set the negotiated ATT MTU; telemetry batches are sized to MTU - 3
+    void set_mtu(uint16_t mtu);
+    uint16_t get_mtu() const;
+
+    // Cap telemetry batches below MTU - 3, e.g. to trade link efficiency
+    // for latency; 0 removes the cap. Takes effect from the next batch.
+    void set_telemetry_batch_limit(uint16_t bytes);
+
+    // Longest time a record waits in a partial batch (TELEMETRY_FLUSH_MS by default)
+    esp_err_t set_telemetry_flush_ms(uint32_t ms);
+
+    // Byte budget of the transmit queue, at most TX_QUEUE_BUDGET
+    void set_tx_queue_budget(size_t bytes);
+
+    // Handle commands the app writes to the characteristic; nullptr ignores them
+    void set_command_handler(bt_command_cb_t handler, void* ctx);
+
+    // Get batched telemetry counters
+    TelemetryStats get_telemetry_stats() const;
+
+    // Get transmit queue and link counters
+    BluetoothTxStats get_tx_stats() const;
     
     // Check if device is connected
     bool is_connected() const;
@@ -36,29 +98,98 @@ public:
     void set_device_name(const std::string& name);
 
 private:
+    // Bluedroid callbacks, run in the Bluetooth host task. Event and param
+    // types are the esp_gap_ble / esp_gatts ones, kept opaque here.
+    static void gap_event_handler(int event, void* param);
+    static void gatts_event_handler(int event, esp_gatt_if_t gatts_if, void* param);
+
+    // Push advertising data; advertising starts once the stack confirms it
+    esp_err_t configure_advertising();
+
+    // Task draining tx_queue into GATT notifications
+    static void tx_task(void* arg);
+
+    // Ask the TX task to apply a link change (LINK_EVENT_x); it owns the
+    // pump and the transport, so the Bluetooth host task never touches them
+    void post_link_event(uint32_t event);
+
+    // Apply the posted link changes; TX task only
+    void apply_link_events();
+
+    // Send the encoder's current batch; telemetry_lock must be held
+    esp_err_t send_pending_batch();
+
+    // Size batches to the MTU and the configured cap, whichever is smaller
+    void update_batch_limit();
+
+    static void flush_timer_callback(TimerHandle_t timer);
+
     // Device name
     std::string device_name;
     
-    // Connection state
-    bool connected;
-    uint16_t conn_id;
+    // Connection state, written from the Bluetooth host task
+    std::atomic<bool> connected;
+    std::atomic<bool> notify_enabled;
+    std::atomic<uint16_t> conn_id;
     uint8_t remote_addr[6]; // Bluetooth address as simple array
+
+    // Advertising state
+    std::atomic<bool> advertising_requested;
     
     // GATT service and characteristic handles
     uint16_t service_handle;
     uint16_t char_handle;
+    uint16_t cccd_handle;
     esp_gatt_if_t gatts_if;
     
-    // Data queue for sending
-    QueueHandle_t data_queue;
+    // Bounded outgoing queue and the task sending it
+    MuxTxLock* tx_lock;
+    TxQueue* tx_queue;
+    GattNotifyTransport* transport;
+    TxPump* tx_pump;
+    TaskHandle_t tx_task_handle;
+    std::atomic<uint32_t> link_events;      // LINK_EVENT_x posted to the TX task
+    std::atomic<bool> link_congested;       // Last ESP_GATTS_CONGEST_EVT state
+
+    // Telemetry batching, guarded by telemetry_lock
+    TelemetryEncoder telemetry;
+    TelemetryStats telemetry_stats;
+    SemaphoreHandle_t telemetry_lock;
+    TimerHandle_t flush_timer;
+    std::atomic<uint16_t> mtu;
+    std::atomic<uint16_t> batch_cap;
+
+    // Commands from the app, set before advertising starts
+    bt_command_cb_t command_handler;
+    void* command_ctx;
+
+    // Instance the static Bluedroid callbacks dispatch to
+    static BluetoothComm* active_instance;
     
     // Log tag
     static const char* TAG;
     
-    // Maximum packet size for BLE
-    static const size_t MAX_PACKET_SIZE = 20; // BLE MTU limit
+    // Default ATT MTU until the peer negotiates a larger one
+    static const uint16_t DEFAULT_MTU = 23;
+
+    // MTU offered to peers during MTU exchange
+    static const uint16_t LOCAL_MTU = 517;
+
+    // Longest time a telemetry record waits in a partial batch
+    static const uint32_t TELEMETRY_FLUSH_MS = 100;
+
+    // Byte budget of the outgoing queue
+    static const size_t TX_QUEUE_BUDGET = 4096;
+
+    // Link changes handed to the TX task
+    static const uint32_t LINK_EVENT_RESET = 0x01;     // Disconnected: drop the message in flight
+    static const uint32_t LINK_EVENT_REBIND = 0x02;    // Connection or MTU changed: rebind the transport
+
+    // TX task parameters
+    static const uint32_t TX_TASK_STACK = 3072;
+    static const UBaseType_t TX_TASK_PRIORITY = 6;
 };
 
 // Custom service and characteristic UUIDs
-#define SNIFFER_SERVICE_UUID    0x1800  // Generic Access Service
-#define SNIFFER_CHAR_UUID       0x2A00  // Device Name Characteristic 
\ No newline at end of file
+#define SNIFFER_SERVICE_UUID    0xFFE0  // Sniffer data service
+#define SNIFFER_CHAR_UUID       0xFFE1  // Notify characteristic carrying telemetry and status; commands are written to it
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Compact binary telemetry batches.
+//
+// A batch fits in one BLE notification and looks like:
+//
+//   offset  size  field
+//   0       1     magic (TELEMETRY_MAGIC)
+//   1       1     version (TELEMETRY_VERSION)
+//   2       2     batch sequence number, little endian, +1 per batch
+//   4       1     record count
+//   5       4     base timestamp (us), little endian
+//   9       ...   records
+//
+// and every record is:
+//
+//   3 bytes  bitfield, little endian:
+//              bits 0-3   channel
+//              bits 4-5   frame type (IEEE80211_TYPE_x)
+//              bits 6-9   frame subtype
+//              bits 10-16 -RSSI (0..127)
+//              bit  17    retry flag
+//              bits 18-23 reserved, zero
+//   varint   zigzag timestamp delta (us) from the previous record, or
+//            from the base timestamp for the first record
+//   varint   frame length
+//
+// Typical records take 5-7 bytes. Receivers detect lost batches from gaps in
+// the sequence number. This header has no ESP-IDF dependencies.
+
+#define TELEMETRY_MAGIC             0xA5
+#define TELEMETRY_VERSION           1
+#define TELEMETRY_HEADER_SIZE       9
+#define TELEMETRY_MAX_RECORD_SIZE   (3 + 5 + 3)
+
+// Largest batch the encoder can build (BLE 4.2+ maximum ATT MTU minus the 3-byte ATT header)
+#define TELEMETRY_MAX_BATCH         514
+
+struct TelemetryRecord {
+    uint32_t timestamp_us;
+    uint16_t length;
+    int8_t rssi;
+    uint8_t channel;
+    uint8_t type;
+    uint8_t subtype;
+    bool retry;
+};
+
+class TelemetryEncoder {
+public:
+    // `batch_limit` is the largest batch to emit, normally the negotiated MTU - 3
+    explicit TelemetryEncoder(size_t batch_limit = TELEMETRY_MAX_BATCH);
+
+    // Change the batch size limit; takes effect from the next batch
+    void set_batch_limit(size_t limit);
+    size_t batch_limit() const { return limit; }
+
+    // Append a record to the current batch. Returns false if it does not
+    // fit; finish() the batch and append again.
+    bool append(const TelemetryRecord& record);
+
+    // Close the current batch. Returns its length and points `out` at it; the
+    // bytes stay valid until the next append(). Returns 0 for an empty batch.
+    size_t finish(const uint8_t** out);
+
+    // Drop the current batch without consuming a sequence number
+    void reset();
+
+    bool empty() const { return count == 0; }
+    size_t size() const { return open ? used : 0; }
+    uint8_t record_count() const { return count; }
+    uint16_t next_sequence() const { return sequence; }
+
+private:
+    void begin_batch(uint32_t base_timestamp_us);
+
+    uint8_t buffer[TELEMETRY_MAX_BATCH];
+    size_t limit;
+    size_t pending_limit;
+    size_t used;
+    uint8_t count;
+    uint16_t sequence;
+    uint32_t last_timestamp_us;
+    bool open;
+};
+
+typedef void (*telemetry_record_cb_t)(const TelemetryRecord& record, void* ctx);
+
+class TelemetryDecoder {
+public:
+    TelemetryDecoder();
+
+    // Decode one batch, calling `on_record` for every record. Returns false if
+    // the batch is malformed (records before the error are still delivered).
+    bool decode(const uint8_t* data, size_t len, telemetry_record_cb_t on_record, void* ctx);
+
+    // Batches decoded, batches missing from the sequence, records decoded
+    uint32_t batches() const { return batch_count; }
+    uint32_t lost_batches() const { return lost_count; }
+    uint32_t records() const { return record_total; }
+
+private:
+    bool have_sequence;
+    uint16_t expected_sequence;
+    uint32_t batch_count;
+    uint32_t lost_count;
+    uint32_t record_total;
+};
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Bounded transmit queue and pump for the BLE link.
+//
+// TxQueue holds outgoing messages in two preallocated byte rings, one per
+// priority class, under a shared byte budget. When a push would exceed the
+// budget the oldest telemetry messages are shed first; control messages
+// (status, stats) are only ever rejected, never shed. TxPump drains the
+// queue into a TxTransport, keeping at most one message in flight and
+// backing off while the transport reports congestion.
+//
+// Nothing here depends on ESP-IDF: locking is injected through TxLock and
+// the radio through TxTransport, so both can be mocked on a Linux host.
+
+// Largest single message (maximum ATT MTU minus the 3-byte ATT header)
+#define TX_QUEUE_MAX_MESSAGE    514
+
+// Priority classes, most important first
+#define TX_PRIORITY_CONTROL     0
+#define TX_PRIORITY_TELEMETRY   1
+#define TX_PRIORITY_COUNT       2
+
+// Critical section hooks; the default does nothing (single-threaded use)
+class TxLock {
+public:
+    virtual ~TxLock() {}
+    virtual void lock() {}
+    virtual void unlock() {}
+};
+
+enum tx_result_t {
+    TX_SENT,      // Message accepted by the link
+    TX_BUSY,      // Link cannot take it now; retry the same message later
+    TX_FAILED,    // Message can never be sent; drop it
+};
+
+class TxTransport {
+public:
+    virtual ~TxTransport() {}
+    virtual tx_result_t send(const uint8_t* data, size_t len) = 0;
+};
+
+struct TxQueueStats {
+    uint32_t pushed;            // Messages accepted, counting every piece of a split one
+    uint32_t shed;              // Queued telemetry messages dropped to make room
+    uint32_t rejected;          // Messages refused on push
+    uint32_t messages;          // Messages currently queued
+    uint32_t bytes_used;        // Budget currently used
+    uint32_t bytes_high_water;  // Highest budget use seen
+    uint32_t byte_budget;
+};
+
+class TxQueue {
+public:
+    // `byte_budget` bounds queued payload plus a 2-byte header per message.
+    // Storage (twice the budget, one ring per class) is allocated here, once.
+    explicit TxQueue(size_t byte_budget, TxLock* lock = nullptr);
+    ~TxQueue();
+
+    TxQueue(const TxQueue&) = delete;
+    TxQueue& operator=(const TxQueue&) = delete;
+
+    // False if the storage allocation in the constructor failed
+    bool valid() const { return storage != nullptr; }
+
+    // Copy a message in, shedding old telemetry if needed. Returns false if
+    // the message was rejected.
+    bool push(const uint8_t* data, size_t len, uint8_t priority);
+
+    // Copy a message in as consecutive pieces of at most `piece_max` bytes,
+    // all or none: either every piece is queued, back to back in its class,
+    // or nothing is and the call counts as one rejection.
+    bool push_split(const uint8_t* data, size_t len, size_t piece_max, uint8_t priority);
+
+    // Copy the most important, oldest message out. Returns its length, or 0
+    // if the queue is empty.
+    size_t pop(uint8_t* out, size_t capacity);
+
+    // Drop everything queued
+    void clear();
+
+    // Lower (or raise back) the byte budget at runtime, within the budget
+    // given to the constructor and never below one largest message. Bytes
+    // already queued over a lowered budget drain normally.
+    void set_byte_budget(size_t byte_budget);
+
+    TxQueueStats stats() const;
+
+private:
+    struct Ring {
+        uint8_t* data;
+        size_t head;        // Read offset
+        size_t used;        // Bytes in the ring
+        uint32_t count;     // Messages in the ring
+    };
+
+    void ring_write(Ring& ring, const uint8_t* src, size_t len);
+    void ring_read(Ring& ring, uint8_t* dst, size_t len);
+    void ring_skip(Ring& ring, size_t len);
+    size_t ring_peek_len(const Ring& ring) const;
+
+    uint8_t* storage;
+    size_t budget;          // Size of each ring
+    size_t limit;           // Budget enforced on push, at most `budget`
+    Ring rings[TX_PRIORITY_COUNT];
+    TxLock* lock;
+    TxLock no_lock;
+
+    uint32_t pushed_count;
+    uint32_t shed_count;
+    uint32_t rejected_count;
+    uint32_t high_water;
+};
+
+struct TxPumpStats {
+    uint32_t sent;
+    uint32_t failed;
+    uint32_t busy;              // Sends deferred because the link was busy or congested
+};
+
+class TxPump {
+public:
+    TxPump(TxQueue& queue, TxTransport& transport);
+
+    // Send until the queue is empty, the link pushes back, or `max_messages`
+    // have gone out. Returns the number of messages sent.
+    size_t pump(size_t max_messages);
+
+    // Congestion reported by the link; pump() sends nothing while set
+    void set_congested(bool congested);
+    bool is_congested() const { return congested; }
+
+    // Drop the in-flight message (e.g. on disconnect)
+    void discard_pending();
+
+    TxPumpStats stats() const { return pump_stats; }
+
+private:
+    TxQueue& queue;
+    TxTransport& transport;
+    uint8_t pending[TX_QUEUE_MAX_MESSAGE];
+    size_t pending_len;
+    volatile bool congested;
+    TxPumpStats pump_stats;
+};
@@ -0,0 +1,169 @@
+#include "telemetry_codec.h"
+#include <string.h>
+
+#define MIN_BATCH_LIMIT     (TELEMETRY_HEADER_SIZE + TELEMETRY_MAX_RECORD_SIZE)
+
+static size_t clamp_limit(size_t limit) {
+    if (limit < MIN_BATCH_LIMIT) return MIN_BATCH_LIMIT;
+    if (limit > TELEMETRY_MAX_BATCH) return TELEMETRY_MAX_BATCH;
+    return limit;
+}
+
+static size_t put_varint(uint8_t* p, uint32_t v) {
+    size_t n = 0;
+    while (v >= 0x80) {
+        p[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+static bool get_varint(const uint8_t** p, const uint8_t* end, uint32_t* v) {
+    uint32_t result = 0;
+    for (int shift = 0; shift < 35 && *p < end; shift += 7) {
+        uint8_t b = *(*p)++;
+        result |= (uint32_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            *v = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+static inline uint32_t zigzag(int32_t v) {
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static inline int32_t unzigzag(uint32_t v) {
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+TelemetryEncoder::TelemetryEncoder(size_t batch_limit)
+    : limit(clamp_limit(batch_limit)), pending_limit(limit), used(0), count(0),
+      sequence(0), last_timestamp_us(0), open(false) {
+}
+
+void TelemetryEncoder::set_batch_limit(size_t new_limit) {
+    pending_limit = clamp_limit(new_limit);
+}
+
+void TelemetryEncoder::begin_batch(uint32_t base_timestamp_us) {
+    limit = pending_limit;
+    buffer[0] = TELEMETRY_MAGIC;
+    buffer[1] = TELEMETRY_VERSION;
+    buffer[2] = (uint8_t)sequence;
+    buffer[3] = (uint8_t)(sequence >> 8);
+    buffer[4] = 0;
+    buffer[5] = (uint8_t)base_timestamp_us;
+    buffer[6] = (uint8_t)(base_timestamp_us >> 8);
+    buffer[7] = (uint8_t)(base_timestamp_us >> 16);
+    buffer[8] = (uint8_t)(base_timestamp_us >> 24);
+    used = TELEMETRY_HEADER_SIZE;
+    count = 0;
+    last_timestamp_us = base_timestamp_us;
+    open = true;
+}
+
+bool TelemetryEncoder::append(const TelemetryRecord& record) {
+    if (!open) {
+        begin_batch(record.timestamp_us);
+    }
+    if (count == UINT8_MAX) {
+        return false;
+    }
+
+    uint8_t encoded[TELEMETRY_MAX_RECORD_SIZE];
+    int rssi = record.rssi > 0 ? 0 : (record.rssi < -127 ? 127 : -record.rssi);
+    uint32_t bits = (record.channel & 0x0f)
+                  | (uint32_t)(record.type & 0x03) << 4
+                  | (uint32_t)(record.subtype & 0x0f) << 6
+                  | (uint32_t)rssi << 10
+                  | (uint32_t)(record.retry ? 1 : 0) << 17;
+    encoded[0] = (uint8_t)bits;
+    encoded[1] = (uint8_t)(bits >> 8);
+    encoded[2] = (uint8_t)(bits >> 16);
+
+    // Wrapping subtraction keeps deltas small across the 32-bit rollover
+    int32_t delta = (int32_t)(record.timestamp_us - last_timestamp_us);
+    size_t n = 3;
+    n += put_varint(encoded + n, zigzag(delta));
+    n += put_varint(encoded + n, record.length);
+
+    if (used + n > limit) {
+        return false;
+    }
+    memcpy(buffer + used, encoded, n);
+    used += n;
+    count++;
+    last_timestamp_us = record.timestamp_us;
+    return true;
+}
+
+size_t TelemetryEncoder::finish(const uint8_t** out) {
+    if (!open || count == 0) {
+        return 0;
+    }
+    buffer[4] = count;
+    *out = buffer;
+    sequence++;
+    open = false;
+    count = 0;
+    return used;
+}
+
+void TelemetryEncoder::reset() {
+    open = false;
+    count = 0;
+}
+
+TelemetryDecoder::TelemetryDecoder()
+    : have_sequence(false), expected_sequence(0), batch_count(0), lost_count(0), record_total(0) {
+}
+
+bool TelemetryDecoder::decode(const uint8_t* data, size_t len, telemetry_record_cb_t on_record, void* ctx) {
+    if (len < TELEMETRY_HEADER_SIZE || data[0] != TELEMETRY_MAGIC || data[1] != TELEMETRY_VERSION) {
+        return false;
+    }
+
+    uint16_t sequence = (uint16_t)(data[2] | (data[3] << 8));
+    if (have_sequence && sequence != expected_sequence) {
+        lost_count += (uint16_t)(sequence - expected_sequence);
+    }
+    have_sequence = true;
+    expected_sequence = sequence + 1;
+    batch_count++;
+
+    uint8_t records = data[4];
+    uint32_t timestamp = (uint32_t)data[5] | (uint32_t)data[6] << 8 |
+                         (uint32_t)data[7] << 16 | (uint32_t)data[8] << 24;
+    const uint8_t* p = data + TELEMETRY_HEADER_SIZE;
+    const uint8_t* end = data + len;
+
+    for (uint8_t i = 0; i < records; i++) {
+        if (end - p < 3) return false;
+        uint32_t bits = (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16;
+        p += 3;
+
+        uint32_t delta, length;
+        if (!get_varint(&p, end, &delta) || !get_varint(&p, end, &length)) {
+            return false;
+        }
+        timestamp += (uint32_t)unzigzag(delta);
+
+        TelemetryRecord record;
+        record.timestamp_us = timestamp;
+        record.length = (uint16_t)length;
+        record.channel = bits & 0x0f;
+        record.type = (bits >> 4) & 0x03;
+        record.subtype = (bits >> 6) & 0x0f;
+        record.rssi = (int8_t)-(int)((bits >> 10) & 0x7f);
+        record.retry = (bits >> 17) & 1;
+        record_total++;
+        if (on_record) {
+            on_record(record, ctx);
+        }
+    }
+    return p == end;
+}
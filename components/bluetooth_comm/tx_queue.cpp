@@ -0,0 +1,200 @@
+#include "tx_queue.h"
+#include <new>
+#include <string.h>
+
+// Every message is stored as a little-endian 16-bit length followed by its bytes
+#define TX_MESSAGE_HEADER   2
+
+TxQueue::TxQueue(size_t byte_budget, TxLock* queue_lock)
+    : storage(nullptr), budget(byte_budget), limit(byte_budget), lock(queue_lock ? queue_lock : &no_lock),
+      pushed_count(0), shed_count(0), rejected_count(0), high_water(0) {
+    storage = new (std::nothrow) uint8_t[budget * TX_PRIORITY_COUNT];
+    for (int i = 0; i < TX_PRIORITY_COUNT; i++) {
+        rings[i].data = storage ? storage + i * budget : nullptr;
+        rings[i].head = 0;
+        rings[i].used = 0;
+        rings[i].count = 0;
+    }
+}
+
+TxQueue::~TxQueue() {
+    delete[] storage;
+}
+
+void TxQueue::ring_write(Ring& ring, const uint8_t* src, size_t len) {
+    size_t tail = (ring.head + ring.used) % budget;
+    size_t first = len < budget - tail ? len : budget - tail;
+    memcpy(ring.data + tail, src, first);
+    memcpy(ring.data, src + first, len - first);
+    ring.used += len;
+}
+
+void TxQueue::ring_read(Ring& ring, uint8_t* dst, size_t len) {
+    size_t first = len < budget - ring.head ? len : budget - ring.head;
+    memcpy(dst, ring.data + ring.head, first);
+    memcpy(dst + first, ring.data, len - first);
+    ring_skip(ring, len);
+}
+
+void TxQueue::ring_skip(Ring& ring, size_t len) {
+    ring.head = (ring.head + len) % budget;
+    ring.used -= len;
+}
+
+size_t TxQueue::ring_peek_len(const Ring& ring) const {
+    uint8_t lo = ring.data[ring.head];
+    uint8_t hi = ring.data[(ring.head + 1) % budget];
+    return (size_t)(lo | (hi << 8));
+}
+
+bool TxQueue::push(const uint8_t* data, size_t len, uint8_t priority) {
+    return push_split(data, len, len, priority);
+}
+
+bool TxQueue::push_split(const uint8_t* data, size_t len, size_t piece_max, uint8_t priority) {
+    const size_t pieces = piece_max ? (len + piece_max - 1) / piece_max : 0;
+    const size_t need = len + pieces * TX_MESSAGE_HEADER;
+    if (!storage || len == 0 || piece_max == 0 || piece_max > TX_QUEUE_MAX_MESSAGE || need > limit ||
+        priority >= TX_PRIORITY_COUNT) {
+        lock->lock();
+        rejected_count++;
+        lock->unlock();
+        return false;
+    }
+
+    lock->lock();
+    Ring& telemetry = rings[TX_PRIORITY_TELEMETRY];
+    size_t used = rings[TX_PRIORITY_CONTROL].used + telemetry.used;
+
+    // Shed the oldest telemetry until the whole message fits
+    while (used + need > limit && telemetry.count > 0) {
+        size_t victim = ring_peek_len(telemetry) + TX_MESSAGE_HEADER;
+        ring_skip(telemetry, victim);
+        telemetry.count--;
+        used -= victim;
+        shed_count++;
+    }
+    if (used + need > limit) {
+        rejected_count++;
+        lock->unlock();
+        return false;
+    }
+
+    Ring& ring = rings[priority];
+    for (size_t offset = 0; offset < len; offset += piece_max) {
+        size_t piece = len - offset < piece_max ? len - offset : piece_max;
+        uint8_t header[TX_MESSAGE_HEADER] = { (uint8_t)piece, (uint8_t)(piece >> 8) };
+        ring_write(ring, header, TX_MESSAGE_HEADER);
+        ring_write(ring, data + offset, piece);
+        ring.count++;
+        pushed_count++;
+    }
+    used += need;
+    if (used > high_water) {
+        high_water = (uint32_t)used;
+    }
+    lock->unlock();
+    return true;
+}
+
+size_t TxQueue::pop(uint8_t* out, size_t capacity) {
+    size_t len = 0;
+    lock->lock();
+    for (int i = 0; i < TX_PRIORITY_COUNT; i++) {
+        Ring& ring = rings[i];
+        if (ring.count == 0) {
+            continue;
+        }
+        len = ring_peek_len(ring);
+        ring_skip(ring, TX_MESSAGE_HEADER);
+        if (len <= capacity) {
+            ring_read(ring, out, len);
+        } else {
+            // Caller's buffer is too small; the message is lost either way
+            ring_skip(ring, len);
+            rejected_count++;
+            len = 0;
+        }
+        ring.count--;
+        break;
+    }
+    lock->unlock();
+    return len;
+}
+
+void TxQueue::clear() {
+    lock->lock();
+    for (int i = 0; i < TX_PRIORITY_COUNT; i++) {
+        rings[i].head = 0;
+        rings[i].used = 0;
+        rings[i].count = 0;
+    }
+    lock->unlock();
+}
+
+void TxQueue::set_byte_budget(size_t byte_budget) {
+    const size_t floor = TX_QUEUE_MAX_MESSAGE + TX_MESSAGE_HEADER;
+    if (byte_budget < floor) {
+        byte_budget = floor;
+    }
+    lock->lock();
+    limit = byte_budget < budget ? byte_budget : budget;
+    lock->unlock();
+}
+
+TxQueueStats TxQueue::stats() const {
+    TxQueueStats s;
+    lock->lock();
+    s.pushed = pushed_count;
+    s.shed = shed_count;
+    s.rejected = rejected_count;
+    s.messages = rings[TX_PRIORITY_CONTROL].count + rings[TX_PRIORITY_TELEMETRY].count;
+    s.bytes_used = (uint32_t)(rings[TX_PRIORITY_CONTROL].used + rings[TX_PRIORITY_TELEMETRY].used);
+    s.bytes_high_water = high_water;
+    s.byte_budget = (uint32_t)limit;
+    lock->unlock();
+    return s;
+}
+
+TxPump::TxPump(TxQueue& tx_queue, TxTransport& tx_transport)
+    : queue(tx_queue), transport(tx_transport), pending_len(0), congested(false), pump_stats() {
+}
+
+size_t TxPump::pump(size_t max_messages) {
+    size_t sent = 0;
+    while (sent < max_messages) {
+        if (congested) {
+            pump_stats.busy++;
+            break;
+        }
+        if (pending_len == 0) {
+            pending_len = queue.pop(pending, sizeof(pending));
+            if (pending_len == 0) {
+                break;
+            }
+        }
+
+        tx_result_t result = transport.send(pending, pending_len);
+        if (result == TX_BUSY) {
+            // Keep the message and let the caller come back later
+            pump_stats.busy++;
+            break;
+        }
+        if (result == TX_SENT) {
+            pump_stats.sent++;
+            sent++;
+        } else {
+            pump_stats.failed++;
+        }
+        pending_len = 0;
+    }
+    return sent;
+}
+
+void TxPump::set_congested(bool is_congested) {
+    congested = is_congested;
+}
+
+void TxPump::discard_pending() {
+    pending_len = 0;
+}
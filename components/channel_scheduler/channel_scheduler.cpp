@@ -0,0 +1,165 @@
+#include "channel_scheduler.h"
+#include <math.h>
+#include "table_hash.h"
+
+static uint32_t popcount32(uint32_t v) {
+    v = v - ((v >> 1) & 0x55555555u);
+    v = (v & 0x33333333u) + ((v >> 2) & 0x33333333u);
+    return (((v + (v >> 4)) & 0x0f0f0f0fu) * 0x01010101u) >> 24;
+}
+
+SchedulerConfig channel_scheduler_default_config() {
+    SchedulerConfig config;
+    config.first_channel = 1;
+    config.last_channel = 13;
+    config.round_ms = 13 * 5000;
+    config.min_dwell_ms = 500;
+    config.exploration = 0.2f;
+    config.smoothing = 0.5f;
+    config.bssid_weight = 5.0f;
+    return config;
+}
+
+SchedulerConfig ChannelScheduler::sanitize(const SchedulerConfig& config) {
+    // Keep the config usable whatever the caller passed in
+    SchedulerConfig cfg = config;
+    if (cfg.first_channel < 1) cfg.first_channel = 1;
+    if (cfg.first_channel > CHANNEL_SCHEDULER_MAX_CHANNEL) cfg.first_channel = CHANNEL_SCHEDULER_MAX_CHANNEL;
+    if (cfg.last_channel > CHANNEL_SCHEDULER_MAX_CHANNEL) cfg.last_channel = CHANNEL_SCHEDULER_MAX_CHANNEL;
+    if (cfg.last_channel < cfg.first_channel) cfg.last_channel = cfg.first_channel;
+    if (cfg.exploration < 0.0f) cfg.exploration = 0.0f;
+    if (cfg.exploration > 1.0f) cfg.exploration = 1.0f;
+    if (cfg.smoothing <= 0.0f || cfg.smoothing > 1.0f) cfg.smoothing = 1.0f;
+    if (cfg.bssid_weight < 0.0f) cfg.bssid_weight = 0.0f;
+    return cfg;
+}
+
+ChannelScheduler::ChannelScheduler(const SchedulerConfig& config)
+    : cfg(sanitize(config)), current(0) {
+    for (uint8_t ch = 0; ch <= CHANNEL_SCHEDULER_MAX_CHANNEL; ch++) {
+        ChannelState& state = channels[ch];
+        state.frames.store(0, std::memory_order_relaxed);
+        for (size_t i = 0; i < CHANNEL_SCHEDULER_BSSID_BITS / 32; i++) {
+            state.bssid_bits[i].store(0, std::memory_order_relaxed);
+        }
+        state.rate = 0.0f;
+        state.bssids = 0.0f;
+        state.visited = false;
+        state.dwell_ms = 0;
+    }
+    plan_round();
+}
+
+void ChannelScheduler::record_frame(uint8_t channel, const uint8_t* bssid) {
+    if (channel > CHANNEL_SCHEDULER_MAX_CHANNEL) {
+        return;
+    }
+    ChannelState& state = channels[channel];
+    state.frames.fetch_add(1, std::memory_order_relaxed);
+    if (bssid) {
+        // The BSSID's FNV-1a picks its sketch bit
+        uint32_t bit = fnv1a(bssid, 6) % CHANNEL_SCHEDULER_BSSID_BITS;
+        state.bssid_bits[bit / 32].fetch_or(1u << (bit % 32), std::memory_order_relaxed);
+    }
+}
+
+HopDecision ChannelScheduler::next_hop(uint32_t elapsed_ms) {
+    if (current != 0) {
+        close_visit(current, elapsed_ms);
+    }
+
+    if (current == 0 || current >= cfg.last_channel) {
+        plan_round();
+        current = cfg.first_channel;
+    } else {
+        current++;
+    }
+
+    HopDecision decision;
+    decision.channel = current;
+    decision.dwell_ms = channels[current].dwell_ms;
+    return decision;
+}
+
+void ChannelScheduler::set_config(const SchedulerConfig& config) {
+    // The visit in progress is cut short: its frames would be credited to
+    // a dwell that never finished, so they are discarded
+    if (current != 0) {
+        close_visit(current, 0);
+        current = 0;
+    }
+    cfg = sanitize(config);
+    plan_round();
+}
+
+void ChannelScheduler::close_visit(uint8_t channel, uint32_t elapsed_ms) {
+    ChannelState& state = channels[channel];
+    uint32_t frames = state.frames.exchange(0, std::memory_order_relaxed);
+
+    uint32_t set_bits = 0;
+    for (size_t i = 0; i < CHANNEL_SCHEDULER_BSSID_BITS / 32; i++) {
+        set_bits += popcount32(state.bssid_bits[i].exchange(0, std::memory_order_relaxed));
+    }
+
+    if (elapsed_ms == 0) {
+        return;
+    }
+
+    // Linear counting: n = -m * ln(zero_bits / m), saturating when the sketch is full
+    const float m = (float)CHANNEL_SCHEDULER_BSSID_BITS;
+    uint32_t zero_bits = CHANNEL_SCHEDULER_BSSID_BITS - set_bits;
+    float bssids = zero_bits ? -m * logf((float)zero_bits / m) : m * logf(m);
+    float rate = frames * 1000.0f / elapsed_ms;
+
+    if (!state.visited) {
+        state.rate = rate;
+        state.bssids = bssids;
+        state.visited = true;
+    } else {
+        state.rate += cfg.smoothing * (rate - state.rate);
+        state.bssids += cfg.smoothing * (bssids - state.bssids);
+    }
+}
+
+void ChannelScheduler::plan_round() {
+    const uint32_t count = cfg.last_channel - cfg.first_channel + 1;
+    const uint32_t reserved = count * cfg.min_dwell_ms;
+    const float spare = cfg.round_ms > reserved ? (float)(cfg.round_ms - reserved) : 0.0f;
+
+    float total_score = 0.0f;
+    for (uint8_t ch = cfg.first_channel; ch <= cfg.last_channel; ch++) {
+        total_score += channel_score(ch);
+    }
+
+    // With no activity information yet, everything is exploration
+    const float explore = total_score > 0.0f ? spare * cfg.exploration : spare;
+    const float exploit = spare - explore;
+
+    for (uint8_t ch = cfg.first_channel; ch <= cfg.last_channel; ch++) {
+        float share = explore / count;
+        if (total_score > 0.0f) {
+            share += exploit * channel_score(ch) / total_score;
+        }
+        channels[ch].dwell_ms = cfg.min_dwell_ms + (uint32_t)share;
+    }
+}
+
+float ChannelScheduler::channel_score(uint8_t channel) const {
+    if (!in_hop_set(channel)) {
+        return 0.0f;
+    }
+    const ChannelState& state = channels[channel];
+    return state.rate + cfg.bssid_weight * state.bssids;
+}
+
+float ChannelScheduler::channel_rate(uint8_t channel) const {
+    return channel <= CHANNEL_SCHEDULER_MAX_CHANNEL ? channels[channel].rate : 0.0f;
+}
+
+float ChannelScheduler::channel_bssids(uint8_t channel) const {
+    return channel <= CHANNEL_SCHEDULER_MAX_CHANNEL ? channels[channel].bssids : 0.0f;
+}
+
+uint32_t ChannelScheduler::planned_dwell(uint8_t channel) const {
+    return in_hop_set(channel) ? channels[channel].dwell_ms : 0;
+}
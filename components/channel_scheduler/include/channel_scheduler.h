@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Highest channel number the scheduler can track
+#define CHANNEL_SCHEDULER_MAX_CHANNEL   14
+
+// Bits in the per-channel unique-BSSID sketch (linear counting)
+#define CHANNEL_SCHEDULER_BSSID_BITS    256
+
+struct SchedulerConfig {
+    uint8_t first_channel;      // First channel of the hop set
+    uint8_t last_channel;       // Last channel of the hop set (inclusive)
+    uint32_t round_ms;          // Total dwell budget of one pass over all channels
+    uint32_t min_dwell_ms;      // Guaranteed dwell for every channel in every round
+    float exploration;          // Fraction of the spare budget spread evenly (0..1)
+    float smoothing;            // EWMA weight of the newest visit (0..1]
+    float bssid_weight;         // Score of one unique BSSID relative to one frame/s
+};
+
+// Default config: channels 1-13, 5 s average dwell, 500 ms minimum dwell
+SchedulerConfig channel_scheduler_default_config();
+
+// Next channel to listen on and for how long
+struct HopDecision {
+    uint8_t channel;
+    uint32_t dwell_ms;
+};
+
+// Adaptive channel-hopping scheduler.
+//
+// Every channel in the hop set is visited once per round. Each visit gets
+// the minimum dwell plus a share of the remaining round budget: an
+// `exploration` fraction of it is split evenly, the rest in proportion to
+// the channel's activity score (EWMA of frames/s plus `bssid_weight` per
+// unique BSSID seen). Busy channels get most of the airtime while quiet
+// ones keep being sampled.
+//
+// The class is pure logic with no ESP-IDF dependencies. record_frame() may
+// be called from a different task than next_hop().
+class ChannelScheduler {
+public:
+    explicit ChannelScheduler(const SchedulerConfig& config = channel_scheduler_default_config());
+
+    ChannelScheduler(const ChannelScheduler&) = delete;
+    ChannelScheduler& operator=(const ChannelScheduler&) = delete;
+
+    // Account one captured frame; `bssid` may be nullptr
+    void record_frame(uint8_t channel, const uint8_t* bssid);
+
+    // Close the visit that just lasted `elapsed_ms` (0 on the first call) and
+    // return the next channel with its dwell time
+    HopDecision next_hop(uint32_t elapsed_ms);
+
+    // Replace the config, keeping the activity learned so far. The next
+    // next_hop() starts a new round; call it from the same task.
+    void set_config(const SchedulerConfig& config);
+
+    // Activity score currently driving the dwell split
+    float channel_score(uint8_t channel) const;
+
+    // EWMA frame rate (frames/s) seen on a channel
+    float channel_rate(uint8_t channel) const;
+
+    // EWMA unique-BSSID estimate for a channel
+    float channel_bssids(uint8_t channel) const;
+
+    // Dwell planned for a channel in the current round
+    uint32_t planned_dwell(uint8_t channel) const;
+
+    const SchedulerConfig& config() const { return cfg; }
+
+private:
+    // Clamp a caller's config to usable values
+    static SchedulerConfig sanitize(const SchedulerConfig& config);
+
+    struct ChannelState {
+        // Written by record_frame()
+        std::atomic<uint32_t> frames;
+        std::atomic<uint32_t> bssid_bits[CHANNEL_SCHEDULER_BSSID_BITS / 32];
+
+        // Owned by next_hop()
+        float rate;
+        float bssids;
+        bool visited;
+        uint32_t dwell_ms;
+    };
+
+    // Fold the frames and BSSIDs of the finished visit into the EWMAs
+    void close_visit(uint8_t channel, uint32_t elapsed_ms);
+
+    // Recompute the dwell split for the next round
+    void plan_round();
+
+    bool in_hop_set(uint8_t channel) const {
+        return channel >= cfg.first_channel && channel <= cfg.last_channel;
+    }
+
+    SchedulerConfig cfg;
+    ChannelState channels[CHANNEL_SCHEDULER_MAX_CHANNEL + 1];
+    uint8_t current;     // 0 before the first hop
+};
@@ -0,0 +1,72 @@
+#include "device_tracker.h"
+#include <string.h>
+
+DeviceTracker::DeviceTracker()
+    : eviction_count(0) {
+}
+
+const DeviceRecord* DeviceTracker::update(const DeviceObservation& obs, bool* inserted) {
+    uint32_t hash = mac_hash(obs.mac);
+    const uint8_t* mac = obs.mac;
+    size_t slot = table.find(hash, [mac](const DeviceRecord& record) { return mac_equal(record.mac, mac); });
+
+    DeviceRecord* record;
+    bool found = table.occupied(slot);
+    if (inserted) {
+        *inserted = !found;
+    }
+    if (found) {
+        record = &table.at_slot(slot);
+        record->rssi_ewma += ((obs.rssi * (1 << DEVICE_TRACKER_RSSI_SHIFT)) - record->rssi_ewma) >> DEVICE_TRACKER_RSSI_ALPHA;
+        if (obs.rssi < record->rssi_min) record->rssi_min = obs.rssi;
+        if (obs.rssi > record->rssi_max) record->rssi_max = obs.rssi;
+    } else {
+        bool evicted;
+        record = table.insert_evict(slot, hash, &evicted);
+        if (evicted) {
+            eviction_count.fetch_add(1, std::memory_order_relaxed);
+        }
+        memset(record, 0, sizeof(*record));
+        memcpy(record->mac, obs.mac, 6);
+        record->first_seen_us = obs.timestamp_us;
+        record->rssi_ewma = (int16_t)(obs.rssi * (1 << DEVICE_TRACKER_RSSI_SHIFT));
+        record->rssi_min = obs.rssi;
+        record->rssi_max = obs.rssi;
+    }
+
+    record->last_seen_us = obs.timestamp_us;
+    record->channel = obs.channel;
+    record->referenced = 1;
+    if (obs.duplicate) {
+        record->retries++;
+    } else if (obs.type < DEVICE_TRACKER_FRAME_TYPES) {
+        record->frames[obs.type]++;
+    }
+    if (obs.is_ap) {
+        record->flags |= DEVICE_FLAG_AP;
+    }
+    // Group addresses (wildcard BSSID in probe requests) say nothing about association
+    if (obs.bssid && mac_unicast(obs.bssid)) {
+        memcpy(record->bssid, obs.bssid, 6);
+        if (!obs.is_ap && !mac_equal(obs.bssid, obs.mac)) {
+            record->flags |= DEVICE_FLAG_ASSOCIATED;
+        }
+    }
+    return record;
+}
+
+const DeviceRecord* DeviceTracker::find(const uint8_t* mac) const {
+    size_t slot = table.find(mac_hash(mac), [mac](const DeviceRecord& record) { return mac_equal(record.mac, mac); });
+    return table.occupied(slot) ? &table.at_slot(slot) : nullptr;
+}
+
+void DeviceTracker::for_each(device_visit_cb_t visit, void* ctx) const {
+    size_t used = table.size();
+    for (size_t i = 0; i < used; i++) {
+        visit(table[i], ctx);
+    }
+}
+
+void DeviceTracker::clear() {
+    table.clear();
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include "fixed_table.h"
+#include "table_hash.h"
+
+// Devices tracked at once; must be a power of two. Override at build time
+// (e.g. -DDEVICE_TRACKER_CAPACITY=1024) to trade RAM for coverage.
+#ifndef DEVICE_TRACKER_CAPACITY
+#define DEVICE_TRACKER_CAPACITY     512
+#endif
+
+// Frame type counters kept per device (IEEE80211_TYPE_MGMT/CTRL/DATA)
+#define DEVICE_TRACKER_FRAME_TYPES  3
+
+// RSSI EWMA: fixed point with 4 fractional bits, weight 1/8 for each new sample
+#define DEVICE_TRACKER_RSSI_SHIFT   4
+#define DEVICE_TRACKER_RSSI_ALPHA   3
+
+// Device role flags
+#define DEVICE_FLAG_AP              0x01    // Seen transmitting as a BSSID
+#define DEVICE_FLAG_ASSOCIATED      0x02    // Seen exchanging data inside a BSS
+
+// One frame's worth of information about its transmitter
+struct DeviceObservation {
+    const uint8_t* mac;         // Transmitter address (required)
+    const uint8_t* bssid;       // BSSID of the frame, nullptr if unknown
+    int64_t timestamp_us;
+    int8_t rssi;
+    uint8_t channel;
+    uint8_t type;               // IEEE80211_TYPE_x
+    bool is_ap;                 // Frame proves the transmitter is an AP
+    bool duplicate;             // Retransmission of a frame already counted (FrameView::duplicate)
+};
+
+struct DeviceRecord {
+    uint8_t mac[6];
+    uint8_t bssid[6];           // Last BSSID seen, all zero if none
+    int64_t first_seen_us;
+    int64_t last_seen_us;
+    uint32_t frames[DEVICE_TRACKER_FRAME_TYPES];   // Retransmissions excluded
+    uint32_t retries;           // Retransmissions collapsed into frames already counted
+    int16_t rssi_ewma;          // dBm << DEVICE_TRACKER_RSSI_SHIFT
+    int8_t rssi_min;
+    int8_t rssi_max;
+    uint8_t channel;            // Last channel seen on
+    uint8_t flags;              // DEVICE_FLAG_x
+    uint8_t referenced;         // Clock bit, set on every update (see FixedTable)
+
+    int rssi_average() const { return rssi_ewma / (1 << DEVICE_TRACKER_RSSI_SHIFT); }
+
+    // Share of the device's transmissions that were retransmissions, 0-1
+    float retry_rate() const {
+        uint32_t sent = frames[0] + frames[1] + frames[2] + retries;
+        return sent ? (float)retries / sent : 0.0f;
+    }
+};
+
+typedef void (*device_visit_cb_t)(const DeviceRecord& record, void* ctx);
+
+// Fixed-capacity table of stations and APs keyed by MAC address.
+//
+// Records live in a FixedTable: a preallocated array behind an
+// open-addressing index (linear probing, backward-shift deletion). When the
+// table is full a clock sweep evicts a device that has not been updated since
+// the hand last passed it, approximating LRU without a linked list. Nothing allocates
+// after construction, so the whole footprint is sizeof(DeviceTracker) and the
+// object can be placed wherever the caller likes, including PSRAM.
+//
+// Pure logic with no ESP-IDF dependencies. update(), find(), for_each() and
+// clear() must be serialized by the caller; size() and evictions() may be
+// read from any task.
+class DeviceTracker {
+public:
+    DeviceTracker();
+
+    DeviceTracker(const DeviceTracker&) = delete;
+    DeviceTracker& operator=(const DeviceTracker&) = delete;
+
+    // Account one frame from `obs.mac`, inserting (and evicting) as needed.
+    // Returns the updated record; `inserted`, if given, tells whether the
+    // device was new.
+    const DeviceRecord* update(const DeviceObservation& obs, bool* inserted = nullptr);
+
+    // Record of a MAC, or nullptr if it is not tracked
+    const DeviceRecord* find(const uint8_t* mac) const;
+
+    // Call `visit` for every tracked device, in no particular order
+    void for_each(device_visit_cb_t visit, void* ctx) const;
+
+    // Forget every device
+    void clear();
+
+    size_t size() const { return table.size(); }
+    size_t capacity() const { return DEVICE_TRACKER_CAPACITY; }
+    uint32_t evictions() const { return eviction_count.load(std::memory_order_relaxed); }
+
+    // Bytes used by one tracker, for RAM budgeting
+    static constexpr size_t footprint() { return sizeof(DeviceTracker); }
+
+private:
+    struct RecordHash {
+        uint32_t operator()(const DeviceRecord& record) const { return mac_hash(record.mac); }
+    };
+
+    FixedTable<DeviceRecord, DEVICE_TRACKER_CAPACITY, RecordHash> table;
+    std::atomic<uint32_t> eviction_count;
+};
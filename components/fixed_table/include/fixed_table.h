@@ -0,0 +1,153 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Fixed-capacity hash table of CAPACITY records, the storage behind the
+// per-address tables (DeviceTracker, ApInventory, FrameDedup).
+//
+// Records live in a preallocated array and stay dense in [0, size()). An
+// open-addressing index of 16-bit record numbers, twice the capacity so it
+// is at most half full, maps hashes to records with linear probing. Removal
+// uses backward-shift deletion, which keeps probe runs unbroken without
+// tombstones, and moves the last record into the freed place. When the
+// table is full, insert_evict() reclaims a record with a clock sweep: one
+// whose `referenced` field is set gets a second chance and the field
+// cleared, approximating LRU without a list.
+//
+// `Hash` is a functor returning a stored record's 32-bit hash, the same
+// value passed to find() and insert_evict() for its key; the index is
+// walked again with it when entries move. Nothing allocates. Calls must be
+// serialized by the caller; size() may be read from any task.
+template <typename Record, size_t CAPACITY, typename Hash>
+class FixedTable {
+public:
+    static const size_t SLOT_COUNT = CAPACITY * 2;
+    static const uint16_t EMPTY_SLOT = 0xFFFF;
+
+    static_assert((CAPACITY & (CAPACITY - 1)) == 0, "Table capacities must be powers of 2");
+    static_assert(SLOT_COUNT < EMPTY_SLOT, "Table capacity too large for 16-bit slots");
+
+    FixedTable() : clock_hand(0), count(0) {
+        memset(slots, 0xFF, sizeof(slots));
+    }
+
+    FixedTable(const FixedTable&) = delete;
+    FixedTable& operator=(const FixedTable&) = delete;
+
+    // Index slot of the record `match` accepts among those hashing to
+    // `hash`, or the empty slot ending its probe run
+    template <typename Match>
+    size_t find(uint32_t hash, Match match) const {
+        size_t slot = home_slot(hash);
+        while (slots[slot] != EMPTY_SLOT && !match(records[slots[slot]])) {
+            slot = next_slot(slot);
+        }
+        return slot;
+    }
+
+    bool occupied(size_t slot) const { return slots[slot] != EMPTY_SLOT; }
+    Record& at_slot(size_t slot) { return records[slots[slot]]; }
+    const Record& at_slot(size_t slot) const { return records[slots[slot]]; }
+
+    // Take a record for the empty `slot` find() returned; nullptr when the
+    // table is full. Its contents are left to the caller.
+    Record* insert(size_t slot) {
+        uint32_t used = count.load(std::memory_order_relaxed);
+        if (used == CAPACITY) {
+            return nullptr;
+        }
+        slots[slot] = (uint16_t)used;
+        count.store(used + 1, std::memory_order_relaxed);
+        return &records[used];
+    }
+
+    // Same, but a full table reclaims the record the clock sweep picks;
+    // `evicted` tells whether one was. `hash` is the new key's.
+    Record* insert_evict(size_t slot, uint32_t hash, bool* evicted) {
+        *evicted = count.load(std::memory_order_relaxed) == CAPACITY;
+        if (!*evicted) {
+            return insert(slot);
+        }
+
+        // Second chance: skip records touched since the hand last passed them
+        while (records[clock_hand].referenced) {
+            records[clock_hand].referenced = 0;
+            clock_hand = (clock_hand + 1) & (CAPACITY - 1);
+        }
+        uint16_t victim = (uint16_t)clock_hand;
+        clock_hand = (clock_hand + 1) & (CAPACITY - 1);
+        unlink(victim);
+
+        // Unlinking may have shifted entries back into the new key's probe run
+        slot = home_slot(hash);
+        while (slots[slot] != EMPTY_SLOT) {
+            slot = next_slot(slot);
+        }
+        slots[slot] = victim;
+        return &records[victim];
+    }
+
+    // Remove a record; the last record moves into its place, so a loop over
+    // [0, size()) visits the same index again
+    void remove(const Record* record) {
+        uint16_t index = (uint16_t)(record - records);
+        uint16_t last = (uint16_t)(count.load(std::memory_order_relaxed) - 1);
+        unlink(index);
+        if (index != last) {
+            slots[slot_of(last)] = index;
+            records[index] = records[last];
+        }
+        count.store(last, std::memory_order_relaxed);
+    }
+
+    // Forget every record
+    void clear() {
+        memset(slots, 0xFF, sizeof(slots));
+        clock_hand = 0;
+        count.store(0, std::memory_order_relaxed);
+    }
+
+    // Records in use are [0, size())
+    Record& operator[](size_t index) { return records[index]; }
+    const Record& operator[](size_t index) const { return records[index]; }
+
+    size_t size() const { return count.load(std::memory_order_relaxed); }
+
+private:
+    // The product's high bits are the best mixed
+    static size_t home_slot(uint32_t hash) { return (size_t)(hash * 0x9E3779B1u >> 16) & (SLOT_COUNT - 1); }
+    static size_t next_slot(size_t slot) { return (slot + 1) & (SLOT_COUNT - 1); }
+
+    // Index slot holding record `index`
+    size_t slot_of(uint16_t index) const {
+        size_t slot = home_slot(Hash()(records[index]));
+        while (slots[slot] != index) {
+            slot = next_slot(slot);
+        }
+        return slot;
+    }
+
+    // Take record `index` out of the index, shifting later members of its probe run back
+    void unlink(uint16_t index) {
+        size_t hole = slot_of(index);
+        size_t next = next_slot(hole);
+        while (slots[next] != EMPTY_SLOT) {
+            size_t home = home_slot(Hash()(records[slots[next]]));
+            // Move the entry into the hole unless its home lies cyclically in (hole, next]
+            if (((next - home) & (SLOT_COUNT - 1)) >= ((next - hole) & (SLOT_COUNT - 1))) {
+                slots[hole] = slots[next];
+                hole = next;
+            }
+            next = next_slot(next);
+        }
+        slots[hole] = EMPTY_SLOT;
+    }
+
+    Record records[CAPACITY];
+    uint16_t slots[SLOT_COUNT];
+    size_t clock_hand;
+    std::atomic<uint32_t> count;
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Keys of the sniffer's tables: 6-byte MAC addresses, optionally tagged
+// with a small discriminator, and byte strings such as SSIDs.
+
+#define FNV1A_OFFSET    2166136261u
+#define FNV1A_PRIME     16777619u
+
+inline bool mac_equal(const uint8_t* a, const uint8_t* b) {
+    return memcmp(a, b, 6) == 0;
+}
+
+// Individual address; group addresses have bit 0 of the first octet set
+inline bool mac_unicast(const uint8_t* mac) {
+    return !(mac[0] & 0x01);
+}
+
+// Multiplicative hash of the 48-bit address with `tag` in bits 48-55; the
+// top half of the product is the best mixed
+inline uint32_t mac_hash(const uint8_t* mac, uint8_t tag = 0) {
+    uint64_t key = (uint64_t)mac[0] | (uint64_t)mac[1] << 8 | (uint64_t)mac[2] << 16 |
+                   (uint64_t)mac[3] << 24 | (uint64_t)mac[4] << 32 | (uint64_t)mac[5] << 40 |
+                   (uint64_t)tag << 48;
+    return (uint32_t)((key * 0x9E3779B97F4A7C15ull) >> 32);
+}
+
+// FNV-1a of `len` bytes, continuing from `hash`
+inline uint32_t fnv1a(const uint8_t* data, size_t len, uint32_t hash = FNV1A_OFFSET) {
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ data[i]) * FNV1A_PRIME;
+    }
+    return hash;
+}
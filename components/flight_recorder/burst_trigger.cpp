@@ -0,0 +1,57 @@
+#include "burst_trigger.h"
+#include <stdio.h>
+
+BurstTrigger::BurstTrigger()
+    : window_us(0), burst(0), next(0), filled(0) {
+}
+
+bool BurstTrigger::configure(const char* expression, uint16_t frames, uint32_t window_ms,
+                             char* error, size_t error_len) {
+    burst = 0;
+    next = 0;
+    filled = 0;
+    if (frames == 0 || frames > BURST_TRIGGER_MAX_FRAMES) {
+        if (error && error_len) {
+            snprintf(error, error_len, "burst size must be 1-%d", BURST_TRIGGER_MAX_FRAMES);
+        }
+        return false;
+    }
+    if (!filter.compile(expression, error, error_len)) {
+        return false;
+    }
+    burst = frames;
+    window_us = (int64_t)window_ms * 1000;
+    return true;
+}
+
+bool BurstTrigger::on_frame(const FrameView& frame) {
+    if (burst == 0) {
+        return false;
+    }
+
+    FilterInput input;
+    input.payload = frame.payload;
+    input.len = frame.len;
+    input.frame_len = frame.orig_len;
+    input.rssi = frame.rx_ctrl->rssi;
+    input.channel = frame.rx_ctrl->channel;
+    if (!filter.matches(input)) {
+        return false;
+    }
+
+    matched_us[next] = frame.timestamp_us;
+    next = next + 1 == burst ? 0 : next + 1;
+    if (filled < burst) {
+        filled++;
+        if (filled < burst) {
+            return false;
+        }
+    }
+    // Once full, the next slot holds the oldest of the last `burst` matches,
+    // this one included
+    if (frame.timestamp_us - matched_us[next] > window_us) {
+        return false;
+    }
+    filled = 0;
+    return true;
+}
@@ -0,0 +1,338 @@
+#include "flight_recorder.h"
+#include <string.h>
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "pipeline_runtime.h"
+
+static const char* TAG = "FLIGHT_RECORDER";
+
+// One frame in the ring: this header, then the payload, padded so that the
+// next header is aligned
+struct RecordHeader {
+    uint32_t size;              // Record bytes, RECORD_WRAP for the unused end of the ring
+    uint16_t len;
+    uint16_t orig_len;
+    int64_t timestamp_us;
+    int64_t reference_us;
+    wifi_pkt_rx_ctrl_t rx_ctrl;
+    wifi_promiscuous_pkt_type_t type;
+};
+
+#define RECORD_ALIGN    8
+#define RECORD_WRAP     0xFFFFFFFFu
+
+static inline size_t align_record(size_t bytes) {
+    return (bytes + RECORD_ALIGN - 1) & ~(size_t)(RECORD_ALIGN - 1);
+}
+
+FlightRecorderConfig flight_recorder_default_config() {
+    FlightRecorderConfig config;
+#if FLIGHT_RECORDER_USE_PSRAM
+    config.ring_bytes = 1024 * 1024;
+#else
+    config.ring_bytes = 64 * 1024;
+#endif
+    config.pre_trigger_ms = 10000;
+    config.post_trigger_ms = 2000;
+    config.holdoff_ms = 10000;
+    return config;
+}
+
+FlightRecorder::FlightRecorder()
+    : cfg(flight_recorder_default_config()), exporter(), trigger_count(0),
+      ring(nullptr), capacity(0), head(0), tail(0), used(0),
+      written_bytes(0), pinned(false), pin_offset(0), pin_written(0), snapshot(), last_trigger_us(0),
+      snapshot_seq(0), requested(nullptr), task_handle(nullptr),
+      recorded_count(0), overwritten_count(0), dropped_count(0), used_bytes(0),
+      triggered_count(0), suppressed_count(0), snapshot_count(0), exported_count(0),
+      export_lost_count(0) {
+}
+
+FlightRecorder::~FlightRecorder() {
+    if (task_handle) {
+        pipeline_unregister_task(task_handle);
+        vTaskDelete(task_handle);
+    }
+    heap_caps_free(ring);
+}
+
+esp_err_t FlightRecorder::start(const FlightRecorderConfig& config) {
+    if (ring != nullptr) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    size_t bytes = config.ring_bytes & ~(size_t)(RECORD_ALIGN - 1);
+    if (bytes < 4 * align_record(sizeof(RecordHeader) + SNIFFER_SNAPLEN)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+#if FLIGHT_RECORDER_USE_PSRAM
+    ring = (uint8_t*)heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+#else
+    ring = (uint8_t*)heap_caps_malloc(bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+#endif
+    if (ring == nullptr) {
+        ESP_LOGE(TAG, "Failed to allocate a %lu byte ring", (uint32_t)bytes);
+        return ESP_ERR_NO_MEM;
+    }
+    cfg = config;
+    capacity = bytes;
+    head = 0;
+    tail = 0;
+    used = 0;
+
+    if (pipeline_create_task(PIPELINE_STAGE_EXPORT, &FlightRecorder::export_task, "flight_rec",
+                             EXPORT_TASK_STACK, this, EXPORT_TASK_PRIORITY, &task_handle) != ESP_OK) {
+        task_handle = nullptr;
+        heap_caps_free(ring);
+        ring = nullptr;
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "Recording into %lu bytes of %s, %lu ms before and %lu ms after a trigger",
+             (uint32_t)capacity, FLIGHT_RECORDER_USE_PSRAM ? "PSRAM" : "internal RAM",
+             cfg.pre_trigger_ms, cfg.post_trigger_ms);
+    return ESP_OK;
+}
+
+esp_err_t FlightRecorder::add_trigger(recorder_trigger_t trigger, void* ctx, const char* reason) {
+    if (trigger == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (trigger_count == FLIGHT_RECORDER_MAX_TRIGGERS) {
+        return ESP_ERR_NO_MEM;
+    }
+    triggers[trigger_count].trigger = trigger;
+    triggers[trigger_count].ctx = ctx;
+    triggers[trigger_count].reason = reason;
+    trigger_count++;
+    return ESP_OK;
+}
+
+void FlightRecorder::set_exporter(const RecorderExporter& new_exporter) {
+    exporter = new_exporter;
+}
+
+void FlightRecorder::trigger(const char* reason) {
+    requested.store(reason ? reason : "manual", std::memory_order_release);
+}
+
+size_t FlightRecorder::record_size(size_t offset) const {
+    const RecordHeader* header = (const RecordHeader*)(ring + offset);
+    return header->size == RECORD_WRAP ? capacity - offset : header->size;
+}
+
+bool FlightRecorder::make_room(size_t bytes) {
+    while (capacity - used < bytes) {
+        if (pinned.load(std::memory_order_acquire) && tail == pin_offset) {
+            return false;
+        }
+        const RecordHeader* header = (const RecordHeader*)(ring + tail);
+        if (header->size != RECORD_WRAP) {
+            overwritten_count.fetch_add(1, std::memory_order_relaxed);
+        }
+        size_t size = record_size(tail);
+        tail += size;
+        if (tail == capacity) {
+            tail = 0;
+        }
+        used -= size;
+    }
+    return true;
+}
+
+void FlightRecorder::on_frame(const FrameView& frame) {
+    if (ring == nullptr) {
+        return;
+    }
+
+    size_t need = align_record(sizeof(RecordHeader) + frame.len);
+    bool stored = false;
+    if (capacity - head < need) {
+        // Not enough room before the end: mark the rest unused and go round
+        size_t rest = capacity - head;
+        if (make_room(rest)) {
+            ((RecordHeader*)(ring + head))->size = RECORD_WRAP;
+            used += rest;
+            head = 0;
+            written_bytes.fetch_add((uint32_t)rest, std::memory_order_release);
+        }
+    }
+    if (capacity - head >= need && make_room(need)) {
+        RecordHeader* header = (RecordHeader*)(ring + head);
+        header->size = (uint32_t)need;
+        header->len = frame.len;
+        header->orig_len = frame.orig_len;
+        header->timestamp_us = frame.timestamp_us;
+        header->reference_us = frame.reference_us;
+        header->rx_ctrl = *frame.rx_ctrl;
+        header->type = frame.type;
+        memcpy(header + 1, frame.payload, frame.len);
+        head += need;
+        if (head == capacity) {
+            head = 0;
+        }
+        used += need;
+        stored = true;
+    }
+
+    if (stored) {
+        // Publishes the record to the export task
+        written_bytes.fetch_add((uint32_t)need, std::memory_order_release);
+        recorded_count.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        dropped_count.fetch_add(1, std::memory_order_relaxed);
+    }
+    used_bytes.store((uint32_t)used, std::memory_order_relaxed);
+
+    if (requested.load(std::memory_order_relaxed) != nullptr) {
+        const char* reason = requested.exchange(nullptr, std::memory_order_acquire);
+        if (reason) {
+            start_snapshot(frame.timestamp_us, reason);
+        }
+    }
+    for (size_t i = 0; i < trigger_count; i++) {
+        if (triggers[i].trigger(frame, triggers[i].ctx)) {
+            start_snapshot(frame.timestamp_us, triggers[i].reason);
+            break;
+        }
+    }
+}
+
+void FlightRecorder::start_snapshot(int64_t trigger_us, const char* reason) {
+    if (pinned.load(std::memory_order_acquire) ||
+        (snapshot_seq != 0 && trigger_us - last_trigger_us < (int64_t)cfg.holdoff_ms * 1000)) {
+        suppressed_count.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    last_trigger_us = trigger_us;
+
+    // Oldest record inside the pre-trigger window. Linear, but only once per snapshot.
+    int64_t from_us = trigger_us - (int64_t)cfg.pre_trigger_ms * 1000;
+    size_t offset = tail;
+    size_t walked = 0;
+    while (walked < used) {
+        const RecordHeader* header = (const RecordHeader*)(ring + offset);
+        if (header->size != RECORD_WRAP && header->timestamp_us >= from_us) {
+            break;
+        }
+        size_t size = record_size(offset);
+        walked += size;
+        offset += size;
+        if (offset == capacity) {
+            offset = 0;
+        }
+    }
+    pin_offset = offset;
+    pin_written = written_bytes.load(std::memory_order_relaxed) - (uint32_t)(used - walked);
+
+    snapshot.id = ++snapshot_seq;
+    snapshot.reason = reason;
+    snapshot.trigger_us = trigger_us;
+    snapshot.start_us = 0;
+    snapshot.end_us = 0;
+    pinned.store(true, std::memory_order_release);
+    triggered_count.fetch_add(1, std::memory_order_relaxed);
+    xTaskNotifyGive(task_handle);
+}
+
+void FlightRecorder::export_snapshot() {
+    RecorderSnapshot info = snapshot;
+    int64_t end_us = info.trigger_us + (int64_t)cfg.post_trigger_ms * 1000;
+    uint32_t window = written_bytes.load(std::memory_order_acquire) - pin_written;
+
+    // Receive times of the window, for begin()
+    size_t offset = pin_offset;
+    uint32_t walked = 0;
+    uint32_t frames = 0;
+    while (walked < window) {
+        const RecordHeader* header = (const RecordHeader*)(ring + offset);
+        if (header->size != RECORD_WRAP && header->timestamp_us <= end_us) {
+            if (frames == 0) {
+                info.start_us = header->timestamp_us;
+            }
+            info.end_us = header->timestamp_us;
+            frames++;
+        }
+        size_t size = record_size(offset);
+        walked += size;
+        offset = offset + size == capacity ? 0 : offset + size;
+    }
+
+    ESP_LOGI(TAG, "Snapshot %lu (%s): %lu frames over %lu ms", info.id, info.reason, frames,
+             (uint32_t)((info.end_us - info.start_us) / 1000));
+    if (frames == 0 || exporter.frame == nullptr ||
+        (exporter.begin && !exporter.begin(info, exporter.ctx))) {
+        return;
+    }
+
+    uint32_t exported = 0;
+    offset = pin_offset;
+    walked = 0;
+    while (walked < window) {
+        const RecordHeader* header = (const RecordHeader*)(ring + offset);
+        if (header->size != RECORD_WRAP && header->timestamp_us <= end_us) {
+            FrameView view = {};
+            view.payload = (const uint8_t*)(header + 1);
+            view.len = header->len;
+            view.orig_len = header->orig_len;
+            view.rx_ctrl = &header->rx_ctrl;
+            view.type = header->type;
+            view.timestamp_us = header->timestamp_us;
+            view.reference_us = header->reference_us;
+
+            int64_t give_up_us = esp_timer_get_time() + FLIGHT_RECORDER_EXPORT_TIMEOUT_MS * 1000;
+            bool done;
+            while (!(done = exporter.frame(view, exporter.ctx)) && esp_timer_get_time() < give_up_us) {
+                vTaskDelay(pdMS_TO_TICKS(FLIGHT_RECORDER_EXPORT_RETRY_MS));
+            }
+            if (done) {
+                exported++;
+            } else {
+                export_lost_count.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        size_t size = record_size(offset);
+        walked += size;
+        offset = offset + size == capacity ? 0 : offset + size;
+    }
+    exported_count.fetch_add(exported, std::memory_order_relaxed);
+
+    if (exporter.end) {
+        exporter.end(info, exported, exporter.ctx);
+    }
+}
+
+void FlightRecorder::export_task(void* arg) {
+    FlightRecorder* recorder = static_cast<FlightRecorder*>(arg);
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        // Let the post-trigger part of the window fill in
+        int64_t end_us = recorder->snapshot.trigger_us + (int64_t)recorder->cfg.post_trigger_ms * 1000;
+        int64_t wait_us = end_us - esp_timer_get_time();
+        if (wait_us > 0) {
+            vTaskDelay(pdMS_TO_TICKS(wait_us / 1000) + 1);
+        }
+
+        recorder->export_snapshot();
+        recorder->snapshot_count.fetch_add(1, std::memory_order_relaxed);
+        recorder->pinned.store(false, std::memory_order_release);
+    }
+}
+
+FlightRecorderStats FlightRecorder::get_stats() const {
+    FlightRecorderStats stats;
+    stats.recorded = recorded_count.load(std::memory_order_relaxed);
+    stats.overwritten = overwritten_count.load(std::memory_order_relaxed);
+    stats.dropped = dropped_count.load(std::memory_order_relaxed);
+    stats.ring_bytes = (uint32_t)capacity;
+    stats.ring_used = used_bytes.load(std::memory_order_relaxed);
+    stats.triggers = triggered_count.load(std::memory_order_relaxed);
+    stats.suppressed = suppressed_count.load(std::memory_order_relaxed);
+    stats.snapshots = snapshot_count.load(std::memory_order_relaxed);
+    stats.exported = exported_count.load(std::memory_order_relaxed);
+    stats.export_lost = export_lost_count.load(std::memory_order_relaxed);
+    return stats;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "network_sniffer.h"
+#include "packet_filter.h"
+
+// Longest burst a BurstTrigger can count
+#define BURST_TRIGGER_MAX_FRAMES    64
+
+// Flight recorder trigger that fires when `frames` frames matching a filter
+// expression (see packet_filter.h) arrive within `window_ms`, e.g. a
+// deauthentication burst:
+//
+//   BurstTrigger deauth;
+//   deauth.configure("subtype deauth or subtype disassoc", 10, 1000);
+//   recorder.add_trigger(&deauth, "deauth burst");
+//
+// After firing it starts counting afresh. Calls must be serialized, as
+// they are when it runs inside a FlightRecorder.
+class BurstTrigger {
+public:
+    BurstTrigger();
+
+    // Compile the expression and set the burst size and window. On failure
+    // the trigger never fires and a message is written to `error`.
+    bool configure(const char* expression, uint16_t frames, uint32_t window_ms,
+                   char* error = nullptr, size_t error_len = 0);
+
+    bool on_frame(const FrameView& frame);
+
+private:
+    PacketFilter filter;
+    int64_t window_us;
+    uint16_t burst;
+    uint16_t next;              // Oldest of the last `burst` matches once `filled` reaches `burst`
+    uint16_t filled;
+    int64_t matched_us[BURST_TRIGGER_MAX_FRAMES];
+};
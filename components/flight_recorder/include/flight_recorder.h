@@ -0,0 +1,190 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "network_sniffer.h"
+
+// Whether the ring goes to external RAM. Follows the PSRAM malloc option.
+#ifndef FLIGHT_RECORDER_USE_PSRAM
+#ifdef CONFIG_SPIRAM_USE_MALLOC
+#define FLIGHT_RECORDER_USE_PSRAM   1
+#else
+#define FLIGHT_RECORDER_USE_PSRAM   0
+#endif
+#endif
+
+// Most triggers evaluated at once
+#define FLIGHT_RECORDER_MAX_TRIGGERS    4
+
+// An exporter that stays busy this long loses the frame
+#define FLIGHT_RECORDER_EXPORT_RETRY_MS     10
+#define FLIGHT_RECORDER_EXPORT_TIMEOUT_MS   2000
+
+struct FlightRecorderConfig {
+    size_t ring_bytes;          // Frames, metadata included, kept before a trigger
+    uint32_t pre_trigger_ms;    // Window exported before the trigger
+    uint32_t post_trigger_ms;   // and after it
+    uint32_t holdoff_ms;        // Least time between two triggers that start a snapshot
+};
+
+// 1 MB of PSRAM with FLIGHT_RECORDER_USE_PSRAM, else 64 KB of internal RAM;
+// 10 s before and 2 s after a trigger, 10 s holdoff
+FlightRecorderConfig flight_recorder_default_config();
+
+// Frame predicate: true starts a snapshot. Called from the sniffer's
+// processing task for every recorded frame.
+typedef bool (*recorder_trigger_t)(const FrameView& frame, void* ctx);
+
+// A frozen window being exported
+struct RecorderSnapshot {
+    uint32_t id;                // 1 for the first snapshot
+    const char* reason;         // Name of the trigger that fired
+    int64_t trigger_us;         // FrameView::timestamp_us of the triggering frame
+    int64_t start_us;           // First and last receive time exported
+    int64_t end_us;
+};
+
+// Where snapshots go. Called from the recorder's export task, one snapshot
+// at a time. Frames are replayed as FrameViews without `parsed` and
+// without a pool; everything else is as recorded.
+struct RecorderExporter {
+    // Before the first frame; false skips the snapshot
+    bool (*begin)(const RecorderSnapshot& snapshot, void* ctx);
+    // One frame; false means busy, and the frame is offered again every
+    // FLIGHT_RECORDER_EXPORT_RETRY_MS until FLIGHT_RECORDER_EXPORT_TIMEOUT_MS
+    bool (*frame)(const FrameView& frame, void* ctx);
+    // After the last frame, with the number exported
+    void (*end)(const RecorderSnapshot& snapshot, uint32_t frames, void* ctx);
+    void* ctx;
+};
+
+struct FlightRecorderStats {
+    uint32_t recorded;          // Frames written to the ring
+    uint32_t overwritten;       // Oldest frames overwritten to make room
+    uint32_t dropped;           // Frames not recorded: the exported window filled the ring, or too large
+    uint32_t ring_bytes;
+    uint32_t ring_used;
+    uint32_t triggers;          // Triggers that started a snapshot
+    uint32_t suppressed;        // Triggers during a snapshot or holdoff
+    uint32_t snapshots;         // Snapshots exported
+    uint32_t exported;          // Frames exported
+    uint32_t export_lost;       // Frames the exporter stayed busy for
+};
+
+// Always-on pre-trigger capture.
+//
+// Subscribed as a frame sink, the recorder copies every frame with its
+// metadata into a byte ring, overwriting the oldest when full: O(1) per
+// frame, nothing allocated after start(). Each frame is run through the
+// triggers (and trigger() requests from other tasks). When one fires, the
+// frames from pre_trigger_ms before it are pinned so that they cannot be
+// overwritten, and once post_trigger_ms has passed an export task replays
+// the window to the exporter, e.g. into a PcapWriter or over Bluetooth.
+// Recording goes on meanwhile in the rest of the ring.
+class FlightRecorder {
+public:
+    FlightRecorder();
+    ~FlightRecorder();
+
+    FlightRecorder(const FlightRecorder&) = delete;
+    FlightRecorder& operator=(const FlightRecorder&) = delete;
+
+    // Allocate the ring and start the export task
+    esp_err_t start(const FlightRecorderConfig& config = flight_recorder_default_config());
+
+    // Add a trigger; call before subscribing the recorder to the sniffer.
+    // `reason` must outlive the recorder.
+    esp_err_t add_trigger(recorder_trigger_t trigger, void* ctx, const char* reason);
+
+    // Add an object exposing `bool on_frame(const FrameView& frame)`
+    template <typename Trigger>
+    esp_err_t add_trigger(Trigger* trigger, const char* reason) {
+        return add_trigger(&FlightRecorder::trigger_trampoline<Trigger>, trigger, reason);
+    }
+
+    // Set where snapshots go; call before start()
+    void set_exporter(const RecorderExporter& exporter);
+
+    // Request a snapshot from any task, e.g. on an external event. It starts
+    // at the next recorded frame. `reason` must outlive the recorder.
+    void trigger(const char* reason);
+
+    // Frame sink entry point, called from the sniffer's processing task
+    void on_frame(const FrameView& frame);
+
+    FlightRecorderStats get_stats() const;
+
+private:
+    struct TriggerEntry {
+        recorder_trigger_t trigger;
+        void* ctx;
+        const char* reason;
+    };
+
+    template <typename Trigger>
+    static bool trigger_trampoline(const FrameView& frame, void* ctx) {
+        return static_cast<Trigger*>(ctx)->on_frame(frame);
+    }
+
+    static void export_task(void* arg);
+
+    // Make `bytes` contiguous bytes free at `head`, overwriting the oldest
+    // frames; false if the pinned window is in the way
+    bool make_room(size_t bytes);
+
+    // Size of the record at `offset`, the rest of the ring for a wrap marker
+    size_t record_size(size_t offset) const;
+
+    // Pin the window around a trigger at `trigger_us` and wake the exporter
+    void start_snapshot(int64_t trigger_us, const char* reason);
+
+    // Replay the pinned window to the exporter
+    void export_snapshot();
+
+    FlightRecorderConfig cfg;
+    RecorderExporter exporter;
+    TriggerEntry triggers[FLIGHT_RECORDER_MAX_TRIGGERS];
+    size_t trigger_count;
+
+    // Byte ring, written only by the processing task. Records occupy
+    // [tail, head) circularly; `used` counts their bytes.
+    uint8_t* ring;
+    size_t capacity;
+    size_t head;
+    size_t tail;
+    size_t used;
+
+    // Bytes ever written, markers included; publishes records to the export task
+    std::atomic<uint32_t> written_bytes;
+
+    // Snapshot handed to the export task. The writer sets `pinned` and the
+    // fields below, the export task clears it when done.
+    std::atomic<bool> pinned;
+    size_t pin_offset;          // First record of the window
+    uint32_t pin_written;       // written_bytes at pin_offset
+    RecorderSnapshot snapshot;
+    int64_t last_trigger_us;
+    uint32_t snapshot_seq;
+
+    // trigger() requests from other tasks
+    std::atomic<const char*> requested;
+
+    TaskHandle_t task_handle;
+
+    std::atomic<uint32_t> recorded_count;
+    std::atomic<uint32_t> overwritten_count;
+    std::atomic<uint32_t> dropped_count;
+    std::atomic<uint32_t> used_bytes;
+    std::atomic<uint32_t> triggered_count;
+    std::atomic<uint32_t> suppressed_count;
+    std::atomic<uint32_t> snapshot_count;
+    std::atomic<uint32_t> exported_count;
+    std::atomic<uint32_t> export_lost_count;
+
+    static const uint32_t EXPORT_TASK_STACK = 4096;
+    static const UBaseType_t EXPORT_TASK_PRIORITY = 4;
+};
@@ -0,0 +1,259 @@
+#include "frame_pool.h"
+#include <new>
+#include <string.h>
+#include "esp_log.h"
+
+const char* FramePool::TAG = "FRAME_POOL";
+
+static const uint16_t class_sizes[FRAME_POOL_CLASS_COUNT] = {
+    FRAME_POOL_SMALL, FRAME_POOL_MEDIUM, FRAME_POOL_LARGE
+};
+
+static const uint32_t tier_caps[FRAME_POOL_TIER_COUNT] = {
+    MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT,
+    MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT
+};
+
+static const char* tier_names[FRAME_POOL_TIER_COUNT] = { "internal", "PSRAM" };
+
+FramePoolConfig frame_pool_default_config() {
+    FramePoolConfig config = {};
+    config.blocks[FRAME_POOL_TIER_INTERNAL][0] = 16;
+    config.blocks[FRAME_POOL_TIER_INTERNAL][1] = 16;
+    config.blocks[FRAME_POOL_TIER_INTERNAL][2] = 2;
+#if FRAME_POOL_USE_PSRAM
+    config.blocks[FRAME_POOL_TIER_PSRAM][0] = 64;
+    config.blocks[FRAME_POOL_TIER_PSRAM][1] = 64;
+    config.blocks[FRAME_POOL_TIER_PSRAM][2] = 16;
+#endif
+    return config;
+}
+
+FramePool::FramePool()
+    : blocks(nullptr), block_count(0), regions(), region_bytes(),
+      alloc_count(0), failure_count(0), spill_count(0) {
+    for (Subpool& subpool : subpools) {
+        subpool.base = nullptr;
+        subpool.first = 0;
+        subpool.count = 0;
+        subpool.block_size = 0;
+        subpool.stride = 0;
+        subpool.head.store(FREE_LIST_END);
+        subpool.in_use.store(0);
+        subpool.peak.store(0);
+    }
+}
+
+FramePool::~FramePool() {
+    free_regions();
+}
+
+void FramePool::free_regions() {
+    // The block headers sit at the start of the internal region
+    for (uint16_t i = 0; i < block_count; i++) {
+        blocks[i].~Block();
+    }
+    for (size_t tier = 0; tier < FRAME_POOL_TIER_COUNT; tier++) {
+        heap_caps_free(regions[tier]);
+        regions[tier] = nullptr;
+        region_bytes[tier] = 0;
+    }
+    blocks = nullptr;
+    block_count = 0;
+}
+
+esp_err_t FramePool::init(const FramePoolConfig& config) {
+    if (blocks != nullptr) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Without PSRAM malloc that tier stays empty
+    FramePoolConfig counts = config;
+#if !FRAME_POOL_USE_PSRAM
+    bool ignored = false;
+    for (size_t cls = 0; cls < FRAME_POOL_CLASS_COUNT; cls++) {
+        ignored |= counts.blocks[FRAME_POOL_TIER_PSRAM][cls] != 0;
+        counts.blocks[FRAME_POOL_TIER_PSRAM][cls] = 0;
+    }
+    if (ignored) {
+        ESP_LOGW(TAG, "PSRAM malloc is disabled, PSRAM blocks are ignored");
+    }
+#endif
+
+    uint32_t total = 0;
+    for (size_t tier = 0; tier < FRAME_POOL_TIER_COUNT; tier++) {
+        for (size_t cls = 0; cls < FRAME_POOL_CLASS_COUNT; cls++) {
+            total += counts.blocks[tier][cls];
+        }
+    }
+    if (total == 0 || total > FRAME_POOL_MAX_BLOCKS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Size each tier: block headers first in the internal region, then the
+    // classes back to back
+    uint32_t offsets[FRAME_POOL_TIER_COUNT][FRAME_POOL_CLASS_COUNT];
+    uint32_t headers = (uint32_t)total * sizeof(Block);
+    for (size_t tier = 0; tier < FRAME_POOL_TIER_COUNT; tier++) {
+        uint32_t bytes = tier == FRAME_POOL_TIER_INTERNAL ? headers : 0;
+        for (size_t cls = 0; cls < FRAME_POOL_CLASS_COUNT; cls++) {
+            offsets[tier][cls] = bytes;
+            bytes += (uint32_t)counts.blocks[tier][cls] * ((class_sizes[cls] + 3u) & ~3u);
+        }
+        region_bytes[tier] = bytes;
+    }
+
+    for (size_t tier = 0; tier < FRAME_POOL_TIER_COUNT; tier++) {
+        if (region_bytes[tier] == 0) {
+            continue;
+        }
+        regions[tier] = heap_caps_malloc(region_bytes[tier], tier_caps[tier]);
+        if (regions[tier] == nullptr) {
+            ESP_LOGE(TAG, "Failed to allocate %lu bytes of %s RAM", region_bytes[tier], tier_names[tier]);
+            free_regions();
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    blocks = (Block*)regions[FRAME_POOL_TIER_INTERNAL];
+    uint16_t index = 0;
+    for (size_t tier = 0; tier < FRAME_POOL_TIER_COUNT; tier++) {
+        for (size_t cls = 0; cls < FRAME_POOL_CLASS_COUNT; cls++) {
+            size_t id = tier * FRAME_POOL_CLASS_COUNT + cls;
+            Subpool& subpool = subpools[id];
+            subpool.base = (uint8_t*)regions[tier] + offsets[tier][cls];
+            subpool.first = index;
+            subpool.count = counts.blocks[tier][cls];
+            subpool.block_size = class_sizes[cls];
+            subpool.stride = (class_sizes[cls] + 3u) & ~3u;
+            subpool.head.store(FREE_LIST_END);
+            subpool.in_use.store(0);
+            subpool.peak.store(0);
+
+            for (uint16_t i = 0; i < subpool.count; i++, index++) {
+                Block* block = new (&blocks[index]) Block();
+                block->data = subpool.base + (size_t)i * subpool.stride;
+                block->refs.store(0);
+                block->size = 0;
+                block->subpool = (uint8_t)id;
+            }
+            // Pushed in reverse so the lowest addresses are handed out first
+            for (uint16_t i = subpool.count; i > 0; i--) {
+                push(subpool, subpool.first + i - 1);
+            }
+        }
+    }
+    block_count = index;
+
+    ESP_LOGI(TAG, "%u blocks in %lu bytes of internal RAM and %lu bytes of PSRAM", block_count,
+             region_bytes[FRAME_POOL_TIER_INTERNAL], region_bytes[FRAME_POOL_TIER_PSRAM]);
+    return ESP_OK;
+}
+
+uint16_t FramePool::pop(Subpool& subpool) {
+    uint32_t head = subpool.head.load(std::memory_order_acquire);
+    while ((uint16_t)head != FREE_LIST_END) {
+        uint16_t index = (uint16_t)head;
+        // The tag changes on every update, so a block that was taken and
+        // returned in between makes the exchange fail instead of linking a stale next
+        uint32_t next = blocks[index].next.load(std::memory_order_relaxed);
+        uint32_t replacement = ((head + 0x10000u) & 0xFFFF0000u) | next;
+        if (subpool.head.compare_exchange_weak(head, replacement, std::memory_order_acquire,
+                                               std::memory_order_acquire)) {
+            return index;
+        }
+    }
+    return FREE_LIST_END;
+}
+
+void FramePool::push(Subpool& subpool, uint16_t index) {
+    uint32_t head = subpool.head.load(std::memory_order_relaxed);
+    uint32_t replacement;
+    do {
+        blocks[index].next.store(head & 0xFFFFu, std::memory_order_relaxed);
+        replacement = ((head + 0x10000u) & 0xFFFF0000u) | index;
+    } while (!subpool.head.compare_exchange_weak(head, replacement, std::memory_order_release,
+                                                 std::memory_order_relaxed));
+}
+
+FrameHandle FramePool::alloc(size_t size) {
+    if (blocks == nullptr || size > FRAME_POOL_LARGE) {
+        failure_count.fetch_add(1, std::memory_order_relaxed);
+        return FrameHandle();
+    }
+
+    bool best_fit = true;
+    for (size_t cls = 0; cls < FRAME_POOL_CLASS_COUNT; cls++) {
+        if (size > class_sizes[cls]) {
+            continue;
+        }
+        for (size_t tier = 0; tier < FRAME_POOL_TIER_COUNT; tier++) {
+            Subpool& subpool = subpools[tier * FRAME_POOL_CLASS_COUNT + cls];
+            if (subpool.count == 0) {
+                continue;
+            }
+            uint16_t index = pop(subpool);
+            if (index == FREE_LIST_END) {
+                best_fit = false;
+                continue;
+            }
+
+            uint32_t used = subpool.in_use.fetch_add(1, std::memory_order_relaxed) + 1;
+            uint32_t peak = subpool.peak.load(std::memory_order_relaxed);
+            while (used > peak && !subpool.peak.compare_exchange_weak(peak, used, std::memory_order_relaxed)) {
+            }
+            alloc_count.fetch_add(1, std::memory_order_relaxed);
+            if (!best_fit) {
+                spill_count.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            Block& block = blocks[index];
+            block.refs.store(1, std::memory_order_relaxed);
+            block.size = (uint16_t)size;
+            return FrameHandle(this, index);
+        }
+        best_fit = false;
+    }
+
+    failure_count.fetch_add(1, std::memory_order_relaxed);
+    return FrameHandle();
+}
+
+FrameHandle FramePool::copy(const uint8_t* data, size_t len) {
+    FrameHandle handle = alloc(len);
+    if (handle) {
+        memcpy(handle.data(), data, len);
+    }
+    return handle;
+}
+
+void FramePool::release(uint16_t index) {
+    Block& block = blocks[index];
+    if (block.refs.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+        return;
+    }
+    Subpool& subpool = subpools[block.subpool];
+    subpool.in_use.fetch_sub(1, std::memory_order_relaxed);
+    push(subpool, index);
+}
+
+FramePoolStats FramePool::get_stats() const {
+    FramePoolStats stats = {};
+    stats.allocs = alloc_count.load(std::memory_order_relaxed);
+    stats.failures = failure_count.load(std::memory_order_relaxed);
+    stats.spills = spill_count.load(std::memory_order_relaxed);
+    for (size_t tier = 0; tier < FRAME_POOL_TIER_COUNT; tier++) {
+        stats.bytes[tier] = region_bytes[tier];
+    }
+    for (size_t cls = 0; cls < FRAME_POOL_CLASS_COUNT; cls++) {
+        FramePoolClassStats& out = stats.classes[cls];
+        out.block_size = class_sizes[cls];
+        for (size_t tier = 0; tier < FRAME_POOL_TIER_COUNT; tier++) {
+            const Subpool& subpool = subpools[tier * FRAME_POOL_CLASS_COUNT + cls];
+            out.blocks[tier] = subpool.count;
+            out.in_use[tier] = (uint16_t)subpool.in_use.load(std::memory_order_relaxed);
+            out.peak[tier] = (uint16_t)subpool.peak.load(std::memory_order_relaxed);
+        }
+    }
+    return stats;
+}
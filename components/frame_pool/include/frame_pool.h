@@ -0,0 +1,232 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_heap_caps.h"
+
+// Block size classes, smallest first. 2346 bytes is the largest 802.11
+// MPDU without aggregation; blocks are laid out on 4-byte boundaries.
+#define FRAME_POOL_CLASS_COUNT  3
+#define FRAME_POOL_SMALL        256
+#define FRAME_POOL_MEDIUM       512
+#define FRAME_POOL_LARGE        2346
+
+// Most blocks one pool can hold, over every class and tier
+#define FRAME_POOL_MAX_BLOCKS   0xFFFE
+
+// Whether blocks may be placed in external RAM. Follows the PSRAM malloc
+// option; without it the PSRAM tier is left empty.
+#ifndef FRAME_POOL_USE_PSRAM
+#ifdef CONFIG_SPIRAM_USE_MALLOC
+#define FRAME_POOL_USE_PSRAM    1
+#else
+#define FRAME_POOL_USE_PSRAM    0
+#endif
+#endif
+
+// Memory a block's bytes live in
+enum FramePoolTier {
+    FRAME_POOL_TIER_INTERNAL,   // Internal DRAM, tried first
+    FRAME_POOL_TIER_PSRAM,      // External RAM, once a class runs out of internal blocks
+    FRAME_POOL_TIER_COUNT
+};
+
+struct FramePoolConfig {
+    uint16_t blocks[FRAME_POOL_TIER_COUNT][FRAME_POOL_CLASS_COUNT];    // Blocks per tier and size class
+};
+
+// 16 small, 16 medium and 2 large blocks internally (about 17 KB), and
+// 64/64/16 more in PSRAM when FRAME_POOL_USE_PSRAM is set
+FramePoolConfig frame_pool_default_config();
+
+// Occupancy of one size class
+struct FramePoolClassStats {
+    uint16_t block_size;
+    uint16_t blocks[FRAME_POOL_TIER_COUNT];
+    uint16_t in_use[FRAME_POOL_TIER_COUNT];
+    uint16_t peak[FRAME_POOL_TIER_COUNT];   // Highest in_use seen
+};
+
+struct FramePoolStats {
+    uint32_t allocs;            // Blocks handed out
+    uint32_t failures;          // Requests no block could serve
+    uint32_t spills;            // Requests served from PSRAM or a larger class than the best fit
+    uint32_t bytes[FRAME_POOL_TIER_COUNT];  // Memory allocated up front per tier
+    FramePoolClassStats classes[FRAME_POOL_CLASS_COUNT];
+};
+
+class FramePool;
+
+// Shared reference to one pool block. Copying takes another reference,
+// the block returns to the pool when the last one goes away. Any task may
+// hold or drop references. Only the creator should write the block, and
+// only before handing out copies.
+class FrameHandle {
+public:
+    FrameHandle() : pool(nullptr), block(0) {}
+    FrameHandle(const FrameHandle& other);
+    FrameHandle(FrameHandle&& other) : pool(other.pool), block(other.block) { other.pool = nullptr; }
+    FrameHandle& operator=(const FrameHandle& other);
+    FrameHandle& operator=(FrameHandle&& other);
+    ~FrameHandle() { reset(); }
+
+    bool valid() const { return pool != nullptr; }
+    explicit operator bool() const { return valid(); }
+
+    uint8_t* data() const;
+    uint16_t size() const;              // Bytes in use
+    uint16_t capacity() const;          // Block size
+    void set_size(uint16_t size);       // Clamped to the capacity
+    uint32_t use_count() const;
+
+    // Drop this reference
+    void reset();
+
+private:
+    friend class FramePool;
+    FrameHandle(FramePool* pool, uint16_t block) : pool(pool), block(block) {}
+
+    FramePool* pool;
+    uint16_t block;
+};
+
+// Fixed-block frame buffer pool.
+//
+// Every block is carved out of one allocation per tier at init(), so
+// keeping a frame costs no malloc and cannot fragment the heap. A request
+// takes the smallest class that fits, internal RAM first, then PSRAM,
+// then the next larger class. Each class and tier has its own lock-free
+// free list, so blocks can be taken and returned from any task without a
+// critical section. Block headers and free lists stay in internal RAM even
+// when the bytes are in PSRAM.
+//
+// All handles must be released before the pool is destroyed.
+class FramePool {
+public:
+    FramePool();
+    ~FramePool();
+
+    FramePool(const FramePool&) = delete;
+    FramePool& operator=(const FramePool&) = delete;
+
+    // Allocate every block. ESP_ERR_INVALID_ARG for an empty config or one
+    // above FRAME_POOL_MAX_BLOCKS, ESP_ERR_NO_MEM if a tier cannot be allocated.
+    esp_err_t init(const FramePoolConfig& config = frame_pool_default_config());
+
+    // A block of at least `size` bytes with size() set to it, or an invalid
+    // handle when the size is too large or every block that fits is in use
+    FrameHandle alloc(size_t size);
+
+    // A block holding a copy of `len` bytes
+    FrameHandle copy(const uint8_t* data, size_t len);
+
+    // Largest request alloc() can serve
+    size_t max_size() const { return FRAME_POOL_LARGE; }
+
+    FramePoolStats get_stats() const;
+
+private:
+    friend class FrameHandle;
+
+    // Free list of one class in one tier
+    struct Subpool {
+        uint8_t* base;
+        uint16_t first;                 // Index of its first block
+        uint16_t count;
+        uint16_t block_size;
+        uint16_t stride;
+        std::atomic<uint32_t> head;     // Tag in the upper half, block index in the lower half
+        std::atomic<uint32_t> in_use;
+        std::atomic<uint32_t> peak;
+    };
+
+    struct Block {
+        uint8_t* data;
+        std::atomic<uint32_t> refs;
+        std::atomic<uint32_t> next;     // Next free block while on a free list
+        uint16_t size;
+        uint8_t subpool;
+    };
+
+    // Pop a block off a free list; FREE_LIST_END when it is empty
+    uint16_t pop(Subpool& subpool);
+    void push(Subpool& subpool, uint16_t index);
+
+    void retain(uint16_t index) { blocks[index].refs.fetch_add(1, std::memory_order_relaxed); }
+    void release(uint16_t index);
+
+    void free_regions();
+
+    Subpool subpools[FRAME_POOL_TIER_COUNT * FRAME_POOL_CLASS_COUNT];
+    Block* blocks;
+    uint16_t block_count;
+    void* regions[FRAME_POOL_TIER_COUNT];
+    uint32_t region_bytes[FRAME_POOL_TIER_COUNT];
+
+    std::atomic<uint32_t> alloc_count;
+    std::atomic<uint32_t> failure_count;
+    std::atomic<uint32_t> spill_count;
+
+    static const uint16_t FREE_LIST_END = 0xFFFF;
+
+    // Log tag
+    static const char* TAG;
+};
+
+inline FrameHandle::FrameHandle(const FrameHandle& other) : pool(other.pool), block(other.block) {
+    if (pool) {
+        pool->retain(block);
+    }
+}
+
+inline FrameHandle& FrameHandle::operator=(const FrameHandle& other) {
+    if (other.pool) {
+        other.pool->retain(other.block);
+    }
+    reset();
+    pool = other.pool;
+    block = other.block;
+    return *this;
+}
+
+inline FrameHandle& FrameHandle::operator=(FrameHandle&& other) {
+    if (this != &other) {
+        reset();
+        pool = other.pool;
+        block = other.block;
+        other.pool = nullptr;
+    }
+    return *this;
+}
+
+inline void FrameHandle::reset() {
+    if (pool) {
+        pool->release(block);
+        pool = nullptr;
+    }
+}
+
+inline uint8_t* FrameHandle::data() const {
+    return pool ? pool->blocks[block].data : nullptr;
+}
+
+inline uint16_t FrameHandle::size() const {
+    return pool ? pool->blocks[block].size : 0;
+}
+
+inline uint16_t FrameHandle::capacity() const {
+    return pool ? pool->subpools[pool->blocks[block].subpool].block_size : 0;
+}
+
+inline void FrameHandle::set_size(uint16_t size) {
+    if (pool) {
+        uint16_t cap = capacity();
+        pool->blocks[block].size = size < cap ? size : cap;
+    }
+}
+
+inline uint32_t FrameHandle::use_count() const {
+    return pool ? pool->blocks[block].refs.load(std::memory_order_relaxed) : 0;
+}
@@ -0,0 +1,125 @@
+#include "frame_stats.h"
+#include <string.h>
+
+static const uint32_t length_bounds[FRAME_STATS_LEN_BUCKETS] = {
+    64, 128, 256, 512, 1024, 1536, 2048, 0,
+};
+
+static const int rssi_floors[FRAME_STATS_RSSI_BUCKETS] = {
+    -128, -90, -80, -70, -60, -50, -40, -30,
+};
+
+uint32_t frame_stats_length_bound(size_t bucket) {
+    return bucket < FRAME_STATS_LEN_BUCKETS ? length_bounds[bucket] : 0;
+}
+
+int frame_stats_rssi_floor(size_t bucket) {
+    return bucket < FRAME_STATS_RSSI_BUCKETS ? rssi_floors[bucket] : 0;
+}
+
+static size_t length_bucket(uint16_t length) {
+    size_t bucket = 0;
+    while (bucket < FRAME_STATS_LEN_BUCKETS - 1 && length >= length_bounds[bucket]) {
+        bucket++;
+    }
+    return bucket;
+}
+
+static size_t rssi_bucket(int8_t rssi) {
+    // 10 dB steps starting at -90 dBm, clamped at both ends
+    int bucket = (rssi + 100) / 10;
+    if (rssi < -90) bucket = 0;
+    if (bucket >= FRAME_STATS_RSSI_BUCKETS) bucket = FRAME_STATS_RSSI_BUCKETS - 1;
+    return (size_t)bucket;
+}
+
+FrameStats::FrameStats() {
+    reset();
+}
+
+void FrameStats::record(size_t shard_index, uint8_t type, uint16_t length, int8_t rssi, uint8_t channel, bool retry) {
+    if (shard_index >= FRAME_STATS_SHARDS) {
+        return;
+    }
+    Shard& shard = shards[shard_index];
+
+    // Odd sequence tells readers an update is in progress
+    uint32_t seq = shard.sequence.load(std::memory_order_relaxed);
+    shard.sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    bump(shard.frames);
+    bump(shard.bytes, length);
+    if (retry) {
+        bump(shard.retries);
+    }
+    if (type < FRAME_STATS_FRAME_TYPES) {
+        bump(shard.by_type[type]);
+    }
+    bump(shard.by_channel[channel < FRAME_STATS_CHANNELS ? channel : 0]);
+    bump(shard.length_hist[length_bucket(length)]);
+    bump(shard.rssi_hist[rssi_bucket(rssi)]);
+
+    shard.sequence.store(seq + 2, std::memory_order_release);
+}
+
+// Copy every counter of one shard into `out`
+template<size_t N>
+static void load_counters(uint32_t (&out)[N], const std::atomic<uint32_t> (&in)[N]) {
+    for (size_t i = 0; i < N; i++) {
+        out[i] = in[i].load(std::memory_order_relaxed);
+    }
+}
+
+template<size_t N>
+static void add_counters(uint32_t (&total)[N], const uint32_t (&part)[N]) {
+    for (size_t i = 0; i < N; i++) {
+        total[i] += part[i];
+    }
+}
+
+void FrameStats::snapshot(StatsSnapshot* out) const {
+    memset(out, 0, sizeof(*out));
+
+    for (size_t s = 0; s < FRAME_STATS_SHARDS; s++) {
+        const Shard& shard = shards[s];
+        StatsSnapshot copy;
+        uint32_t before, after;
+
+        // Retry until the copy was taken with no update in between
+        do {
+            before = shard.sequence.load(std::memory_order_acquire);
+            copy.frames = shard.frames.load(std::memory_order_relaxed);
+            copy.bytes = shard.bytes.load(std::memory_order_relaxed);
+            copy.retries = shard.retries.load(std::memory_order_relaxed);
+            load_counters(copy.by_type, shard.by_type);
+            load_counters(copy.by_channel, shard.by_channel);
+            load_counters(copy.length_hist, shard.length_hist);
+            load_counters(copy.rssi_hist, shard.rssi_hist);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = shard.sequence.load(std::memory_order_relaxed);
+        } while ((before & 1) || before != after);
+
+        out->frames += copy.frames;
+        out->bytes += copy.bytes;
+        out->retries += copy.retries;
+        add_counters(out->by_type, copy.by_type);
+        add_counters(out->by_channel, copy.by_channel);
+        add_counters(out->length_hist, copy.length_hist);
+        add_counters(out->rssi_hist, copy.rssi_hist);
+    }
+}
+
+void FrameStats::reset() {
+    for (size_t s = 0; s < FRAME_STATS_SHARDS; s++) {
+        Shard& shard = shards[s];
+        shard.sequence.store(0, std::memory_order_relaxed);
+        shard.frames.store(0, std::memory_order_relaxed);
+        shard.bytes.store(0, std::memory_order_relaxed);
+        shard.retries.store(0, std::memory_order_relaxed);
+        for (auto& c : shard.by_type) c.store(0, std::memory_order_relaxed);
+        for (auto& c : shard.by_channel) c.store(0, std::memory_order_relaxed);
+        for (auto& c : shard.length_hist) c.store(0, std::memory_order_relaxed);
+        for (auto& c : shard.rssi_hist) c.store(0, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Counter shards, one per producer task. Each shard must only ever be
+// written by a single task; any number of tasks may read.
+#ifndef FRAME_STATS_SHARDS
+#define FRAME_STATS_SHARDS        4
+#endif
+
+// Frame types counted separately (IEEE80211_TYPE_MGMT/CTRL/DATA)
+#define FRAME_STATS_FRAME_TYPES   3
+
+// Channels 1-14 are counted at their own index; index 0 collects anything else
+#define FRAME_STATS_CHANNELS      15
+
+// Frame length histogram: bucket i counts lengths below the i-th bound, the
+// last bucket everything from 2048 bytes up
+#define FRAME_STATS_LEN_BUCKETS   8
+
+// RSSI histogram: 10 dB buckets from below -90 dBm to -30 dBm and above
+#define FRAME_STATS_RSSI_BUCKETS  8
+
+// Merged, self-consistent view of all shards
+struct StatsSnapshot {
+    uint32_t frames;
+    uint32_t bytes;                                     // Sum of original frame lengths
+    uint32_t retries;                                   // Frames with the retry flag set
+    uint32_t by_type[FRAME_STATS_FRAME_TYPES];
+    uint32_t by_channel[FRAME_STATS_CHANNELS];
+    uint32_t length_hist[FRAME_STATS_LEN_BUCKETS];
+    uint32_t rssi_hist[FRAME_STATS_RSSI_BUCKETS];
+};
+
+// Upper bound (exclusive) of a length bucket, 0 for the open-ended last one
+uint32_t frame_stats_length_bound(size_t bucket);
+
+// Lower bound (inclusive, dBm) of an RSSI bucket; bucket 0 is open-ended below
+int frame_stats_rssi_floor(size_t bucket);
+
+// Sharded frame statistics.
+//
+// Each producer task owns a shard and updates it with plain relaxed
+// stores; there are no locks and no read-modify-write atomics on the hot
+// path, and shards sit on separate cache lines. Each shard carries a
+// sequence counter (seqlock) so snapshot() can copy it consistently: a
+// snapshot never shows a frame counted in `frames` but missing from a
+// histogram. Shards are merged on read.
+//
+// Pure logic with no ESP-IDF dependencies.
+class FrameStats {
+public:
+    FrameStats();
+
+    FrameStats(const FrameStats&) = delete;
+    FrameStats& operator=(const FrameStats&) = delete;
+
+    // Account one frame in `shard` (0..FRAME_STATS_SHARDS-1). Only one task
+    // may record into a given shard.
+    void record(size_t shard, uint8_t type, uint16_t length, int8_t rssi, uint8_t channel, bool retry);
+
+    // Merge all shards into `out`
+    void snapshot(StatsSnapshot* out) const;
+
+    // Zero every shard. Writers must be quiescent.
+    void reset();
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<uint32_t> sequence;
+        std::atomic<uint32_t> frames;
+        std::atomic<uint32_t> bytes;
+        std::atomic<uint32_t> retries;
+        std::atomic<uint32_t> by_type[FRAME_STATS_FRAME_TYPES];
+        std::atomic<uint32_t> by_channel[FRAME_STATS_CHANNELS];
+        std::atomic<uint32_t> length_hist[FRAME_STATS_LEN_BUCKETS];
+        std::atomic<uint32_t> rssi_hist[FRAME_STATS_RSSI_BUCKETS];
+    };
+
+    static void bump(std::atomic<uint32_t>& counter, uint32_t amount = 1) {
+        counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+
+    Shard shards[FRAME_STATS_SHARDS];
+};
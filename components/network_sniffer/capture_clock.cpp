@@ -0,0 +1,163 @@
+#include "capture_clock.h"
+
+static inline int64_t abs64(int64_t v) {
+    return v < 0 ? -v : v;
+}
+
+ReferenceClock::ReferenceClock() {
+    reset();
+}
+
+void ReferenceClock::reset() {
+    anchor_local_us = 0;
+    anchor_reference_us = 0;
+    skew_local_us = 0;
+    skew_reference_us = 0;
+    skew_q32 = 0;
+    valid = false;
+    skew_valid = false;
+    outlier_run = 0;
+    restart_count = 0;
+    reference_count = 0;
+    outlier_count = 0;
+}
+
+bool ReferenceClock::add_reference(int64_t local_us, int64_t reference_us) {
+    if (valid) {
+        int64_t elapsed = local_us - anchor_local_us;
+        int64_t error = reference_us - to_reference(local_us);
+        int64_t bound = abs64(elapsed) / 1000000 * CAPTURE_CLOCK_MAX_SKEW_PPM + CAPTURE_CLOCK_REFERENCE_JITTER_US;
+        if (elapsed <= 0 || abs64(error) > bound) {
+            outlier_count++;
+            if (++outlier_run < CAPTURE_CLOCK_MAX_OUTLIERS) {
+                return false;
+            }
+            // Three in a row: the reference stepped, follow it from here
+            valid = false;
+            skew_valid = false;
+            skew_q32 = 0;
+            return false;
+        }
+    }
+    outlier_run = 0;
+
+    if (!valid) {
+        restart_count++;
+        skew_local_us = local_us;
+        skew_reference_us = reference_us;
+    } else if (local_us - skew_local_us >= CAPTURE_CLOCK_SKEW_INTERVAL_US) {
+        int64_t local_elapsed = local_us - skew_local_us;
+        int64_t drift = (reference_us - skew_reference_us) - local_elapsed;
+        int64_t measured = (drift << 32) / local_elapsed;
+        const int64_t max_q32 = ((int64_t)CAPTURE_CLOCK_MAX_SKEW_PPM << 32) / 1000000;
+        if (measured > max_q32) measured = max_q32;
+        if (measured < -max_q32) measured = -max_q32;
+        if (skew_valid) {
+            skew_q32 += (measured - skew_q32) / (1 << CAPTURE_CLOCK_SKEW_SHIFT);
+        } else {
+            skew_q32 = measured;
+            skew_valid = true;
+        }
+        skew_local_us = local_us;
+        skew_reference_us = reference_us;
+    }
+
+    // The mapping passes through the newest pair with the smoothed skew
+    anchor_local_us = local_us;
+    anchor_reference_us = reference_us;
+    valid = true;
+    reference_count++;
+    return true;
+}
+
+void ReferenceClock::get_stats(CaptureClockStats* stats) const {
+    stats->references = reference_count;
+    stats->outliers = outlier_count;
+    stats->skew_ppb = (int32_t)((skew_q32 * 1000000000) >> 32);
+    stats->reference_offset_us = valid ? anchor_reference_us - anchor_local_us : 0;
+}
+
+CaptureClock::CaptureClock() {
+    reset();
+}
+
+void CaptureClock::reset() {
+    started = false;
+    last_rx = 0;
+    extended_rx = 0;
+    offset_us = 0;
+    window_min = 0;
+    previous_window_min = 0;
+    window_start_us = 0;
+    last.local_us = INT64_MIN;
+    last.reference_us = INT64_MIN;
+    reference_generation = 0;
+    frame_count = 0;
+    wrap_count = 0;
+    resync_count = 0;
+    clamp_count = 0;
+}
+
+void CaptureClock::anchor(uint32_t rx_timestamp, int64_t now_us) {
+    last_rx = rx_timestamp;
+    extended_rx = rx_timestamp;
+    offset_us = now_us - extended_rx;
+    window_min = offset_us;
+    previous_window_min = offset_us;
+    window_start_us = now_us;
+    started = true;
+}
+
+CaptureTime CaptureClock::capture(uint32_t rx_timestamp, int64_t now_us, const ReferenceClock& reference) {
+    frame_count++;
+    if (!started) {
+        anchor(rx_timestamp, now_us);
+    } else {
+        // Signed difference, so wraparound and slight reordering both extend correctly
+        int32_t delta = (int32_t)(rx_timestamp - last_rx);
+        if (delta > 0 && rx_timestamp < last_rx) {
+            wrap_count++;
+        }
+        last_rx = rx_timestamp;
+        extended_rx += delta;
+
+        int64_t sample = now_us - extended_rx;
+        if (abs64(sample - offset_us) > CAPTURE_CLOCK_RESYNC_US) {
+            resync_count++;
+            anchor(rx_timestamp, now_us);
+        } else {
+            if (now_us - window_start_us >= CAPTURE_CLOCK_WINDOW_US) {
+                previous_window_min = window_min;
+                window_min = sample;
+                window_start_us = now_us;
+            } else if (sample < window_min) {
+                window_min = sample;
+            }
+            offset_us = window_min < previous_window_min ? window_min : previous_window_min;
+        }
+    }
+
+    CaptureTime time;
+    time.local_us = extended_rx + offset_us;
+    time.reference_us = reference.to_reference(time.local_us);
+    if (reference.generation() != reference_generation) {
+        // A new reference may lie before the old one; only keep it monotonic from here on
+        reference_generation = reference.generation();
+        last.reference_us = INT64_MIN;
+    }
+    if (time.local_us < last.local_us || time.reference_us < last.reference_us) {
+        clamp_count++;
+        if (time.local_us < last.local_us) time.local_us = last.local_us;
+        if (time.reference_us < last.reference_us) time.reference_us = last.reference_us;
+    }
+    last = time;
+    return time;
+}
+
+void CaptureClock::get_stats(CaptureClockStats* stats) const {
+    stats->frames = frame_count;
+    stats->wraps = wrap_count;
+    stats->resyncs = resync_count;
+    stats->clamped = clamp_count;
+    stats->offset_us = offset_us;
+}
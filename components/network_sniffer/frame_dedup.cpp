@@ -0,0 +1,107 @@
+#include "frame_dedup.h"
+#include <string.h>
+
+// Streams beside the 16 TIDs
+#define DEDUP_LANE_DATA     16      // Non-QoS data
+#define DEDUP_LANE_MGMT     17      // Management
+
+// Sequence numbers are 12 bits and wrap
+#define SEQUENCE_MODULO     4096
+
+// Relaxed single-writer increment
+static inline void bump(std::atomic<uint32_t>& counter) {
+    counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+FrameDedup::FrameDedup()
+    : checked_count(0), duplicate_count(0), retry_count(0), eviction_count(0) {
+}
+
+bool FrameDedup::record(Stream& stream, uint16_t sequence, uint8_t fragment, bool retry) {
+    uint16_t ahead = (sequence - stream.head) & (SEQUENCE_MODULO - 1);
+    if (ahead == 0) {
+        // The newest frame again, or its next fragment
+        if (fragment > stream.head_fragment) {
+            stream.head_fragment = fragment;
+            return false;
+        }
+        return retry;
+    }
+    if (ahead < SEQUENCE_MODULO / 2) {
+        stream.seen = ahead >= FRAME_DEDUP_WINDOW ? 1 : (stream.seen << ahead) | 1;
+        stream.head = sequence;
+        stream.head_fragment = fragment;
+        return false;
+    }
+
+    uint16_t behind = SEQUENCE_MODULO - ahead;
+    if (behind >= FRAME_DEDUP_WINDOW) {
+        // Far behind: the transmitter restarted its counter
+        stream.seen = 1;
+        stream.head = sequence;
+        stream.head_fragment = fragment;
+        return false;
+    }
+    uint64_t bit = 1ull << behind;
+    if (stream.seen & bit) {
+        return retry;
+    }
+    stream.seen |= bit;
+    return false;
+}
+
+DedupVerdict FrameDedup::check(const ParsedFrame& frame) {
+    if (!frame.transmitter || !frame.has_sequence) {
+        return DEDUP_UNTRACKED;
+    }
+    uint8_t lane = frame.type == IEEE80211_TYPE_MGMT ? DEDUP_LANE_MGMT
+                 : frame.has_qos ? (uint8_t)(frame.tid & 0x0F) : DEDUP_LANE_DATA;
+    bool retry = (frame.flags & IEEE80211_FC_RETRY) != 0;
+    bump(checked_count);
+    if (retry) {
+        bump(retry_count);
+    }
+
+    const uint8_t* mac = frame.transmitter;
+    uint32_t hash = mac_hash(mac, lane);
+    size_t slot = streams.find(hash, [mac, lane](const Stream& stream) {
+        return stream.lane == lane && mac_equal(stream.mac, mac);
+    });
+
+    if (streams.occupied(slot)) {
+        Stream& stream = streams.at_slot(slot);
+        stream.referenced = 1;
+        if (record(stream, frame.sequence_number, frame.fragment_number, retry)) {
+            bump(duplicate_count);
+            return DEDUP_DUPLICATE;
+        }
+        return DEDUP_NEW;
+    }
+
+    bool evicted;
+    Stream& stream = *streams.insert_evict(slot, hash, &evicted);
+    if (evicted) {
+        bump(eviction_count);
+    }
+    memcpy(stream.mac, mac, 6);
+    stream.lane = lane;
+    stream.referenced = 1;
+    stream.seen = 1;
+    stream.head = frame.sequence_number;
+    stream.head_fragment = frame.fragment_number;
+    return DEDUP_NEW;
+}
+
+void FrameDedup::clear() {
+    streams.clear();
+}
+
+FrameDedupStats FrameDedup::get_stats() const {
+    FrameDedupStats stats;
+    stats.checked = checked_count.load(std::memory_order_relaxed);
+    stats.duplicates = duplicate_count.load(std::memory_order_relaxed);
+    stats.retries = retry_count.load(std::memory_order_relaxed);
+    stats.evictions = eviction_count.load(std::memory_order_relaxed);
+    stats.streams = (uint32_t)streams.size();
+    return stats;
+}
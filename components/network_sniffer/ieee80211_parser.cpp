@@ -0,0 +1,317 @@
+#include "ieee80211_parser.h"
+#include <string.h>
+
+// Little-endian field readers; 802.11 fields are unaligned so go byte by byte
+static inline uint16_t read_le16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+// Per-subtype management body decoder. Reads the fixed fields and returns
+// the offset of the first tagged element, or `len` if the body has none.
+typedef size_t (*mgmt_decoder_t)(const uint8_t* body, size_t len, ParsedFrame* out);
+
+static size_t decode_assoc_req(const uint8_t* body, size_t len, ParsedFrame* out) {
+    if (len < 4) return len;
+    out->capability = read_le16(body);
+    out->listen_interval = read_le16(body + 2);
+    return 4;
+}
+
+static size_t decode_assoc_resp(const uint8_t* body, size_t len, ParsedFrame* out) {
+    if (len < 6) return len;
+    out->capability = read_le16(body);
+    out->status_code = read_le16(body + 2);
+    return 6;
+}
+
+static size_t decode_reassoc_req(const uint8_t* body, size_t len, ParsedFrame* out) {
+    // Capability, listen interval, current AP address
+    if (len < 10) return len;
+    out->capability = read_le16(body);
+    out->listen_interval = read_le16(body + 2);
+    return 10;
+}
+
+static size_t decode_probe_req(const uint8_t*, size_t, ParsedFrame*) {
+    // No fixed fields; the SSID and rates are elements
+    return 0;
+}
+
+static size_t decode_beacon(const uint8_t* body, size_t len, ParsedFrame* out) {
+    // Timestamp, beacon interval, capability (beacons and probe responses)
+    if (len < 12) return len;
+    out->beacon_interval = read_le16(body + 8);
+    out->capability = read_le16(body + 10);
+    return 12;
+}
+
+static size_t decode_reason(const uint8_t* body, size_t len, ParsedFrame* out) {
+    // Deauthentication and disassociation
+    if (len < 2) return len;
+    out->reason_code = read_le16(body);
+    return len;
+}
+
+static size_t decode_auth(const uint8_t* body, size_t len, ParsedFrame* out) {
+    if (len < 6) return len;
+    out->auth_algorithm = read_le16(body);
+    out->auth_sequence = read_le16(body + 2);
+    out->status_code = read_le16(body + 4);
+    return 6;
+}
+
+static size_t decode_no_ies(const uint8_t*, size_t len, ParsedFrame*) {
+    return len;
+}
+
+static const mgmt_decoder_t mgmt_decoders[16] = {
+    decode_assoc_req,     // ASSOC_REQ
+    decode_assoc_resp,    // ASSOC_RESP
+    decode_reassoc_req,   // REASSOC_REQ
+    decode_assoc_resp,    // REASSOC_RESP
+    decode_probe_req,     // PROBE_REQ
+    decode_beacon,        // PROBE_RESP
+    decode_no_ies,        // TIMING_ADV
+    decode_no_ies,        // reserved
+    decode_beacon,        // BEACON
+    decode_no_ies,        // ATIM
+    decode_reason,        // DISASSOC
+    decode_auth,          // AUTH
+    decode_reason,        // DEAUTH
+    decode_no_ies,        // ACTION
+    decode_no_ies,        // ACTION_NOACK
+    decode_no_ies,        // reserved
+};
+
+static void assign_data_roles(ParsedFrame* out) {
+    out->receiver = out->addr1;
+    out->transmitter = out->addr2;
+    switch (out->flags & (IEEE80211_FC_TO_DS | IEEE80211_FC_FROM_DS)) {
+        case 0:
+            out->destination = out->addr1;
+            out->source = out->addr2;
+            out->bssid = out->addr3;
+            break;
+        case IEEE80211_FC_TO_DS:
+            out->bssid = out->addr1;
+            out->source = out->addr2;
+            out->destination = out->addr3;
+            break;
+        case IEEE80211_FC_FROM_DS:
+            out->destination = out->addr1;
+            out->bssid = out->addr2;
+            out->source = out->addr3;
+            break;
+        default:
+            // WDS / mesh: no single BSSID
+            out->destination = out->addr3;
+            out->source = out->addr4;
+            break;
+    }
+}
+
+static bool parse_ctrl_header(const uint8_t* data, size_t len, ParsedFrame* out) {
+    // Every control frame carries the receiver address
+    if (len < 10) return false;
+    out->addr1 = data + 4;
+    out->receiver = out->addr1;
+    out->header_len = 10;
+
+    switch (out->subtype) {
+        case IEEE80211_CTRL_CTS:
+        case IEEE80211_CTRL_ACK:
+        case IEEE80211_CTRL_WRAPPER:
+            break;
+        default:
+            // RTS, PS-Poll, CF-End, BAR and BA also carry the transmitter
+            if (len < 16) return false;
+            out->addr2 = data + 10;
+            out->transmitter = out->addr2;
+            out->header_len = 16;
+            if (out->subtype == IEEE80211_CTRL_PSPOLL || out->subtype == IEEE80211_CTRL_CFEND ||
+                out->subtype == IEEE80211_CTRL_CFEND_ACK) {
+                out->bssid = out->subtype == IEEE80211_CTRL_PSPOLL ? out->addr1 : out->addr2;
+            }
+            break;
+    }
+    return true;
+}
+
+bool ieee80211_parse(const uint8_t* data, size_t len, bool has_fcs, ParsedFrame* out) {
+    memset(out, 0, sizeof(*out));
+    if (data == nullptr) {
+        return false;
+    }
+    if (has_fcs) {
+        if (len < IEEE80211_FCS_LEN) return false;
+        len -= IEEE80211_FCS_LEN;
+    }
+    if (len < 2) {
+        return false;
+    }
+
+    out->frame_control = read_le16(data);
+    out->type = (data[0] >> 2) & 0x03;
+    out->subtype = (data[0] >> 4) & 0x0f;
+    out->flags = data[1];
+    if (len >= 4) {
+        out->duration = read_le16(data + 2);
+    }
+
+    if (out->type == IEEE80211_TYPE_CTRL) {
+        if (!parse_ctrl_header(data, len, out)) return false;
+        out->body.data = data + out->header_len;
+        out->body.len = len - out->header_len;
+        return true;
+    }
+    if (out->type == IEEE80211_TYPE_EXT) {
+        return false;
+    }
+
+    // Management and data frames share the three-address header
+    size_t hdr = 24;
+    if (len < hdr) return false;
+    out->addr1 = data + 4;
+    out->addr2 = data + 10;
+    out->addr3 = data + 16;
+    uint16_t seq_ctrl = read_le16(data + 22);
+    out->has_sequence = true;
+    out->fragment_number = seq_ctrl & 0x0f;
+    out->sequence_number = seq_ctrl >> 4;
+
+    bool has_htc = false;
+    if (out->type == IEEE80211_TYPE_DATA) {
+        if ((out->flags & (IEEE80211_FC_TO_DS | IEEE80211_FC_FROM_DS)) ==
+            (IEEE80211_FC_TO_DS | IEEE80211_FC_FROM_DS)) {
+            if (len < hdr + IEEE80211_MAC_LEN) return false;
+            out->addr4 = data + hdr;
+            hdr += IEEE80211_MAC_LEN;
+        }
+        if (out->subtype & IEEE80211_DATA_SUBTYPE_QOS) {
+            if (len < hdr + 2) return false;
+            out->has_qos = true;
+            out->qos_control = read_le16(data + hdr);
+            out->tid = out->qos_control & 0x0f;
+            hdr += 2;
+            has_htc = (out->flags & IEEE80211_FC_ORDER) != 0;
+        }
+        assign_data_roles(out);
+    } else {
+        out->receiver = out->addr1;
+        out->transmitter = out->addr2;
+        out->destination = out->addr1;
+        out->source = out->addr2;
+        out->bssid = out->addr3;
+        // Unprotected management frames with the Order bit carry an HT control field
+        has_htc = (out->flags & (IEEE80211_FC_ORDER | IEEE80211_FC_PROTECTED)) == IEEE80211_FC_ORDER;
+    }
+    if (has_htc) {
+        if (len < hdr + 4) return false;
+        hdr += 4;
+    }
+
+    out->header_len = hdr;
+    out->body.data = data + hdr;
+    out->body.len = len - hdr;
+
+    // Protected management bodies are ciphertext
+    if (out->type == IEEE80211_TYPE_MGMT && !(out->flags & IEEE80211_FC_PROTECTED)) {
+        size_t ie_offset = mgmt_decoders[out->subtype](out->body.data, out->body.len, out);
+        if (ie_offset < out->body.len) {
+            ByteSpan ies = { out->body.data + ie_offset, out->body.len - ie_offset };
+            ieee80211_parse_ies(ies, out);
+        }
+    }
+    return true;
+}
+
+void ieee80211_parse_ies(ByteSpan ies, ParsedFrame* out) {
+    static const uint8_t wpa_oui_type[4] = { 0x00, 0x50, 0xf2, 0x01 };
+
+    out->ies = ies;
+    const uint8_t* p = ies.data;
+    const uint8_t* end = ies.data + ies.len;
+
+    while (end - p >= 2) {
+        uint8_t id = p[0];
+        uint8_t elen = p[1];
+        const uint8_t* value = p + 2;
+        if (elen > end - value) {
+            out->ies_truncated = true;
+            break;
+        }
+
+        // Only the first instance of each element is kept
+        switch (id) {
+            case IEEE80211_IE_SSID:
+                if (out->ssid.empty() && elen <= IEEE80211_MAX_SSID_LEN) {
+                    out->ssid.data = value;
+                    out->ssid.len = elen;
+                }
+                break;
+            case IEEE80211_IE_DS_PARAMS:
+                if (out->ds_channel == 0 && elen >= 1) {
+                    out->ds_channel = value[0];
+                }
+                break;
+            case IEEE80211_IE_RSN:
+                if (out->rsn.empty()) {
+                    out->rsn.data = value;
+                    out->rsn.len = elen;
+                }
+                break;
+            case IEEE80211_IE_HT_CAPS:
+                if (out->ht_caps.empty()) {
+                    out->ht_caps.data = value;
+                    out->ht_caps.len = elen;
+                }
+                break;
+            case IEEE80211_IE_VHT_CAPS:
+                if (out->vht_caps.empty()) {
+                    out->vht_caps.data = value;
+                    out->vht_caps.len = elen;
+                }
+                break;
+            case IEEE80211_IE_VENDOR:
+                if (out->wpa.empty() && elen >= 4 && memcmp(value, wpa_oui_type, 4) == 0) {
+                    out->wpa.data = value;
+                    out->wpa.len = elen;
+                }
+                break;
+            default:
+                break;
+        }
+        p = value + elen;
+    }
+
+    if (p != end && end - p < 2) {
+        out->ies_truncated = true;
+    }
+}
+
+const char* ieee80211_subtype_name(uint8_t type, uint8_t subtype) {
+    static const char* const mgmt_names[16] = {
+        "assoc-req", "assoc-resp", "reassoc-req", "reassoc-resp",
+        "probe-req", "probe-resp", "timing-adv", "mgmt-7",
+        "beacon", "atim", "disassoc", "auth",
+        "deauth", "action", "action-noack", "mgmt-15",
+    };
+    static const char* const ctrl_names[16] = {
+        "ctrl-0", "ctrl-1", "ctrl-2", "ctrl-3", "ctrl-4", "ctrl-5", "ctrl-6",
+        "ctrl-wrapper", "bar", "ba", "ps-poll", "rts", "cts", "ack", "cf-end", "cf-end-ack",
+    };
+    static const char* const data_names[16] = {
+        "data", "data-cf-ack", "data-cf-poll", "data-cf-ack-poll",
+        "null", "cf-ack", "cf-poll", "cf-ack-poll",
+        "qos-data", "qos-data-cf-ack", "qos-data-cf-poll", "qos-data-cf-ack-poll",
+        "qos-null", "data-13", "qos-cf-poll", "qos-cf-ack-poll",
+    };
+
+    subtype &= 0x0f;
+    switch (type) {
+        case IEEE80211_TYPE_MGMT: return mgmt_names[subtype];
+        case IEEE80211_TYPE_CTRL: return ctrl_names[subtype];
+        case IEEE80211_TYPE_DATA: return data_names[subtype];
+        default: return "extension";
+    }
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <stdint.h>
+
+// Per-frame capture timestamps.
+//
+// The driver stamps every frame with the 32-bit microsecond receive timer
+// (rx_ctrl.timestamp), which wraps every ~71 minutes and runs on its own
+// epoch. CaptureClock extends it to 64 bits and aligns it to
+// esp_timer_get_time(): the offset between the two clocks is the smallest
+// (processing time - receive time) seen over a sliding window, since a frame
+// is never processed before it was received. Queueing delay therefore does
+// not leak into the timestamps, and slow drift between the two clocks is
+// followed within two windows.
+//
+// ReferenceClock optionally maps local time onto an external reference
+// (GPS PPS, NTP, a collector's sync messages) with an offset and a skew
+// estimated from (local, reference) pairs, so captures from several
+// sniffers can be merged on one time base.
+//
+// This header has no ESP-IDF dependencies so it can be tested on a host.
+
+// Window over which the minimum clock offset is taken
+#ifndef CAPTURE_CLOCK_WINDOW_US
+#define CAPTURE_CLOCK_WINDOW_US             1000000
+#endif
+
+// An offset sample this far from the estimate means the receive timer jumped
+// (driver restart, stalled processing); the alignment starts over
+#ifndef CAPTURE_CLOCK_RESYNC_US
+#define CAPTURE_CLOCK_RESYNC_US             5000000
+#endif
+
+// Skew between local and reference time beyond which a reference pair is an outlier
+#define CAPTURE_CLOCK_MAX_SKEW_PPM          500
+// Slack for reference jitter on top of the skew bound
+#define CAPTURE_CLOCK_REFERENCE_JITTER_US   2000
+// Consecutive outliers after which the reference is assumed to have stepped
+#define CAPTURE_CLOCK_MAX_OUTLIERS          3
+// Least spacing of the pairs the skew is measured between
+#define CAPTURE_CLOCK_SKEW_INTERVAL_US      10000000
+// Skew EWMA weight 1/4 for each new measurement
+#define CAPTURE_CLOCK_SKEW_SHIFT            2
+
+// Timestamps of one frame
+struct CaptureTime {
+    int64_t local_us;       // esp_timer_get_time() time base, monotonic
+    int64_t reference_us;   // Reference time base, monotonic; local_us until a reference is set
+};
+
+struct CaptureClockStats {
+    uint32_t frames;
+    uint32_t wraps;             // Receive timer wraparounds
+    uint32_t resyncs;           // Receive timer jumps the alignment restarted after
+    uint32_t clamped;           // Timestamps held back to stay monotonic
+    int64_t offset_us;          // Local time minus extended receive time
+    uint32_t references;        // Reference pairs accepted
+    uint32_t outliers;          // Reference pairs rejected
+    int32_t skew_ppb;           // Reference rate relative to local, parts per billion
+    int64_t reference_offset_us;// Reference minus local time at the last pair
+};
+
+// Local to reference time mapping. Small and copyable, so that a reader can
+// take a snapshot under whatever lock guards the writer.
+class ReferenceClock {
+public:
+    ReferenceClock();
+
+    // Feed a pair of simultaneous local and reference readings. Returns false
+    // for an outlier; after CAPTURE_CLOCK_MAX_OUTLIERS in a row the reference
+    // is assumed to have stepped and the next pair restarts the mapping.
+    bool add_reference(int64_t local_us, int64_t reference_us);
+
+    // Reference time at `local_us`, or `local_us` itself until a pair was accepted
+    int64_t to_reference(int64_t local_us) const {
+        if (!valid) {
+            return local_us;
+        }
+        int64_t elapsed = local_us - anchor_local_us;
+        return anchor_reference_us + elapsed + ((elapsed * skew_q32) >> 32);
+    }
+
+    bool has_reference() const { return valid; }
+
+    // Bumped whenever the mapping restarts, which may step reference time back
+    uint32_t generation() const { return restart_count; }
+
+    void reset();
+
+    // Fill in the reference fields of `stats`
+    void get_stats(CaptureClockStats* stats) const;
+
+private:
+    // Last accepted pair; to_reference() is exact there
+    int64_t anchor_local_us;
+    int64_t anchor_reference_us;
+    // Pair the next skew measurement is taken from
+    int64_t skew_local_us;
+    int64_t skew_reference_us;
+    // Reference rate minus 1, 32 fractional bits
+    int64_t skew_q32;
+    bool valid;
+    bool skew_valid;
+    uint8_t outlier_run;
+    uint32_t restart_count;
+    uint32_t reference_count;
+    uint32_t outlier_count;
+};
+
+// Receive timer extension and alignment. Calls must be serialized by the
+// caller; the sniffer makes them all from its processing task, in receive order.
+class CaptureClock {
+public:
+    CaptureClock();
+
+    // Timestamps of a frame with receive timer value `rx_timestamp`, processed
+    // at local time `now_us`, mapped through `reference`
+    CaptureTime capture(uint32_t rx_timestamp, int64_t now_us, const ReferenceClock& reference);
+
+    void reset();
+
+    // Fill in the receive timer fields of `stats`
+    void get_stats(CaptureClockStats* stats) const;
+
+private:
+    // Restart extension and alignment from this frame
+    void anchor(uint32_t rx_timestamp, int64_t now_us);
+
+    bool started;
+    uint32_t last_rx;
+    int64_t extended_rx;        // last_rx extended to 64 bits
+    int64_t offset_us;          // min(window_min, previous_window_min)
+    int64_t window_min;
+    int64_t previous_window_min;
+    int64_t window_start_us;
+    CaptureTime last;
+    uint32_t reference_generation;  // Of the reference last.reference_us came from
+    uint32_t frame_count;
+    uint32_t wrap_count;
+    uint32_t resync_count;
+    uint32_t clamp_count;
+};
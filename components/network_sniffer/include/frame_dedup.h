@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include "fixed_table.h"
+#include "ieee80211_parser.h"
+#include "table_hash.h"
+
+// Sequence streams tracked at once; must be a power of two. A stream is one
+// transmitter's traffic for one TID (or its management, or its non-QoS data).
+#ifndef FRAME_DEDUP_CAPACITY
+#define FRAME_DEDUP_CAPACITY    512
+#endif
+
+// Sequence numbers remembered per stream, the newest included. A retry of
+// an older frame is taken for a new frame.
+#define FRAME_DEDUP_WINDOW      64
+
+enum DedupVerdict {
+    DEDUP_UNTRACKED,    // No transmitter or sequence number (control frames, malformed headers)
+    DEDUP_NEW,          // First copy of this frame
+    DEDUP_DUPLICATE,    // Retransmission of a frame already seen
+};
+
+struct FrameDedupStats {
+    uint32_t checked;       // Frames with a transmitter and sequence number
+    uint32_t duplicates;    // Retransmissions of frames already seen
+    uint32_t retries;       // Frames with the Retry bit set, first copies included
+    uint32_t evictions;     // Streams forgotten to make room
+    uint32_t streams;       // Streams currently tracked
+};
+
+// Retransmission filter keyed by (transmitter, TID, sequence number).
+//
+// A station that misses an ACK sends the same frame again with the Retry
+// bit set and the same sequence number, so on a busy channel the sniffer
+// hears many frames several times. Like a receiver's duplicate cache, a
+// frame is a duplicate only if its Retry bit is set and its sequence
+// number (and fragment number, for the newest frame) was already seen on
+// the same stream; anything else updates the stream and passes.
+//
+// Each stream keeps the newest sequence number and a FRAME_DEDUP_WINDOW-bit
+// map of the ones behind it, so a check is a hash lookup and a shift.
+// Streams live in a FixedTable, a preallocated array behind an
+// open-addressing index; when full, a clock sweep evicts one not seen since
+// the hand last passed.
+// Nothing allocates after construction.
+//
+// Pure logic with no ESP-IDF dependencies. check() and clear() must be
+// serialized by the caller; get_stats() may be called from any task.
+class FrameDedup {
+public:
+    FrameDedup();
+
+    FrameDedup(const FrameDedup&) = delete;
+    FrameDedup& operator=(const FrameDedup&) = delete;
+
+    // Classify one frame and remember it
+    DedupVerdict check(const ParsedFrame& frame);
+
+    // Forget every stream; counters are kept
+    void clear();
+
+    FrameDedupStats get_stats() const;
+
+    // Bytes used by one filter, for RAM budgeting
+    static constexpr size_t footprint() { return sizeof(FrameDedup); }
+
+private:
+    struct Stream {
+        uint64_t seen;          // Bit i: sequence number `head` - i was seen
+        uint8_t mac[6];
+        uint8_t lane;           // TID 0-15, 16 for non-QoS data, 17 for management
+        uint8_t referenced;     // Clock bit, set on every check
+        uint16_t head;          // Newest sequence number
+        uint8_t head_fragment;  // Highest fragment of `head` seen
+    };
+
+    struct StreamHash {
+        uint32_t operator()(const Stream& stream) const { return mac_hash(stream.mac, stream.lane); }
+    };
+
+    static_assert(FRAME_DEDUP_WINDOW <= 64, "FRAME_DEDUP_WINDOW must fit the 64-bit map");
+
+    // Update a stream with a sequence number; true if it is a retransmission
+    static bool record(Stream& stream, uint16_t sequence, uint8_t fragment, bool retry);
+
+    FixedTable<Stream, FRAME_DEDUP_CAPACITY, StreamHash> streams;
+
+    // Only written by the checking task
+    std::atomic<uint32_t> checked_count;
+    std::atomic<uint32_t> duplicate_count;
+    std::atomic<uint32_t> retry_count;
+    std::atomic<uint32_t> eviction_count;
+};
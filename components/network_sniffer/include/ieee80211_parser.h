@@ -0,0 +1,150 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Zero-allocation 802.11 MAC frame decoder.
+//
+// Every pointer and span in a ParsedFrame points into the caller's buffer;
+// nothing is copied and nothing is allocated, so the result is only valid
+// while that buffer is. This header has no ESP-IDF dependencies.
+
+// Frame types (frame control bits 2-3)
+#define IEEE80211_TYPE_MGMT                 0
+#define IEEE80211_TYPE_CTRL                 1
+#define IEEE80211_TYPE_DATA                 2
+#define IEEE80211_TYPE_EXT                  3
+
+// Management subtypes
+#define IEEE80211_MGMT_ASSOC_REQ            0
+#define IEEE80211_MGMT_ASSOC_RESP           1
+#define IEEE80211_MGMT_REASSOC_REQ          2
+#define IEEE80211_MGMT_REASSOC_RESP         3
+#define IEEE80211_MGMT_PROBE_REQ            4
+#define IEEE80211_MGMT_PROBE_RESP           5
+#define IEEE80211_MGMT_TIMING_ADV           6
+#define IEEE80211_MGMT_BEACON               8
+#define IEEE80211_MGMT_ATIM                 9
+#define IEEE80211_MGMT_DISASSOC             10
+#define IEEE80211_MGMT_AUTH                 11
+#define IEEE80211_MGMT_DEAUTH               12
+#define IEEE80211_MGMT_ACTION               13
+#define IEEE80211_MGMT_ACTION_NOACK         14
+
+// Control subtypes
+#define IEEE80211_CTRL_WRAPPER              7
+#define IEEE80211_CTRL_BAR                  8
+#define IEEE80211_CTRL_BA                   9
+#define IEEE80211_CTRL_PSPOLL               10
+#define IEEE80211_CTRL_RTS                  11
+#define IEEE80211_CTRL_CTS                  12
+#define IEEE80211_CTRL_ACK                  13
+#define IEEE80211_CTRL_CFEND                14
+#define IEEE80211_CTRL_CFEND_ACK            15
+
+// Data subtype bits
+#define IEEE80211_DATA_SUBTYPE_NULL         0x04
+#define IEEE80211_DATA_SUBTYPE_QOS          0x08
+
+// Frame control flags (second frame control byte)
+#define IEEE80211_FC_TO_DS                  0x01
+#define IEEE80211_FC_FROM_DS                0x02
+#define IEEE80211_FC_MORE_FRAG              0x04
+#define IEEE80211_FC_RETRY                  0x08
+#define IEEE80211_FC_PWR_MGMT               0x10
+#define IEEE80211_FC_MORE_DATA              0x20
+#define IEEE80211_FC_PROTECTED              0x40
+#define IEEE80211_FC_ORDER                  0x80
+
+// Information element IDs decoded by the parser
+#define IEEE80211_IE_SSID                   0
+#define IEEE80211_IE_DS_PARAMS              3
+#define IEEE80211_IE_HT_CAPS                45
+#define IEEE80211_IE_RSN                    48
+#define IEEE80211_IE_VHT_CAPS               191
+#define IEEE80211_IE_VENDOR                 221
+
+#define IEEE80211_MAC_LEN                   6
+#define IEEE80211_FCS_LEN                   4
+#define IEEE80211_MAX_SSID_LEN              32
+
+// Non-owning view of a byte range inside the parsed buffer
+struct ByteSpan {
+    const uint8_t* data;
+    size_t len;
+
+    bool empty() const { return data == nullptr; }
+};
+
+// Decoded frame. Address pointers are nullptr when the frame type does not
+// carry that address; spans are empty when the element was not present.
+struct ParsedFrame {
+    // Frame control
+    uint16_t frame_control;
+    uint8_t type;
+    uint8_t subtype;
+    uint8_t flags;
+    uint16_t duration;
+
+    // Raw addresses 1-4 as they appear in the header
+    const uint8_t* addr1;
+    const uint8_t* addr2;
+    const uint8_t* addr3;
+    const uint8_t* addr4;
+
+    // Roles derived from the type and the To/From DS bits
+    const uint8_t* receiver;
+    const uint8_t* transmitter;
+    const uint8_t* source;
+    const uint8_t* destination;
+    const uint8_t* bssid;
+
+    // Sequence control (management and data frames)
+    bool has_sequence;
+    uint16_t sequence_number;
+    uint8_t fragment_number;
+
+    // QoS control (QoS data frames)
+    bool has_qos;
+    uint16_t qos_control;
+    uint8_t tid;
+
+    // MAC header length and frame body (FCS excluded)
+    size_t header_len;
+    ByteSpan body;
+
+    // Management fixed fields; only the ones the subtype carries are set
+    uint16_t capability;
+    uint16_t beacon_interval;
+    uint16_t listen_interval;
+    uint16_t status_code;
+    uint16_t reason_code;
+    uint16_t auth_algorithm;
+    uint16_t auth_sequence;
+
+    // Tagged information elements of management frames
+    ByteSpan ies;
+    ByteSpan ssid;           // Zero length for a hidden / wildcard SSID
+    uint8_t ds_channel;      // 0 if no DS parameter set
+    ByteSpan rsn;
+    ByteSpan wpa;            // Microsoft WPA vendor element
+    ByteSpan ht_caps;
+    ByteSpan vht_caps;
+    bool ies_truncated;      // An element ran past the end of the buffer
+};
+
+// Decode the MAC header, per-subtype fixed fields and tagged elements of one
+// frame. `has_fcs` says whether the last four bytes are the FCS (true for a
+// complete frame from the ESP32 promiscuous callback). Returns false if the
+// buffer is too short for the header implied by its frame control field.
+bool ieee80211_parse(const uint8_t* data, size_t len, bool has_fcs, ParsedFrame* out);
+
+// Walk the tagged elements in `ies` and fill the element fields of `out`
+void ieee80211_parse_ies(ByteSpan ies, ParsedFrame* out);
+
+// Human-readable name of a type/subtype pair, for logs
+const char* ieee80211_subtype_name(uint8_t type, uint8_t subtype);
+
+inline bool ieee80211_is_mgmt(const ParsedFrame& frame, uint8_t subtype) {
+    return frame.type == IEEE80211_TYPE_MGMT && frame.subtype == subtype;
+}
@@ -1,9 +1,84 @@
 #pragma once
 
+#include <atomic>
 #include <string>
 #include "esp_wifi.h"
 #include "esp_event.h"
 #include "esp_log.h"
+#include "capture_clock.h"
+#include "frame_dedup.h"
+#include "frame_pool.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "spsc_ring.h"
+#include "ieee80211_parser.h"
+#include "packet_filter.h"
+
+// Maximum payload bytes copied per frame; longer frames are truncated
+#define SNIFFER_SNAPLEN         512
+// Number of preallocated frame slots between the RX callback and the processing task
+#define SNIFFER_RING_SLOTS      32
+
+// Highest 2.4 GHz channel the sniffer can be tuned to
+#define SNIFFER_MAX_CHANNEL     14
+
+// Channel hop timing. Dwell is time spent listening on a channel, dead time
+// is time spent retuning during which nothing can be captured.
+struct HopMetrics {
+    uint32_t hops;
+    uint32_t last_dead_time_us;
+    uint32_t max_dead_time_us;
+    uint64_t total_dead_time_us;
+    uint64_t total_dwell_us;
+    uint64_t dwell_us[SNIFFER_MAX_CHANNEL + 1];  // Indexed by channel number
+};
+
+// One captured frame as copied out of the promiscuous RX callback
+struct CapturedFrame {
+    wifi_pkt_rx_ctrl_t rx_ctrl;
+    wifi_promiscuous_pkt_type_t type;
+    uint16_t len;          // Bytes stored in payload
+    uint16_t orig_len;     // Length reported by the driver (sig_len)
+    uint8_t payload[SNIFFER_SNAPLEN];
+};
+
+// Maximum number of frame sinks that can be subscribed at once
+#define SNIFFER_MAX_FRAME_SINKS 8
+
+// Non-owning view of a captured frame. Only valid for the duration of the
+// sink call; retain() or copy whatever needs to outlive it.
+struct FrameView {
+    const uint8_t* payload;
+    uint16_t len;                        // Bytes available at payload
+    uint16_t orig_len;                   // Length reported by the driver (sig_len)
+    const wifi_pkt_rx_ctrl_t* rx_ctrl;
+    wifi_promiscuous_pkt_type_t type;
+    const ParsedFrame* parsed;           // Decoded 802.11 header, nullptr if malformed
+    int64_t timestamp_us;                // Receive time on the esp_timer_get_time() time base
+    int64_t reference_us;                // Receive time on the reference time base, see add_time_reference()
+    bool duplicate;                      // Retransmission of a frame already dispatched, see set_dedup()
+
+    // Keep the payload past the sink call. The first sink to ask copies it
+    // into the sniffer's frame pool, later sinks share that block. Invalid
+    // when no pool is set or the pool is exhausted.
+    FrameHandle retain() const;
+
+    FramePool* pool;                     // Pool retain() copies into, nullptr if none
+    FrameHandle* retained;               // Block shared by this frame's sinks
+};
+
+// Frame subscriber: a plain function plus the context pointer it was registered with
+typedef void (*frame_sink_t)(const FrameView& frame, void* ctx);
+
+// Capture path counters
+struct SnifferStats {
+    uint32_t captured;        // Frames copied into the ring
+    uint32_t filtered;        // Frames rejected by the software filter
+    uint32_t dropped;         // Frames lost because the ring was full
+    uint32_t processed;       // Frames drained by the processing task
+    uint32_t ring_high_water; // Highest ring occupancy seen
+    uint32_t ring_capacity;
+};
 
 class NetworkSniffer {
 public:
@@ -19,20 +94,93 @@ public:
     // Stop sniffing
     esp_err_t stop_sniffing();
     
+    // Retune to another channel while promiscuous mode stays enabled
+    esp_err_t set_channel(uint8_t channel);
+    
     // Set callback for packet processing
     void set_packet_callback(void (*callback)(const uint8_t* data, size_t len));
     
+    // Subscribe a sink to every captured frame
+    esp_err_t add_frame_sink(frame_sink_t sink, void* ctx);
+
+    // Unsubscribe a sink previously added with the same function and context
+    esp_err_t remove_frame_sink(frame_sink_t sink, void* ctx);
+
+    // Subscribe an object exposing `void on_frame(const FrameView& frame)`
+    template <typename Sink>
+    esp_err_t add_frame_sink(Sink* sink) {
+        return add_frame_sink(&NetworkSniffer::sink_trampoline<Sink>, sink);
+    }
+
+    template <typename Sink>
+    esp_err_t remove_frame_sink(Sink* sink) {
+        return remove_frame_sink(&NetworkSniffer::sink_trampoline<Sink>, sink);
+    }
+    
+    // Set the pool FrameView::retain() copies frames into, nullptr to stop
+    // retaining. Takes effect with the next batch; the pool must outlive the sniffer.
+    void set_frame_pool(FramePool* pool);
+
+    // Check every frame against `dedup` before dispatch. Retransmissions of
+    // frames already dispatched still reach every sink, with
+    // FrameView::duplicate set; sinks that count frames skip them. nullptr
+    // stops checking. Takes effect with the next batch; `dedup` must outlive
+    // the sniffer and is only touched by the processing task.
+    void set_dedup(FrameDedup* dedup);
+
+    // Compile a filter expression (see packet_filter.h) and apply it: the
+    // coarse frame type mask is pushed down to the driver and the compiled
+    // predicates run in the RX callback before anything is copied.
+    // An empty expression restores the default management + data capture.
+    esp_err_t set_filter(const char* expression);
+    
     // Get current channel
     uint8_t get_current_channel() const;
     
     // Check if sniffing is active
     bool is_sniffing() const;
 
+    // Get capture path counters
+    SnifferStats get_stats() const;
+
+    // Get channel dwell and retune dead-time metrics
+    HopMetrics get_hop_metrics() const;
+
+    // Feed a pair of simultaneous esp_timer_get_time() and external reference
+    // readings; FrameView::reference_us follows the reference from the next
+    // batch on. ESP_ERR_INVALID_ARG if the pair was rejected as an outlier.
+    esp_err_t add_time_reference(int64_t local_us, int64_t reference_us);
+
+    // Get receive timer extension and reference tracking state
+    CaptureClockStats get_clock_stats() const;
+
 private:
+    typedef SpscRing<CapturedFrame, SNIFFER_RING_SLOTS> FrameRing;
+
+    struct FrameSinkEntry {
+        frame_sink_t sink;
+        void* ctx;
+    };
+
+    template <typename Sink>
+    static void sink_trampoline(const FrameView& frame, void* ctx) {
+        static_cast<Sink*>(ctx)->on_frame(frame);
+    }
+
     static void wifi_event_handler(void* arg, esp_event_base_t event_base,
                                   int32_t event_id, void* event_data);
     
     static void packet_handler(void* buf, wifi_promiscuous_pkt_type_t type);
+
+    // Task draining the frame ring outside of the Wi-Fi driver context
+    static void processing_task(void* arg);
+
+    // Push the active filter's type masks down to the driver
+    esp_err_t apply_driver_filter();
+
+    // Handle one frame taken from the ring, dispatching it to the given sinks
+    void process_frame(const CapturedFrame& frame, const FrameSinkEntry* sinks, size_t sink_count,
+                       FramePool* pool, FrameDedup* dedup, const ReferenceClock& reference);
     
     // WiFi event handler instance
     esp_event_handler_instance_t wifi_event_handler_instance;
@@ -42,10 +190,58 @@ private:
     
     // Sniffing state
     bool sniffing_active;
+
+    // Hop metrics and the time the current channel started listening, guarded by hop_lock
+    HopMetrics hop_metrics;
+    int64_t channel_enter_us;
+    mutable portMUX_TYPE hop_lock;
     
     // Packet callback function
     void (*packet_callback)(const uint8_t* data, size_t len);
+
+    // Subscribed frame sinks, the pool they retain frames into and the
+    // retransmission filter, guarded by sinks_lock
+    FrameSinkEntry frame_sinks[SNIFFER_MAX_FRAME_SINKS];
+    size_t frame_sink_count;
+    FramePool* frame_pool;
+    FrameDedup* frame_dedup;
+    portMUX_TYPE sinks_lock;
+
+    // Frames handed from the RX callback to the processing task
+    FrameRing* frame_ring;
+    TaskHandle_t processing_task_handle;
+
+    // Receive timestamps, only used by the processing task
+    CaptureClock capture_clock;
+
+    // Reference time mapping and the capture clock state last published by
+    // the processing task, guarded by clock_lock
+    ReferenceClock reference_clock;
+    CaptureClockStats clock_stats;
+    mutable portMUX_TYPE clock_lock;
+
+    // Wi-Fi driver task the RX callback runs in, only written by that task
+    TaskHandle_t ingest_task_handle;
+
+    // Double-buffered software filter: set_filter compiles into the inactive
+    // slot, flips active_filter and waits until the RX callback is no longer
+    // evaluating the old one
+    PacketFilter filters[2];
+    std::atomic<uint8_t> active_filter;
+    std::atomic<bool> filter_in_use;
+
+    // Capture counters (ring drops are counted by the ring itself)
+    std::atomic<uint32_t> captured_count;
+    std::atomic<uint32_t> filtered_count;
+    std::atomic<uint32_t> processed_count;
+
+    // Instance the static promiscuous callback feeds
+    static NetworkSniffer* active_instance;
     
     // Log tag
     static const char* TAG;
-}; 
\ No newline at end of file
+
+    // Processing task parameters
+    static const uint32_t PROCESSING_TASK_STACK = 4096;
+    static const UBaseType_t PROCESSING_TASK_PRIORITY = 10;
+};
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Compiled software packet filter.
+//
+// A small BPF-like expression is compiled once into a flat table of
+// predicates that is cheap enough to evaluate inside the promiscuous RX
+// callback, before the frame is copied anywhere. Grammar:
+//
+//   expr      := clause ("or" clause)*
+//   clause    := term ("and" term)*
+//   term      := ["not"] primitive
+//   primitive := "type" (mgmt | ctrl | data)
+//              | "subtype" NAME            e.g. beacon, probe-req, deauth, qos-data, rts
+//              | (bssid | src | dst | addr) MAC
+//              | (rssi | len | channel) [CMP] NUMBER     CMP: == != < <= > >=  (default ==)
+//              | len NUMBER-NUMBER         inclusive length range
+//
+// "and" binds tighter than "or". `src` is the transmitter (address 2), `dst`
+// the receiver (address 1), `addr` matches any of addresses 1-3. An empty
+// expression matches everything. Subtype names are the ones returned by
+// ieee80211_subtype_name().
+//
+// This header has no ESP-IDF dependencies.
+
+// Maximum number of predicates in one compiled filter
+#define PACKET_FILTER_MAX_TERMS     16
+
+// Frame summary the filter is evaluated against
+struct FilterInput {
+    const uint8_t* payload;   // Start of the 802.11 header
+    size_t len;               // Bytes available at payload
+    uint16_t frame_len;       // Length reported by the driver
+    int8_t rssi;
+    uint8_t channel;
+};
+
+class PacketFilter {
+public:
+    PacketFilter();
+
+    // Compile an expression, replacing the current table. On failure the
+    // filter is left matching everything and a message is written to `error`.
+    bool compile(const char* expression, char* error = nullptr, size_t error_len = 0);
+
+    // Reset to the match-everything filter
+    void clear();
+
+    // Evaluate the compiled table against one frame
+    bool matches(const FilterInput& input) const;
+
+    // Bitmask of 802.11 frame types (1 << IEEE80211_TYPE_x) the filter can
+    // accept, for pushing down to the driver
+    uint32_t type_mask() const { return accepted_types; }
+
+    // Bitmask of control subtypes (1 << subtype) the filter can accept
+    uint16_t ctrl_subtype_mask() const { return accepted_ctrl_subtypes; }
+
+    // Number of compiled predicates
+    size_t term_count() const { return count; }
+
+private:
+    struct Term {
+        uint8_t field;
+        uint8_t op;
+        uint8_t flags;        // TERM_NEGATE, TERM_CLAUSE_END
+        uint8_t mac[6];
+        int32_t a;
+        int32_t b;
+    };
+
+    bool eval_term(const Term& term, const FilterInput& input) const;
+    void compute_masks();
+
+    Term terms[PACKET_FILTER_MAX_TERMS];
+    size_t count;
+    uint32_t accepted_types;
+    uint16_t accepted_ctrl_subtypes;
+};
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Single-producer / single-consumer lock-free ring of preallocated slots.
+//
+// The producer claims the next free slot, fills it in place and publishes it;
+// the consumer peeks the oldest published slot and releases it when done.
+// Neither side ever blocks or allocates, so the producer side is safe to run
+// inside the Wi-Fi promiscuous callback. When the ring is full the producer
+// fails immediately and the drop counter is bumped.
+//
+// This header has no ESP-IDF dependencies so it can be built and
+// stress-tested on a Linux host with two std::threads.
+template <typename T, size_t Capacity>
+class SpscRing {
+    static_assert(Capacity >= 2, "SpscRing needs at least two slots");
+    static_assert((Capacity & (Capacity - 1)) == 0, "SpscRing capacity must be a power of two");
+
+public:
+    SpscRing() : head(0), tail(0), dropped_count(0), high_water_mark(0) {}
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // Producer: claim the next free slot, or nullptr (and count a drop) if full.
+    // The slot is invisible to the consumer until publish() is called.
+    T* claim() {
+        const size_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) >= Capacity) {
+            dropped_count.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        return &slots[h & MASK];
+    }
+
+    // Producer: make the slot returned by the last claim() visible.
+    void publish() {
+        const size_t h = head.load(std::memory_order_relaxed) + 1;
+        head.store(h, std::memory_order_release);
+
+        const uint32_t used = static_cast<uint32_t>(h - tail.load(std::memory_order_relaxed));
+        if (used > high_water_mark.load(std::memory_order_relaxed)) {
+            high_water_mark.store(used, std::memory_order_relaxed);
+        }
+    }
+
+    // Producer: copy an item in. Returns false if the ring was full.
+    bool push(const T& item) {
+        T* slot = claim();
+        if (slot == nullptr) {
+            return false;
+        }
+        *slot = item;
+        publish();
+        return true;
+    }
+
+    // Consumer: oldest published slot, or nullptr if the ring is empty.
+    T* peek() {
+        const size_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        return &slots[t & MASK];
+    }
+
+    // Consumer: hand the slot returned by peek() back to the producer.
+    void release() {
+        tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Consumer: copy the oldest item out. Returns false if the ring was empty.
+    bool pop(T& out) {
+        T* slot = peek();
+        if (slot == nullptr) {
+            return false;
+        }
+        out = *slot;
+        release();
+        return true;
+    }
+
+    // Approximate number of published, unconsumed slots (exact from either side).
+    size_t size() const {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    bool empty() const { return size() == 0; }
+
+    static constexpr size_t capacity() { return Capacity; }
+
+    // Number of claim()/push() calls rejected because the ring was full
+    uint32_t dropped() const { return dropped_count.load(std::memory_order_relaxed); }
+
+    // Highest occupancy observed by the producer
+    uint32_t high_water() const { return high_water_mark.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr size_t MASK = Capacity - 1;
+
+    // Producer and consumer indices live on separate cache lines so the two
+    // sides do not false-share on hosts with real caches.
+    alignas(64) std::atomic<size_t> head;
+    alignas(64) std::atomic<size_t> tail;
+
+    // Producer-side counters
+    alignas(64) std::atomic<uint32_t> dropped_count;
+    std::atomic<uint32_t> high_water_mark;
+
+    T slots[Capacity];
+};
@@ -1,21 +1,54 @@
 #include "network_sniffer.h"
+#include <new>
+#include <string.h>
 #include "esp_wifi.h"
 #include "esp_event.h"
 #include "esp_log.h"
 #include "esp_system.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "pipeline_runtime.h"
+#include "sniffer_trace.h"
 
 const char* NetworkSniffer::TAG = "NETWORK_SNIFFER";
 
+NetworkSniffer* NetworkSniffer::active_instance = nullptr;
+
+// Big-endian word at `offset` of the captured bytes, zero past the end
+static uint32_t load_be32(const CapturedFrame& frame, size_t offset) {
+    uint32_t word = 0;
+    for (size_t i = offset; i < offset + 4; i++) {
+        word = (word << 8) | (i < frame.len ? frame.payload[i] : 0);
+    }
+    return word;
+}
+
 NetworkSniffer::NetworkSniffer() 
-    : current_channel(1), sniffing_active(false), packet_callback(nullptr) {
+    : current_channel(1), sniffing_active(false), hop_metrics(), channel_enter_us(0),
+      hop_lock(portMUX_INITIALIZER_UNLOCKED), packet_callback(nullptr),
+      frame_sink_count(0), frame_pool(nullptr), frame_dedup(nullptr), sinks_lock(portMUX_INITIALIZER_UNLOCKED),
+      frame_ring(nullptr), processing_task_handle(nullptr), clock_stats(),
+      clock_lock(portMUX_INITIALIZER_UNLOCKED), ingest_task_handle(nullptr),
+      active_filter(0), filter_in_use(false),
+      captured_count(0), filtered_count(0), processed_count(0) {
 }
 
 NetworkSniffer::~NetworkSniffer() {
     if (sniffing_active) {
         stop_sniffing();
     }
+    if (active_instance == this) {
+        active_instance = nullptr;
+    }
+    if (processing_task_handle) {
+        pipeline_unregister_task(processing_task_handle);
+        vTaskDelete(processing_task_handle);
+    }
+    if (ingest_task_handle) {
+        pipeline_unregister_task(ingest_task_handle);
+    }
+    delete frame_ring;
 }
 
 esp_err_t NetworkSniffer::init() {
@@ -29,8 +62,30 @@ esp_err_t NetworkSniffer::init() {
         this,
         &wifi_event_handler_instance
     ));
+
+    // Preallocate the frame ring so the RX callback never allocates
+    frame_ring = new (std::nothrow) FrameRing();
+    if (frame_ring == nullptr) {
+        ESP_LOGE(TAG, "Failed to allocate frame ring (%d bytes)", (int)sizeof(FrameRing));
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Parsing and the sinks run on the analysis core, away from the Wi-Fi task
+    if (pipeline_create_task(PIPELINE_STAGE_ANALYSIS, &NetworkSniffer::processing_task, "sniffer_proc",
+                             PROCESSING_TASK_STACK, this, PROCESSING_TASK_PRIORITY,
+                             &processing_task_handle) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create processing task");
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Hot-path diagnostics are printed from the trace task, never inline
+    esp_err_t ret = sniffer_trace_start();
+    if (ret != ESP_OK) {
+        return ret;
+    }
     
-    ESP_LOGI(TAG, "Network sniffer initialized successfully");
+    ESP_LOGI(TAG, "Network sniffer initialized successfully (%d ring slots, %d byte snaplen)",
+             SNIFFER_RING_SLOTS, SNIFFER_SNAPLEN);
     return ESP_OK;
 }
 
@@ -39,6 +94,10 @@ esp_err_t NetworkSniffer::start_sniffing(uint8_t channel) {
         ESP_LOGW(TAG, "Sniffing already active");
         return ESP_ERR_INVALID_STATE;
     }
+    if (frame_ring == nullptr) {
+        ESP_LOGE(TAG, "Sniffer not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
     
     ESP_LOGI(TAG, "Starting sniffing on channel %d", channel);
     
@@ -52,11 +111,16 @@ esp_err_t NetworkSniffer::start_sniffing(uint8_t channel) {
     ESP_ERROR_CHECK(esp_wifi_start());
     
     // Set promiscuous mode
+    active_instance = this;
     ESP_ERROR_CHECK(esp_wifi_set_promiscuous(true));
     ESP_ERROR_CHECK(esp_wifi_set_promiscuous_rx_cb(&NetworkSniffer::packet_handler));
+    ESP_ERROR_CHECK(apply_driver_filter());
     
     current_channel = channel;
     sniffing_active = true;
+    portENTER_CRITICAL(&hop_lock);
+    channel_enter_us = esp_timer_get_time();
+    portEXIT_CRITICAL(&hop_lock);
     
     ESP_LOGI(TAG, "Sniffing started on channel %d", channel);
     return ESP_OK;
@@ -77,15 +141,183 @@ esp_err_t NetworkSniffer::stop_sniffing() {
     ESP_ERROR_CHECK(esp_wifi_stop());
     
     sniffing_active = false;
+    portENTER_CRITICAL(&hop_lock);
+    uint64_t dwell = esp_timer_get_time() - channel_enter_us;
+    hop_metrics.dwell_us[current_channel] += dwell;
+    hop_metrics.total_dwell_us += dwell;
+    portEXIT_CRITICAL(&hop_lock);
     
     ESP_LOGI(TAG, "Sniffing stopped");
     return ESP_OK;
 }
 
+esp_err_t NetworkSniffer::set_channel(uint8_t channel) {
+    if (channel < 1 || channel > SNIFFER_MAX_CHANNEL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!sniffing_active) {
+        ESP_LOGW(TAG, "Sniffing not active");
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (channel == current_channel) {
+        return ESP_OK;
+    }
+
+    // Only the radio is retuned; promiscuous mode and the RX callback stay live
+    int64_t leave_us = esp_timer_get_time();
+    esp_err_t ret = esp_wifi_set_channel(channel, WIFI_SECOND_CHAN_NONE);
+    int64_t enter_us = esp_timer_get_time();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to switch to channel %d: %s", channel, esp_err_to_name(ret));
+        return ret;
+    }
+
+    uint32_t dead_us = (uint32_t)(enter_us - leave_us);
+    portENTER_CRITICAL(&hop_lock);
+    uint64_t dwell = leave_us - channel_enter_us;
+    hop_metrics.dwell_us[current_channel] += dwell;
+    hop_metrics.total_dwell_us += dwell;
+    hop_metrics.hops++;
+    hop_metrics.last_dead_time_us = dead_us;
+    hop_metrics.total_dead_time_us += dead_us;
+    if (dead_us > hop_metrics.max_dead_time_us) {
+        hop_metrics.max_dead_time_us = dead_us;
+    }
+    channel_enter_us = enter_us;
+    portEXIT_CRITICAL(&hop_lock);
+
+    current_channel = channel;
+    ESP_LOGD(TAG, "Switched to channel %d in %lu us", channel, dead_us);
+    return ESP_OK;
+}
+
 void NetworkSniffer::set_packet_callback(void (*callback)(const uint8_t* data, size_t len)) {
     packet_callback = callback;
 }
 
+esp_err_t NetworkSniffer::set_filter(const char* expression) {
+    uint8_t next = active_filter.load() ^ 1;
+    char error[64];
+    if (!filters[next].compile(expression, error, sizeof(error))) {
+        ESP_LOGE(TAG, "Invalid filter '%s': %s", expression, error);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    active_filter.store(next);
+    // Once the callback is seen idle it can only pick up the new filter
+    while (filter_in_use.load()) {
+        taskYIELD();
+    }
+
+    ESP_LOGI(TAG, "Filter set to '%s' (%d terms)", expression ? expression : "",
+             (int)filters[next].term_count());
+    if (sniffing_active) {
+        return apply_driver_filter();
+    }
+    return ESP_OK;
+}
+
+esp_err_t NetworkSniffer::apply_driver_filter() {
+    const PacketFilter& filter = filters[active_filter.load()];
+
+    wifi_promiscuous_filter_t type_filter = {};
+    uint32_t types = filter.type_mask();
+    if (types & (1u << IEEE80211_TYPE_MGMT)) type_filter.filter_mask |= WIFI_PROMIS_FILTER_MASK_MGMT;
+    if (types & (1u << IEEE80211_TYPE_CTRL)) type_filter.filter_mask |= WIFI_PROMIS_FILTER_MASK_CTRL;
+    if (types & (1u << IEEE80211_TYPE_DATA)) type_filter.filter_mask |= WIFI_PROMIS_FILTER_MASK_DATA;
+
+    esp_err_t ret = esp_wifi_set_promiscuous_filter(&type_filter);
+    if (ret != ESP_OK || !(types & (1u << IEEE80211_TYPE_CTRL))) {
+        return ret;
+    }
+
+    // Control subtypes the driver can filter on individually
+    static const struct {
+        uint8_t subtype;
+        uint32_t mask;
+    } ctrl_masks[] = {
+        { IEEE80211_CTRL_WRAPPER,   WIFI_PROMIS_CTRL_FILTER_MASK_WRAPPER },
+        { IEEE80211_CTRL_BAR,       WIFI_PROMIS_CTRL_FILTER_MASK_BAR },
+        { IEEE80211_CTRL_BA,        WIFI_PROMIS_CTRL_FILTER_MASK_BA },
+        { IEEE80211_CTRL_PSPOLL,    WIFI_PROMIS_CTRL_FILTER_MASK_PSPOLL },
+        { IEEE80211_CTRL_RTS,       WIFI_PROMIS_CTRL_FILTER_MASK_RTS },
+        { IEEE80211_CTRL_CTS,       WIFI_PROMIS_CTRL_FILTER_MASK_CTS },
+        { IEEE80211_CTRL_ACK,       WIFI_PROMIS_CTRL_FILTER_MASK_ACK },
+        { IEEE80211_CTRL_CFEND,     WIFI_PROMIS_CTRL_FILTER_MASK_CFEND },
+        { IEEE80211_CTRL_CFEND_ACK, WIFI_PROMIS_CTRL_FILTER_MASK_CFENDACK },
+    };
+    wifi_promiscuous_filter_t ctrl_filter = {};
+    uint16_t subtypes = filter.ctrl_subtype_mask();
+    for (size_t i = 0; i < sizeof(ctrl_masks) / sizeof(ctrl_masks[0]); i++) {
+        if (subtypes & (1u << ctrl_masks[i].subtype)) {
+            ctrl_filter.filter_mask |= ctrl_masks[i].mask;
+        }
+    }
+    return esp_wifi_set_promiscuous_ctrl_filter(&ctrl_filter);
+}
+
+esp_err_t NetworkSniffer::add_frame_sink(frame_sink_t sink, void* ctx) {
+    if (sink == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = ESP_OK;
+    portENTER_CRITICAL(&sinks_lock);
+    if (frame_sink_count >= SNIFFER_MAX_FRAME_SINKS) {
+        ret = ESP_ERR_NO_MEM;
+    } else {
+        frame_sinks[frame_sink_count].sink = sink;
+        frame_sinks[frame_sink_count].ctx = ctx;
+        frame_sink_count++;
+    }
+    portEXIT_CRITICAL(&sinks_lock);
+
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Frame sink table full (%d sinks)", SNIFFER_MAX_FRAME_SINKS);
+    }
+    return ret;
+}
+
+esp_err_t NetworkSniffer::remove_frame_sink(frame_sink_t sink, void* ctx) {
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    portENTER_CRITICAL(&sinks_lock);
+    for (size_t i = 0; i < frame_sink_count; i++) {
+        if (frame_sinks[i].sink == sink && frame_sinks[i].ctx == ctx) {
+            // Keep subscription order stable for the remaining sinks
+            for (size_t j = i + 1; j < frame_sink_count; j++) {
+                frame_sinks[j - 1] = frame_sinks[j];
+            }
+            frame_sink_count--;
+            ret = ESP_OK;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&sinks_lock);
+    return ret;
+}
+
+void NetworkSniffer::set_frame_pool(FramePool* pool) {
+    portENTER_CRITICAL(&sinks_lock);
+    frame_pool = pool;
+    portEXIT_CRITICAL(&sinks_lock);
+}
+
+void NetworkSniffer::set_dedup(FrameDedup* dedup) {
+    portENTER_CRITICAL(&sinks_lock);
+    frame_dedup = dedup;
+    portEXIT_CRITICAL(&sinks_lock);
+}
+
+FrameHandle FrameView::retain() const {
+    if (retained == nullptr) {
+        return FrameHandle();
+    }
+    if (!retained->valid() && pool != nullptr) {
+        *retained = pool->copy(payload, len);
+    }
+    return *retained;
+}
+
 uint8_t NetworkSniffer::get_current_channel() const {
     return current_channel;
 }
@@ -94,6 +326,47 @@ bool NetworkSniffer::is_sniffing() const {
     return sniffing_active;
 }
 
+SnifferStats NetworkSniffer::get_stats() const {
+    SnifferStats stats = {};
+    stats.captured = captured_count.load(std::memory_order_relaxed);
+    stats.filtered = filtered_count.load(std::memory_order_relaxed);
+    stats.processed = processed_count.load(std::memory_order_relaxed);
+    stats.ring_capacity = SNIFFER_RING_SLOTS;
+    if (frame_ring) {
+        stats.dropped = frame_ring->dropped();
+        stats.ring_high_water = frame_ring->high_water();
+    }
+    return stats;
+}
+
+esp_err_t NetworkSniffer::add_time_reference(int64_t local_us, int64_t reference_us) {
+    portENTER_CRITICAL(&clock_lock);
+    bool accepted = reference_clock.add_reference(local_us, reference_us);
+    portEXIT_CRITICAL(&clock_lock);
+    return accepted ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+CaptureClockStats NetworkSniffer::get_clock_stats() const {
+    portENTER_CRITICAL(&clock_lock);
+    CaptureClockStats stats = clock_stats;
+    reference_clock.get_stats(&stats);
+    portEXIT_CRITICAL(&clock_lock);
+    return stats;
+}
+
+HopMetrics NetworkSniffer::get_hop_metrics() const {
+    portENTER_CRITICAL(&hop_lock);
+    HopMetrics metrics = hop_metrics;
+    if (sniffing_active) {
+        // Include the time spent so far on the current channel
+        uint64_t dwell = esp_timer_get_time() - channel_enter_us;
+        metrics.dwell_us[current_channel] += dwell;
+        metrics.total_dwell_us += dwell;
+    }
+    portEXIT_CRITICAL(&hop_lock);
+    return metrics;
+}
+
 void NetworkSniffer::wifi_event_handler(void* arg, esp_event_base_t event_base,
                                        int32_t event_id, void* event_data) {
     NetworkSniffer* sniffer = static_cast<NetworkSniffer*>(arg);
@@ -112,25 +385,144 @@ void NetworkSniffer::wifi_event_handler(void* arg, esp_event_base_t event_base,
 }
 
 void NetworkSniffer::packet_handler(void* buf, wifi_promiscuous_pkt_type_t type) {
-    if (type != WIFI_PKT_MGMT && type != WIFI_PKT_DATA) {
+    // Runs in the Wi-Fi driver task: filter, copy into the ring and return.
+    // The frame type mask has already been applied by the driver.
+    if (type == WIFI_PKT_MISC) {
+        return;
+    }
+
+    NetworkSniffer* sniffer = active_instance;
+    if (sniffer == nullptr) {
         return;
     }
     
-    wifi_promiscuous_pkt_t* pkt = (wifi_promiscuous_pkt_t*)buf;
-    
-    // Log packet information
-    ESP_LOGI(TAG, "Packet received - Type: %d, Length: %d, Channel: %d, RSSI: %d",
-             type, pkt->rx_ctrl.sig_len, pkt->rx_ctrl.channel, pkt->rx_ctrl.rssi);
-    
-    // Print first few bytes of the packet for debugging
-    if (pkt->rx_ctrl.sig_len > 0) {
-        ESP_LOG_BUFFER_HEX(TAG, pkt->payload, 
-                          pkt->rx_ctrl.sig_len > 32 ? 32 : pkt->rx_ctrl.sig_len);
+    const wifi_promiscuous_pkt_t* pkt = (const wifi_promiscuous_pkt_t*)buf;
+
+    // The driver task is the ingest stage; account it on its first frame
+    if (sniffer->ingest_task_handle == nullptr) {
+        sniffer->ingest_task_handle = xTaskGetCurrentTaskHandle();
+        pipeline_register_task(PIPELINE_STAGE_INGEST, sniffer->ingest_task_handle);
+    }
+
+    FilterInput input;
+    input.payload = pkt->payload;
+    input.len = pkt->rx_ctrl.sig_len;
+    input.frame_len = pkt->rx_ctrl.sig_len;
+    input.rssi = pkt->rx_ctrl.rssi;
+    input.channel = pkt->rx_ctrl.channel;
+
+    sniffer->filter_in_use.store(true);
+    bool keep = sniffer->filters[sniffer->active_filter.load()].matches(input);
+    sniffer->filter_in_use.store(false, std::memory_order_release);
+    if (!keep) {
+        sniffer->filtered_count.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    CapturedFrame* slot = sniffer->frame_ring->claim();
+    if (slot == nullptr) {
+        SNIFFER_TRACE_D(TAG, "Frame ring full, %lu frames dropped", sniffer->frame_ring->dropped());
+        return;
+    }
+
+    uint16_t len = pkt->rx_ctrl.sig_len;
+    slot->rx_ctrl = pkt->rx_ctrl;
+    slot->type = type;
+    slot->orig_len = len;
+    slot->len = len > SNIFFER_SNAPLEN ? SNIFFER_SNAPLEN : len;
+    memcpy(slot->payload, pkt->payload, slot->len);
+    sniffer->frame_ring->publish();
+
+    sniffer->captured_count.fetch_add(1, std::memory_order_relaxed);
+    xTaskNotifyGive(sniffer->processing_task_handle);
+}
+
+void NetworkSniffer::processing_task(void* arg) {
+    NetworkSniffer* sniffer = static_cast<NetworkSniffer*>(arg);
+
+    FrameSinkEntry sinks[SNIFFER_MAX_FRAME_SINKS];
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+
+        // Snapshot the subscriber table once per batch so sinks can be
+        // added or removed while frames are being dispatched
+        portENTER_CRITICAL(&sniffer->sinks_lock);
+        size_t sink_count = sniffer->frame_sink_count;
+        memcpy(sinks, sniffer->frame_sinks, sink_count * sizeof(FrameSinkEntry));
+        FramePool* pool = sniffer->frame_pool;
+        FrameDedup* dedup = sniffer->frame_dedup;
+        portEXIT_CRITICAL(&sniffer->sinks_lock);
+
+        portENTER_CRITICAL(&sniffer->clock_lock);
+        ReferenceClock reference = sniffer->reference_clock;
+        portEXIT_CRITICAL(&sniffer->clock_lock);
+
+        CapturedFrame* frame;
+        bool processed = false;
+        while ((frame = sniffer->frame_ring->peek()) != nullptr) {
+            sniffer->process_frame(*frame, sinks, sink_count, pool, dedup, reference);
+            sniffer->frame_ring->release();
+            sniffer->processed_count.fetch_add(1, std::memory_order_relaxed);
+            processed = true;
+        }
+
+        if (processed) {
+            CaptureClockStats stats;
+            sniffer->capture_clock.get_stats(&stats);
+            portENTER_CRITICAL(&sniffer->clock_lock);
+            sniffer->clock_stats = stats;
+            portEXIT_CRITICAL(&sniffer->clock_lock);
+        }
+    }
+}
+
+void NetworkSniffer::process_frame(const CapturedFrame& frame, const FrameSinkEntry* sinks, size_t sink_count,
+                                   FramePool* pool, FrameDedup* dedup, const ReferenceClock& reference) {
+    CaptureTime time = capture_clock.capture(frame.rx_ctrl.timestamp, esp_timer_get_time(), reference);
+
+    // Decode the 802.11 header once for every sink. The FCS is only present
+    // when the frame was not truncated to the snaplen.
+    ParsedFrame parsed;
+    bool parsed_ok = ieee80211_parse(frame.payload, frame.len, frame.len == frame.orig_len, &parsed);
+
+    // Trace packet information; compiled out below TRACE_LEVEL_INFO
+    if (parsed_ok && parsed.transmitter) {
+        const uint8_t* ta = parsed.transmitter;
+        SNIFFER_TRACE_I(TAG, "Packet received - %s, Length: %lu, Channel: %lu, RSSI: %ld, TA: %06lx%06lx",
+                        ieee80211_subtype_name(parsed.type, parsed.subtype), frame.orig_len,
+                        frame.rx_ctrl.channel, frame.rx_ctrl.rssi,
+                        (ta[0] << 16) | (ta[1] << 8) | ta[2], (ta[3] << 16) | (ta[4] << 8) | ta[5]);
+    } else {
+        SNIFFER_TRACE_I(TAG, "Packet received - Type: %lu, Length: %lu, Channel: %lu, RSSI: %ld",
+                        frame.type, frame.orig_len, frame.rx_ctrl.channel, frame.rx_ctrl.rssi);
     }
     
-    // TODO: Add more sophisticated packet analysis here
-    // - Parse 802.11 frame headers
-    // - Extract MAC addresses
-    // - Analyze packet types (beacon, probe, data, etc.)
-    // - Store statistics
-} 
\ No newline at end of file
+    // First bytes of the packet for debugging
+    SNIFFER_TRACE_V(TAG, "Header: %08lx %08lx %08lx %08lx",
+                    load_be32(frame, 0), load_be32(frame, 4), load_be32(frame, 8), load_be32(frame, 12));
+
+    // The view points straight into the ring slot; nothing is copied again
+    // unless a sink retains the frame
+    FrameHandle retained;
+    FrameView view;
+    view.payload = frame.payload;
+    view.len = frame.len;
+    view.orig_len = frame.orig_len;
+    view.rx_ctrl = &frame.rx_ctrl;
+    view.type = frame.type;
+    view.parsed = parsed_ok ? &parsed : nullptr;
+    view.timestamp_us = time.local_us;
+    view.reference_us = time.reference_us;
+    view.duplicate = dedup && parsed_ok && dedup->check(parsed) == DEDUP_DUPLICATE;
+    view.pool = pool;
+    view.retained = &retained;
+
+    for (size_t i = 0; i < sink_count; i++) {
+        sinks[i].sink(view, sinks[i].ctx);
+    }
+
+    if (packet_callback) {
+        packet_callback(frame.payload, frame.len);
+    }
+}
@@ -0,0 +1,359 @@
+#include "packet_filter.h"
+#include "ieee80211_parser.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+    FIELD_TYPE,
+    FIELD_SUBTYPE,
+    FIELD_BSSID,
+    FIELD_SRC,
+    FIELD_DST,
+    FIELD_ADDR,
+    FIELD_RSSI,
+    FIELD_LEN,
+    FIELD_CHANNEL,
+};
+
+enum {
+    OP_EQ,
+    OP_NE,
+    OP_LT,
+    OP_LE,
+    OP_GT,
+    OP_GE,
+    OP_RANGE,
+};
+
+#define TERM_NEGATE         0x01
+#define TERM_CLAUSE_END     0x02
+
+// Types accepted by a clause that does not constrain the type
+#define DEFAULT_TYPE_MASK   ((1u << IEEE80211_TYPE_MGMT) | (1u << IEEE80211_TYPE_DATA))
+#define ALL_TYPE_MASK       ((1u << IEEE80211_TYPE_MGMT) | (1u << IEEE80211_TYPE_CTRL) | (1u << IEEE80211_TYPE_DATA))
+
+#define MAX_TOKEN_LEN       24
+
+namespace {
+
+// Whitespace tokenizer over the expression string
+struct Lexer {
+    const char* p;
+    char token[MAX_TOKEN_LEN];
+
+    // Read the next token; returns false at end of input
+    bool next() {
+        while (*p && isspace((unsigned char)*p)) p++;
+        if (!*p) return false;
+        size_t n = 0;
+        while (*p && !isspace((unsigned char)*p)) {
+            if (n + 1 < sizeof(token)) token[n++] = (char)tolower((unsigned char)*p);
+            p++;
+        }
+        token[n] = '\0';
+        return true;
+    }
+};
+
+bool parse_int(const char* s, int32_t* out) {
+    char* end;
+    long v = strtol(s, &end, 10);
+    if (end == s || *end != '\0') return false;
+    *out = (int32_t)v;
+    return true;
+}
+
+bool parse_mac(const char* s, uint8_t mac[6]) {
+    unsigned int b[6];
+    char tail;
+    if (sscanf(s, "%2x:%2x:%2x:%2x:%2x:%2x%c", &b[0], &b[1], &b[2], &b[3], &b[4], &b[5], &tail) != 6) {
+        return false;
+    }
+    for (int i = 0; i < 6; i++) mac[i] = (uint8_t)b[i];
+    return true;
+}
+
+// Split an optional comparison prefix off a value token ("<=-70" -> OP_LE, "-70")
+const char* parse_op(const char* s, uint8_t* op) {
+    if (s[0] == '=' && s[1] == '=') { *op = OP_EQ; return s + 2; }
+    if (s[0] == '!' && s[1] == '=') { *op = OP_NE; return s + 2; }
+    if (s[0] == '<' && s[1] == '=') { *op = OP_LE; return s + 2; }
+    if (s[0] == '>' && s[1] == '=') { *op = OP_GE; return s + 2; }
+    if (s[0] == '<') { *op = OP_LT; return s + 1; }
+    if (s[0] == '>') { *op = OP_GT; return s + 1; }
+    if (s[0] == '=') { *op = OP_EQ; return s + 1; }
+    *op = OP_EQ;
+    return s;
+}
+
+bool lookup_subtype(const char* name, uint8_t* type, uint8_t* subtype) {
+    for (uint8_t t = IEEE80211_TYPE_MGMT; t <= IEEE80211_TYPE_DATA; t++) {
+        for (uint8_t s = 0; s < 16; s++) {
+            if (strcmp(name, ieee80211_subtype_name(t, s)) == 0) {
+                *type = t;
+                *subtype = s;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool compare(int32_t v, uint8_t op, int32_t a, int32_t b) {
+    switch (op) {
+        case OP_EQ: return v == a;
+        case OP_NE: return v != a;
+        case OP_LT: return v < a;
+        case OP_LE: return v <= a;
+        case OP_GT: return v > a;
+        case OP_GE: return v >= a;
+        case OP_RANGE: return v >= a && v <= b;
+        default: return false;
+    }
+}
+
+const uint8_t* frame_bssid(const FilterInput& in, uint8_t type, uint8_t flags) {
+    if (in.len < 24) return nullptr;
+    if (type == IEEE80211_TYPE_MGMT) return in.payload + 16;
+    if (type != IEEE80211_TYPE_DATA) return nullptr;
+    switch (flags & (IEEE80211_FC_TO_DS | IEEE80211_FC_FROM_DS)) {
+        case 0: return in.payload + 16;
+        case IEEE80211_FC_TO_DS: return in.payload + 4;
+        case IEEE80211_FC_FROM_DS: return in.payload + 10;
+        default: return nullptr;
+    }
+}
+
+} // namespace
+
+PacketFilter::PacketFilter() {
+    clear();
+}
+
+void PacketFilter::clear() {
+    count = 0;
+    compute_masks();
+}
+
+bool PacketFilter::compile(const char* expression, char* error, size_t error_len) {
+    Lexer lex = { expression ? expression : "", {0} };
+    size_t n = 0;
+    bool expect_term = true;
+    uint8_t pending_flags = 0;
+
+#define COMPILE_FAIL(...) do { \
+        if (error && error_len) snprintf(error, error_len, __VA_ARGS__); \
+        clear(); \
+        return false; \
+    } while (0)
+
+    while (lex.next()) {
+        if (!expect_term) {
+            if (strcmp(lex.token, "and") == 0) {
+                expect_term = true;
+                continue;
+            }
+            if (strcmp(lex.token, "or") == 0) {
+                terms[n - 1].flags |= TERM_CLAUSE_END;
+                expect_term = true;
+                continue;
+            }
+            COMPILE_FAIL("expected 'and' or 'or' before '%s'", lex.token);
+        }
+
+        if (strcmp(lex.token, "not") == 0) {
+            pending_flags ^= TERM_NEGATE;
+            continue;
+        }
+        if (n >= PACKET_FILTER_MAX_TERMS) {
+            COMPILE_FAIL("too many terms (max %d)", PACKET_FILTER_MAX_TERMS);
+        }
+
+        Term& term = terms[n];
+        memset(&term, 0, sizeof(term));
+        term.flags = pending_flags;
+        term.op = OP_EQ;
+
+        // A comparison may be glued to the keyword ("rssi>=-70")
+        char keyword[MAX_TOKEN_LEN];
+        strcpy(keyword, lex.token);
+        char* glued = strpbrk(keyword, "<>=!");
+        if (glued && glued != keyword) {
+            memmove(lex.token, lex.token + (glued - keyword), strlen(glued) + 1);
+            *glued = '\0';
+        } else if (!lex.next()) {
+            COMPILE_FAIL("missing value after '%s'", keyword);
+        }
+
+        if (strcmp(keyword, "type") == 0) {
+            term.field = FIELD_TYPE;
+            if (strcmp(lex.token, "mgmt") == 0) term.a = IEEE80211_TYPE_MGMT;
+            else if (strcmp(lex.token, "ctrl") == 0) term.a = IEEE80211_TYPE_CTRL;
+            else if (strcmp(lex.token, "data") == 0) term.a = IEEE80211_TYPE_DATA;
+            else COMPILE_FAIL("unknown frame type '%s'", lex.token);
+        } else if (strcmp(keyword, "subtype") == 0) {
+            uint8_t type, subtype;
+            if (!lookup_subtype(lex.token, &type, &subtype)) {
+                COMPILE_FAIL("unknown subtype '%s'", lex.token);
+            }
+            term.field = FIELD_SUBTYPE;
+            term.a = type;
+            term.b = subtype;
+        } else if (strcmp(keyword, "bssid") == 0 || strcmp(keyword, "src") == 0 ||
+                   strcmp(keyword, "dst") == 0 || strcmp(keyword, "addr") == 0) {
+            term.field = keyword[0] == 'b' ? FIELD_BSSID :
+                         keyword[0] == 's' ? FIELD_SRC :
+                         keyword[0] == 'd' ? FIELD_DST : FIELD_ADDR;
+            if (!parse_mac(lex.token, term.mac)) {
+                COMPILE_FAIL("bad MAC address '%s'", lex.token);
+            }
+        } else if (strcmp(keyword, "rssi") == 0 || strcmp(keyword, "len") == 0 ||
+                   strcmp(keyword, "channel") == 0) {
+            term.field = keyword[0] == 'r' ? FIELD_RSSI :
+                         keyword[0] == 'l' ? FIELD_LEN : FIELD_CHANNEL;
+
+            // Operator may be its own token or glued to the number
+            const char* value = parse_op(lex.token, &term.op);
+            if (*value == '\0') {
+                if (!lex.next()) COMPILE_FAIL("missing number after '%s'", keyword);
+                value = lex.token;
+            }
+
+            const char* dash = term.field == FIELD_LEN ? strchr(value + 1, '-') : nullptr;
+            if (dash && term.op == OP_EQ) {
+                char lo[MAX_TOKEN_LEN];
+                size_t lo_len = (size_t)(dash - value);
+                memcpy(lo, value, lo_len);
+                lo[lo_len] = '\0';
+                if (!parse_int(lo, &term.a) || !parse_int(dash + 1, &term.b) || term.a > term.b) {
+                    COMPILE_FAIL("bad range '%s'", value);
+                }
+                term.op = OP_RANGE;
+            } else if (!parse_int(value, &term.a)) {
+                COMPILE_FAIL("bad number '%s'", value);
+            }
+        } else {
+            COMPILE_FAIL("unknown keyword '%s'", keyword);
+        }
+
+        pending_flags = 0;
+        n++;
+        count = n;
+        expect_term = false;
+    }
+
+    if (expect_term && (n > 0 || pending_flags)) {
+        COMPILE_FAIL("expression ends with an operator");
+    }
+#undef COMPILE_FAIL
+
+    count = n;
+    if (n > 0) {
+        terms[n - 1].flags |= TERM_CLAUSE_END;
+    }
+    compute_masks();
+    return true;
+}
+
+void PacketFilter::compute_masks() {
+    if (count == 0) {
+        accepted_types = DEFAULT_TYPE_MASK;
+        accepted_ctrl_subtypes = 0;
+        return;
+    }
+
+    accepted_types = 0;
+    accepted_ctrl_subtypes = 0;
+
+    uint32_t clause_types = ALL_TYPE_MASK;
+    uint16_t clause_ctrl = 0xffff;
+    bool typed = false;
+    for (size_t i = 0; i < count; i++) {
+        const Term& term = terms[i];
+        bool negate = term.flags & TERM_NEGATE;
+        if (term.field == FIELD_TYPE) {
+            // Excluding a type asks for the others, control frames included
+            clause_types &= negate ? ~(1u << term.a) : 1u << term.a;
+            typed = true;
+        } else if (term.field == FIELD_SUBTYPE && !negate) {
+            clause_types &= 1u << term.a;
+            if (term.a == IEEE80211_TYPE_CTRL) {
+                clause_ctrl &= (uint16_t)(1u << term.b);
+            }
+            typed = true;
+        }
+
+        if (term.flags & TERM_CLAUSE_END) {
+            // Control frames are only captured when a clause asks for them
+            if (!typed) clause_types &= DEFAULT_TYPE_MASK;
+            accepted_types |= clause_types;
+            if (clause_types & (1u << IEEE80211_TYPE_CTRL)) {
+                accepted_ctrl_subtypes |= clause_ctrl;
+            }
+            clause_types = ALL_TYPE_MASK;
+            clause_ctrl = 0xffff;
+            typed = false;
+        }
+    }
+}
+
+bool PacketFilter::eval_term(const Term& term, const FilterInput& in) const {
+    uint8_t type = (in.payload[0] >> 2) & 0x03;
+    uint8_t flags = in.payload[1];
+
+    switch (term.field) {
+        case FIELD_TYPE:
+            return type == term.a;
+        case FIELD_SUBTYPE:
+            return type == term.a && ((in.payload[0] >> 4) & 0x0f) == term.b;
+        case FIELD_BSSID: {
+            const uint8_t* bssid = frame_bssid(in, type, flags);
+            return bssid && memcmp(bssid, term.mac, 6) == 0;
+        }
+        case FIELD_SRC:
+            return in.len >= 16 && memcmp(in.payload + 10, term.mac, 6) == 0;
+        case FIELD_DST:
+            return in.len >= 10 && memcmp(in.payload + 4, term.mac, 6) == 0;
+        case FIELD_ADDR:
+            return (in.len >= 10 && memcmp(in.payload + 4, term.mac, 6) == 0) ||
+                   (in.len >= 16 && memcmp(in.payload + 10, term.mac, 6) == 0) ||
+                   (in.len >= 22 && type != IEEE80211_TYPE_CTRL && memcmp(in.payload + 16, term.mac, 6) == 0);
+        case FIELD_RSSI:
+            return compare(in.rssi, term.op, term.a, term.b);
+        case FIELD_LEN:
+            return compare(in.frame_len, term.op, term.a, term.b);
+        case FIELD_CHANNEL:
+            return compare(in.channel, term.op, term.a, term.b);
+        default:
+            return false;
+    }
+}
+
+bool PacketFilter::matches(const FilterInput& input) const {
+    if (input.len < 2) {
+        return false;
+    }
+    if (!(accepted_types & (1u << ((input.payload[0] >> 2) & 0x03)))) {
+        return false;
+    }
+    if (count == 0) {
+        return true;
+    }
+
+    bool clause_ok = true;
+    for (size_t i = 0; i < count; i++) {
+        const Term& term = terms[i];
+        // Short-circuit the rest of a clause once a term has failed
+        if (clause_ok) {
+            bool result = eval_term(term, input);
+            clause_ok = (term.flags & TERM_NEGATE) ? !result : result;
+        }
+        if (term.flags & TERM_CLAUSE_END) {
+            if (clause_ok) return true;
+            clause_ok = true;
+        }
+    }
+    return false;
+}
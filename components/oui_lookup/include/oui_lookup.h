@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Vendor id of an address with no registered OUI
+#define OUI_VENDOR_NONE         0xFFFF
+
+// What the first octet of an address says about it
+enum MacKind {
+    MAC_UNIVERSAL,      // Globally unique, assigned from an IEEE OUI
+    MAC_LOCAL,          // Locally administered: randomized (privacy) or set by software
+    MAC_GROUP,          // Multicast or broadcast; never a transmitter
+};
+
+MacKind mac_kind(const uint8_t* mac);
+
+// OUI (MA-L) registry table, generated from the IEEE registry file by
+// oui_gen.py at build time. All arrays are const and stay in flash.
+//
+// Keys are 24-bit OUIs in Eytzinger (BFS) order: the sorted keys laid out
+// as an implicit binary search tree, keys[1] the root and keys[2k],
+// keys[2k + 1] the children of keys[k]. A search walks down one level per
+// step without a branch on the comparison, and the first levels share a
+// few cache lines, so they stay cached between lookups.
+struct OuiTable {
+    const uint32_t* keys;           // count + 1 entries, keys[0] unused
+    const uint16_t* vendors;        // Vendor id of keys[i]
+    uint32_t count;
+    const uint32_t* name_offsets;   // Offset of each vendor's name in `names`
+    const char* names;              // NUL-terminated names, shortened and deduplicated
+    uint32_t names_size;
+    uint16_t vendor_count;
+};
+
+// The table compiled into the firmware
+extern const OuiTable oui_registry;
+
+// Vendor id of a 24-bit OUI, or OUI_VENDOR_NONE
+uint16_t oui_find(const OuiTable& table, uint32_t oui);
+
+// Vendor id of a universal address in the built-in registry;
+// OUI_VENDOR_NONE for unregistered, locally administered and group addresses
+uint16_t oui_lookup(const uint8_t* mac);
+
+// Name of a vendor id from the built-in registry, nullptr for OUI_VENDOR_NONE.
+// The string is static.
+const char* oui_vendor_name(uint16_t vendor);
+
+// Label for an address: the vendor name, "Randomized" for locally
+// administered addresses, "Unknown" otherwise. The string is static.
+const char* oui_label(const uint8_t* mac);
+
+// Flash bytes used by a table's arrays
+size_t oui_table_bytes(const OuiTable& table);
@@ -0,0 +1,130 @@
+#!/usr/bin/env python3
+"""Generate the OUI registry table (oui_registry.cpp) from the IEEE MA-L registry.
+
+Reads the CSV published at https://standards-oui.ieee.org/oui/oui.csv
+(Registry,Assignment,Organization Name,Organization Address) and writes a
+C++ source defining `oui_registry`: the OUIs in Eytzinger order, a vendor
+id per OUI and a pool of shortened, deduplicated vendor names.
+
+    oui_gen.py oui.csv oui_registry.cpp [--max-name 24]
+"""
+
+import argparse
+import csv
+import re
+import sys
+
+# Legal-form suffixes dropped from vendor names, so that "Apple, Inc." and
+# "Apple Inc" share one entry
+SUFFIXES = re.compile(
+    r"[\s,.]+(inc|incorporated|corp|corporation|co|company|ltd|limited|llc|gmbh|ag|bv|b\.v|s\.a|sa|"
+    r"plc|pte|pty|kg|oy|ab|as|srl|spa|technologies|technology)\.?$",
+    re.IGNORECASE)
+
+
+def short_name(name, max_len):
+    name = " ".join(name.split())
+    while True:
+        trimmed = SUFFIXES.sub("", name).rstrip(" ,.")
+        if trimmed == name or not trimmed:
+            break
+        name = trimmed
+    return name[:max_len].rstrip()
+
+
+def read_registry(path, max_len):
+    entries = {}
+    with open(path, newline="", encoding="utf-8", errors="replace") as f:
+        for row in csv.reader(f):
+            # MA-M and MA-S blocks share an OUI between vendors; only MA-L is tabled
+            if len(row) < 3 or row[0] != "MA-L":
+                continue
+            try:
+                oui = int(row[1], 16)
+            except ValueError:
+                continue
+            if oui > 0xFFFFFF:
+                continue
+            entries[oui] = short_name(row[2], max_len) or "?"
+    return entries
+
+
+def eytzinger(sorted_keys):
+    """Sorted keys laid out as an implicit BFS tree, 1-based"""
+    out = [0] * (len(sorted_keys) + 1)
+    source = iter(sorted_keys)
+
+    def fill(k):
+        if k < len(out):
+            fill(2 * k)
+            out[k] = next(source)
+            fill(2 * k + 1)
+
+    fill(1)
+    return out
+
+
+def c_string(text):
+    escaped = []
+    for ch in text.encode("utf-8"):
+        if ch in (0x22, 0x5C):
+            escaped.append("\\" + chr(ch))
+        elif 0x20 <= ch < 0x7F and ch != 0x3F:
+            escaped.append(chr(ch))
+        else:
+            # Octal escapes cannot swallow a following digit the way hex ones do
+            escaped.append("\\%03o" % ch)
+    return '"' + "".join(escaped) + '\\0"'
+
+
+def write_table(out, entries, source):
+    vendors = sorted(set(entries.values()))
+    if len(vendors) >= 0xFFFF:
+        sys.exit("too many vendors for 16-bit ids: %d" % len(vendors))
+    vendor_id = {name: i for i, name in enumerate(vendors)}
+    keys = eytzinger(sorted(entries))
+
+    offsets = []
+    size = 0
+    for name in vendors:
+        offsets.append(size)
+        size += len(name.encode("utf-8")) + 1
+
+    def rows(values, fmt, per_line):
+        for i in range(0, len(values), per_line):
+            out.write("    " + ", ".join(fmt % v for v in values[i:i + per_line]) + ",\n")
+
+    out.write("// Generated by oui_gen.py from %s; do not edit.\n" % source)
+    out.write("// %d OUIs, %d vendors\n\n" % (len(entries), len(vendors)))
+    out.write('#include "oui_lookup.h"\n\n')
+    out.write("static const uint32_t keys[] = {\n")
+    rows(keys, "0x%06X", 8)
+    out.write("};\n\nstatic const uint16_t vendors[] = {\n")
+    rows([0] + [vendor_id[entries[k]] for k in keys[1:]], "%d", 12)
+    out.write("};\n\nstatic const uint32_t name_offsets[] = {\n")
+    rows(offsets or [0], "%d", 12)
+    out.write("};\n\nstatic const char names[] =\n")
+    for name in vendors:
+        out.write("    %s\n" % c_string(name))
+    if not vendors:
+        out.write('    ""\n')
+    out.write(";\n\n")
+    out.write("const OuiTable oui_registry = {\n")
+    out.write("    keys, vendors, %d, name_offsets, names, %d, %d,\n" % (len(entries), size, len(vendors)))
+    out.write("};\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("registry", help="IEEE MA-L registry, CSV")
+    parser.add_argument("output", help="C++ source to write")
+    parser.add_argument("--max-name", type=int, default=24, help="longest vendor name kept")
+    args = parser.parse_args()
+
+    entries = read_registry(args.registry, args.max_name)
+    with open(args.output, "w", newline="\n") as out:
+        write_table(out, entries, args.registry.replace("\\", "/").split("/")[-1])
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,54 @@
+#include "oui_lookup.h"
+
+// First-octet bits of an address
+#define MAC_GROUP_BIT       0x01
+#define MAC_LOCAL_BIT       0x02
+
+MacKind mac_kind(const uint8_t* mac) {
+    if (mac[0] & MAC_GROUP_BIT) {
+        return MAC_GROUP;
+    }
+    return (mac[0] & MAC_LOCAL_BIT) ? MAC_LOCAL : MAC_UNIVERSAL;
+}
+
+uint16_t oui_find(const OuiTable& table, uint32_t oui) {
+    const uint32_t* keys = table.keys;
+    uint32_t k = 1;
+    while (k <= table.count) {
+        // The node four levels down shares a 64-byte line with its 15 siblings;
+        // a no-op where the target has no prefetch
+        __builtin_prefetch(keys + 16 * k);
+        k = 2 * k + (keys[k] < oui);
+    }
+    // Undo the right turns taken after the last left one: k is then the
+    // smallest key >= oui, or 0 if there is none
+    k >>= __builtin_ffs(~k);
+    return (k && keys[k] == oui) ? table.vendors[k] : OUI_VENDOR_NONE;
+}
+
+uint16_t oui_lookup(const uint8_t* mac) {
+    if (mac_kind(mac) != MAC_UNIVERSAL) {
+        return OUI_VENDOR_NONE;
+    }
+    return oui_find(oui_registry, (uint32_t)mac[0] << 16 | (uint32_t)mac[1] << 8 | mac[2]);
+}
+
+const char* oui_vendor_name(uint16_t vendor) {
+    if (vendor >= oui_registry.vendor_count) {
+        return nullptr;
+    }
+    return oui_registry.names + oui_registry.name_offsets[vendor];
+}
+
+const char* oui_label(const uint8_t* mac) {
+    const char* name = oui_vendor_name(oui_lookup(mac));
+    if (name) {
+        return name;
+    }
+    return mac_kind(mac) == MAC_LOCAL ? "Randomized" : "Unknown";
+}
+
+size_t oui_table_bytes(const OuiTable& table) {
+    return (table.count + 1) * (sizeof(uint32_t) + sizeof(uint16_t)) +
+           table.vendor_count * sizeof(uint32_t) + table.names_size;
+}
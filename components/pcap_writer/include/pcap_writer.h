@@ -0,0 +1,127 @@
+#pragma once
+
+#include <stdio.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "network_sniffer.h"
+#include "pcapng.h"
+
+struct PcapWriterConfig {
+    const char* path_prefix;    // Files are <prefix>_<NNNN>.<extension>, e.g. "/sdcard/cap"
+    const char* extension;      // "pcapng"; use a 3-letter one on FAT without long file names.
+                                // nullptr: one stream to `path_prefix` itself (e.g. "/dev/uart/1"), never reopened
+                                // while it works; max_file_seconds then repeats the section header instead
+    size_t buffer_size;         // Bytes per buffer; two are allocated
+    uint32_t max_file_bytes;    // Start a new file after this many bytes, 0 = no limit
+    uint32_t max_file_seconds;  // Start a new file after this long, 0 = no limit
+    uint32_t flush_ms;          // Longest time a frame waits in a partly filled buffer
+};
+
+// Default config: "/sdcard/cap", 16 KB buffers, 16 MB files, flush every second
+PcapWriterConfig pcap_writer_default_config();
+
+struct PcapWriterStats {
+    uint32_t frames;            // Frames accepted into a buffer
+    uint32_t dropped;           // Frames dropped because both buffers were full
+    uint32_t writes;            // Buffer writes issued to the file system
+    uint32_t write_errors;      // Writes that failed or were short
+    uint32_t files;             // Files opened
+    uint64_t bytes;             // Bytes written
+};
+
+// Fill in the Enhanced Packet Block fields of `frame`: reference time,
+// channel, RSSI, noise, rate or MCS. `record->data` points into the frame.
+void pcap_writer_fill_frame(const FrameView& frame, PcapngFrame* record);
+
+// Streaming PCAPNG capture writer.
+//
+// Frames are appended as Enhanced Packet Blocks to one of two large
+// DMA-capable buffers. When the active buffer fills (or flush_ms passes)
+// it is handed to a writer task, which writes it in one call while the
+// other buffer keeps filling; the capture path never touches the file
+// system. If the writer falls a whole buffer behind, new frames are
+// dropped and counted. Files are rotated by size or age at buffer
+// boundaries, and each file starts with its own section header so every
+// file opens in Wireshark on its own. Without an extension the writer
+// streams to a device instead, for a host collector to merge the streams
+// of several sniffers.
+//
+// Subscribe it with `sniffer.add_frame_sink(&writer)`. The file system
+// (SD card, SPIFFS, LittleFS) must be mounted by the application.
+class PcapWriter {
+public:
+    PcapWriter();
+    ~PcapWriter();
+
+    PcapWriter(const PcapWriter&) = delete;
+    PcapWriter& operator=(const PcapWriter&) = delete;
+
+    // Allocate the buffers, open the first file and start the writer task
+    esp_err_t start(const PcapWriterConfig& config = pcap_writer_default_config());
+
+    // Write out everything buffered, close the file and stop the task
+    esp_err_t stop();
+
+    // Frame sink entry point, called from the sniffer's processing task
+    void on_frame(const FrameView& frame);
+
+    // Same, but false without counting a drop if both buffers are full, so
+    // that a caller that can wait (e.g. a FlightRecorder exporter) retries
+    bool write_frame(const FrameView& frame);
+
+    bool is_running() const { return running; }
+    PcapWriterStats get_stats() const;
+
+private:
+    static void writer_task(void* arg);
+
+    // Close the current file and open the next one with a fresh header
+    bool open_next_file();
+
+    // Write a section and interface header to the current file; closes it on failure
+    bool write_header();
+
+    // Write one buffer to the current file, rotating (or, for a stream, repeating the header) first if due
+    void write_buffer(const uint8_t* data, size_t len);
+
+    // Hand the active buffer to the writer; lock must be held. False if the
+    // writer still owns the other buffer.
+    bool swap_buffers();
+
+    PcapWriterConfig cfg;
+    FILE* file;
+    uint32_t file_index;
+    uint32_t file_bytes;
+    int64_t file_opened_us;
+
+    // Double buffer, guarded by lock: the sink fills `active`, the writer
+    // task drains the other one while `pending_len` is non-zero. Sinks
+    // reserve space under the lock and build their block after releasing
+    // it; `writers` counts blocks still being built in each buffer, and the
+    // writer task waits for a handed-over buffer's count to reach zero.
+    uint8_t* buffers[2];
+    uint8_t active;
+    size_t fill;
+    size_t pending_len;
+    uint8_t writers[2];
+    int64_t last_swap_us;
+    mutable portMUX_TYPE lock;
+
+    PcapWriterStats stats;
+    volatile bool running;
+    volatile bool stop_requested;
+    TaskHandle_t task_handle;
+    SemaphoreHandle_t task_done;
+
+    // Log tag
+    static const char* TAG;
+
+    // Buffer alignment; keeps SD card DMA from needing a bounce buffer
+    static const size_t BUFFER_ALIGN = 32;
+
+    // Writer task parameters
+    static const uint32_t WRITER_TASK_STACK = 4096;
+    static const UBaseType_t WRITER_TASK_PRIORITY = 5;
+};
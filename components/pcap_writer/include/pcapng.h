@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// PCAPNG block builder for 802.11 captures with radiotap headers.
+//
+// A capture file is a Section Header Block and one Interface Description
+// Block (pcapng_write_header) followed by one Enhanced Packet Block per
+// frame (pcapng_write_frame). Blocks are self-contained, so a file can be
+// cut after any block and still open in Wireshark. Timestamps use the
+// default microsecond resolution.
+//
+// Every frame is prefixed with a radiotap header carrying:
+//
+//   TSFT            8 bytes  receive timestamp (us)
+//   Flags           1 byte   FCS-at-end when the frame includes its FCS
+//   Rate            1 byte   legacy rate in 500 kbps units (non-HT frames)
+//   Channel         4 bytes  frequency (MHz) and 2.4 GHz/CCK/OFDM flags
+//   Antenna signal  1 byte   RSSI (dBm)
+//   Antenna noise   1 byte   noise floor (dBm)
+//   MCS             3 bytes  MCS index, bandwidth and guard interval (HT frames)
+//
+// Nothing here depends on ESP-IDF; the builder can write straight into a
+// buffer that is then fwrite()n to a regular file on a Linux host.
+
+#define PCAPNG_LINKTYPE_IEEE802_11_RADIOTAP 127
+
+// Section Header Block plus Interface Description Block
+#define PCAPNG_HEADER_SIZE          48
+
+// Enhanced Packet Block overhead excluding the padded packet data
+#define PCAPNG_EPB_OVERHEAD         32
+
+// Radiotap header as built by pcapng_write_frame
+#define PCAPNG_RADIOTAP_SIZE        28
+
+struct PcapngFrame {
+    uint64_t timestamp_us;
+    const uint8_t* data;        // 802.11 frame as captured
+    uint32_t len;               // Captured bytes at `data`
+    uint32_t orig_len;          // Length on air
+    uint8_t channel;
+    int8_t rssi;
+    int8_t noise;
+    bool has_fcs;               // The on-air length includes the 4-byte FCS
+    bool is_ht;                 // HT frame: `mcs` is valid instead of `rate_500kbps`
+    uint8_t rate_500kbps;       // Legacy rate, 0 if unknown
+    uint8_t mcs;
+    bool ht40;
+    bool short_gi;
+};
+
+// Bytes pcapng_write_header() produces
+size_t pcapng_header_size();
+
+// Bytes pcapng_write_frame() needs for `frame`
+size_t pcapng_frame_size(const PcapngFrame& frame);
+
+// Write the section and interface headers. Returns the bytes written, or 0
+// if `capacity` is too small.
+size_t pcapng_write_header(uint8_t* out, size_t capacity, uint32_t snaplen);
+
+// Write one Enhanced Packet Block. Returns the bytes written, or 0 if
+// `capacity` is too small.
+size_t pcapng_write_frame(uint8_t* out, size_t capacity, const PcapngFrame& frame);
+
+// Centre frequency in MHz of a 2.4 GHz channel, 0 if out of range
+uint16_t pcapng_channel_frequency(uint8_t channel);
@@ -0,0 +1,367 @@
+#include "pcap_writer.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "pipeline_runtime.h"
+#include <string.h>
+
+const char* PcapWriter::TAG = "PCAP_WRITER";
+
+// Legacy rates (wifi_phy_rate_t 0x00-0x0F) in 500 kbps units
+static const uint8_t legacy_rate_500kbps[16] = {
+    2, 4, 11, 22, 0, 4, 11, 22, 96, 48, 24, 12, 108, 72, 36, 18,
+};
+
+PcapWriterConfig pcap_writer_default_config() {
+    PcapWriterConfig config;
+    config.path_prefix = "/sdcard/cap";
+    config.extension = "pcapng";
+    config.buffer_size = 16 * 1024;
+    config.max_file_bytes = 16 * 1024 * 1024;
+    config.max_file_seconds = 0;
+    config.flush_ms = 1000;
+    return config;
+}
+
+PcapWriter::PcapWriter()
+    : cfg(pcap_writer_default_config()), file(nullptr), file_index(0), file_bytes(0),
+      file_opened_us(0), active(0), fill(0), pending_len(0), last_swap_us(0),
+      lock(portMUX_INITIALIZER_UNLOCKED), stats(),
+      running(false), stop_requested(false), task_handle(nullptr), task_done(nullptr) {
+    buffers[0] = nullptr;
+    buffers[1] = nullptr;
+    writers[0] = 0;
+    writers[1] = 0;
+}
+
+PcapWriter::~PcapWriter() {
+    stop();
+    if (task_handle) {
+        pipeline_unregister_task(task_handle);
+        vTaskDelete(task_handle);
+    }
+    heap_caps_free(buffers[0]);
+    heap_caps_free(buffers[1]);
+    if (task_done) {
+        vSemaphoreDelete(task_done);
+    }
+}
+
+esp_err_t PcapWriter::start(const PcapWriterConfig& config) {
+    if (running) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    // A buffer must at least hold one full-size frame
+    PcapngFrame largest = {};
+    largest.len = SNIFFER_SNAPLEN;
+    if (!config.path_prefix || config.buffer_size < pcapng_frame_size(largest)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    cfg = config;
+
+    for (int i = 0; i < 2; i++) {
+        heap_caps_free(buffers[i]);
+        buffers[i] = (uint8_t*)heap_caps_aligned_alloc(BUFFER_ALIGN, cfg.buffer_size, MALLOC_CAP_DMA);
+        if (buffers[i] == nullptr) {
+            ESP_LOGE(TAG, "Failed to allocate %d byte capture buffer", (int)cfg.buffer_size);
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    if (task_done == nullptr) {
+        task_done = xSemaphoreCreateBinary();
+        if (task_done == nullptr) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    active = 0;
+    fill = 0;
+    pending_len = 0;
+    last_swap_us = esp_timer_get_time();
+    stats = PcapWriterStats();
+    file_index = 0;
+
+    if (!open_next_file()) {
+        return ESP_FAIL;
+    }
+
+    // The writer task outlives stop() so late notifications always reach a live task
+    if (task_handle == nullptr &&
+        pipeline_create_task(PIPELINE_STAGE_EXPORT, &PcapWriter::writer_task, "pcap_writer", WRITER_TASK_STACK,
+                             this, WRITER_TASK_PRIORITY, &task_handle) != ESP_OK) {
+        task_handle = nullptr;
+        fclose(file);
+        file = nullptr;
+        ESP_LOGE(TAG, "Failed to create writer task");
+        return ESP_ERR_NO_MEM;
+    }
+    running = true;
+
+    if (cfg.extension) {
+        ESP_LOGI(TAG, "Capturing to %s_*.%s (%d byte buffers)", cfg.path_prefix, cfg.extension, (int)cfg.buffer_size);
+    } else {
+        ESP_LOGI(TAG, "Streaming to %s (%d byte buffers)", cfg.path_prefix, (int)cfg.buffer_size);
+    }
+    return ESP_OK;
+}
+
+esp_err_t PcapWriter::stop() {
+    if (!running) {
+        return ESP_OK;
+    }
+
+    portENTER_CRITICAL(&lock);
+    running = false;
+    portEXIT_CRITICAL(&lock);
+
+    // The writer task drains both buffers and closes the file
+    stop_requested = true;
+    xTaskNotifyGive(task_handle);
+    xSemaphoreTake(task_done, portMAX_DELAY);
+
+    ESP_LOGI(TAG, "Capture stopped: %lu frames, %lu dropped, %lu files",
+             stats.frames, stats.dropped, stats.files);
+    return ESP_OK;
+}
+
+bool PcapWriter::open_next_file() {
+    if (file) {
+        fclose(file);
+        file = nullptr;
+    }
+
+    char path[128];
+    if (cfg.extension) {
+        snprintf(path, sizeof(path), "%s_%04lu.%s", cfg.path_prefix, (unsigned long)file_index, cfg.extension);
+    } else {
+        // A stream reopened after an error starts a new section, which readers handle
+        snprintf(path, sizeof(path), "%s", cfg.path_prefix);
+    }
+    file = fopen(path, "wb");
+    if (file == nullptr) {
+        ESP_LOGE(TAG, "Failed to open %s", path);
+        return false;
+    }
+    // Buffers are already large; skip the stdio copy
+    setvbuf(file, nullptr, _IONBF, 0);
+    file_index++;
+
+    if (!write_header()) {
+        ESP_LOGE(TAG, "Failed to write header to %s", path);
+        return false;
+    }
+
+    portENTER_CRITICAL(&lock);
+    stats.files++;
+    portEXIT_CRITICAL(&lock);
+
+    ESP_LOGI(TAG, "Writing %s", path);
+    return true;
+}
+
+bool PcapWriter::write_header() {
+    uint8_t header[PCAPNG_HEADER_SIZE];
+    size_t len = pcapng_write_header(header, sizeof(header), SNIFFER_SNAPLEN);
+    if (fwrite(header, 1, len, file) != len) {
+        fclose(file);
+        file = nullptr;
+        return false;
+    }
+    file_bytes = len;
+    file_opened_us = esp_timer_get_time();
+
+    portENTER_CRITICAL(&lock);
+    stats.bytes += len;
+    portEXIT_CRITICAL(&lock);
+    return true;
+}
+
+void PcapWriter::write_buffer(const uint8_t* data, size_t len) {
+    // Rotate only between buffers; buffers always end on a block boundary
+    bool too_big = cfg.max_file_bytes && file_bytes > PCAPNG_HEADER_SIZE && file_bytes + len > cfg.max_file_bytes;
+    bool too_old = cfg.max_file_seconds &&
+                   esp_timer_get_time() - file_opened_us >= (int64_t)cfg.max_file_seconds * 1000000;
+    if (file == nullptr || (cfg.extension && (too_big || too_old))) {
+        open_next_file();
+    } else if (!cfg.extension && too_old && !write_header()) {
+        // A stream stays open; the repeated header lets a reader that attached mid-stream sync up
+        ESP_LOGE(TAG, "Failed to write header to %s", cfg.path_prefix);
+    }
+
+    size_t written = file ? fwrite(data, 1, len, file) : 0;
+    file_bytes += written;
+
+    portENTER_CRITICAL(&lock);
+    stats.writes++;
+    stats.bytes += written;
+    if (written != len) {
+        stats.write_errors++;
+    }
+    portEXIT_CRITICAL(&lock);
+
+    if (written != len && file) {
+        // Likely a full or removed card; try a new file next time
+        ESP_LOGE(TAG, "Short write (%d of %d bytes)", (int)written, (int)len);
+        fclose(file);
+        file = nullptr;
+    }
+}
+
+bool PcapWriter::swap_buffers() {
+    if (pending_len != 0) {
+        return false;
+    }
+    pending_len = fill;
+    active ^= 1;
+    fill = 0;
+    last_swap_us = esp_timer_get_time();
+    return true;
+}
+
+void pcap_writer_fill_frame(const FrameView& frame, PcapngFrame* record) {
+    const wifi_pkt_rx_ctrl_t* rx_ctrl = frame.rx_ctrl;
+
+    // Reference time, so that captures of several sniffers sharing a reference merge
+    *record = PcapngFrame();
+    record->timestamp_us = (uint64_t)frame.reference_us;
+    record->data = frame.payload;
+    record->len = frame.len;
+    record->orig_len = frame.orig_len;
+    record->channel = rx_ctrl->channel;
+    record->rssi = rx_ctrl->rssi;
+    record->noise = rx_ctrl->noise_floor;
+    // The on-air length reported by the driver includes the FCS
+    record->has_fcs = true;
+    record->is_ht = rx_ctrl->sig_mode != 0;
+    if (record->is_ht) {
+        record->mcs = rx_ctrl->mcs;
+        record->ht40 = rx_ctrl->cwb;
+        record->short_gi = rx_ctrl->sgi;
+    } else {
+        record->rate_500kbps = legacy_rate_500kbps[rx_ctrl->rate & 0x0F];
+    }
+}
+
+void PcapWriter::on_frame(const FrameView& frame) {
+    if (running && !write_frame(frame)) {
+        portENTER_CRITICAL(&lock);
+        stats.dropped++;
+        portEXIT_CRITICAL(&lock);
+    }
+}
+
+bool PcapWriter::write_frame(const FrameView& frame) {
+    if (!running) {
+        return true;
+    }
+    PcapngFrame record;
+    pcap_writer_fill_frame(frame, &record);
+
+    size_t need = pcapng_frame_size(record);
+    bool notify = false;
+
+    // Only reserve the space with interrupts off; the block, up to a
+    // snaplen-sized copy, is built after the lock is released
+    portENTER_CRITICAL(&lock);
+    if (!running) {
+        portEXIT_CRITICAL(&lock);
+        return true;
+    }
+    if (fill + need > cfg.buffer_size) {
+        if (!swap_buffers()) {
+            // Writer is a whole buffer behind
+            portEXIT_CRITICAL(&lock);
+            return false;
+        }
+        notify = true;
+    }
+    uint8_t buffer = active;
+    uint8_t* out = buffers[buffer] + fill;
+    fill += need;
+    writers[buffer]++;
+    stats.frames++;
+    portEXIT_CRITICAL(&lock);
+
+    pcapng_write_frame(out, need, record);
+
+    portENTER_CRITICAL(&lock);
+    writers[buffer]--;
+    portEXIT_CRITICAL(&lock);
+
+    if (notify) {
+        xTaskNotifyGive(task_handle);
+    }
+    return true;
+}
+
+void PcapWriter::writer_task(void* arg) {
+    PcapWriter* writer = static_cast<PcapWriter*>(arg);
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(writer->cfg.flush_ms));
+        bool stopping = writer->stop_requested;
+        if (!writer->running && !stopping) {
+            continue;
+        }
+
+        // Hand over a partly filled buffer if it has waited long enough
+        portENTER_CRITICAL(&writer->lock);
+        if (writer->fill > 0 && (stopping ||
+            esp_timer_get_time() - writer->last_swap_us >= (int64_t)writer->cfg.flush_ms * 1000)) {
+            writer->swap_buffers();
+        }
+        portEXIT_CRITICAL(&writer->lock);
+
+        // Drain until the sink has nothing more for us; at most both buffers
+        for (int i = 0; i < 2; i++) {
+            size_t len;
+            const uint8_t* data;
+            while (true) {
+                portENTER_CRITICAL(&writer->lock);
+                len = writer->pending_len;
+                data = writer->buffers[writer->active ^ 1];
+                bool building = writer->writers[writer->active ^ 1] != 0;
+                portEXIT_CRITICAL(&writer->lock);
+                if (!building) {
+                    break;
+                }
+                // A sink is still copying its last frame in; let it finish
+                vTaskDelay(1);
+            }
+            if (len == 0) {
+                break;
+            }
+
+            writer->write_buffer(data, len);
+
+            portENTER_CRITICAL(&writer->lock);
+            writer->pending_len = 0;
+            if (stopping && writer->fill > 0) {
+                writer->swap_buffers();
+            }
+            portEXIT_CRITICAL(&writer->lock);
+        }
+
+        if (stopping) {
+            // Nothing may linger for the next start()
+            portENTER_CRITICAL(&writer->lock);
+            writer->fill = 0;
+            writer->pending_len = 0;
+            portEXIT_CRITICAL(&writer->lock);
+
+            if (writer->file) {
+                fclose(writer->file);
+                writer->file = nullptr;
+            }
+            writer->stop_requested = false;
+            xSemaphoreGive(writer->task_done);
+        }
+    }
+}
+
+PcapWriterStats PcapWriter::get_stats() const {
+    portENTER_CRITICAL(&lock);
+    PcapWriterStats copy = stats;
+    portEXIT_CRITICAL(&lock);
+    return copy;
+}
@@ -0,0 +1,158 @@
+#include "pcapng.h"
+#include <string.h>
+
+#define PCAPNG_BLOCK_SHB            0x0A0D0D0A
+#define PCAPNG_BLOCK_IDB            0x00000001
+#define PCAPNG_BLOCK_EPB            0x00000006
+#define PCAPNG_BYTE_ORDER_MAGIC     0x1A2B3C4D
+#define PCAPNG_SHB_SIZE             28
+#define PCAPNG_IDB_SIZE             20
+
+// Radiotap present bits and field values
+#define RADIOTAP_TSFT               (1u << 0)
+#define RADIOTAP_FLAGS              (1u << 1)
+#define RADIOTAP_RATE               (1u << 2)
+#define RADIOTAP_CHANNEL            (1u << 3)
+#define RADIOTAP_DBM_ANTSIGNAL      (1u << 5)
+#define RADIOTAP_DBM_ANTNOISE       (1u << 6)
+#define RADIOTAP_MCS                (1u << 19)
+#define RADIOTAP_F_FCS              0x10
+#define RADIOTAP_CHAN_CCK           0x0020
+#define RADIOTAP_CHAN_OFDM          0x0040
+#define RADIOTAP_CHAN_2GHZ          0x0080
+#define RADIOTAP_MCS_HAVE_BW        0x01
+#define RADIOTAP_MCS_HAVE_MCS       0x02
+#define RADIOTAP_MCS_HAVE_GI        0x04
+#define RADIOTAP_MCS_BW_40          0x01
+#define RADIOTAP_MCS_SGI            0x04
+
+static inline uint8_t* put16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    return p + 2;
+}
+
+static inline uint8_t* put32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+    return p + 4;
+}
+
+static inline uint8_t* put64(uint8_t* p, uint64_t v) {
+    p = put32(p, (uint32_t)v);
+    return put32(p, (uint32_t)(v >> 32));
+}
+
+static inline size_t pad4(size_t len) {
+    return (len + 3) & ~(size_t)3;
+}
+
+uint16_t pcapng_channel_frequency(uint8_t channel) {
+    if (channel >= 1 && channel <= 13) {
+        return 2407 + 5 * channel;
+    }
+    return channel == 14 ? 2484 : 0;
+}
+
+size_t pcapng_header_size() {
+    return PCAPNG_HEADER_SIZE;
+}
+
+size_t pcapng_frame_size(const PcapngFrame& frame) {
+    return PCAPNG_EPB_OVERHEAD + pad4(PCAPNG_RADIOTAP_SIZE + frame.len);
+}
+
+size_t pcapng_write_header(uint8_t* out, size_t capacity, uint32_t snaplen) {
+    if (capacity < PCAPNG_HEADER_SIZE) {
+        return 0;
+    }
+    uint8_t* p = out;
+
+    // Section Header Block, section length unknown
+    p = put32(p, PCAPNG_BLOCK_SHB);
+    p = put32(p, PCAPNG_SHB_SIZE);
+    p = put32(p, PCAPNG_BYTE_ORDER_MAGIC);
+    p = put16(p, 1);
+    p = put16(p, 0);
+    p = put64(p, UINT64_MAX);
+    p = put32(p, PCAPNG_SHB_SIZE);
+
+    // Interface Description Block
+    p = put32(p, PCAPNG_BLOCK_IDB);
+    p = put32(p, PCAPNG_IDB_SIZE);
+    p = put16(p, PCAPNG_LINKTYPE_IEEE802_11_RADIOTAP);
+    p = put16(p, 0);
+    p = put32(p, snaplen + PCAPNG_RADIOTAP_SIZE);
+    p = put32(p, PCAPNG_IDB_SIZE);
+
+    return (size_t)(p - out);
+}
+
+static uint8_t* put_radiotap(uint8_t* p, const PcapngFrame& frame) {
+    // Header: version, pad, length, present bitmap
+    *p++ = 0;
+    *p++ = 0;
+    p = put16(p, PCAPNG_RADIOTAP_SIZE);
+    p = put32(p, RADIOTAP_TSFT | RADIOTAP_FLAGS | RADIOTAP_RATE | RADIOTAP_CHANNEL |
+                 RADIOTAP_DBM_ANTSIGNAL | RADIOTAP_DBM_ANTNOISE | RADIOTAP_MCS);
+
+    // Fields in bit order, each naturally aligned within the header
+    p = put64(p, frame.timestamp_us);
+    *p++ = frame.has_fcs ? RADIOTAP_F_FCS : 0;
+    *p++ = frame.is_ht ? 0 : frame.rate_500kbps;
+
+    bool cck = !frame.is_ht && (frame.rate_500kbps == 2 || frame.rate_500kbps == 4 ||
+                                frame.rate_500kbps == 11 || frame.rate_500kbps == 22);
+    p = put16(p, pcapng_channel_frequency(frame.channel));
+    p = put16(p, RADIOTAP_CHAN_2GHZ | (cck ? RADIOTAP_CHAN_CCK : RADIOTAP_CHAN_OFDM));
+
+    *p++ = (uint8_t)frame.rssi;
+    *p++ = (uint8_t)frame.noise;
+
+    if (frame.is_ht) {
+        *p++ = RADIOTAP_MCS_HAVE_BW | RADIOTAP_MCS_HAVE_MCS | RADIOTAP_MCS_HAVE_GI;
+        *p++ = (frame.ht40 ? RADIOTAP_MCS_BW_40 : 0) | (frame.short_gi ? RADIOTAP_MCS_SGI : 0);
+        *p++ = frame.mcs;
+    } else {
+        // Field present but nothing known keeps the header a fixed size
+        *p++ = 0;
+        *p++ = 0;
+        *p++ = 0;
+    }
+
+    // Trailing pad up to the declared length
+    *p++ = 0;
+    return p;
+}
+
+size_t pcapng_write_frame(uint8_t* out, size_t capacity, const PcapngFrame& frame) {
+    size_t total = pcapng_frame_size(frame);
+    if (capacity < total) {
+        return 0;
+    }
+    uint32_t captured = PCAPNG_RADIOTAP_SIZE + frame.len;
+    uint32_t original = PCAPNG_RADIOTAP_SIZE + (frame.orig_len > frame.len ? frame.orig_len : frame.len);
+
+    uint8_t* p = out;
+    p = put32(p, PCAPNG_BLOCK_EPB);
+    p = put32(p, (uint32_t)total);
+    p = put32(p, 0);
+    p = put32(p, (uint32_t)(frame.timestamp_us >> 32));
+    p = put32(p, (uint32_t)frame.timestamp_us);
+    p = put32(p, captured);
+    p = put32(p, original);
+
+    p = put_radiotap(p, frame);
+    memcpy(p, frame.data, frame.len);
+    p += frame.len;
+
+    // Pad packet data to 32 bits
+    size_t padding = pad4(captured) - captured;
+    memset(p, 0, padding);
+    p += padding;
+
+    p = put32(p, (uint32_t)total);
+    return (size_t)(p - out);
+}
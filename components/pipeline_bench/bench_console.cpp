@@ -0,0 +1,82 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "esp_console.h"
+#include "esp_log.h"
+#include "argtable3/argtable3.h"
+#include "pipeline_bench.h"
+
+static const char* TAG = "PIPELINE_BENCH";
+
+static struct {
+    struct arg_int* loads;
+    struct arg_int* step_ms;
+    struct arg_int* frames;
+    struct arg_int* seed;
+    struct arg_str* filter;
+    struct arg_lit* all_steps;
+    struct arg_end* end;
+} bench_args;
+
+// JSON lines go to the console, one per step
+static void print_step(const BenchStepResult& result, void* ctx) {
+    pipeline_bench_print_json(result, stdout);
+    fflush(stdout);
+}
+
+static int bench_command(int argc, char** argv) {
+    if (arg_parse(argc, argv, (void**)&bench_args) != 0) {
+        arg_print_errors(stderr, bench_args.end, argv[0]);
+        return 1;
+    }
+
+    PipelineBenchConfig config = pipeline_bench_default_config();
+    if (bench_args.loads->count > 0) {
+        config.load_count = bench_args.loads->count;
+        for (int i = 0; i < bench_args.loads->count; i++) {
+            config.loads[i] = (uint32_t)bench_args.loads->ival[i];
+        }
+    }
+    if (bench_args.step_ms->count > 0) {
+        config.step_ms = (uint32_t)bench_args.step_ms->ival[0];
+    }
+    if (bench_args.filter->count > 0) {
+        config.filter = bench_args.filter->sval[0];
+    }
+    if (bench_args.all_steps->count > 0) {
+        config.stop_drop_rate = 0.0f;
+    }
+
+    size_t frames = bench_args.frames->count > 0 ? (size_t)bench_args.frames->ival[0] : BENCH_CORPUS_DEFAULT_FRAMES;
+    uint32_t seed = bench_args.seed->count > 0 ? (uint32_t)bench_args.seed->ival[0] : 1;
+
+    BenchCorpus corpus;
+    if (bench_corpus_generate(&corpus, frames, seed) == 0) {
+        ESP_LOGE(TAG, "Not enough memory for a %lu frame corpus", frames);
+        return 1;
+    }
+
+    esp_err_t ret = pipeline_bench_run(config, corpus, print_step, nullptr);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Benchmark failed: %s", esp_err_to_name(ret));
+        return 1;
+    }
+    return 0;
+}
+
+esp_err_t pipeline_bench_register_console() {
+    bench_args.loads = arg_intn(NULL, NULL, "<fps>", 0, PIPELINE_BENCH_MAX_STEPS,
+                                "Offered frames/s per step, 0 = unpaced");
+    bench_args.step_ms = arg_int0("t", "step-ms", "<ms>", "Duration of each step");
+    bench_args.frames = arg_int0("n", "frames", "<count>", "Synthetic corpus size");
+    bench_args.seed = arg_int0("s", "seed", "<seed>", "Synthetic corpus seed");
+    bench_args.filter = arg_str0("f", "filter", "<expr>", "Filter expression");
+    bench_args.all_steps = arg_lit0("a", "all", "Run every step even when drops are high");
+    bench_args.end = arg_end(4);
+
+    esp_console_cmd_t command = {};
+    command.command = "pipeline_bench";
+    command.help = "Drive the capture pipeline at increasing loads and print JSON results";
+    command.func = &bench_command;
+    command.argtable = &bench_args;
+    return esp_console_cmd_register(&command);
+}
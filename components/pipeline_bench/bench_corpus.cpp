@@ -0,0 +1,240 @@
+#include "bench_corpus.h"
+#include <new>
+#include <stdio.h>
+#include <string.h>
+
+// Synthetic population
+#define CORPUS_ACCESS_POINTS    8
+#define CORPUS_STATIONS         32
+#define CORPUS_ROLE_AP          0x01
+#define CORPUS_ROLE_STATION     0x02
+
+BenchCorpus::BenchCorpus()
+    : frames(nullptr), count(0), max_count(0), arena(nullptr), used(0), arena_size(0) {
+}
+
+BenchCorpus::~BenchCorpus() {
+    delete[] frames;
+    delete[] arena;
+}
+
+bool BenchCorpus::reserve(size_t max_frames, size_t arena_bytes) {
+    delete[] frames;
+    delete[] arena;
+    frames = new (std::nothrow) BenchFrame[max_frames];
+    arena = new (std::nothrow) uint8_t[arena_bytes];
+    count = 0;
+    used = 0;
+    if (frames == nullptr || arena == nullptr) {
+        delete[] frames;
+        delete[] arena;
+        frames = nullptr;
+        arena = nullptr;
+        max_count = 0;
+        arena_size = 0;
+        return false;
+    }
+    max_count = max_frames;
+    arena_size = arena_bytes;
+    return true;
+}
+
+bool BenchCorpus::add(const uint8_t* data, uint16_t orig_len, int8_t rssi, uint8_t channel) {
+    uint16_t len = orig_len > BENCH_CORPUS_MAX_FRAME ? BENCH_CORPUS_MAX_FRAME : orig_len;
+    if (count == max_count || arena_size - used < len) {
+        return false;
+    }
+    memcpy(arena + used, data, len);
+
+    BenchFrame& frame = frames[count++];
+    frame.data = arena + used;
+    frame.len = len;
+    frame.orig_len = orig_len;
+    frame.rssi = rssi;
+    frame.channel = channel;
+    used += len;
+    return true;
+}
+
+void BenchCorpus::clear() {
+    count = 0;
+    used = 0;
+}
+
+// Generator state: an xorshift32 PRNG and the running sequence number
+struct CorpusGenerator {
+    uint32_t state;
+    uint16_t sequence;
+
+    uint32_t random() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    uint32_t random_range(uint32_t low, uint32_t high) {
+        return low + random() % (high - low + 1);
+    }
+};
+
+static const uint8_t broadcast[6] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+static const uint8_t supported_rates[] = { 0x01, 0x08, 0x82, 0x84, 0x8B, 0x96, 0x0C, 0x12, 0x18, 0x24 };
+static const uint8_t ap_channels[] = { 1, 6, 11 };
+
+static void put_mac(uint8_t* out, uint8_t role, uint16_t index) {
+    out[0] = 0x02;
+    out[1] = 0x00;
+    out[2] = 0x00;
+    out[3] = role;
+    out[4] = (uint8_t)(index >> 8);
+    out[5] = (uint8_t)index;
+}
+
+// Frame control, duration and sequence control around three addresses
+static size_t put_header(uint8_t* out, uint8_t fc0, uint8_t fc1, const uint8_t* a1, const uint8_t* a2,
+                         const uint8_t* a3, uint16_t sequence) {
+    out[0] = fc0;
+    out[1] = fc1;
+    out[2] = 0x3A;
+    out[3] = 0x01;
+    memcpy(out + 4, a1, 6);
+    memcpy(out + 10, a2, 6);
+    memcpy(out + 16, a3, 6);
+    out[22] = (uint8_t)(sequence << 4);
+    out[23] = (uint8_t)(sequence >> 4);
+    return 24;
+}
+
+// Beacon (subtype 8, broadcast) or probe response (subtype 5) from an AP
+static size_t build_beacon(uint8_t* out, CorpusGenerator& gen, uint16_t ap, uint8_t subtype, uint16_t station) {
+    uint8_t bssid[6];
+    uint8_t da[6];
+    put_mac(bssid, CORPUS_ROLE_AP, ap);
+    if (subtype == 8) {
+        memcpy(da, broadcast, 6);
+    } else {
+        put_mac(da, CORPUS_ROLE_STATION, station);
+    }
+    size_t len = put_header(out, (uint8_t)(subtype << 4), 0, da, bssid, bssid, gen.sequence);
+
+    // TSF, beacon interval (100 TU), capabilities (ESS, privacy, short preamble/slot)
+    memset(out + len, 0, 8);
+    len += 8;
+    out[len++] = 0x64;
+    out[len++] = 0x00;
+    out[len++] = 0x31;
+    out[len++] = 0x04;
+
+    int ssid_len = snprintf((char*)out + len + 2, 33, "bench-ap-%u", ap);
+    out[len] = 0;
+    out[len + 1] = (uint8_t)ssid_len;
+    len += 2 + ssid_len;
+
+    memcpy(out + len, supported_rates, sizeof(supported_rates));
+    len += sizeof(supported_rates);
+
+    out[len++] = 3;
+    out[len++] = 1;
+    out[len++] = ap_channels[ap % sizeof(ap_channels)];
+    return len;
+}
+
+static size_t build_probe_request(uint8_t* out, CorpusGenerator& gen, uint16_t station) {
+    uint8_t sa[6];
+    put_mac(sa, CORPUS_ROLE_STATION, station);
+    size_t len = put_header(out, 0x40, 0, broadcast, sa, broadcast, gen.sequence);
+
+    // Wildcard SSID
+    out[len++] = 0;
+    out[len++] = 0;
+    memcpy(out + len, supported_rates, sizeof(supported_rates));
+    return len + sizeof(supported_rates);
+}
+
+// RTS from a station to its AP, or CTS/ACK back to the station
+static size_t build_control(uint8_t* out, CorpusGenerator& gen, uint16_t station, uint16_t ap) {
+    uint8_t sta_mac[6];
+    uint8_t ap_mac[6];
+    put_mac(sta_mac, CORPUS_ROLE_STATION, station);
+    put_mac(ap_mac, CORPUS_ROLE_AP, ap);
+
+    uint32_t pick = gen.random() % 4;
+    out[1] = 0;
+    out[2] = 0x2C;
+    out[3] = 0x00;
+    if (pick == 0) {
+        out[0] = 0xB4;
+        memcpy(out + 4, ap_mac, 6);
+        memcpy(out + 10, sta_mac, 6);
+        return 16;
+    }
+    out[0] = pick == 1 ? 0xC4 : 0xD4;
+    memcpy(out + 4, sta_mac, 6);
+    return 10;
+}
+
+// QoS data; uplink goes to the DS, downlink comes from it. Only the first
+// BENCH_CORPUS_MAX_FRAME bytes are written, the full length is returned.
+static size_t build_data(uint8_t* out, CorpusGenerator& gen, uint16_t station, uint16_t ap, bool uplink) {
+    uint8_t sta_mac[6];
+    uint8_t ap_mac[6];
+    put_mac(sta_mac, CORPUS_ROLE_STATION, station);
+    put_mac(ap_mac, CORPUS_ROLE_AP, ap);
+
+    uint8_t flags = uplink ? 0x01 : 0x02;
+    if (gen.random() % 100 < 5) {
+        flags |= 0x08;
+    }
+    size_t len = uplink ? put_header(out, 0x88, flags, ap_mac, sta_mac, ap_mac, gen.sequence)
+                        : put_header(out, 0x88, flags, sta_mac, ap_mac, ap_mac, gen.sequence);
+    out[len++] = (uint8_t)(gen.random() % 8);
+    out[len++] = 0;
+
+    // LLC/SNAP for IPv4 followed by filler
+    static const uint8_t snap[] = { 0xAA, 0xAA, 0x03, 0x00, 0x00, 0x00, 0x08, 0x00 };
+    uint32_t body = gen.random_range(32, 1500);
+    memcpy(out + len, snap, sizeof(snap));
+    for (uint32_t i = sizeof(snap); i < body && len + i < BENCH_CORPUS_MAX_FRAME; i++) {
+        out[len + i] = (uint8_t)(i * 131);
+    }
+    return len + body;
+}
+
+size_t bench_corpus_generate(BenchCorpus* corpus, size_t frames, uint32_t seed) {
+    // Worst case every frame is a full-size data frame
+    if (!corpus->reserve(frames, frames * BENCH_CORPUS_MAX_FRAME)) {
+        return 0;
+    }
+
+    CorpusGenerator gen;
+    gen.state = seed ? seed : 0x9E3779B9;
+    gen.sequence = 0;
+
+    // The FCS is never checked, so its four bytes stay zero
+    uint8_t buffer[BENCH_CORPUS_MAX_FRAME + 4];
+    for (size_t i = 0; i < frames; i++) {
+        uint16_t station = (uint16_t)(gen.random() % CORPUS_STATIONS);
+        uint16_t ap = station % CORPUS_ACCESS_POINTS;
+        int8_t rssi = (int8_t)((int)gen.random_range(0, 60) - 90);
+
+        memset(buffer, 0, sizeof(buffer));
+        uint32_t pick = gen.random() % 100;
+        size_t len;
+        if (pick < 10) {
+            len = build_beacon(buffer, gen, ap, 8, 0);
+        } else if (pick < 20) {
+            len = (pick & 1) ? build_probe_request(buffer, gen, station) : build_beacon(buffer, gen, ap, 5, station);
+        } else if (pick < 40) {
+            len = build_control(buffer, gen, station, ap);
+        } else {
+            len = build_data(buffer, gen, station, ap, (pick & 1) != 0);
+        }
+        gen.sequence = (gen.sequence + 1) & 0x0FFF;
+
+        if (!corpus->add(buffer, (uint16_t)(len + 4), rssi, ap_channels[ap % sizeof(ap_channels)])) {
+            break;
+        }
+    }
+    return corpus->size();
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Frames generated by bench_corpus_generate() by default
+#define BENCH_CORPUS_DEFAULT_FRAMES     128
+
+// Frame bytes a corpus stores at most; longer frames keep their original
+// length but are truncated, just as the capture path truncates them
+#define BENCH_CORPUS_MAX_FRAME          512
+
+// One frame as the radio would hand it over
+struct BenchFrame {
+    const uint8_t* data;    // 802.11 header onwards, FCS included unless truncated
+    uint16_t len;           // Bytes stored at data
+    uint16_t orig_len;      // On-air length including the FCS
+    int8_t rssi;
+    uint8_t channel;
+};
+
+// Frames replayed by the pipeline benchmark.
+//
+// Frames are packed into one arena allocated up front so that building the
+// corpus is never part of a measurement. Pure logic with no ESP-IDF
+// dependencies; the host build can fill it from a capture file.
+class BenchCorpus {
+public:
+    BenchCorpus();
+    ~BenchCorpus();
+
+    BenchCorpus(const BenchCorpus&) = delete;
+    BenchCorpus& operator=(const BenchCorpus&) = delete;
+
+    // Allocate room for `max_frames` frames and `arena_bytes` of frame data,
+    // dropping any frames already held. Returns false if out of memory.
+    bool reserve(size_t max_frames, size_t arena_bytes);
+
+    // Copy a frame in. `orig_len` is its on-air length including the FCS;
+    // `data` must hold min(orig_len, BENCH_CORPUS_MAX_FRAME) bytes. Returns
+    // false when the corpus is full.
+    bool add(const uint8_t* data, uint16_t orig_len, int8_t rssi, uint8_t channel);
+
+    void clear();
+
+    size_t size() const { return count; }
+    size_t bytes() const { return used; }
+    const BenchFrame& frame(size_t index) const { return frames[index]; }
+
+private:
+    BenchFrame* frames;
+    size_t count;
+    size_t max_count;
+    uint8_t* arena;
+    size_t used;
+    size_t arena_size;
+};
+
+// Fill `corpus` with `frames` frames of seeded synthetic traffic between 8
+// APs on channels 1/6/11 and 32 associated stations: 10% beacons, 10%
+// probes, 20% RTS/CTS/ACK and 60% QoS data, 5% of it retried, RSSI -90 to
+// -30 dBm. Reserves the corpus itself. Returns the number of frames added.
+size_t bench_corpus_generate(BenchCorpus* corpus, size_t frames, uint32_t seed);
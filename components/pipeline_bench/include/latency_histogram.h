@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Linear sub-buckets per power of two, as a power of two. Values below
+// 2^LATENCY_HISTOGRAM_SUB_BITS are counted exactly; above that every bucket
+// is at most 1/2^LATENCY_HISTOGRAM_SUB_BITS of its value wide (5 bits: 3%).
+#ifndef LATENCY_HISTOGRAM_SUB_BITS
+#define LATENCY_HISTOGRAM_SUB_BITS  5
+#endif
+
+// Buckets needed to cover the whole uint32_t range
+#define LATENCY_HISTOGRAM_BUCKETS \
+    ((33 - LATENCY_HISTOGRAM_SUB_BITS) << LATENCY_HISTOGRAM_SUB_BITS)
+
+// HDR-style log-linear histogram of 32-bit latencies.
+//
+// Recording is a count-leading-zeros, a shift and an increment, with no
+// allocation and no floating point, so it can sit inside the stage being
+// measured. Percentiles are reported as the upper bound of the bucket they
+// fall in, clamped to the largest value recorded. The unit is whatever the
+// caller records (CPU cycles, ns, us).
+//
+// Not thread-safe: each histogram has one writer, and readers must wait
+// until it is done. Pure logic with no ESP-IDF dependencies.
+class LatencyHistogram {
+public:
+    LatencyHistogram();
+
+    void record(uint32_t value) {
+        counts[bucket_index(value)]++;
+        total++;
+        sum += value;
+        if (value < lowest) {
+            lowest = value;
+        }
+        if (value > highest) {
+            highest = value;
+        }
+    }
+
+    // Add every value recorded in `other`
+    void merge(const LatencyHistogram& other);
+
+    void reset();
+
+    // Smallest value at or below which `percent` (0-100) of the values lie, 0 if empty
+    uint32_t percentile(double percent) const;
+
+    uint32_t count() const { return total; }
+    uint32_t min() const { return total ? lowest : 0; }
+    uint32_t max() const { return highest; }
+    uint32_t mean() const { return total ? (uint32_t)(sum / total) : 0; }
+
+    // Bucket a value falls in, and the largest value that bucket holds
+    static size_t bucket_index(uint32_t value) {
+        if (value < (1u << LATENCY_HISTOGRAM_SUB_BITS)) {
+            return value;
+        }
+        unsigned shift = 31 - __builtin_clz(value) - LATENCY_HISTOGRAM_SUB_BITS;
+        return ((size_t)shift << LATENCY_HISTOGRAM_SUB_BITS) + (value >> shift);
+    }
+    static uint32_t bucket_upper(size_t index);
+
+private:
+    uint32_t counts[LATENCY_HISTOGRAM_BUCKETS];
+    uint32_t total;
+    uint64_t sum;
+    uint32_t lowest;
+    uint32_t highest;
+};
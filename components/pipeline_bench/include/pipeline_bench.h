@@ -0,0 +1,88 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include "esp_err.h"
+#include "bench_corpus.h"
+
+// Pipeline stages timed by the benchmark
+enum BenchStage {
+    BENCH_STAGE_FILTER,         // PacketFilter::matches(), in the producer
+    BENCH_STAGE_CAPTURE,        // Ring claim, copy and publish, in the producer
+    BENCH_STAGE_PARSE,          // CaptureClock::capture() and ieee80211_parse()
+    BENCH_STAGE_RETAIN,         // FramePool copy into a window of held frames, releasing the oldest
+    BENCH_STAGE_AGGREGATE,      // FrameStats, ChannelScheduler and DeviceTracker updates
+    BENCH_STAGE_ENCODE,         // TelemetryEncoder append (and finish when a batch fills)
+    BENCH_STAGE_END_TO_END,     // Offered to the filter until encoded, queueing included
+    BENCH_STAGE_COUNT
+};
+
+// Name of a stage as used in the JSON output
+const char* pipeline_bench_stage_name(BenchStage stage);
+
+// Most load steps one run can have
+#define PIPELINE_BENCH_MAX_STEPS    16
+
+struct PipelineBenchConfig {
+    uint32_t loads[PIPELINE_BENCH_MAX_STEPS];   // Offered frames/s per step, in order; 0 = as fast as possible
+    size_t load_count;
+    uint32_t step_ms;                           // Duration of each step
+    const char* filter;                         // Filter expression (packet_filter.h); nullptr or "" keeps the
+                                                // default management + data capture
+    float stop_drop_rate;                       // Skip the remaining steps once one drops more than this fraction, 0 = never
+};
+
+// 1k to 100k frames/s and then unpaced, 2 s each, no filter, stop above 50% drops
+PipelineBenchConfig pipeline_bench_default_config();
+
+// Latency of one stage in ns
+struct BenchStageResult {
+    uint32_t count;
+    uint32_t min_ns;
+    uint32_t mean_ns;
+    uint32_t p50_ns;
+    uint32_t p99_ns;
+    uint32_t p999_ns;
+    uint32_t max_ns;
+};
+
+struct BenchStepResult {
+    uint32_t offered_fps;           // Configured load, 0 = unpaced
+    uint32_t elapsed_ms;            // From the first frame offered to the last one encoded
+    uint32_t offered;               // Frames offered to the filter
+    uint32_t filtered;              // Rejected by the filter
+    uint32_t dropped;               // Lost because the ring was full
+    uint32_t processed;             // Frames through every stage
+    float sustained_fps;            // processed / elapsed
+    float drop_rate;                // dropped / (offered - filtered)
+    uint32_t ring_high_water;
+    uint32_t ring_capacity;
+    uint32_t telemetry_batches;
+    uint32_t telemetry_bytes;
+    uint32_t heap_peak_bytes;       // Largest drop in free heap since the step started
+    uint32_t pool_allocs;           // Frames retained in the frame pool
+    uint32_t pool_spills;           // Retained in PSRAM or a larger class than the best fit
+    uint32_t pool_failures;         // Not retained because the pool was exhausted
+    uint32_t pool_peak_internal;    // Sum of the per-class peak block counts in internal RAM
+    uint32_t pool_peak_psram;       // Same for PSRAM
+    BenchStageResult stages[BENCH_STAGE_COUNT];
+};
+
+// Called with the results of each step as soon as it completes
+typedef void (*bench_step_cb_t)(const BenchStepResult& result, void* ctx);
+
+// Run every load step in `config` against `corpus`, blocking the calling
+// task. Each step allocates a fresh pipeline and runs a producer task,
+// standing in for the Wi-Fi driver, and a consumer task, standing in for
+// the processing task. Returns ESP_ERR_INVALID_ARG for an empty corpus, a
+// bad filter or bad step list, ESP_ERR_NO_MEM if a step cannot be set up,
+// ESP_ERR_TIMEOUT if a step does not finish.
+esp_err_t pipeline_bench_run(const PipelineBenchConfig& config, const BenchCorpus& corpus,
+                             bench_step_cb_t on_step, void* ctx);
+
+// Write one step as a single-line JSON object
+void pipeline_bench_print_json(const BenchStepResult& result, FILE* out);
+
+// Register the `pipeline_bench` console command. esp_console must already be
+// initialised. Target only.
+esp_err_t pipeline_bench_register_console();
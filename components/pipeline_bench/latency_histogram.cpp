@@ -0,0 +1,65 @@
+#include "latency_histogram.h"
+#include <math.h>
+#include <string.h>
+
+LatencyHistogram::LatencyHistogram() {
+    reset();
+}
+
+void LatencyHistogram::reset() {
+    memset(counts, 0, sizeof(counts));
+    total = 0;
+    sum = 0;
+    lowest = UINT32_MAX;
+    highest = 0;
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (size_t i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+        counts[i] += other.counts[i];
+    }
+    total += other.total;
+    sum += other.sum;
+    if (other.total && other.lowest < lowest) {
+        lowest = other.lowest;
+    }
+    if (other.highest > highest) {
+        highest = other.highest;
+    }
+}
+
+uint32_t LatencyHistogram::bucket_upper(size_t index) {
+    const size_t sub_count = (size_t)1 << LATENCY_HISTOGRAM_SUB_BITS;
+    if (index < sub_count) {
+        return (uint32_t)index;
+    }
+    // Inverse of bucket_index(): the bucket covers [sub << shift, (sub + 1) << shift)
+    unsigned shift = (unsigned)(index >> LATENCY_HISTOGRAM_SUB_BITS) - 1;
+    uint64_t sub = index - ((size_t)shift << LATENCY_HISTOGRAM_SUB_BITS);
+    return (uint32_t)(((sub + 1) << shift) - 1);
+}
+
+uint32_t LatencyHistogram::percentile(double percent) const {
+    if (total == 0) {
+        return 0;
+    }
+    if (percent >= 100.0) {
+        return highest;
+    }
+
+    // Rank of the value sought, 1-based
+    uint64_t rank = (uint64_t)ceil(percent / 100.0 * total);
+    if (rank == 0) {
+        rank = 1;
+    }
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+        seen += counts[i];
+        if (seen >= rank) {
+            uint32_t upper = bucket_upper(i);
+            return upper < highest ? upper : highest;
+        }
+    }
+    return highest;
+}
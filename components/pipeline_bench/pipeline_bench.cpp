@@ -0,0 +1,473 @@
+#include "pipeline_bench.h"
+#include <atomic>
+#include <new>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_cpu.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_rom_sys.h"
+#include "esp_timer.h"
+#include "frame_pool.h"
+#include "network_sniffer.h"
+#include "channel_scheduler.h"
+#include "device_tracker.h"
+#include "frame_stats.h"
+#include "latency_histogram.h"
+#include "pipeline_runtime.h"
+#include "telemetry_codec.h"
+
+static const char* TAG = "PIPELINE_BENCH";
+
+// Producer stands in for the Wi-Fi driver task: same priority, on the ingest core
+#define BENCH_PRODUCER_STACK        4096
+#define BENCH_PRODUCER_PRIORITY     23
+
+// Consumer stands in for the NetworkSniffer processing task, on the analysis core
+#define BENCH_CONSUMER_STACK        4096
+#define BENCH_CONSUMER_PRIORITY     10
+
+// A spinning producer gives up the CPU this often so the idle task can feed the task watchdog
+#define BENCH_PRODUCER_YIELD_US     500000
+
+// Heap sampling period while a step runs
+#define BENCH_HEAP_SAMPLE_MS        10
+
+// Frames the retain stage keeps held, as a sink buffering recent frames would.
+// More than the default pool's internal small and medium blocks, so that spilling is exercised.
+#define BENCH_RETAIN_WINDOW         48
+
+// Extra time a step may take to drain before it is abandoned
+#define BENCH_STEP_GRACE_MS         5000
+
+static const char* stage_names[BENCH_STAGE_COUNT] = {
+    "filter", "capture", "parse", "retain", "aggregate", "encode", "end_to_end"
+};
+
+const char* pipeline_bench_stage_name(BenchStage stage) {
+    return stage < BENCH_STAGE_COUNT ? stage_names[stage] : "unknown";
+}
+
+PipelineBenchConfig pipeline_bench_default_config() {
+    static const uint32_t default_loads[] = { 1000, 2000, 5000, 10000, 20000, 50000, 100000, 0 };
+
+    PipelineBenchConfig config = {};
+    memcpy(config.loads, default_loads, sizeof(default_loads));
+    config.load_count = sizeof(default_loads) / sizeof(default_loads[0]);
+    config.step_ms = 2000;
+    config.filter = nullptr;
+    config.stop_drop_rate = 0.5f;
+    return config;
+}
+
+// Ring slot: the captured frame plus the cycle count when it was offered
+struct BenchSlot {
+    uint32_t offered_cycles;
+    CapturedFrame frame;
+};
+
+// Everything one step needs, allocated when the step starts so that it
+// shows up in the heap figure
+struct BenchPipeline {
+    const BenchCorpus* corpus;
+    uint32_t offered_fps;
+    uint32_t step_us;
+
+    PacketFilter filter;
+    SpscRing<BenchSlot, SNIFFER_RING_SLOTS> ring;
+    CaptureClock clock;
+    ReferenceClock reference;
+    FrameStats stats;
+    ChannelScheduler scheduler;
+    DeviceTracker devices;
+    TelemetryEncoder encoder;
+
+    // Declared before the handles so that they are released first
+    FramePool pool;
+    FrameHandle held[BENCH_RETAIN_WINDOW];
+    size_t held_next;
+
+    // Filter and capture are written by the producer, the rest by the consumer
+    LatencyHistogram latency[BENCH_STAGE_COUNT];
+
+    TaskHandle_t consumer_task;
+    SemaphoreHandle_t done;
+    std::atomic<bool> producing;
+
+    // Producer counters
+    int64_t start_us;
+    uint32_t offered;
+    uint32_t filtered;
+
+    // Consumer counters
+    int64_t last_processed_us;
+    uint32_t processed;
+    uint32_t batches;
+    uint32_t telemetry_bytes;
+};
+
+static inline uint32_t cycles_since(uint32_t start) {
+    return (uint32_t)esp_cpu_get_cycle_count() - start;
+}
+
+// Offer one corpus frame: filter it, then copy it into the ring as the RX callback does
+static void offer_frame(BenchPipeline* bench, const BenchFrame& frame) {
+    uint32_t offered_at = (uint32_t)esp_cpu_get_cycle_count();
+    bench->offered++;
+
+    FilterInput input;
+    input.payload = frame.data;
+    input.len = frame.len;
+    input.frame_len = frame.orig_len;
+    input.rssi = frame.rssi;
+    input.channel = frame.channel;
+    bool keep = bench->filter.matches(input);
+    uint32_t filtered_at = (uint32_t)esp_cpu_get_cycle_count();
+    bench->latency[BENCH_STAGE_FILTER].record(filtered_at - offered_at);
+    if (!keep) {
+        bench->filtered++;
+        return;
+    }
+
+    BenchSlot* slot = bench->ring.claim();
+    if (slot == nullptr) {
+        return;
+    }
+    slot->offered_cycles = offered_at;
+    memset(&slot->frame.rx_ctrl, 0, sizeof(slot->frame.rx_ctrl));
+    slot->frame.rx_ctrl.rssi = frame.rssi;
+    slot->frame.rx_ctrl.channel = frame.channel;
+    slot->frame.rx_ctrl.sig_len = frame.orig_len;
+    slot->frame.rx_ctrl.timestamp = (uint32_t)esp_timer_get_time();
+    slot->frame.type = (wifi_promiscuous_pkt_type_t)((frame.data[0] >> 2) & 0x03);
+    slot->frame.orig_len = frame.orig_len;
+    slot->frame.len = frame.len > SNIFFER_SNAPLEN ? SNIFFER_SNAPLEN : frame.len;
+    memcpy(slot->frame.payload, frame.data, slot->frame.len);
+    bench->ring.publish();
+    bench->latency[BENCH_STAGE_CAPTURE].record(cycles_since(filtered_at));
+
+    xTaskNotifyGive(bench->consumer_task);
+}
+
+static void producer_task(void* arg) {
+    BenchPipeline* bench = static_cast<BenchPipeline*>(arg);
+    const BenchCorpus& corpus = *bench->corpus;
+    const int64_t tick_us = portTICK_PERIOD_MS * 1000;
+
+    bench->start_us = esp_timer_get_time();
+    const int64_t end_us = bench->start_us + bench->step_us;
+    int64_t yielded_us = bench->start_us;
+    uint64_t slot = 0;
+    size_t next = 0;
+
+    while (1) {
+        int64_t now = esp_timer_get_time();
+        if (now >= end_us) {
+            break;
+        }
+        if (now - yielded_us >= BENCH_PRODUCER_YIELD_US) {
+            vTaskDelay(1);
+            yielded_us = now;
+        }
+
+        if (bench->offered_fps) {
+            // Frames are due on a fixed schedule; sleep through long gaps,
+            // spin through short ones and catch up in a burst when behind
+            int64_t due = bench->start_us + (int64_t)(slot * 1000000 / bench->offered_fps);
+            if (due > now) {
+                if (due - now > 2 * tick_us) {
+                    vTaskDelay((TickType_t)((due - now) / tick_us - 1));
+                }
+                continue;
+            }
+            slot++;
+        }
+
+        offer_frame(bench, corpus.frame(next));
+        if (++next == corpus.size()) {
+            next = 0;
+        }
+    }
+
+    bench->producing.store(false, std::memory_order_release);
+    xTaskNotifyGive(bench->consumer_task);
+    xSemaphoreGive(bench->done);
+    vTaskDelete(NULL);
+}
+
+// Parse, aggregate and encode one frame as the processing task and the main.cpp sinks do
+static void process_frame(BenchPipeline* bench, const BenchSlot& slot) {
+    const CapturedFrame& frame = slot.frame;
+
+    uint32_t start = (uint32_t)esp_cpu_get_cycle_count();
+    CaptureTime time = bench->clock.capture(frame.rx_ctrl.timestamp, esp_timer_get_time(), bench->reference);
+    ParsedFrame parsed;
+    bool parsed_ok = ieee80211_parse(frame.payload, frame.len, frame.len == frame.orig_len, &parsed);
+    uint32_t parsed_at = (uint32_t)esp_cpu_get_cycle_count();
+    bench->latency[BENCH_STAGE_PARSE].record(parsed_at - start);
+
+    // Assigning drops the reference to the oldest held frame
+    bench->held[bench->held_next] = bench->pool.copy(frame.payload, frame.len);
+    if (++bench->held_next == BENCH_RETAIN_WINDOW) {
+        bench->held_next = 0;
+    }
+    uint32_t retained_at = (uint32_t)esp_cpu_get_cycle_count();
+    bench->latency[BENCH_STAGE_RETAIN].record(retained_at - parsed_at);
+
+    bool retry = parsed_ok && (parsed.flags & IEEE80211_FC_RETRY) != 0;
+    bench->stats.record(0, frame.type, frame.orig_len, frame.rx_ctrl.rssi, frame.rx_ctrl.channel, retry);
+    bench->scheduler.record_frame(frame.rx_ctrl.channel, parsed_ok ? parsed.bssid : nullptr);
+    if (parsed_ok && parsed.transmitter) {
+        DeviceObservation obs = {};
+        obs.mac = parsed.transmitter;
+        obs.bssid = parsed.bssid;
+        obs.timestamp_us = time.local_us;
+        obs.rssi = frame.rx_ctrl.rssi;
+        obs.channel = frame.rx_ctrl.channel;
+        obs.type = parsed.type;
+        obs.is_ap = ieee80211_is_mgmt(parsed, IEEE80211_MGMT_BEACON) ||
+                    ieee80211_is_mgmt(parsed, IEEE80211_MGMT_PROBE_RESP) ||
+                    (parsed.bssid && memcmp(parsed.bssid, parsed.transmitter, 6) == 0);
+        bench->devices.update(obs);
+    }
+    uint32_t aggregated_at = (uint32_t)esp_cpu_get_cycle_count();
+    bench->latency[BENCH_STAGE_AGGREGATE].record(aggregated_at - retained_at);
+
+    TelemetryRecord record = {};
+    record.timestamp_us = (uint32_t)time.local_us;
+    record.length = frame.orig_len;
+    record.rssi = frame.rx_ctrl.rssi;
+    record.channel = frame.rx_ctrl.channel;
+    record.type = frame.type;
+    if (parsed_ok) {
+        record.subtype = parsed.subtype;
+        record.retry = retry;
+    }
+    if (!bench->encoder.append(record)) {
+        const uint8_t* batch;
+        bench->telemetry_bytes += bench->encoder.finish(&batch);
+        bench->batches++;
+        bench->encoder.append(record);
+    }
+    uint32_t encoded_at = (uint32_t)esp_cpu_get_cycle_count();
+    bench->latency[BENCH_STAGE_ENCODE].record(encoded_at - aggregated_at);
+    bench->latency[BENCH_STAGE_END_TO_END].record(encoded_at - slot.offered_cycles);
+}
+
+static void consumer_task(void* arg) {
+    BenchPipeline* bench = static_cast<BenchPipeline*>(arg);
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(10));
+        // Read before draining: once the producer has stopped, this drain sees its last frame
+        bool producing = bench->producing.load(std::memory_order_acquire);
+
+        BenchSlot* slot;
+        while ((slot = bench->ring.peek()) != nullptr) {
+            process_frame(bench, *slot);
+            bench->ring.release();
+            bench->processed++;
+            bench->last_processed_us = esp_timer_get_time();
+        }
+        if (!producing) {
+            break;
+        }
+    }
+
+    const uint8_t* batch;
+    size_t len = bench->encoder.finish(&batch);
+    if (len) {
+        bench->telemetry_bytes += len;
+        bench->batches++;
+    }
+
+    xSemaphoreGive(bench->done);
+    vTaskDelete(NULL);
+}
+
+static void fill_stage(const LatencyHistogram& histogram, uint32_t cycles_per_us, BenchStageResult* out) {
+    // Cycles to ns, saturating instead of wrapping
+    auto to_ns = [cycles_per_us](uint32_t cycles) -> uint32_t {
+        uint64_t ns = (uint64_t)cycles * 1000 / cycles_per_us;
+        return ns > UINT32_MAX ? UINT32_MAX : (uint32_t)ns;
+    };
+    out->count = histogram.count();
+    out->min_ns = to_ns(histogram.min());
+    out->mean_ns = to_ns(histogram.mean());
+    out->p50_ns = to_ns(histogram.percentile(50.0));
+    out->p99_ns = to_ns(histogram.percentile(99.0));
+    out->p999_ns = to_ns(histogram.percentile(99.9));
+    out->max_ns = to_ns(histogram.max());
+}
+
+// Run one load step and fill `result`
+static esp_err_t run_step(const PipelineBenchConfig& config, const BenchCorpus& corpus,
+                          uint32_t offered_fps, BenchStepResult* result) {
+    size_t free_before = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    size_t free_lowest = free_before;
+
+    BenchPipeline* bench = new (std::nothrow) BenchPipeline();
+    if (bench == nullptr) {
+        return ESP_ERR_NO_MEM;
+    }
+    bench->corpus = &corpus;
+    bench->offered_fps = offered_fps;
+    bench->step_us = config.step_ms * 1000;
+    bench->producing.store(true);
+    bench->start_us = esp_timer_get_time();
+    bench->offered = 0;
+    bench->filtered = 0;
+    bench->last_processed_us = 0;
+    bench->processed = 0;
+    bench->batches = 0;
+    bench->telemetry_bytes = 0;
+    bench->held_next = 0;
+    if (bench->pool.init() != ESP_OK) {
+        delete bench;
+        return ESP_ERR_NO_MEM;
+    }
+    if (config.filter && config.filter[0] != '\0' && !bench->filter.compile(config.filter)) {
+        delete bench;
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    bench->done = xSemaphoreCreateCounting(2, 0);
+    if (bench->done == nullptr) {
+        delete bench;
+        return ESP_ERR_NO_MEM;
+    }
+
+    // The consumer must exist before the producer can notify it
+    if (xTaskCreatePinnedToCore(consumer_task, "bench_consumer", BENCH_CONSUMER_STACK, bench, BENCH_CONSUMER_PRIORITY,
+                                &bench->consumer_task, pipeline_stage_core(PIPELINE_STAGE_ANALYSIS)) != pdPASS) {
+        vSemaphoreDelete(bench->done);
+        delete bench;
+        return ESP_ERR_NO_MEM;
+    }
+    if (xTaskCreatePinnedToCore(producer_task, "bench_producer", BENCH_PRODUCER_STACK, bench, BENCH_PRODUCER_PRIORITY,
+                                NULL, pipeline_stage_core(PIPELINE_STAGE_INGEST)) != pdPASS) {
+        // Let the consumer drain nothing and exit on its own
+        bench->producing.store(false, std::memory_order_release);
+        xTaskNotifyGive(bench->consumer_task);
+        xSemaphoreTake(bench->done, portMAX_DELAY);
+        vSemaphoreDelete(bench->done);
+        delete bench;
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Wait for both tasks, sampling the free heap meanwhile
+    int finished = 0;
+    TickType_t deadline = xTaskGetTickCount() + pdMS_TO_TICKS(config.step_ms + BENCH_STEP_GRACE_MS);
+    while (finished < 2) {
+        if (xSemaphoreTake(bench->done, pdMS_TO_TICKS(BENCH_HEAP_SAMPLE_MS)) == pdTRUE) {
+            finished++;
+        }
+        size_t free_now = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+        if (free_now < free_lowest) {
+            free_lowest = free_now;
+        }
+        if ((int32_t)(xTaskGetTickCount() - deadline) > 0) {
+            // The tasks still reference the pipeline, so it is leaked rather than freed
+            ESP_LOGE(TAG, "Step at %lu frames/s did not finish", offered_fps);
+            return ESP_ERR_TIMEOUT;
+        }
+    }
+
+    memset(result, 0, sizeof(*result));
+    result->offered_fps = offered_fps;
+    int64_t elapsed_us = (bench->processed ? bench->last_processed_us : esp_timer_get_time()) - bench->start_us;
+    if (elapsed_us < bench->step_us) {
+        elapsed_us = bench->step_us;
+    }
+    result->elapsed_ms = (uint32_t)(elapsed_us / 1000);
+    result->offered = bench->offered;
+    result->filtered = bench->filtered;
+    result->dropped = bench->ring.dropped();
+    result->processed = bench->processed;
+    result->sustained_fps = (float)(bench->processed * 1000000.0 / elapsed_us);
+    uint32_t accepted = bench->offered - bench->filtered;
+    result->drop_rate = accepted ? (float)result->dropped / accepted : 0.0f;
+    result->ring_high_water = bench->ring.high_water();
+    result->ring_capacity = SNIFFER_RING_SLOTS;
+    result->telemetry_batches = bench->batches;
+    result->telemetry_bytes = bench->telemetry_bytes;
+    result->heap_peak_bytes = (uint32_t)(free_before - free_lowest);
+
+    FramePoolStats pool = bench->pool.get_stats();
+    result->pool_allocs = pool.allocs;
+    result->pool_spills = pool.spills;
+    result->pool_failures = pool.failures;
+    for (size_t i = 0; i < FRAME_POOL_CLASS_COUNT; i++) {
+        result->pool_peak_internal += pool.classes[i].peak[FRAME_POOL_TIER_INTERNAL];
+        result->pool_peak_psram += pool.classes[i].peak[FRAME_POOL_TIER_PSRAM];
+    }
+
+    uint32_t cycles_per_us = esp_rom_get_cpu_ticks_per_us();
+    for (size_t i = 0; i < BENCH_STAGE_COUNT; i++) {
+        fill_stage(bench->latency[i], cycles_per_us, &result->stages[i]);
+    }
+
+    vSemaphoreDelete(bench->done);
+    delete bench;
+    return ESP_OK;
+}
+
+esp_err_t pipeline_bench_run(const PipelineBenchConfig& config, const BenchCorpus& corpus,
+                             bench_step_cb_t on_step, void* ctx) {
+    if (corpus.size() == 0 || config.load_count == 0 || config.load_count > PIPELINE_BENCH_MAX_STEPS ||
+        config.step_ms == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    ESP_LOGI(TAG, "%lu load steps of %lu ms over %lu frames (%lu bytes)",
+             config.load_count, config.step_ms, corpus.size(), corpus.bytes());
+
+    for (size_t i = 0; i < config.load_count; i++) {
+        BenchStepResult result;
+        esp_err_t ret = run_step(config, corpus, config.loads[i], &result);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+
+        const BenchStageResult& e2e = result.stages[BENCH_STAGE_END_TO_END];
+        ESP_LOGI(TAG, "%7lu frames/s offered: %.0f frames/s sustained, %lu dropped (%.2f%%), "
+                 "end-to-end p50=%lu p99=%lu p99.9=%lu ns, heap %lu bytes",
+                 result.offered_fps, result.sustained_fps, result.dropped, result.drop_rate * 100.0f,
+                 e2e.p50_ns, e2e.p99_ns, e2e.p999_ns, result.heap_peak_bytes);
+        if (on_step) {
+            on_step(result, ctx);
+        }
+
+        if (config.stop_drop_rate > 0.0f && result.drop_rate > config.stop_drop_rate && i + 1 < config.load_count) {
+            ESP_LOGI(TAG, "Drop rate above %.0f%%, skipping the remaining steps", config.stop_drop_rate * 100.0f);
+            break;
+        }
+    }
+    return ESP_OK;
+}
+
+void pipeline_bench_print_json(const BenchStepResult& result, FILE* out) {
+    fprintf(out,
+            "{\"offered_fps\":%lu,\"elapsed_ms\":%lu,\"offered\":%lu,\"filtered\":%lu,\"dropped\":%lu,"
+            "\"processed\":%lu,\"sustained_fps\":%.1f,\"drop_rate\":%.6f,\"ring_high_water\":%lu,"
+            "\"ring_capacity\":%lu,\"telemetry_batches\":%lu,\"telemetry_bytes\":%lu,\"heap_peak_bytes\":%lu,"
+            "\"pool\":{\"allocs\":%lu,\"spills\":%lu,\"failures\":%lu,\"peak_internal\":%lu,\"peak_psram\":%lu},"
+            "\"latency_ns\":{",
+            (unsigned long)result.offered_fps, (unsigned long)result.elapsed_ms, (unsigned long)result.offered,
+            (unsigned long)result.filtered, (unsigned long)result.dropped, (unsigned long)result.processed,
+            result.sustained_fps, result.drop_rate, (unsigned long)result.ring_high_water,
+            (unsigned long)result.ring_capacity, (unsigned long)result.telemetry_batches,
+            (unsigned long)result.telemetry_bytes, (unsigned long)result.heap_peak_bytes,
+            (unsigned long)result.pool_allocs, (unsigned long)result.pool_spills, (unsigned long)result.pool_failures,
+            (unsigned long)result.pool_peak_internal, (unsigned long)result.pool_peak_psram);
+    for (size_t i = 0; i < BENCH_STAGE_COUNT; i++) {
+        const BenchStageResult& stage = result.stages[i];
+        fprintf(out, "%s\"%s\":{\"count\":%lu,\"min\":%lu,\"mean\":%lu,\"p50\":%lu,\"p99\":%lu,\"p999\":%lu,\"max\":%lu}",
+                i ? "," : "", stage_names[i], (unsigned long)stage.count, (unsigned long)stage.min_ns,
+                (unsigned long)stage.mean_ns, (unsigned long)stage.p50_ns, (unsigned long)stage.p99_ns,
+                (unsigned long)stage.p999_ns, (unsigned long)stage.max_ns);
+    }
+    fprintf(out, "}}\n");
+}
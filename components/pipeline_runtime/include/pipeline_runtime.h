@@ -0,0 +1,88 @@
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+// Core placement and CPU accounting for the capture pipeline.
+//
+// The pipeline runs in three stages joined by queues:
+//
+//   ingest    Wi-Fi driver task: promiscuous RX callback, filter, copy
+//             into the lock-free frame ring
+//   analysis  sniffer_proc: 802.11 parse and the frame sinks (statistics,
+//             device table, channel scheduler, telemetry encoding)
+//   export    bt_tx, pcap_writer, stats: BLE notifications and file writes
+//
+// Ingest has to run where the driver runs, so it is kept light; analysis
+// and export go to the other core so that it does the heavy lifting while
+// the Wi-Fi (and Bluetooth) stacks keep theirs. Components create their
+// tasks with pipeline_create_task(), which pins them to the stage's core
+// and accounts their run time to the stage.
+
+enum PipelineStage {
+    PIPELINE_STAGE_INGEST,
+    PIPELINE_STAGE_ANALYSIS,
+    PIPELINE_STAGE_EXPORT,
+    PIPELINE_STAGE_COUNT
+};
+
+// Core of the Wi-Fi driver task, and so of the ingest stage
+#ifndef PIPELINE_INGEST_CORE
+#ifdef CONFIG_ESP_WIFI_TASK_CORE_ID
+#define PIPELINE_INGEST_CORE    CONFIG_ESP_WIFI_TASK_CORE_ID
+#else
+#define PIPELINE_INGEST_CORE    0
+#endif
+#endif
+
+// Analysis and export default to the core the driver does not use
+#ifndef PIPELINE_ANALYSIS_CORE
+#if portNUM_PROCESSORS > 1
+#define PIPELINE_ANALYSIS_CORE  (1 - PIPELINE_INGEST_CORE)
+#else
+#define PIPELINE_ANALYSIS_CORE  0
+#endif
+#endif
+
+#ifndef PIPELINE_EXPORT_CORE
+#define PIPELINE_EXPORT_CORE    PIPELINE_ANALYSIS_CORE
+#endif
+
+// Most tasks that can be accounted to the stages at once
+#define PIPELINE_MAX_TASKS      12
+
+// CPU use over the interval between two pipeline_get_cpu_usage() calls
+struct PipelineCpuUsage {
+    uint32_t interval_us;
+    float stage_percent[PIPELINE_STAGE_COUNT];      // Share of one core used by each stage's tasks
+    float core_busy_percent[portNUM_PROCESSORS];    // 100 minus the idle task's share, negative if unknown
+};
+
+const char* pipeline_stage_name(PipelineStage stage);
+
+// Core tasks of a stage are pinned to, or tskNO_AFFINITY
+BaseType_t pipeline_stage_core(PipelineStage stage);
+
+// Move a stage to another core (or tskNO_AFFINITY). Only tasks created
+// afterwards are affected, so call it before starting the components.
+esp_err_t pipeline_set_stage_core(PipelineStage stage, BaseType_t core);
+
+// xTaskCreatePinnedToCore() on the stage's core, accounting the new task to the stage
+esp_err_t pipeline_create_task(PipelineStage stage, TaskFunction_t function, const char* name,
+                               uint32_t stack_depth, void* arg, UBaseType_t priority, TaskHandle_t* handle);
+
+// Account an existing task, such as the Wi-Fi driver task, to a stage. Its
+// first sample includes everything it ran before it was registered.
+esp_err_t pipeline_register_task(PipelineStage stage, TaskHandle_t task);
+
+// Stop accounting a task; call it before deleting the task
+void pipeline_unregister_task(TaskHandle_t task);
+
+// CPU use per stage and per core since the previous call, or since boot on
+// the first. Needs configUSE_TRACE_FACILITY and configGENERATE_RUN_TIME_STATS
+// (CONFIG_FREERTOS_USE_TRACE_FACILITY, CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS).
+// Returns ESP_ERR_NOT_SUPPORTED without them, ESP_ERR_NO_MEM if the task
+// list cannot be copied.
+esp_err_t pipeline_get_cpu_usage(PipelineCpuUsage* out);
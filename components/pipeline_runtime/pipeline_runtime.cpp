@@ -0,0 +1,186 @@
+#include "pipeline_runtime.h"
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+
+static const char* TAG = "PIPELINE_RUNTIME";
+
+static const char* stage_names[PIPELINE_STAGE_COUNT] = { "ingest", "analysis", "export" };
+
+// A task accounted to a stage and its run-time counter at the last sample
+struct StageTask {
+    TaskHandle_t task;
+    PipelineStage stage;
+    uint32_t last_run_time;
+};
+
+static portMUX_TYPE runtime_lock = portMUX_INITIALIZER_UNLOCKED;
+static BaseType_t stage_cores[PIPELINE_STAGE_COUNT] = {
+    PIPELINE_INGEST_CORE, PIPELINE_ANALYSIS_CORE, PIPELINE_EXPORT_CORE
+};
+static StageTask stage_tasks[PIPELINE_MAX_TASKS];
+static size_t stage_task_count = 0;
+
+// Previous sample: total run time and each core's idle task counter
+static uint32_t last_total_run_time = 0;
+static uint32_t last_idle_run_time[portNUM_PROCESSORS];
+
+const char* pipeline_stage_name(PipelineStage stage) {
+    return stage < PIPELINE_STAGE_COUNT ? stage_names[stage] : "unknown";
+}
+
+BaseType_t pipeline_stage_core(PipelineStage stage) {
+    if (stage >= PIPELINE_STAGE_COUNT) {
+        return tskNO_AFFINITY;
+    }
+    portENTER_CRITICAL(&runtime_lock);
+    BaseType_t core = stage_cores[stage];
+    portEXIT_CRITICAL(&runtime_lock);
+    return core;
+}
+
+esp_err_t pipeline_set_stage_core(PipelineStage stage, BaseType_t core) {
+    if (stage >= PIPELINE_STAGE_COUNT || (core != tskNO_AFFINITY && (core < 0 || core >= portNUM_PROCESSORS))) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    portENTER_CRITICAL(&runtime_lock);
+    stage_cores[stage] = core;
+    portEXIT_CRITICAL(&runtime_lock);
+    return ESP_OK;
+}
+
+esp_err_t pipeline_register_task(PipelineStage stage, TaskHandle_t task) {
+    if (stage >= PIPELINE_STAGE_COUNT || task == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = ESP_ERR_NO_MEM;
+    portENTER_CRITICAL(&runtime_lock);
+    for (size_t i = 0; i < stage_task_count; i++) {
+        if (stage_tasks[i].task == task) {
+            stage_tasks[i].stage = stage;
+            ret = ESP_OK;
+            break;
+        }
+    }
+    if (ret != ESP_OK && stage_task_count < PIPELINE_MAX_TASKS) {
+        // The first sample counts everything the task has run so far
+        stage_tasks[stage_task_count].task = task;
+        stage_tasks[stage_task_count].stage = stage;
+        stage_tasks[stage_task_count].last_run_time = 0;
+        stage_task_count++;
+        ret = ESP_OK;
+    }
+    portEXIT_CRITICAL(&runtime_lock);
+
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "No room to account task %s to the %s stage", pcTaskGetName(task), stage_names[stage]);
+    }
+    return ret;
+}
+
+void pipeline_unregister_task(TaskHandle_t task) {
+    portENTER_CRITICAL(&runtime_lock);
+    for (size_t i = 0; i < stage_task_count; i++) {
+        if (stage_tasks[i].task == task) {
+            stage_tasks[i] = stage_tasks[--stage_task_count];
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&runtime_lock);
+}
+
+esp_err_t pipeline_create_task(PipelineStage stage, TaskFunction_t function, const char* name,
+                               uint32_t stack_depth, void* arg, UBaseType_t priority, TaskHandle_t* handle) {
+    if (stage >= PIPELINE_STAGE_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    TaskHandle_t task = nullptr;
+    BaseType_t core = pipeline_stage_core(stage);
+    if (xTaskCreatePinnedToCore(function, name, stack_depth, arg, priority, &task, core) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (core == tskNO_AFFINITY) {
+        ESP_LOGI(TAG, "Task %s (%s stage) on any core", name, stage_names[stage]);
+    } else {
+        ESP_LOGI(TAG, "Task %s (%s stage) on core %d", name, stage_names[stage], (int)core);
+    }
+
+    pipeline_register_task(stage, task);
+    if (handle) {
+        *handle = task;
+    }
+    return ESP_OK;
+}
+
+#if configUSE_TRACE_FACILITY && configGENERATE_RUN_TIME_STATS
+
+// Run-time counter of `task` in a system state snapshot, false if it has gone
+static bool find_run_time(const TaskStatus_t* tasks, UBaseType_t count, TaskHandle_t task, uint32_t* run_time) {
+    for (UBaseType_t i = 0; i < count; i++) {
+        if (tasks[i].xHandle == task) {
+            *run_time = tasks[i].ulRunTimeCounter;
+            return true;
+        }
+    }
+    return false;
+}
+
+esp_err_t pipeline_get_cpu_usage(PipelineCpuUsage* out) {
+    if (out == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Room for a few tasks created while the list is being copied
+    UBaseType_t capacity = uxTaskGetNumberOfTasks() + 4;
+    TaskStatus_t* tasks = (TaskStatus_t*)malloc(capacity * sizeof(TaskStatus_t));
+    if (tasks == nullptr) {
+        return ESP_ERR_NO_MEM;
+    }
+    uint32_t total = 0;
+    UBaseType_t count = uxTaskGetSystemState(tasks, capacity, &total);
+
+    memset(out, 0, sizeof(*out));
+
+    portENTER_CRITICAL(&runtime_lock);
+    uint32_t interval = total - last_total_run_time;
+    out->interval_us = interval;
+
+    for (size_t i = 0; i < stage_task_count; i++) {
+        StageTask& entry = stage_tasks[i];
+        uint32_t run_time;
+        if (!find_run_time(tasks, count, entry.task, &run_time)) {
+            continue;
+        }
+        if (interval) {
+            out->stage_percent[entry.stage] += 100.0f * (run_time - entry.last_run_time) / interval;
+        }
+        entry.last_run_time = run_time;
+    }
+
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        uint32_t idle;
+        TaskHandle_t idle_task = xTaskGetIdleTaskHandleForCore(core);
+        if (idle_task == nullptr || !find_run_time(tasks, count, idle_task, &idle) || interval == 0) {
+            out->core_busy_percent[core] = -1.0f;
+            continue;
+        }
+        float idle_percent = 100.0f * (idle - last_idle_run_time[core]) / interval;
+        out->core_busy_percent[core] = idle_percent > 100.0f ? 0.0f : 100.0f - idle_percent;
+        last_idle_run_time[core] = idle;
+    }
+    last_total_run_time = total;
+    portEXIT_CRITICAL(&runtime_lock);
+
+    free(tasks);
+    return ESP_OK;
+}
+
+#else
+
+esp_err_t pipeline_get_cpu_usage(PipelineCpuUsage* out) {
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+#endif
@@ -0,0 +1,137 @@
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+#include "esp_console.h"
+#include "sniffer_config.h"
+
+// Longest command line the console passes on
+#define CONFIG_COMMAND_MAX  (SNIFFER_CONFIG_FILTER_LEN + 64)
+
+// Next whitespace-separated word of `*line`, terminated in place
+static char* next_word(char** line) {
+    char* p = *line;
+    while (isspace((unsigned char)*p)) {
+        p++;
+    }
+    char* word = p;
+    while (*p && !isspace((unsigned char)*p)) {
+        p++;
+    }
+    if (*p) {
+        *p++ = '\0';
+    }
+    *line = p;
+    return word;
+}
+
+// Append a "key=value" line for `field`; returns the new length
+static size_t append_value(const ConfigField& field, const SnifferSettings& settings,
+                           char* reply, size_t len, size_t reply_len) {
+    if (len + 1 >= reply_len) {
+        return len;
+    }
+    int n = snprintf(reply + len, reply_len - len, "%s%s=", len ? "\n" : "", field.key);
+    if (n < 0 || (size_t)n >= reply_len - len) {
+        return reply_len - 1;
+    }
+    len += n;
+    return len + sniffer_config_format(field, settings, reply + len, reply_len - len);
+}
+
+esp_err_t sniffer_config_execute(SnifferConfig& config, const char* line, char* reply, size_t reply_len) {
+    char buffer[CONFIG_COMMAND_MAX];
+    snprintf(buffer, sizeof(buffer), "%s", line);
+    char* rest = buffer;
+    const char* command = next_word(&rest);
+    const char* key = next_word(&rest);
+
+    // The value is the rest of the line, so that filters keep their spaces
+    while (isspace((unsigned char)*rest)) {
+        rest++;
+    }
+    size_t value_len = strlen(rest);
+    while (value_len && isspace((unsigned char)rest[value_len - 1])) {
+        rest[--value_len] = '\0';
+    }
+
+    size_t count;
+    const ConfigField* fields = sniffer_config_fields(&count);
+    SnifferSettings settings;
+    char error[96];
+    esp_err_t ret = ESP_OK;
+    reply[0] = '\0';
+
+    if (strcmp(command, "get") == 0) {
+        config.get(&settings);
+        size_t len = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (*key == '\0' || strcmp(key, fields[i].key) == 0) {
+                len = append_value(fields[i], settings, reply, len, reply_len);
+            }
+        }
+        if (len == 0) {
+            snprintf(error, sizeof(error), "unknown setting '%s'", key);
+            ret = ESP_ERR_NOT_FOUND;
+        }
+    } else if (strcmp(command, "set") == 0) {
+        ret = config.set(key, rest, error, sizeof(error));
+        if (ret == ESP_OK) {
+            config.get(&settings);
+            append_value(*sniffer_config_find(key), settings, reply, 0, reply_len);
+        }
+    } else if (strcmp(command, "save") == 0) {
+        ret = sniffer_config_save(config);
+        snprintf(error, sizeof(error), "save failed: %s", esp_err_to_name(ret));
+    } else if (strcmp(command, "reset") == 0) {
+        ret = config.apply(sniffer_config_default_settings(), error, sizeof(error));
+    } else if (strcmp(command, "erase") == 0) {
+        ret = sniffer_config_erase();
+        snprintf(error, sizeof(error), "erase failed: %s", esp_err_to_name(ret));
+    } else if (strcmp(command, "help") == 0) {
+        size_t len = 0;
+        for (size_t i = 0; i < count && len + 1 < reply_len; i++) {
+            int n = snprintf(reply + len, reply_len - len, "%s%s %lu-%lu: %s", len ? "\n" : "",
+                             fields[i].key, (unsigned long)fields[i].min, (unsigned long)fields[i].max,
+                             fields[i].help);
+            len = n < 0 || (size_t)n >= reply_len - len ? reply_len - 1 : len + n;
+        }
+    } else {
+        snprintf(error, sizeof(error), "unknown command '%s'; try get, set, save, reset, erase or help", command);
+        ret = ESP_ERR_INVALID_ARG;
+    }
+
+    if (ret != ESP_OK) {
+        snprintf(reply, reply_len, "ERROR: %s", error);
+    } else if (reply[0] == '\0') {
+        snprintf(reply, reply_len, "OK");
+    }
+    return ret;
+}
+
+static SnifferConfig* console_config;
+
+static int config_command(int argc, char** argv) {
+    // The console split the line into words; join them back
+    char line[CONFIG_COMMAND_MAX];
+    size_t len = 0;
+    line[0] = '\0';
+    for (int i = 1; i < argc && len < sizeof(line); i++) {
+        len += snprintf(line + len, sizeof(line) - len, "%s%s", i > 1 ? " " : "", argv[i]);
+    }
+
+    char reply[1024];
+    esp_err_t ret = sniffer_config_execute(*console_config, line, reply, sizeof(reply));
+    printf("%s\n", reply);
+    return ret == ESP_OK ? 0 : 1;
+}
+
+esp_err_t sniffer_config_register_console(SnifferConfig* config) {
+    console_config = config;
+
+    esp_console_cmd_t command = {};
+    command.command = "config";
+    command.help = "Runtime settings: get [KEY], set KEY VALUE, save, reset, erase, help";
+    command.hint = "<get|set|save|reset|erase|help> [KEY] [VALUE]";
+    command.func = &config_command;
+    return esp_console_cmd_register(&command);
+}
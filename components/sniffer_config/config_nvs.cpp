@@ -0,0 +1,85 @@
+#include "sniffer_config.h"
+#include "esp_log.h"
+#include "nvs.h"
+
+static const char* TAG = "SNIFFER_CONFIG";
+
+// The settings are stored as one blob next to the layout version
+#define KEY_VERSION     "version"
+#define KEY_SETTINGS    "settings"
+
+esp_err_t sniffer_config_load(SnifferConfig& config) {
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(SNIFFER_CONFIG_NAMESPACE, NVS_READONLY, &handle);
+    if (ret != ESP_OK) {
+        // ESP_ERR_NVS_NOT_FOUND: the namespace only exists once something was saved
+        return ret;
+    }
+
+    uint32_t version = 0;
+    SnifferSettings settings;
+    size_t len = sizeof(settings);
+    ret = nvs_get_u32(handle, KEY_VERSION, &version);
+    if (ret == ESP_OK) {
+        ret = nvs_get_blob(handle, KEY_SETTINGS, &settings, &len);
+    }
+    nvs_close(handle);
+    if (ret == ESP_ERR_NVS_INVALID_LENGTH || (ret == ESP_OK && (version != SNIFFER_CONFIG_VERSION ||
+                                                                len != sizeof(settings)))) {
+        ESP_LOGW(TAG, "Stored settings are version %lu, expected %d; using defaults",
+                 version, SNIFFER_CONFIG_VERSION);
+        return ESP_ERR_INVALID_VERSION;
+    }
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    char error[64];
+    ret = config.apply(settings, error, sizeof(error));
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Stored settings rejected: %s", error);
+        return ret;
+    }
+    ESP_LOGI(TAG, "Loaded stored settings");
+    return ESP_OK;
+}
+
+esp_err_t sniffer_config_save(const SnifferConfig& config) {
+    SnifferSettings settings;
+    config.get(&settings);
+
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(SNIFFER_CONFIG_NAMESPACE, NVS_READWRITE, &handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open NVS: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    ret = nvs_set_u32(handle, KEY_VERSION, SNIFFER_CONFIG_VERSION);
+    if (ret == ESP_OK) {
+        ret = nvs_set_blob(handle, KEY_SETTINGS, &settings, sizeof(settings));
+    }
+    if (ret == ESP_OK) {
+        ret = nvs_commit(handle);
+    }
+    nvs_close(handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to save settings: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    ESP_LOGI(TAG, "Settings saved");
+    return ESP_OK;
+}
+
+esp_err_t sniffer_config_erase() {
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(SNIFFER_CONFIG_NAMESPACE, NVS_READWRITE, &handle);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    ret = nvs_erase_all(handle);
+    if (ret == ESP_OK) {
+        ret = nvs_commit(handle);
+    }
+    nvs_close(handle);
+    return ret;
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+// Longest filter expression and device name, terminator included. Names
+// are kept short enough to fit the advertising packet.
+#define SNIFFER_CONFIG_FILTER_LEN   128
+#define SNIFFER_CONFIG_NAME_LEN     17
+
+// NVS namespace and layout version of the stored settings. Bump the version
+// when SnifferSettings changes; a stored blob of another version is ignored.
+#define SNIFFER_CONFIG_NAMESPACE    "sniffer_cfg"
+#define SNIFFER_CONFIG_VERSION      1
+
+// Everything that can be tuned without reflashing
+struct SnifferSettings {
+    uint8_t channel;                // Fixed channel, 0 to hop with the adaptive scheduler
+    uint8_t hop_first;              // Hop set, inclusive
+    uint8_t hop_last;
+    uint8_t hop_explore_pct;        // Share of the spare dwell budget spread evenly
+    uint32_t hop_round_ms;          // Dwell budget of one pass over the hop set
+    uint32_t hop_min_dwell_ms;      // Least dwell of every channel in every round
+    uint32_t stats_interval_ms;     // Period of the STATS message to the app
+    uint16_t ble_batch_bytes;       // Largest telemetry batch, 0 for MTU - 3
+    uint16_t ble_flush_ms;          // Longest wait of a partial telemetry batch
+    uint16_t ble_queue_bytes;       // Byte budget of the BLE transmit queue
+    uint8_t log_level;              // esp_log_level_t applied to every tag
+    char filter[SNIFFER_CONFIG_FILTER_LEN];     // Capture filter, empty for none
+    char device_name[SNIFFER_CONFIG_NAME_LEN];  // BLE device name
+};
+
+// Adaptive hopping over channels 1-13, 30 s average and 5 s minimum dwell,
+// 20% exploration; stats every 30 s; MTU-sized telemetry batches flushed
+// after 100 ms through a 4 KB queue; info logging, no filter, "ESP32_Sniffer"
+SnifferSettings sniffer_config_default_settings();
+
+enum ConfigType {
+    CONFIG_TYPE_U8,
+    CONFIG_TYPE_U16,
+    CONFIG_TYPE_U32,
+    CONFIG_TYPE_STRING,
+    CONFIG_TYPE_LOG_LEVEL,      // uint8_t; "none" ... "verbose" or 0-5
+};
+
+// One entry of the registry: a named, typed, range-checked setting
+struct ConfigField {
+    const char* key;
+    ConfigType type;
+    uint16_t offset;            // Of the value in SnifferSettings
+    uint16_t size;              // Of the value, terminator included for strings
+    uint32_t min;               // Inclusive range of integers; of the length of strings
+    uint32_t max;
+    const char* help;
+};
+
+// Registry of every setting, in display order
+const ConfigField* sniffer_config_fields(size_t* count);
+
+// Field named `key`, or nullptr
+const ConfigField* sniffer_config_find(const char* key);
+
+// Parse `text` into the field's value in `settings`; false with a reason
+// in `error` if it is malformed or out of range
+bool sniffer_config_parse(const ConfigField& field, const char* text, SnifferSettings* settings,
+                          char* error, size_t error_len);
+
+// Print the field's value in `settings` the way parse() reads it; returns
+// the length, truncated to `len` - 1
+size_t sniffer_config_format(const ConfigField& field, const SnifferSettings& settings, char* out, size_t len);
+
+// Check every range and the rules spanning fields (hop set order, filter
+// syntax); false with a reason in `error`
+bool sniffer_config_validate(const SnifferSettings& settings, char* error, size_t error_len);
+
+// Called after every published change, from the task that made it
+typedef void (*config_change_cb_t)(uint32_t generation, void* ctx);
+
+// Runtime configuration shared by the whole pipeline.
+//
+// Settings live in two slots. A change is written to the inactive slot,
+// validated as a whole and published by flipping the active index, so a
+// reader always copies one consistent set of settings, old or new, and
+// never waits for a writer. Readers poll generation() and apply what
+// changed from their own task: the filter and channel policy are swapped
+// in while capture runs, without restarting Wi-Fi.
+//
+// Writers are serialized by a mutex; readers only bump a per-slot counter
+// that the next writer waits out before reusing the slot.
+class SnifferConfig {
+public:
+    explicit SnifferConfig(const SnifferSettings& settings = sniffer_config_default_settings());
+    ~SnifferConfig();
+
+    SnifferConfig(const SnifferConfig&) = delete;
+    SnifferConfig& operator=(const SnifferConfig&) = delete;
+
+    // Copy of the current settings, from any task
+    void get(SnifferSettings* out) const;
+
+    // Incremented by every published change
+    uint32_t generation() const { return generation_count.load(); }
+
+    // Validate and publish a whole set of settings. Publishing settings
+    // equal to the current ones does nothing.
+    esp_err_t apply(const SnifferSettings& settings, char* error, size_t error_len);
+
+    // Parse one setting into a copy of the current ones and publish it
+    esp_err_t set(const char* key, const char* value, char* error, size_t error_len);
+
+    // Call `cb` after every published change; set it before sharing the object
+    void set_change_callback(config_change_cb_t cb, void* ctx);
+
+private:
+    // Write `settings` to the inactive slot and flip; write_lock must be held
+    void publish(const SnifferSettings& settings);
+
+    // Validate and publish unless equal to the current settings; returns
+    // whether they changed. write_lock must be held.
+    bool publish_locked(const SnifferSettings& settings, char* error, size_t error_len, esp_err_t* result);
+
+    SnifferSettings slots[2];
+    std::atomic<uint8_t> active;
+    mutable std::atomic<uint32_t> readers[2];
+    std::atomic<uint32_t> generation_count;
+    SemaphoreHandle_t write_lock;
+
+    config_change_cb_t change_cb;
+    void* change_ctx;
+};
+
+// Load settings stored in NVS (namespace SNIFFER_CONFIG_NAMESPACE) and
+// publish them. nvs_flash_init() must have been called. Returns
+// ESP_ERR_NVS_NOT_FOUND if nothing was saved yet, ESP_ERR_INVALID_VERSION if
+// the stored settings are from another layout; the current ones are kept.
+esp_err_t sniffer_config_load(SnifferConfig& config);
+
+// Store the current settings in NVS
+esp_err_t sniffer_config_save(const SnifferConfig& config);
+
+// Forget the stored settings; the next boot starts with the defaults
+esp_err_t sniffer_config_erase();
+
+// Run one text command and write the reply to `reply`:
+//
+//   get [KEY]          Current value of KEY, or of every setting
+//   set KEY VALUE      Change a setting; VALUE is the rest of the line
+//   save               Store the current settings in NVS
+//   reset              Publish the defaults (stored settings are kept)
+//   erase              Forget the stored settings
+//   help               Keys with their ranges
+//
+// Shared by the console and the Bluetooth link. Returns ESP_OK, or the
+// error of a rejected command with its reason in `reply`.
+esp_err_t sniffer_config_execute(SnifferConfig& config, const char* line, char* reply, size_t reply_len);
+
+// Register the `config` console command running sniffer_config_execute().
+// `config` must outlive the console.
+esp_err_t sniffer_config_register_console(SnifferConfig* config);
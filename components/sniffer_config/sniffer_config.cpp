@@ -0,0 +1,283 @@
+#include "sniffer_config.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/task.h"
+#include "packet_filter.h"
+
+static const ConfigField fields[] = {
+    { "channel", CONFIG_TYPE_U8, (uint16_t)offsetof(SnifferSettings, channel), 1, 0, 13,
+      "Fixed channel, 0 to hop" },
+    { "hop.first", CONFIG_TYPE_U8, (uint16_t)offsetof(SnifferSettings, hop_first), 1, 1, 13,
+      "First channel of the hop set" },
+    { "hop.last", CONFIG_TYPE_U8, (uint16_t)offsetof(SnifferSettings, hop_last), 1, 1, 13,
+      "Last channel of the hop set" },
+    { "hop.explore_pct", CONFIG_TYPE_U8, (uint16_t)offsetof(SnifferSettings, hop_explore_pct), 1, 0, 100,
+      "Share of the spare dwell spread evenly" },
+    { "hop.round_ms", CONFIG_TYPE_U32, (uint16_t)offsetof(SnifferSettings, hop_round_ms), 4, 1000, 3600000,
+      "Dwell budget of one pass over the hop set" },
+    { "hop.min_dwell_ms", CONFIG_TYPE_U32, (uint16_t)offsetof(SnifferSettings, hop_min_dwell_ms), 4, 100, 600000,
+      "Least dwell per channel per round" },
+    { "stats.interval_ms", CONFIG_TYPE_U32, (uint16_t)offsetof(SnifferSettings, stats_interval_ms), 4, 1000, 3600000,
+      "Period of the STATS message" },
+    { "ble.batch_bytes", CONFIG_TYPE_U16, (uint16_t)offsetof(SnifferSettings, ble_batch_bytes), 2, 0, 514,
+      "Largest telemetry batch, 0 for the MTU" },
+    { "ble.flush_ms", CONFIG_TYPE_U16, (uint16_t)offsetof(SnifferSettings, ble_flush_ms), 2, 10, 5000,
+      "Longest wait of a partial telemetry batch" },
+    // Up to the budget BluetoothComm allocates, down to one largest message
+    { "ble.queue_bytes", CONFIG_TYPE_U16, (uint16_t)offsetof(SnifferSettings, ble_queue_bytes), 2, 516, 4096,
+      "Byte budget of the transmit queue" },
+    { "ble.name", CONFIG_TYPE_STRING, (uint16_t)offsetof(SnifferSettings, device_name), SNIFFER_CONFIG_NAME_LEN,
+      1, SNIFFER_CONFIG_NAME_LEN - 1, "BLE device name" },
+    { "log.level", CONFIG_TYPE_LOG_LEVEL, (uint16_t)offsetof(SnifferSettings, log_level), 1, 0, 5,
+      "none, error, warn, info, debug or verbose" },
+    { "filter", CONFIG_TYPE_STRING, (uint16_t)offsetof(SnifferSettings, filter), SNIFFER_CONFIG_FILTER_LEN,
+      0, SNIFFER_CONFIG_FILTER_LEN - 1, "Capture filter, empty for none" },
+};
+
+static const char* level_names[] = { "none", "error", "warn", "info", "debug", "verbose" };
+
+SnifferSettings sniffer_config_default_settings() {
+    // Zeroed first so that settings compare equal byte for byte
+    SnifferSettings settings;
+    memset(&settings, 0, sizeof(settings));
+    settings.channel = 0;
+    settings.hop_first = 1;
+    settings.hop_last = 13;
+    settings.hop_explore_pct = 20;
+    settings.hop_round_ms = 13 * 30000;
+    settings.hop_min_dwell_ms = 5000;
+    settings.stats_interval_ms = 30000;
+    settings.ble_batch_bytes = 0;
+    settings.ble_flush_ms = 100;
+    settings.ble_queue_bytes = 4096;
+    settings.log_level = 3;     // ESP_LOG_INFO
+    strcpy(settings.device_name, "ESP32_Sniffer");
+    return settings;
+}
+
+const ConfigField* sniffer_config_fields(size_t* count) {
+    *count = sizeof(fields) / sizeof(fields[0]);
+    return fields;
+}
+
+const ConfigField* sniffer_config_find(const char* key) {
+    for (const ConfigField& field : fields) {
+        if (strcmp(field.key, key) == 0) {
+            return &field;
+        }
+    }
+    return nullptr;
+}
+
+static uint32_t read_integer(const ConfigField& field, const SnifferSettings& settings) {
+    const uint8_t* value = (const uint8_t*)&settings + field.offset;
+    switch (field.type) {
+        case CONFIG_TYPE_U16: { uint16_t v; memcpy(&v, value, sizeof(v)); return v; }
+        case CONFIG_TYPE_U32: { uint32_t v; memcpy(&v, value, sizeof(v)); return v; }
+        default: return *value;
+    }
+}
+
+static void write_integer(const ConfigField& field, SnifferSettings* settings, uint32_t v) {
+    uint8_t* value = (uint8_t*)settings + field.offset;
+    switch (field.type) {
+        case CONFIG_TYPE_U16: { uint16_t w = (uint16_t)v; memcpy(value, &w, sizeof(w)); break; }
+        case CONFIG_TYPE_U32: memcpy(value, &v, sizeof(v)); break;
+        default: *value = (uint8_t)v; break;
+    }
+}
+
+bool sniffer_config_parse(const ConfigField& field, const char* text, SnifferSettings* settings,
+                          char* error, size_t error_len) {
+    if (field.type == CONFIG_TYPE_STRING) {
+        size_t len = strlen(text);
+        if (len < field.min || len > field.max) {
+            snprintf(error, error_len, "%s must be %lu to %lu characters", field.key,
+                     (unsigned long)field.min, (unsigned long)field.max);
+            return false;
+        }
+        // Zero the rest so that equal strings compare equal
+        char* value = (char*)settings + field.offset;
+        memset(value, 0, field.size);
+        memcpy(value, text, len);
+        return true;
+    }
+
+    if (field.type == CONFIG_TYPE_LOG_LEVEL) {
+        for (uint32_t i = 0; i < sizeof(level_names) / sizeof(level_names[0]); i++) {
+            if (strcmp(text, level_names[i]) == 0) {
+                write_integer(field, settings, i);
+                return true;
+            }
+        }
+    }
+
+    char* end;
+    unsigned long v = strtoul(text, &end, 0);
+    if (*text == '\0' || *text == '-' || isspace((unsigned char)*text) || *end != '\0') {
+        snprintf(error, error_len, "%s: '%s' is not a number", field.key, text);
+        return false;
+    }
+    if (v < field.min || v > field.max) {
+        snprintf(error, error_len, "%s must be %lu to %lu", field.key,
+                 (unsigned long)field.min, (unsigned long)field.max);
+        return false;
+    }
+    write_integer(field, settings, (uint32_t)v);
+    return true;
+}
+
+size_t sniffer_config_format(const ConfigField& field, const SnifferSettings& settings, char* out, size_t len) {
+    int n;
+    if (field.type == CONFIG_TYPE_STRING) {
+        n = snprintf(out, len, "%s", (const char*)&settings + field.offset);
+    } else if (field.type == CONFIG_TYPE_LOG_LEVEL && read_integer(field, settings) <= field.max) {
+        n = snprintf(out, len, "%s", level_names[read_integer(field, settings)]);
+    } else {
+        n = snprintf(out, len, "%lu", (unsigned long)read_integer(field, settings));
+    }
+    if (n < 0) {
+        return 0;
+    }
+    return (size_t)n < len ? (size_t)n : (len ? len - 1 : 0);
+}
+
+bool sniffer_config_validate(const SnifferSettings& settings, char* error, size_t error_len) {
+    for (const ConfigField& field : fields) {
+        if (field.type == CONFIG_TYPE_STRING) {
+            const char* value = (const char*)&settings + field.offset;
+            size_t len = strnlen(value, field.size);
+            if (len < field.min || len > field.max) {
+                snprintf(error, error_len, "%s must be %lu to %lu characters", field.key,
+                         (unsigned long)field.min, (unsigned long)field.max);
+                return false;
+            }
+            continue;
+        }
+        uint32_t v = read_integer(field, settings);
+        if (v < field.min || v > field.max) {
+            snprintf(error, error_len, "%s must be %lu to %lu", field.key,
+                     (unsigned long)field.min, (unsigned long)field.max);
+            return false;
+        }
+    }
+
+    if (settings.hop_first > settings.hop_last) {
+        snprintf(error, error_len, "hop.first must not be above hop.last");
+        return false;
+    }
+    // Smaller batches could not hold a single record
+    if (settings.ble_batch_bytes != 0 && settings.ble_batch_bytes < 20) {
+        snprintf(error, error_len, "ble.batch_bytes must be 0 or 20 to 514");
+        return false;
+    }
+
+    // Compiled here as well, so that a bad filter never gets published
+    PacketFilter filter;
+    char reason[64];
+    if (!filter.compile(settings.filter, reason, sizeof(reason))) {
+        snprintf(error, error_len, "filter: %s", reason);
+        return false;
+    }
+    return true;
+}
+
+SnifferConfig::SnifferConfig(const SnifferSettings& settings)
+    : active(0), generation_count(0), change_cb(nullptr), change_ctx(nullptr) {
+    slots[0] = settings;
+    slots[1] = settings;
+    readers[0].store(0);
+    readers[1].store(0);
+    write_lock = xSemaphoreCreateMutex();
+}
+
+SnifferConfig::~SnifferConfig() {
+    if (write_lock) {
+        vSemaphoreDelete(write_lock);
+    }
+}
+
+void SnifferConfig::get(SnifferSettings* out) const {
+    // Announce the slot, then make sure it is still the active one: a
+    // writer only reuses a slot once nobody has announced it
+    uint8_t slot;
+    while (true) {
+        slot = active.load();
+        readers[slot].fetch_add(1);
+        if (active.load() == slot) {
+            break;
+        }
+        readers[slot].fetch_sub(1);
+    }
+    *out = slots[slot];
+    readers[slot].fetch_sub(1);
+}
+
+void SnifferConfig::publish(const SnifferSettings& settings) {
+    uint8_t next = active.load() ^ 1;
+    // Readers still copying the previous settings out of this slot
+    while (readers[next].load() != 0) {
+        taskYIELD();
+    }
+    slots[next] = settings;
+    active.store(next);
+    generation_count.fetch_add(1);
+}
+
+bool SnifferConfig::publish_locked(const SnifferSettings& settings, char* error, size_t error_len,
+                                   esp_err_t* result) {
+    if (!sniffer_config_validate(settings, error, error_len)) {
+        *result = ESP_ERR_INVALID_ARG;
+        return false;
+    }
+    *result = ESP_OK;
+    if (memcmp(&settings, &slots[active.load()], sizeof(settings)) == 0) {
+        return false;
+    }
+    publish(settings);
+    return true;
+}
+
+esp_err_t SnifferConfig::apply(const SnifferSettings& settings, char* error, size_t error_len) {
+    esp_err_t ret;
+    xSemaphoreTake(write_lock, portMAX_DELAY);
+    bool changed = publish_locked(settings, error, error_len, &ret);
+    uint32_t generation = generation_count.load();
+    xSemaphoreGive(write_lock);
+
+    if (changed && change_cb) {
+        change_cb(generation, change_ctx);
+    }
+    return ret;
+}
+
+esp_err_t SnifferConfig::set(const char* key, const char* value, char* error, size_t error_len) {
+    const ConfigField* field = sniffer_config_find(key);
+    if (field == nullptr) {
+        snprintf(error, error_len, "unknown setting '%s'", key);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    // Start from the active slot, which only writers change
+    esp_err_t ret = ESP_ERR_INVALID_ARG;
+    bool changed = false;
+    xSemaphoreTake(write_lock, portMAX_DELAY);
+    SnifferSettings next = slots[active.load()];
+    if (sniffer_config_parse(*field, value, &next, error, error_len)) {
+        changed = publish_locked(next, error, error_len, &ret);
+    }
+    uint32_t generation = generation_count.load();
+    xSemaphoreGive(write_lock);
+
+    if (changed && change_cb) {
+        change_cb(generation, change_ctx);
+    }
+    return ret;
+}
+
+void SnifferConfig::set_change_callback(config_change_cb_t cb, void* ctx) {
+    change_cb = cb;
+    change_ctx = ctx;
+}
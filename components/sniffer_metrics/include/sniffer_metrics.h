@@ -0,0 +1,159 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+// Most tasks reported per sample; with more, those closest to overflowing
+// their stack are kept
+#ifndef METRICS_MAX_TASKS
+#define METRICS_MAX_TASKS       24
+#endif
+
+// Most queues that can be registered
+#ifndef METRICS_MAX_QUEUES
+#define METRICS_MAX_QUEUES      8
+#endif
+
+// Longest task or queue name kept, terminator included
+#define METRICS_NAME_LEN        16
+
+enum MetricsHeapKind {
+    METRICS_HEAP_INTERNAL,      // MALLOC_CAP_INTERNAL: DRAM
+    METRICS_HEAP_SPIRAM,        // MALLOC_CAP_SPIRAM: external RAM, all zero without PSRAM
+    METRICS_HEAP_COUNT
+};
+
+struct MetricsHeap {
+    uint32_t total_bytes;
+    uint32_t free_bytes;
+    uint32_t min_free_bytes;    // Lowest free since boot
+    uint32_t largest_block;     // Largest allocation that would currently succeed
+};
+
+struct MetricsTask {
+    char name[METRICS_NAME_LEN];
+    uint32_t stack_free_min;    // High-water mark: least free stack since the task started, bytes
+    float cpu_percent;          // Share of one core since the previous sample, negative if unknown
+    uint8_t priority;
+    int8_t core;                // -1 when not pinned
+};
+
+// A queue between two stages, in whatever unit it counts (slots, bytes)
+struct MetricsQueue {
+    char name[METRICS_NAME_LEN];
+    uint32_t used;
+    uint32_t capacity;
+    uint32_t high_water;        // Highest `used` seen by the queue, or at least by the samples
+    uint32_t drops;             // Items lost because the queue was full, since boot
+};
+
+// Fill in `used`, `capacity`, `drops` and, if the queue tracks it,
+// `high_water` of a registered queue. Called by sample(), from the
+// sampling task, with the other fields zeroed.
+typedef void (*metrics_queue_cb_t)(MetricsQueue* queue, void* ctx);
+
+struct MetricsSnapshot {
+    uint32_t sequence;          // +1 per sample
+    uint32_t uptime_ms;
+    uint32_t interval_ms;       // Since the previous sample, which CPU shares cover
+    MetricsHeap heap[METRICS_HEAP_COUNT];
+    uint8_t task_count;
+    uint8_t tasks_omitted;      // Tasks beyond METRICS_MAX_TASKS
+    MetricsTask tasks[METRICS_MAX_TASKS];   // Least free stack first
+    uint8_t queue_count;
+    MetricsQueue queues[METRICS_MAX_QUEUES];
+};
+
+// Samples how close the sniffer runs to its limits: heap per capability,
+// task stack high-water marks and CPU shares, and the fill level and
+// losses of every queue between the pipeline stages. One sample every
+// stats interval is enough to right-size stacks and buffers, and shows a
+// queue filling up before frames are lost.
+//
+// Task figures need configUSE_TRACE_FACILITY, CPU shares also
+// configGENERATE_RUN_TIME_STATS; without them task_count is 0.
+class MetricsSampler {
+public:
+    MetricsSampler();
+    ~MetricsSampler();
+
+    MetricsSampler(const MetricsSampler&) = delete;
+    MetricsSampler& operator=(const MetricsSampler&) = delete;
+
+    // Report a queue in every sample, in registration order. `name` is
+    // copied; `cb` is called with `ctx` from the sampling task.
+    esp_err_t add_queue(const char* name, metrics_queue_cb_t cb, void* ctx);
+
+    // Take a sample into `out` and keep a copy for latest(). CPU shares
+    // cover the time since the previous sample, whoever took it.
+    esp_err_t sample(MetricsSnapshot* out);
+
+    // Copy of the last sample; false if none was taken yet
+    bool latest(MetricsSnapshot* out) const;
+
+private:
+    struct QueueSource {
+        char name[METRICS_NAME_LEN];
+        metrics_queue_cb_t cb;
+        void* ctx;
+        uint32_t high_water;    // Highest `used` of any sample
+    };
+
+    // Fill in the task list and CPU shares; the previous task list is kept for the next delta
+    esp_err_t sample_tasks(MetricsSnapshot* out);
+
+    SemaphoreHandle_t lock;
+    QueueSource queues[METRICS_MAX_QUEUES];
+    size_t queue_count;
+
+    // Task states and total run time of the previous sample
+    TaskStatus_t* previous;
+    UBaseType_t previous_count;
+    uint32_t previous_run_time;
+    uint32_t previous_uptime_ms;
+
+    MetricsSnapshot last;
+    bool has_last;
+};
+
+// Compact binary metrics frame for the BLE link, told apart from telemetry
+// by its magic byte. It may be longer than one notification; sent with
+// BluetoothComm::send_data(), its notifications are queued together and
+// arrive back to back, so the app joins them until it has `length` bytes.
+//
+//   offset  size  field
+//   0       1     magic (METRICS_MAGIC)
+//   1       1     version (METRICS_VERSION)
+//   2       2     length of the whole frame, little endian
+//   4       2     sequence, little endian, low 16 bits
+//   6       4     uptime (ms), little endian
+//   10      4     interval (ms), little endian
+//   14      ...   per heap (internal, SPIRAM): varint total, free,
+//                 min free and largest block, in bytes
+//   ...     1     task count, then per task: 1 name length, name,
+//                 varint least free stack (bytes), 1 CPU in 0.5% steps
+//                 (255 if unknown or above), 1 priority, 1 core (255 unpinned)
+//   ...     1     queue count, then per queue: 1 name length, name,
+//                 varint used, capacity, high water and drops
+//
+// Varints are unsigned LEB128.
+#define METRICS_MAGIC           0xA8
+#define METRICS_VERSION         1
+#define METRICS_MAX_FRAME       (14 + METRICS_HEAP_COUNT * 4 * 5 + \
+                                 1 + METRICS_MAX_TASKS * (1 + METRICS_NAME_LEN - 1 + 5 + 3) + \
+                                 1 + METRICS_MAX_QUEUES * (1 + METRICS_NAME_LEN - 1 + 4 * 5))
+
+// Encode a snapshot into `out`; returns its length, or 0 if `capacity` is too small
+size_t metrics_encode(const MetricsSnapshot& snapshot, uint8_t* out, size_t capacity);
+
+// Print a snapshot as text, one line per heap, task and queue; returns the
+// length, truncated to `len` - 1
+size_t metrics_format(const MetricsSnapshot& snapshot, char* out, size_t len);
+
+// Register the `metrics` console command, printing the last sample (or a
+// fresh one if none was taken). `sampler` must outlive the console.
+esp_err_t sniffer_metrics_register_console(MetricsSampler* sampler);
@@ -0,0 +1,30 @@
+#include <stdio.h>
+#include "esp_console.h"
+#include "sniffer_metrics.h"
+
+static MetricsSampler* console_sampler;
+
+// Too large for the console task's stack
+static MetricsSnapshot console_snapshot;
+static char console_text[2048];
+
+static int metrics_command(int argc, char** argv) {
+    if (!console_sampler->latest(&console_snapshot) &&
+        console_sampler->sample(&console_snapshot) != ESP_OK) {
+        printf("ERROR: no metrics\n");
+        return 1;
+    }
+    metrics_format(console_snapshot, console_text, sizeof(console_text));
+    printf("%s\n", console_text);
+    return 0;
+}
+
+esp_err_t sniffer_metrics_register_console(MetricsSampler* sampler) {
+    console_sampler = sampler;
+
+    esp_console_cmd_t command = {};
+    command.command = "metrics";
+    command.help = "Heap, task stack and CPU, and queue fill of the last metrics sample";
+    command.func = &metrics_command;
+    return esp_console_cmd_register(&command);
+}
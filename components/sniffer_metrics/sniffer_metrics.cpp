@@ -0,0 +1,324 @@
+#include "sniffer_metrics.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+
+static const uint32_t heap_caps[METRICS_HEAP_COUNT] = { MALLOC_CAP_INTERNAL, MALLOC_CAP_SPIRAM };
+static const char* heap_names[METRICS_HEAP_COUNT] = { "internal", "spiram" };
+
+MetricsSampler::MetricsSampler()
+    : queue_count(0), previous(nullptr), previous_count(0), previous_run_time(0), previous_uptime_ms(0),
+      has_last(false) {
+    memset(&last, 0, sizeof(last));
+    lock = xSemaphoreCreateMutex();
+}
+
+MetricsSampler::~MetricsSampler() {
+    free(previous);
+    if (lock) {
+        vSemaphoreDelete(lock);
+    }
+}
+
+esp_err_t MetricsSampler::add_queue(const char* name, metrics_queue_cb_t cb, void* ctx) {
+    if (name == nullptr || cb == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t ret = ESP_ERR_NO_MEM;
+    xSemaphoreTake(lock, portMAX_DELAY);
+    if (queue_count < METRICS_MAX_QUEUES) {
+        QueueSource& source = queues[queue_count++];
+        snprintf(source.name, sizeof(source.name), "%s", name);
+        source.cb = cb;
+        source.ctx = ctx;
+        source.high_water = 0;
+        ret = ESP_OK;
+    }
+    xSemaphoreGive(lock);
+    return ret;
+}
+
+#if configUSE_TRACE_FACILITY
+
+// Run-time counter of `task` in the previous sample, 0 if it is new
+static uint32_t previous_run_time_of(const TaskStatus_t* tasks, UBaseType_t count, TaskHandle_t task) {
+    for (UBaseType_t i = 0; i < count; i++) {
+        if (tasks[i].xHandle == task) {
+            return tasks[i].ulRunTimeCounter;
+        }
+    }
+    return 0;
+}
+
+esp_err_t MetricsSampler::sample_tasks(MetricsSnapshot* out) {
+    // Room for a few tasks created while the list is being copied
+    UBaseType_t capacity = uxTaskGetNumberOfTasks() + 4;
+    TaskStatus_t* tasks = (TaskStatus_t*)malloc(capacity * sizeof(TaskStatus_t));
+    if (tasks == nullptr) {
+        return ESP_ERR_NO_MEM;
+    }
+    uint32_t total = 0;
+    UBaseType_t count = uxTaskGetSystemState(tasks, capacity, &total);
+    uint32_t interval = total - previous_run_time;
+
+    for (UBaseType_t i = 0; i < count; i++) {
+        const TaskStatus_t& status = tasks[i];
+        MetricsTask task;
+        snprintf(task.name, sizeof(task.name), "%s", status.pcTaskName);
+        task.stack_free_min = (uint32_t)status.usStackHighWaterMark * sizeof(StackType_t);
+#if configGENERATE_RUN_TIME_STATS
+        uint32_t ran = status.ulRunTimeCounter - previous_run_time_of(previous, previous_count, status.xHandle);
+        task.cpu_percent = interval ? 100.0f * ran / interval : -1.0f;
+#else
+        task.cpu_percent = -1.0f;
+#endif
+        task.priority = (uint8_t)status.uxCurrentPriority;
+#if configTASKLIST_INCLUDE_COREID
+        task.core = status.xCoreID == tskNO_AFFINITY ? -1 : (int8_t)status.xCoreID;
+#else
+        task.core = -1;
+#endif
+
+        // Insertion by least free stack; when full the task with the most headroom goes
+        size_t n = out->task_count;
+        if (n == METRICS_MAX_TASKS) {
+            out->tasks_omitted++;
+            if (task.stack_free_min >= out->tasks[n - 1].stack_free_min) {
+                continue;
+            }
+            n--;
+        }
+        while (n > 0 && out->tasks[n - 1].stack_free_min > task.stack_free_min) {
+            out->tasks[n] = out->tasks[n - 1];
+            n--;
+        }
+        out->tasks[n] = task;
+        if (out->task_count < METRICS_MAX_TASKS) {
+            out->task_count++;
+        }
+    }
+
+    // Keep this list to compute the next sample's CPU shares
+    free(previous);
+    previous = tasks;
+    previous_count = count;
+    previous_run_time = total;
+    return ESP_OK;
+}
+
+#else
+
+esp_err_t MetricsSampler::sample_tasks(MetricsSnapshot* out) {
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+#endif
+
+esp_err_t MetricsSampler::sample(MetricsSnapshot* out) {
+    if (out == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(out, 0, sizeof(*out));
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    out->sequence = last.sequence + (has_last ? 1 : 0);
+    out->uptime_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    out->interval_ms = out->uptime_ms - previous_uptime_ms;
+    previous_uptime_ms = out->uptime_ms;
+
+    for (int kind = 0; kind < METRICS_HEAP_COUNT; kind++) {
+        MetricsHeap& heap = out->heap[kind];
+        heap.total_bytes = (uint32_t)heap_caps_get_total_size(heap_caps[kind]);
+        if (heap.total_bytes == 0) {
+            continue;
+        }
+        heap.free_bytes = (uint32_t)heap_caps_get_free_size(heap_caps[kind]);
+        heap.min_free_bytes = (uint32_t)heap_caps_get_minimum_free_size(heap_caps[kind]);
+        heap.largest_block = (uint32_t)heap_caps_get_largest_free_block(heap_caps[kind]);
+    }
+
+    // Without the trace facility the sample simply has no tasks
+    esp_err_t ret = sample_tasks(out);
+    if (ret == ESP_ERR_NOT_SUPPORTED) {
+        ret = ESP_OK;
+    }
+
+    for (size_t i = 0; i < queue_count; i++) {
+        QueueSource& source = queues[i];
+        MetricsQueue& queue = out->queues[out->queue_count++];
+        memcpy(queue.name, source.name, sizeof(queue.name));
+        source.cb(&queue, source.ctx);
+        // Queues that keep no peak of their own get the highest sampled fill
+        if (queue.used > source.high_water) {
+            source.high_water = queue.used;
+        }
+        if (queue.high_water < source.high_water) {
+            queue.high_water = source.high_water;
+        }
+    }
+
+    last = *out;
+    has_last = true;
+    xSemaphoreGive(lock);
+    return ret;
+}
+
+bool MetricsSampler::latest(MetricsSnapshot* out) const {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    bool ok = has_last;
+    if (ok) {
+        *out = last;
+    }
+    xSemaphoreGive(lock);
+    return ok;
+}
+
+// Frame encoding
+
+struct FrameWriter {
+    uint8_t* out;
+    size_t capacity;
+    size_t used;
+    bool overflow;
+};
+
+static void put_byte(FrameWriter* w, uint8_t v) {
+    if (w->used < w->capacity) {
+        w->out[w->used++] = v;
+    } else {
+        w->overflow = true;
+    }
+}
+
+static void put_le(FrameWriter* w, uint32_t v, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        put_byte(w, (uint8_t)(v >> (8 * i)));
+    }
+}
+
+static void put_varint(FrameWriter* w, uint32_t v) {
+    while (v >= 0x80) {
+        put_byte(w, (uint8_t)(v | 0x80));
+        v >>= 7;
+    }
+    put_byte(w, (uint8_t)v);
+}
+
+static void put_name(FrameWriter* w, const char* name) {
+    size_t len = strnlen(name, METRICS_NAME_LEN - 1);
+    put_byte(w, (uint8_t)len);
+    for (size_t i = 0; i < len; i++) {
+        put_byte(w, (uint8_t)name[i]);
+    }
+}
+
+size_t metrics_encode(const MetricsSnapshot& snapshot, uint8_t* out, size_t capacity) {
+    FrameWriter w = { out, capacity, 0, false };
+    put_byte(&w, METRICS_MAGIC);
+    put_byte(&w, METRICS_VERSION);
+    put_le(&w, 0, 2);               // Length, filled in below
+    put_le(&w, snapshot.sequence, 2);
+    put_le(&w, snapshot.uptime_ms, 4);
+    put_le(&w, snapshot.interval_ms, 4);
+
+    for (int kind = 0; kind < METRICS_HEAP_COUNT; kind++) {
+        const MetricsHeap& heap = snapshot.heap[kind];
+        put_varint(&w, heap.total_bytes);
+        put_varint(&w, heap.free_bytes);
+        put_varint(&w, heap.min_free_bytes);
+        put_varint(&w, heap.largest_block);
+    }
+
+    put_byte(&w, snapshot.task_count);
+    for (uint8_t i = 0; i < snapshot.task_count; i++) {
+        const MetricsTask& task = snapshot.tasks[i];
+        float half_percent = task.cpu_percent * 2.0f + 0.5f;
+        put_name(&w, task.name);
+        put_varint(&w, task.stack_free_min);
+        put_byte(&w, task.cpu_percent < 0.0f || half_percent >= 255.0f ? 255 : (uint8_t)half_percent);
+        put_byte(&w, task.priority);
+        put_byte(&w, task.core < 0 ? 255 : (uint8_t)task.core);
+    }
+
+    put_byte(&w, snapshot.queue_count);
+    for (uint8_t i = 0; i < snapshot.queue_count; i++) {
+        const MetricsQueue& queue = snapshot.queues[i];
+        put_name(&w, queue.name);
+        put_varint(&w, queue.used);
+        put_varint(&w, queue.capacity);
+        put_varint(&w, queue.high_water);
+        put_varint(&w, queue.drops);
+    }
+
+    if (w.overflow || w.used > 0xFFFF) {
+        return 0;
+    }
+    out[2] = (uint8_t)w.used;
+    out[3] = (uint8_t)(w.used >> 8);
+    return w.used;
+}
+
+// Text dump
+
+// Append to `out` like snprintf; returns the new length, at most `len` - 1
+static size_t append(char* out, size_t len, size_t used, const char* format, ...)
+    __attribute__((format(printf, 4, 5)));
+
+static size_t append(char* out, size_t len, size_t used, const char* format, ...) {
+    if (used + 1 >= len) {
+        return used;
+    }
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(out + used, len - used, format, args);
+    va_end(args);
+    if (n < 0) {
+        return used;
+    }
+    return (size_t)n < len - used ? used + n : len - 1;
+}
+
+size_t metrics_format(const MetricsSnapshot& snapshot, char* out, size_t len) {
+    if (len == 0) {
+        return 0;
+    }
+    out[0] = '\0';
+    size_t used = append(out, len, 0, "Metrics %lu: uptime=%lu ms interval=%lu ms",
+                         (unsigned long)snapshot.sequence, (unsigned long)snapshot.uptime_ms,
+                         (unsigned long)snapshot.interval_ms);
+
+    for (int kind = 0; kind < METRICS_HEAP_COUNT; kind++) {
+        const MetricsHeap& heap = snapshot.heap[kind];
+        if (heap.total_bytes == 0) {
+            used = append(out, len, used, "\nHeap %s: none", heap_names[kind]);
+            continue;
+        }
+        used = append(out, len, used, "\nHeap %s: free=%lu/%lu min=%lu largest=%lu", heap_names[kind],
+                      (unsigned long)heap.free_bytes, (unsigned long)heap.total_bytes,
+                      (unsigned long)heap.min_free_bytes, (unsigned long)heap.largest_block);
+    }
+
+    for (uint8_t i = 0; i < snapshot.task_count; i++) {
+        const MetricsTask& task = snapshot.tasks[i];
+        used = append(out, len, used, "\nTask %s: stack_free=%lu prio=%u core=", task.name,
+                      (unsigned long)task.stack_free_min, (unsigned)task.priority);
+        used = task.core < 0 ? append(out, len, used, "any") : append(out, len, used, "%d", task.core);
+        if (task.cpu_percent >= 0.0f) {
+            used = append(out, len, used, " cpu=%.1f%%", task.cpu_percent);
+        }
+    }
+    if (snapshot.tasks_omitted) {
+        used = append(out, len, used, "\nTasks omitted: %u", (unsigned)snapshot.tasks_omitted);
+    }
+
+    for (uint8_t i = 0; i < snapshot.queue_count; i++) {
+        const MetricsQueue& queue = snapshot.queues[i];
+        used = append(out, len, used, "\nQueue %s: used=%lu/%lu peak=%lu drops=%lu", queue.name,
+                      (unsigned long)queue.used, (unsigned long)queue.capacity,
+                      (unsigned long)queue.high_water, (unsigned long)queue.drops);
+    }
+    return used;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// Deferred binary tracing for hot paths.
+//
+// A trace point records a fixed-size binary record (timestamp, event, tag
+// and up to SNIFFER_TRACE_MAX_ARGS integer/pointer arguments) into a RAM
+// ring; a low-priority task formats queued records through esp_log later.
+// Nothing is formatted and nothing touches the UART in the caller.
+//
+// Trace points above SNIFFER_TRACE_LEVEL are discarded at compile time by
+// an `if constexpr`: no record, no format string in flash, no argument
+// evaluation at run time. Set the level per build, e.g.
+//   target_compile_definitions(${COMPONENT_LIB} PUBLIC SNIFFER_TRACE_LEVEL=TRACE_LEVEL_DEBUG)
+//
+// Formats see every argument as a uintptr_t: use %lu/%lx for unsigned
+// values, %ld for signed ones, and %s only for strings that outlive the
+// record (literals, static tables).
+//
+//   SNIFFER_TRACE_I(TAG, "rx len=%lu rssi=%ld", frame.len, rssi);
+
+// Levels, numerically equal to esp_log_level_t
+#define TRACE_LEVEL_NONE        0
+#define TRACE_LEVEL_ERROR       1
+#define TRACE_LEVEL_WARN        2
+#define TRACE_LEVEL_INFO        3
+#define TRACE_LEVEL_DEBUG       4
+#define TRACE_LEVEL_VERBOSE     5
+
+// Most verbose level compiled in
+#ifndef SNIFFER_TRACE_LEVEL
+#define SNIFFER_TRACE_LEVEL     TRACE_LEVEL_WARN
+#endif
+
+// Records in the ring; must be a power of two
+#ifndef SNIFFER_TRACE_RECORDS
+#define SNIFFER_TRACE_RECORDS   128
+#endif
+
+#define SNIFFER_TRACE_MAX_ARGS  6
+
+// Static description of one trace point
+struct TraceEvent {
+    uint8_t level;
+    const char* format;
+};
+
+struct TraceRecord {
+    uint32_t timestamp_us;
+    const TraceEvent* event;
+    const char* tag;
+    uintptr_t args[SNIFFER_TRACE_MAX_ARGS];
+};
+
+struct TraceStats {
+    uint32_t written;           // Records queued
+    uint32_t dropped;           // Records lost because the ring was full
+    uint32_t printed;           // Records formatted by the drain task
+};
+
+// Start the drain task; safe to call more than once. Records written
+// before this are kept until the ring fills.
+esp_err_t sniffer_trace_start();
+
+TraceStats sniffer_trace_get_stats();
+
+// Queue one record; normally called through the SNIFFER_TRACE macros
+void sniffer_trace_write(const TraceEvent* event, const char* tag, const uintptr_t* args, size_t count);
+
+template <typename T>
+inline uintptr_t sniffer_trace_arg(T* value) {
+    return (uintptr_t)value;
+}
+
+template <typename T>
+inline uintptr_t sniffer_trace_arg(T value) {
+    // Sign-extend so %ld prints negative values correctly
+    return (uintptr_t)(intptr_t)value;
+}
+
+template <typename... Args>
+inline void sniffer_trace_emit(const TraceEvent* event, const char* tag, Args... args) {
+    static_assert(sizeof...(Args) <= SNIFFER_TRACE_MAX_ARGS, "Too many trace arguments");
+    const uintptr_t packed[sizeof...(Args) + 1] = { sniffer_trace_arg(args)..., 0 };
+    sniffer_trace_write(event, tag, packed, sizeof...(Args));
+}
+
+#define SNIFFER_TRACE(level, tag, format, ...)                                  \
+    do {                                                                        \
+        if constexpr ((level) <= SNIFFER_TRACE_LEVEL) {                         \
+            static const TraceEvent sniffer_trace_event_ = { (level), (format) }; \
+            sniffer_trace_emit(&sniffer_trace_event_, (tag), ##__VA_ARGS__);   \
+        }                                                                       \
+    } while (0)
+
+#define SNIFFER_TRACE_E(tag, format, ...) SNIFFER_TRACE(TRACE_LEVEL_ERROR, tag, format, ##__VA_ARGS__)
+#define SNIFFER_TRACE_W(tag, format, ...) SNIFFER_TRACE(TRACE_LEVEL_WARN, tag, format, ##__VA_ARGS__)
+#define SNIFFER_TRACE_I(tag, format, ...) SNIFFER_TRACE(TRACE_LEVEL_INFO, tag, format, ##__VA_ARGS__)
+#define SNIFFER_TRACE_D(tag, format, ...) SNIFFER_TRACE(TRACE_LEVEL_DEBUG, tag, format, ##__VA_ARGS__)
+#define SNIFFER_TRACE_V(tag, format, ...) SNIFFER_TRACE(TRACE_LEVEL_VERBOSE, tag, format, ##__VA_ARGS__)
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Multi-producer / single-consumer lock-free ring of fixed-size records.
+//
+// Every slot carries a sequence number telling whose turn it is: producers
+// reserve a slot by advancing the head with a compare-and-swap, copy the
+// record in and then bump the slot's sequence to publish it; the consumer
+// reads slots in order and hands them back by advancing the sequence a full
+// lap. Producers never block: when the ring is full the record is dropped
+// and counted, so the oldest unread records are the ones that survive.
+//
+// This header has no ESP-IDF dependencies so it can be stress-tested on a
+// Linux host with std::threads.
+template <typename T, size_t Capacity>
+class TraceRing {
+    static_assert(Capacity >= 2, "TraceRing needs at least two slots");
+    static_assert((Capacity & (Capacity - 1)) == 0, "TraceRing capacity must be a power of two");
+
+public:
+    TraceRing() : head(0), tail(0), dropped_count(0) {
+        for (size_t i = 0; i < Capacity; i++) {
+            slots[i].sequence.store((uint32_t)i, std::memory_order_relaxed);
+        }
+    }
+
+    TraceRing(const TraceRing&) = delete;
+    TraceRing& operator=(const TraceRing&) = delete;
+
+    // Producer (any task, any core): copy `record` in. Returns false, and
+    // counts a drop, if the ring is full.
+    bool push(const T& record) {
+        uint32_t pos = head.load(std::memory_order_relaxed);
+        Slot* slot;
+        while (1) {
+            slot = &slots[pos & MASK];
+            int32_t lag = (int32_t)(slot->sequence.load(std::memory_order_acquire) - pos);
+            if (lag == 0) {
+                if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (lag < 0) {
+                dropped_count.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            } else {
+                pos = head.load(std::memory_order_relaxed);
+            }
+        }
+        slot->record = record;
+        slot->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer (one task only): copy the oldest record out. Returns false if
+    // nothing is published yet.
+    bool pop(T* out) {
+        Slot& slot = slots[tail & MASK];
+        if ((int32_t)(slot.sequence.load(std::memory_order_acquire) - (tail + 1)) < 0) {
+            return false;
+        }
+        *out = slot.record;
+        slot.sequence.store(tail + (uint32_t)Capacity, std::memory_order_release);
+        tail++;
+        return true;
+    }
+
+    size_t capacity() const { return Capacity; }
+    uint32_t dropped() const { return dropped_count.load(std::memory_order_relaxed); }
+
+private:
+    static const uint32_t MASK = (uint32_t)Capacity - 1;
+
+    struct Slot {
+        std::atomic<uint32_t> sequence;
+        T record;
+    };
+
+    alignas(64) std::atomic<uint32_t> head;
+    alignas(64) uint32_t tail;
+    std::atomic<uint32_t> dropped_count;
+    Slot slots[Capacity];
+};
@@ -0,0 +1,94 @@
+#include "sniffer_trace.h"
+#include "trace_ring.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <atomic>
+#include <stdio.h>
+#include <string.h>
+
+static const char* TAG = "SNIFFER_TRACE";
+
+// Drain task parameters; it only has to keep up on average
+#define TRACE_TASK_STACK        3072
+#define TRACE_TASK_PRIORITY     1
+#define TRACE_DRAIN_PERIOD_MS   50
+
+// Longest formatted message; longer ones are cut
+#define TRACE_MESSAGE_MAX       160
+
+static TraceRing<TraceRecord, SNIFFER_TRACE_RECORDS> trace_ring;
+static std::atomic<uint32_t> written_count(0);
+static std::atomic<uint32_t> printed_count(0);
+static TaskHandle_t trace_task_handle = nullptr;
+
+static const char level_letter[] = { 'N', 'E', 'W', 'I', 'D', 'V' };
+
+void sniffer_trace_write(const TraceEvent* event, const char* tag, const uintptr_t* args, size_t count) {
+    TraceRecord record;
+    record.timestamp_us = (uint32_t)esp_timer_get_time();
+    record.event = event;
+    record.tag = tag;
+    memcpy(record.args, args, count * sizeof(uintptr_t));
+    memset(record.args + count, 0, (SNIFFER_TRACE_MAX_ARGS - count) * sizeof(uintptr_t));
+
+    if (trace_ring.push(record)) {
+        written_count.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+static void print_record(const TraceRecord& record) {
+    const TraceEvent* event = record.event;
+    const uintptr_t* a = record.args;
+    char message[TRACE_MESSAGE_MAX];
+
+    // Surplus arguments are ignored by the format
+    snprintf(message, sizeof(message), event->format, a[0], a[1], a[2], a[3], a[4], a[5]);
+
+    uint8_t level = event->level <= TRACE_LEVEL_VERBOSE ? event->level : TRACE_LEVEL_VERBOSE;
+    esp_log_write((esp_log_level_t)level, record.tag, "%c (%lu) %s: %s\n",
+                  level_letter[level], (unsigned long)(record.timestamp_us / 1000), record.tag, message);
+}
+
+static void trace_task(void* arg) {
+    uint32_t reported_drops = 0;
+    TraceRecord record;
+
+    while (1) {
+        while (trace_ring.pop(&record)) {
+            print_record(record);
+            printed_count.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        uint32_t drops = trace_ring.dropped();
+        if (drops != reported_drops) {
+            ESP_LOGW(TAG, "%lu trace records dropped", (unsigned long)(drops - reported_drops));
+            reported_drops = drops;
+        }
+
+        vTaskDelay(pdMS_TO_TICKS(TRACE_DRAIN_PERIOD_MS));
+    }
+}
+
+esp_err_t sniffer_trace_start() {
+    if (trace_task_handle) {
+        return ESP_OK;
+    }
+    if (xTaskCreate(trace_task, "sniffer_trace", TRACE_TASK_STACK, nullptr,
+                    TRACE_TASK_PRIORITY, &trace_task_handle) != pdPASS) {
+        trace_task_handle = nullptr;
+        ESP_LOGE(TAG, "Failed to create trace task");
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "Tracing up to level %d into %d records", SNIFFER_TRACE_LEVEL, SNIFFER_TRACE_RECORDS);
+    return ESP_OK;
+}
+
+TraceStats sniffer_trace_get_stats() {
+    TraceStats stats;
+    stats.written = written_count.load(std::memory_order_relaxed);
+    stats.dropped = trace_ring.dropped();
+    stats.printed = printed_count.load(std::memory_order_relaxed);
+    return stats;
+}
@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <string.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_system.h"
@@ -8,6 +9,7 @@
 #include "nvs_flash.h"
 #include "esp_netif.h"
 #include "network_sniffer.h"
+#include "sniffer_trace.h"
 #include "bluetooth_comm.h"
 
 static const char *TAG = "BLUETOOTH_SNIFFER";
@@ -19,39 +21,37 @@ BluetoothComm* g_bluetooth = nullptr;
 // Packet counter
 static uint32_t packet_count = 0;
 
-// Enhanced packet handler that sends data via Bluetooth
-void bluetooth_packet_handler(void* buf, wifi_promiscuous_pkt_type_t type) {
-    if (type != WIFI_PKT_MGMT && type != WIFI_PKT_DATA) {
-        return;
-    }
-    
-    wifi_promiscuous_pkt_t* pkt = (wifi_promiscuous_pkt_t*)buf;
+// Frame sink that sends data via Bluetooth
+void bluetooth_packet_handler(const FrameView& frame, void* ctx) {
+    BluetoothComm* bluetooth = static_cast<BluetoothComm*>(ctx);
     packet_count++;
     
     // Log packet information
-    ESP_LOGI(TAG, "Packet #%lu - Type: %d, Length: %d, Channel: %d, RSSI: %d",
-             packet_count, type, pkt->rx_ctrl.sig_len, pkt->rx_ctrl.channel, pkt->rx_ctrl.rssi);
+    SNIFFER_TRACE_I(TAG, "Packet #%lu at %lu ms - Type: %lu, Length: %lu, Channel: %lu, RSSI: %ld",
+                    packet_count, (uint32_t)(frame.timestamp_us / 1000), frame.type, frame.orig_len,
+                    frame.rx_ctrl->channel, frame.rx_ctrl->rssi);
     
     // Send packet info via Bluetooth if connected
-    if (g_bluetooth && g_bluetooth->is_connected()) {
-        esp_err_t ret = g_bluetooth->send_packet_info(
-            pkt->rx_ctrl.channel,
-            pkt->rx_ctrl.rssi,
-            pkt->rx_ctrl.sig_len,
-            type
+    if (bluetooth->is_connected()) {
+        esp_err_t ret = bluetooth->send_packet_info(
+            frame.rx_ctrl->channel,
+            frame.rx_ctrl->rssi,
+            frame.orig_len,
+            frame.type,
+            frame.timestamp_us
         );
         
         if (ret != ESP_OK) {
-            ESP_LOGW(TAG, "Failed to send packet info via Bluetooth: %s", esp_err_to_name(ret));
+            SNIFFER_TRACE_W(TAG, "Failed to send packet info via Bluetooth: %s", esp_err_to_name(ret));
         } else {
-            ESP_LOGD(TAG, "Packet info sent via Bluetooth");
+            SNIFFER_TRACE_D(TAG, "Packet info sent via Bluetooth");
         }
     }
     
     // Send packet data (first 20 bytes) if connected
-    if (g_bluetooth && g_bluetooth->is_connected() && pkt->rx_ctrl.sig_len > 0) {
-        size_t data_len = (pkt->rx_ctrl.sig_len > 20) ? 20 : pkt->rx_ctrl.sig_len;
-        g_bluetooth->send_data(pkt->payload, data_len);
+    if (bluetooth->is_connected() && frame.len > 0) {
+        size_t data_len = (frame.len > 20) ? 20 : frame.len;
+        bluetooth->send_data(frame.payload, data_len);
     }
 }
 
@@ -98,6 +98,7 @@ void app_main(void)
     // Create and initialize network sniffer
     g_sniffer = new NetworkSniffer();
     ESP_ERROR_CHECK(g_sniffer->init());
+    ESP_ERROR_CHECK(g_sniffer->add_frame_sink(bluetooth_packet_handler, g_bluetooth));
     
     // Start status reporting task
     xTaskCreate(status_task, "status_task", 4096, NULL, 5, NULL);
@@ -8,12 +8,15 @@
 #include "nvs_flash.h"
 #include "esp_netif.h"
 #include "network_sniffer.h"
+#include "channel_scheduler.h"
 
 static const char *TAG = "CHANNEL_HOPPER";
 
-// Channel hopping configuration
-#define HOP_INTERVAL_MS 5000  // 5 seconds per channel
-#define CHANNEL_COUNT 13      // 2.4GHz channels 1-13
+// Frame sink feeding channel activity to the scheduler
+static void scheduler_sink(const FrameView& frame, void* ctx) {
+    ChannelScheduler* scheduler = static_cast<ChannelScheduler*>(ctx);
+    scheduler->record_frame(frame.rx_ctrl->channel, frame.parsed ? frame.parsed->bssid : nullptr);
+}
 
 void app_main(void)
 {
@@ -35,24 +38,35 @@ void app_main(void)
     NetworkSniffer sniffer;
     ESP_ERROR_CHECK(sniffer.init());
     
-    // Start on channel 1
-    uint8_t current_channel = 1;
+    // Channels 1-13, 5 seconds per channel on average
+    static ChannelScheduler scheduler;
+    ESP_ERROR_CHECK(sniffer.add_frame_sink(scheduler_sink, &scheduler));
+    
+    HopDecision hop = scheduler.next_hop(0);
     ESP_LOGI(TAG, "Starting channel hopping sniffer");
-    ESP_ERROR_CHECK(sniffer.start_sniffing(current_channel));
+    ESP_ERROR_CHECK(sniffer.start_sniffing(hop.channel));
     
     // Channel hopping loop
     while (1) {
-        ESP_LOGI(TAG, "Currently sniffing on channel %d", current_channel);
+        ESP_LOGI(TAG, "Currently sniffing on channel %d for %lu ms", hop.channel, hop.dwell_ms);
+        
+        // Wait for the planned dwell
+        vTaskDelay(pdMS_TO_TICKS(hop.dwell_ms));
         
-        // Wait for hop interval
-        vTaskDelay(pdMS_TO_TICKS(HOP_INTERVAL_MS));
+        // Move to the next channel; busy channels get longer dwells
+        uint32_t elapsed_ms = hop.dwell_ms;
+        uint8_t previous = hop.channel;
+        hop = scheduler.next_hop(elapsed_ms);
+        ESP_LOGI(TAG, "Channel %d: %.1f frames/s, ~%.0f BSSIDs", previous,
+                 scheduler.channel_rate(previous), scheduler.channel_bssids(previous));
         
-        // Move to next channel
-        current_channel = (current_channel % CHANNEL_COUNT) + 1;
+        // Retune without restarting WiFi
+        ESP_ERROR_CHECK(sniffer.set_channel(hop.channel));
         
-        // Stop current sniffing and start on new channel
-        ESP_LOGI(TAG, "Hopping to channel %d", current_channel);
-        sniffer.stop_sniffing();
-        ESP_ERROR_CHECK(sniffer.start_sniffing(current_channel));
+        HopMetrics metrics = sniffer.get_hop_metrics();
+        uint64_t total_us = metrics.total_dwell_us + metrics.total_dead_time_us;
+        ESP_LOGI(TAG, "Hopped to channel %d in %lu us (max %lu us, coverage %.3f%%)",
+                 hop.channel, metrics.last_dead_time_us, metrics.max_dead_time_us,
+                 total_us ? 100.0 * metrics.total_dwell_us / total_us : 100.0);
     }
-} 
\ No newline at end of file
+}
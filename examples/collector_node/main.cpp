@@ -0,0 +1,101 @@
+#include <stdio.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_system.h"
+#include "esp_wifi.h"
+#include "esp_event.h"
+#include "esp_log.h"
+#include "nvs_flash.h"
+#include "esp_netif.h"
+#include "driver/uart.h"
+#include "esp_vfs_dev.h"
+#include "network_sniffer.h"
+#include "pcap_writer.h"
+
+static const char *TAG = "COLLECTOR_NODE";
+
+// One node of a multi-channel capture: flash each board with its own
+// channel and connect its stream UART to the host running sniffer_collector
+#define NODE_CHANNEL        6
+
+// Stream UART, separate from the console; adjust to your board and adapter
+#define STREAM_UART         UART_NUM_1
+#define STREAM_BAUD         2000000
+#define STREAM_PIN_TX       17
+#define STREAM_PIN_RX       16
+
+// Install the UART driver and register it with the VFS, so that the
+// writer's fopen()/fwrite() on /dev/uart/1 go through its TX buffer
+static esp_err_t open_stream_uart(void) {
+    uart_config_t uart_config = {};
+    uart_config.baud_rate = STREAM_BAUD;
+    uart_config.data_bits = UART_DATA_8_BITS;
+    uart_config.parity = UART_PARITY_DISABLE;
+    uart_config.stop_bits = UART_STOP_BITS_1;
+    uart_config.flow_ctrl = UART_HW_FLOWCTRL_DISABLE;
+    uart_config.source_clk = UART_SCLK_DEFAULT;
+
+    esp_err_t ret = uart_driver_install(STREAM_UART, 256, 16 * 1024, 0, nullptr, 0);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    ret = uart_param_config(STREAM_UART, &uart_config);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    ret = uart_set_pin(STREAM_UART, STREAM_PIN_TX, STREAM_PIN_RX, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    esp_vfs_dev_uart_use_driver(STREAM_UART);
+    return ESP_OK;
+}
+
+extern "C" void app_main(void)
+{
+    ESP_LOGI(TAG, "Collector Node Example");
+    
+    // Initialize NVS
+    esp_err_t ret = nvs_flash_init();
+    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+      ESP_ERROR_CHECK(nvs_flash_erase());
+      ret = nvs_flash_init();
+    }
+    ESP_ERROR_CHECK(ret);
+
+    // Initialize ESP-NETIF
+    ESP_ERROR_CHECK(esp_netif_init());
+    ESP_ERROR_CHECK(esp_event_loop_create_default());
+
+    ESP_ERROR_CHECK(open_stream_uart());
+
+    // Create sniffer
+    static NetworkSniffer sniffer;
+    ESP_ERROR_CHECK(sniffer.init());
+
+    // The UART carries about 200 KB/s; leave out control frames to stay within it
+    ESP_ERROR_CHECK(sniffer.set_filter("type mgmt or type data"));
+    
+    // Stream to the UART; repeat the section header every 10 s so that a
+    // collector started after the node syncs up
+    static PcapWriter writer;
+    PcapWriterConfig config = pcap_writer_default_config();
+    config.path_prefix = "/dev/uart/1";
+    config.extension = nullptr;
+    config.buffer_size = 8 * 1024;
+    config.max_file_seconds = 10;
+    config.flush_ms = 100;
+    ESP_ERROR_CHECK(writer.start(config));
+    ESP_ERROR_CHECK(sniffer.add_frame_sink(&writer));
+    
+    ESP_LOGI(TAG, "Starting sniffing on channel %d", NODE_CHANNEL);
+    ESP_ERROR_CHECK(sniffer.start_sniffing(NODE_CHANNEL));
+    
+    // Keep running
+    while (1) {
+        PcapWriterStats stats = writer.get_stats();
+        ESP_LOGI(TAG, "Streamed: Frames=%lu, Dropped=%lu, Bytes=%llu, Write errors=%lu",
+                stats.frames, stats.dropped, stats.bytes, stats.write_errors);
+        vTaskDelay(pdMS_TO_TICKS(10000)); // Log every 10 seconds
+    }
+}
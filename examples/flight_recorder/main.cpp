@@ -0,0 +1,148 @@
+#include <stdio.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_system.h"
+#include "esp_wifi.h"
+#include "esp_event.h"
+#include "esp_log.h"
+#include "nvs_flash.h"
+#include "esp_netif.h"
+#include "esp_vfs_fat.h"
+#include "sdmmc_cmd.h"
+#include "driver/gpio.h"
+#include "driver/sdspi_host.h"
+#include "burst_trigger.h"
+#include "flight_recorder.h"
+#include "network_sniffer.h"
+#include "pcap_writer.h"
+
+static const char *TAG = "FLIGHT_RECORDER_EXAMPLE";
+
+// SD card on the SPI bus; adjust to your board
+#define SD_MOUNT_POINT  "/sdcard"
+#define SD_PIN_MOSI     23
+#define SD_PIN_MISO     19
+#define SD_PIN_CLK      18
+#define SD_PIN_CS       5
+
+// Pressing the BOOT button saves a snapshot too
+#define BUTTON_PIN      GPIO_NUM_0
+
+// Mount the SD card as a FAT file system
+static esp_err_t mount_sd_card(void) {
+    esp_vfs_fat_sdmmc_mount_config_t mount_config = {};
+    mount_config.format_if_mount_failed = false;
+    mount_config.max_files = 4;
+    mount_config.allocation_unit_size = 16 * 1024;
+
+    sdmmc_host_t host = SDSPI_HOST_DEFAULT();
+    spi_bus_config_t bus_config = {};
+    bus_config.mosi_io_num = SD_PIN_MOSI;
+    bus_config.miso_io_num = SD_PIN_MISO;
+    bus_config.sclk_io_num = SD_PIN_CLK;
+    bus_config.quadwp_io_num = -1;
+    bus_config.quadhd_io_num = -1;
+    bus_config.max_transfer_sz = 16 * 1024;
+    esp_err_t ret = spi_bus_initialize((spi_host_device_t)host.slot, &bus_config, SDSPI_DEFAULT_DMA);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    sdspi_device_config_t slot_config = SDSPI_DEVICE_CONFIG_DEFAULT();
+    slot_config.gpio_cs = (gpio_num_t)SD_PIN_CS;
+    slot_config.host_id = (spi_host_device_t)host.slot;
+
+    sdmmc_card_t* card;
+    return esp_vfs_fat_sdspi_mount(SD_MOUNT_POINT, &host, &slot_config, &mount_config, &card);
+}
+
+// Each snapshot goes to its own file, <mount>/snap<id>_0000.pcapng
+static PcapWriter writer;
+
+static bool snapshot_begin(const RecorderSnapshot& snapshot, void* ctx) {
+    static char prefix[32];
+    snprintf(prefix, sizeof(prefix), SD_MOUNT_POINT "/snap%03lu", snapshot.id);
+    PcapWriterConfig config = pcap_writer_default_config();
+    config.path_prefix = prefix;
+    config.max_file_bytes = 0;
+    ESP_LOGI(TAG, "Saving snapshot %lu (%s)", snapshot.id, snapshot.reason);
+    return writer.start(config) == ESP_OK;
+}
+
+// Returning false while both buffers are full makes the recorder wait for the card
+static bool snapshot_frame(const FrameView& frame, void* ctx) {
+    return writer.write_frame(frame);
+}
+
+static void snapshot_end(const RecorderSnapshot& snapshot, uint32_t frames, void* ctx) {
+    writer.stop();
+    ESP_LOGI(TAG, "Snapshot %lu saved: %lu frames", snapshot.id, frames);
+}
+
+extern "C" void app_main(void)
+{
+    ESP_LOGI(TAG, "Flight Recorder Example");
+    
+    // Initialize NVS
+    esp_err_t ret = nvs_flash_init();
+    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+      ESP_ERROR_CHECK(nvs_flash_erase());
+      ret = nvs_flash_init();
+    }
+    ESP_ERROR_CHECK(ret);
+
+    // Initialize ESP-NETIF
+    ESP_ERROR_CHECK(esp_netif_init());
+    ESP_ERROR_CHECK(esp_event_loop_create_default());
+
+    ESP_ERROR_CHECK(mount_sd_card());
+    ESP_LOGI(TAG, "SD card mounted at %s", SD_MOUNT_POINT);
+
+    gpio_set_direction(BUTTON_PIN, GPIO_MODE_INPUT);
+    gpio_set_pull_mode(BUTTON_PIN, GPIO_PULLUP_ONLY);
+
+    // Create sniffer
+    static NetworkSniffer sniffer;
+    ESP_ERROR_CHECK(sniffer.init());
+    
+    // Keep the last 10 seconds; a burst of 10 deauthentication or
+    // disassociation frames within a second saves them and the 2 seconds after
+    static FlightRecorder recorder;
+    static BurstTrigger deauth;
+    char error[64];
+    if (!deauth.configure("subtype deauth or subtype disassoc", 10, 1000, error, sizeof(error))) {
+        ESP_LOGE(TAG, "Invalid trigger: %s", error);
+        return;
+    }
+    ESP_ERROR_CHECK(recorder.add_trigger(&deauth, "deauth burst"));
+    RecorderExporter exporter = {};
+    exporter.begin = snapshot_begin;
+    exporter.frame = snapshot_frame;
+    exporter.end = snapshot_end;
+    recorder.set_exporter(exporter);
+    ESP_ERROR_CHECK(recorder.start());
+    ESP_ERROR_CHECK(sniffer.add_frame_sink(&recorder));
+    
+    ESP_LOGI(TAG, "Starting sniffing on channel 6");
+    ESP_ERROR_CHECK(sniffer.start_sniffing(6));
+    
+    // Poll the button, log every 10 seconds
+    int ticks = 0;
+    bool pressed = false;
+    while (1) {
+        bool down = gpio_get_level(BUTTON_PIN) == 0;
+        if (down && !pressed) {
+            recorder.trigger("button");
+        }
+        pressed = down;
+
+        if (++ticks == 100) {
+            ticks = 0;
+            FlightRecorderStats stats = recorder.get_stats();
+            ESP_LOGI(TAG, "Recorder: Recorded=%lu, Overwritten=%lu, Used=%lu/%lu, Triggers=%lu, Suppressed=%lu, Snapshots=%lu",
+                    stats.recorded, stats.overwritten, stats.ring_used, stats.ring_bytes,
+                    stats.triggers, stats.suppressed, stats.snapshots);
+        }
+        vTaskDelay(pdMS_TO_TICKS(100));
+    }
+}
@@ -0,0 +1,95 @@
+#include <stdio.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_system.h"
+#include "esp_wifi.h"
+#include "esp_event.h"
+#include "esp_log.h"
+#include "nvs_flash.h"
+#include "esp_netif.h"
+#include "esp_vfs_fat.h"
+#include "sdmmc_cmd.h"
+#include "driver/sdspi_host.h"
+#include "network_sniffer.h"
+#include "pcap_writer.h"
+
+static const char *TAG = "PCAP_CAPTURE";
+
+// SD card on the SPI bus; adjust to your board
+#define SD_MOUNT_POINT  "/sdcard"
+#define SD_PIN_MOSI     23
+#define SD_PIN_MISO     19
+#define SD_PIN_CLK      18
+#define SD_PIN_CS       5
+
+// Mount the SD card as a FAT file system
+static esp_err_t mount_sd_card(void) {
+    esp_vfs_fat_sdmmc_mount_config_t mount_config = {};
+    mount_config.format_if_mount_failed = false;
+    mount_config.max_files = 4;
+    mount_config.allocation_unit_size = 16 * 1024;
+
+    sdmmc_host_t host = SDSPI_HOST_DEFAULT();
+    spi_bus_config_t bus_config = {};
+    bus_config.mosi_io_num = SD_PIN_MOSI;
+    bus_config.miso_io_num = SD_PIN_MISO;
+    bus_config.sclk_io_num = SD_PIN_CLK;
+    bus_config.quadwp_io_num = -1;
+    bus_config.quadhd_io_num = -1;
+    bus_config.max_transfer_sz = 16 * 1024;
+    esp_err_t ret = spi_bus_initialize((spi_host_device_t)host.slot, &bus_config, SDSPI_DEFAULT_DMA);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    sdspi_device_config_t slot_config = SDSPI_DEVICE_CONFIG_DEFAULT();
+    slot_config.gpio_cs = (gpio_num_t)SD_PIN_CS;
+    slot_config.host_id = (spi_host_device_t)host.slot;
+
+    sdmmc_card_t* card;
+    return esp_vfs_fat_sdspi_mount(SD_MOUNT_POINT, &host, &slot_config, &mount_config, &card);
+}
+
+extern "C" void app_main(void)
+{
+    ESP_LOGI(TAG, "PCAPNG Capture Example");
+    
+    // Initialize NVS
+    esp_err_t ret = nvs_flash_init();
+    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+      ESP_ERROR_CHECK(nvs_flash_erase());
+      ret = nvs_flash_init();
+    }
+    ESP_ERROR_CHECK(ret);
+
+    // Initialize ESP-NETIF
+    ESP_ERROR_CHECK(esp_netif_init());
+    ESP_ERROR_CHECK(esp_event_loop_create_default());
+
+    ESP_ERROR_CHECK(mount_sd_card());
+    ESP_LOGI(TAG, "SD card mounted at %s", SD_MOUNT_POINT);
+
+    // Create sniffer
+    static NetworkSniffer sniffer;
+    ESP_ERROR_CHECK(sniffer.init());
+    
+    // Write 8 MB or 10 minute files, whichever comes first
+    static PcapWriter writer;
+    PcapWriterConfig config = pcap_writer_default_config();
+    config.path_prefix = SD_MOUNT_POINT "/cap";
+    config.max_file_bytes = 8 * 1024 * 1024;
+    config.max_file_seconds = 600;
+    ESP_ERROR_CHECK(writer.start(config));
+    ESP_ERROR_CHECK(sniffer.add_frame_sink(&writer));
+    
+    ESP_LOGI(TAG, "Starting sniffing on channel 6");
+    ESP_ERROR_CHECK(sniffer.start_sniffing(6));
+    
+    // Keep running
+    while (1) {
+        PcapWriterStats stats = writer.get_stats();
+        ESP_LOGI(TAG, "Written: Frames=%lu, Dropped=%lu, Files=%lu, Bytes=%llu, Write errors=%lu",
+                stats.frames, stats.dropped, stats.files, stats.bytes, stats.write_errors);
+        vTaskDelay(pdMS_TO_TICKS(10000)); // Log every 10 seconds
+    }
+}
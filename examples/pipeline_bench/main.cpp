@@ -0,0 +1,27 @@
+#include <stdio.h>
+#include "esp_console.h"
+#include "esp_system.h"
+#include "esp_log.h"
+#include "pipeline_bench.h"
+
+static const char *TAG = "PIPELINE_BENCH_EXAMPLE";
+
+extern "C" void app_main(void)
+{
+    ESP_LOGI(TAG, "Pipeline Benchmark Example");
+    ESP_LOGI(TAG, "Free heap: %lu bytes", esp_get_free_heap_size());
+
+    // Console on the default UART; the benchmark runs in the console task
+    esp_console_repl_t* repl = nullptr;
+    esp_console_repl_config_t repl_config = ESP_CONSOLE_REPL_CONFIG_DEFAULT();
+    repl_config.prompt = "bench>";
+    repl_config.task_stack_size = 8192;
+    esp_console_dev_uart_config_t uart_config = ESP_CONSOLE_DEV_UART_CONFIG_DEFAULT();
+    ESP_ERROR_CHECK(esp_console_new_repl_uart(&uart_config, &repl_config, &repl));
+
+    ESP_ERROR_CHECK(esp_console_register_help_command());
+    ESP_ERROR_CHECK(pipeline_bench_register_console());
+
+    // Try: pipeline_bench, or pipeline_bench -t 5000 -f "type data" 10000 50000 0
+    ESP_ERROR_CHECK(esp_console_start_repl(repl));
+}
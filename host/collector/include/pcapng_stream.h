@@ -0,0 +1,106 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+// One Enhanced Packet Block as read from a stream
+struct StreamPacket {
+    uint32_t section;               // Section it belongs to, counted from 1
+    uint32_t interface_id;          // Interface within the section
+    uint16_t linktype;
+    uint64_t timestamp_us;          // Converted from the interface's resolution
+    const uint8_t* data;            // Valid until the next call to feed()
+    uint32_t captured;
+    uint32_t orig_len;
+};
+
+struct StreamReaderStats {
+    uint64_t bytes;                 // Bytes fed
+    uint64_t skipped_bytes;         // Bytes outside any section: boot log, line noise, torn blocks
+    uint32_t sections;              // Section headers read
+    uint32_t resyncs;               // Times a bad block made the reader search for the next section header
+    uint64_t packets;               // Enhanced Packet Blocks returned
+    uint64_t unknown_interface;     // Packets for an interface the section does not describe; skipped
+};
+
+// Incremental PCAPNG reader for a byte stream that can start, stop and be
+// interrupted anywhere, such as a sniffer's UART or socket.
+//
+// Bytes are fed as they arrive and complete blocks are read out of them.
+// Until the first Section Header Block, and after any block that does not
+// look valid (bad length, trailer mismatch), the reader discards bytes up
+// to the next section header, so a board reset mid-stream, with its boot
+// log, costs the frames in flight and nothing more. Each section carries
+// its own byte order and interfaces; blocks other than interface
+// descriptions and enhanced packets are skipped.
+class PcapngStreamReader {
+public:
+    PcapngStreamReader();
+
+    // Append received bytes; invalidates the data of returned packets
+    void feed(const uint8_t* data, size_t len);
+
+    // Next complete packet, or false until more bytes are fed
+    bool next(StreamPacket* packet);
+
+    // True inside a section, false while searching for a section header
+    bool in_sync() const { return synced; }
+
+    const StreamReaderStats& get_stats() const { return stats; }
+
+private:
+    struct Interface {
+        uint16_t linktype;
+        uint64_t ticks_per_second;
+    };
+
+    bool sync();
+    void lose_sync();
+
+    uint16_t get16(const uint8_t* p) const;
+    uint32_t get32(const uint8_t* p) const;
+
+    std::vector<uint8_t> buffer;
+    size_t head;                    // First unread byte of `buffer`
+    bool synced;
+    bool swapped;                   // Section byte order differs from the host's
+    std::vector<Interface> interfaces;
+    StreamReaderStats stats;
+};
+
+// PCAPNG file writer with any number of interfaces in one section, each
+// with a name, as the collector's merged output.
+class PcapngFileWriter {
+public:
+    PcapngFileWriter();
+    ~PcapngFileWriter();
+
+    PcapngFileWriter(const PcapngFileWriter&) = delete;
+    PcapngFileWriter& operator=(const PcapngFileWriter&) = delete;
+
+    // Create the file and write the section header
+    bool open(const char* path);
+
+    // Write an Interface Description Block; returns its interface id.
+    // Timestamps are in microseconds.
+    uint32_t add_interface(uint16_t linktype, uint32_t snaplen, const char* name);
+
+    // Write an Enhanced Packet Block
+    bool write_packet(uint32_t interface_id, uint64_t timestamp_us, const uint8_t* data, uint32_t captured,
+                      uint32_t orig_len);
+
+    // Flush and close; false if any write failed
+    bool close();
+
+    uint64_t bytes() const { return written; }
+
+private:
+    bool write(const void* data, size_t len);
+
+    FILE* file;
+    uint32_t interfaces;
+    uint64_t written;
+    bool failed;
+};
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <queue>
+#include <string>
+#include <vector>
+
+struct MergerConfig {
+    uint32_t reorder_us;            // Reorder window: how far back in time a node's frames may arrive
+    uint32_t max_lag_us;            // A node silent this long stops holding back the merge
+    size_t max_buffered;            // Frames held at most; beyond this release() writes the oldest regardless
+};
+
+// Default config: 100 ms reorder window, 2 s lag, 200000 frames
+MergerConfig merger_default_config();
+
+// Per-node counters
+struct MergerNodeStats {
+    uint64_t frames;                // Frames pushed
+    uint64_t bytes;                 // Captured bytes pushed
+    uint64_t out_of_order;          // Frames older than one the node sent before them
+    uint64_t late;                  // Frames older than the merge had already written; dropped
+    uint64_t newest_us;             // Newest timestamp seen from the node
+    uint64_t lag_us;                // How far newest_us trails the newest timestamp of all nodes
+    uint64_t max_lag_us;
+    bool stalled;                   // Silent for max_lag_us; not holding back the merge
+    bool closed;
+};
+
+struct MergerStats {
+    uint64_t pushed;
+    uint64_t emitted;
+    uint64_t late;
+    uint64_t forced;                // Frames written early because max_buffered was reached
+    size_t buffered;
+    size_t peak_buffered;
+};
+
+// One frame leaving the merge, in timestamp order
+struct MergedFrame {
+    uint64_t timestamp_us;
+    uint32_t node;
+    uint32_t interface_id;          // As given to push()
+    const uint8_t* data;            // Valid during the emit callback only
+    uint32_t captured;
+    uint32_t orig_len;
+};
+
+typedef void (*merger_emit_t)(const MergedFrame& frame, void* ctx);
+
+// K-way merge of per-node frame streams into one timestamp-ordered stream.
+//
+// Frames wait in a min-heap on (timestamp, arrival). The oldest frame is
+// released once it can no longer be preceded: every node still feeding
+// the merge has sent a frame at least `reorder_us` newer than it. So each
+// node's stream may be out of order by up to the reorder window, and a
+// node that delivers in bursts (a UART buffer, a flush interval) holds
+// the merge back until its burst arrives, but at most `max_lag_us` of
+// wall time: a node silent for longer no longer counts until it sends
+// again. A frame older than one already released is late; it is dropped
+// and counted against its node, so the output stays ordered.
+//
+// Frame data is copied into reusable slots; after warm-up pushes do not
+// allocate. Not thread-safe: one thread pushes and releases.
+class StreamMerger {
+public:
+    explicit StreamMerger(const MergerConfig& config = merger_default_config());
+
+    // Register a node; returns its index. `now_us` starts its lag clock.
+    uint32_t add_node(const char* name, uint64_t now_us);
+
+    // The node will send nothing more and no longer holds back the merge
+    void close_node(uint32_t node);
+
+    // Queue a frame; false if it was late and dropped. `now_us` is the
+    // arrival time on any monotonic clock used consistently.
+    bool push(uint32_t node, uint64_t timestamp_us, uint32_t interface_id, const uint8_t* data,
+              uint32_t captured, uint32_t orig_len, uint64_t now_us);
+
+    // Emit every frame that is due; returns the count
+    size_t release(uint64_t now_us, merger_emit_t emit, void* ctx);
+
+    // Emit everything still queued, at shutdown
+    size_t flush(merger_emit_t emit, void* ctx);
+
+    size_t node_count() const { return nodes.size(); }
+    const char* node_name(uint32_t node) const { return nodes[node].name.c_str(); }
+    const MergerNodeStats& node_stats(uint32_t node) const { return nodes[node].stats; }
+    const MergerStats& get_stats() const { return stats; }
+
+private:
+    struct Node {
+        std::string name;
+        uint64_t last_arrival_us;   // Wall time of the last push, or of add_node()
+        bool seen;                  // Has pushed a frame
+        MergerNodeStats stats;
+    };
+
+    struct Entry {
+        uint64_t timestamp_us;
+        uint64_t sequence;          // Arrival order, breaks ties so equal timestamps keep it
+        uint32_t slot;
+        uint32_t node;
+        uint32_t interface_id;
+        uint32_t captured;
+        uint32_t orig_len;
+
+        // Greater, for a min-heap with std::priority_queue
+        bool operator<(const Entry& other) const {
+            return timestamp_us != other.timestamp_us ? timestamp_us > other.timestamp_us
+                                                      : sequence > other.sequence;
+        }
+    };
+
+    // Newest timestamp that may be released, given the open nodes; also updates their lag
+    uint64_t watermark(uint64_t now_us);
+    void emit_top(merger_emit_t emit, void* ctx);
+
+    MergerConfig cfg;
+    std::vector<Node> nodes;
+    std::priority_queue<Entry> heap;
+    std::vector<std::vector<uint8_t>> slots;
+    std::vector<uint32_t> free_slots;
+    uint64_t sequence;
+    uint64_t newest_us;             // Newest timestamp of all nodes
+    uint64_t emitted_us;            // Timestamp of the last frame released
+    bool any_emitted;
+    MergerStats stats;
+};
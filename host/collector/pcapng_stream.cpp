@@ -0,0 +1,271 @@
+#include "pcapng_stream.h"
+#include <string.h>
+
+#define PCAPNG_BLOCK_SHB            0x0A0D0D0A
+#define PCAPNG_BLOCK_IDB            0x00000001
+#define PCAPNG_BLOCK_EPB            0x00000006
+#define PCAPNG_BYTE_ORDER_MAGIC     0x1A2B3C4D
+#define PCAPNG_OPTION_END           0
+#define PCAPNG_OPTION_IF_NAME       2
+#define PCAPNG_OPTION_TSRESOL       9
+
+// Largest block accepted; anything bigger is taken as corruption
+#define STREAM_MAX_BLOCK            (256 * 1024)
+
+// Block type, length and byte-order magic: enough to recognize a section header
+#define STREAM_SHB_PREFIX           12
+
+PcapngStreamReader::PcapngStreamReader() : head(0), synced(false), swapped(false), stats() {
+}
+
+uint16_t PcapngStreamReader::get16(const uint8_t* p) const {
+    uint16_t v;
+    memcpy(&v, p, 2);
+    return swapped ? __builtin_bswap16(v) : v;
+}
+
+uint32_t PcapngStreamReader::get32(const uint8_t* p) const {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return swapped ? __builtin_bswap32(v) : v;
+}
+
+void PcapngStreamReader::feed(const uint8_t* data, size_t len) {
+    // Drop what has been read before appending, so the buffer stays about one block long
+    if (head > 0) {
+        buffer.erase(buffer.begin(), buffer.begin() + head);
+        head = 0;
+    }
+    buffer.insert(buffer.end(), data, data + len);
+    stats.bytes += len;
+}
+
+void PcapngStreamReader::lose_sync() {
+    synced = false;
+    interfaces.clear();
+    stats.resyncs++;
+    // Skip a byte so the search does not find the same section header again
+    head++;
+    stats.skipped_bytes++;
+}
+
+bool PcapngStreamReader::sync() {
+    // The block type reads the same in both byte orders; the magic after it tells them apart
+    static const uint8_t shb[4] = { 0x0A, 0x0D, 0x0D, 0x0A };
+    size_t end = buffer.size();
+    for (size_t i = head; i + STREAM_SHB_PREFIX <= end; i++) {
+        if (memcmp(&buffer[i], shb, 4) != 0) {
+            continue;
+        }
+        uint32_t magic;
+        memcpy(&magic, &buffer[i + 8], 4);
+        if (magic == PCAPNG_BYTE_ORDER_MAGIC || magic == __builtin_bswap32(PCAPNG_BYTE_ORDER_MAGIC)) {
+            stats.skipped_bytes += i - head;
+            head = i;
+            synced = true;
+            return true;
+        }
+    }
+    // Keep a tail that may hold the start of a section header
+    size_t keep = end - head < STREAM_SHB_PREFIX - 1 ? end - head : STREAM_SHB_PREFIX - 1;
+    stats.skipped_bytes += end - head - keep;
+    head = end - keep;
+    return false;
+}
+
+bool PcapngStreamReader::next(StreamPacket* packet) {
+    while (true) {
+        if (!synced && !sync()) {
+            return false;
+        }
+        size_t available = buffer.size() - head;
+        if (available < STREAM_SHB_PREFIX) {
+            return false;
+        }
+        const uint8_t* block = &buffer[head];
+
+        uint32_t type;
+        memcpy(&type, block, 4);
+        if (type == PCAPNG_BLOCK_SHB) {
+            uint32_t magic;
+            memcpy(&magic, block + 8, 4);
+            swapped = magic != PCAPNG_BYTE_ORDER_MAGIC;
+        } else {
+            type = get32(block);
+        }
+        uint32_t total = get32(block + 4);
+        if (total < 12 || total > STREAM_MAX_BLOCK || (total & 3) != 0) {
+            lose_sync();
+            continue;
+        }
+        if (available < total) {
+            return false;
+        }
+        if (get32(block + total - 4) != total) {
+            // Torn block: the sender restarted or bytes were lost
+            lose_sync();
+            continue;
+        }
+        head += total;
+
+        const uint8_t* body = block + 8;
+        uint32_t body_len = total - 12;
+        if (type == PCAPNG_BLOCK_SHB) {
+            interfaces.clear();
+            stats.sections++;
+        } else if (type == PCAPNG_BLOCK_IDB && body_len >= 8) {
+            Interface iface;
+            iface.linktype = get16(body);
+            iface.ticks_per_second = 1000000;
+            // Options: code, length, value padded to 32 bits
+            size_t offset = 8;
+            while (offset + 4 <= body_len) {
+                uint16_t code = get16(body + offset);
+                uint16_t len = get16(body + offset + 2);
+                if (code == PCAPNG_OPTION_END || offset + 4 + len > body_len) {
+                    break;
+                }
+                if (code == PCAPNG_OPTION_TSRESOL && len >= 1) {
+                    uint8_t resol = body[offset + 4];
+                    uint64_t ticks = 1;
+                    for (uint8_t i = 0; i < (resol & 0x7F) && ticks < (1ull << 60); i++) {
+                        ticks *= (resol & 0x80) ? 2 : 10;
+                    }
+                    iface.ticks_per_second = ticks;
+                }
+                offset += 4 + ((len + 3) & ~3u);
+            }
+            interfaces.push_back(iface);
+        } else if (type == PCAPNG_BLOCK_EPB && body_len >= 20) {
+            uint32_t interface_id = get32(body);
+            uint32_t captured = get32(body + 12);
+            if (20 + (uint64_t)captured > body_len) {
+                lose_sync();
+                continue;
+            }
+            if (interface_id >= interfaces.size()) {
+                stats.unknown_interface++;
+                continue;
+            }
+            const Interface& iface = interfaces[interface_id];
+            uint64_t ticks = ((uint64_t)get32(body + 4) << 32) | get32(body + 8);
+            packet->section = stats.sections;
+            packet->interface_id = interface_id;
+            packet->linktype = iface.linktype;
+            packet->timestamp_us = ticks / iface.ticks_per_second * 1000000 +
+                                   ticks % iface.ticks_per_second * 1000000 / iface.ticks_per_second;
+            packet->data = body + 20;
+            packet->captured = captured;
+            packet->orig_len = get32(body + 16);
+            stats.packets++;
+            return true;
+        }
+    }
+}
+
+static inline uint8_t* put16(uint8_t* p, uint16_t v) {
+    memcpy(p, &v, 2);
+    return p + 2;
+}
+
+static inline uint8_t* put32(uint8_t* p, uint32_t v) {
+    memcpy(p, &v, 4);
+    return p + 4;
+}
+
+PcapngFileWriter::PcapngFileWriter() : file(nullptr), interfaces(0), written(0), failed(false) {
+}
+
+PcapngFileWriter::~PcapngFileWriter() {
+    close();
+}
+
+bool PcapngFileWriter::write(const void* data, size_t len) {
+    if (fwrite(data, 1, len, file) != len) {
+        failed = true;
+        return false;
+    }
+    written += len;
+    return true;
+}
+
+bool PcapngFileWriter::open(const char* path) {
+    file = fopen(path, "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    setvbuf(file, nullptr, _IOFBF, 256 * 1024);
+    interfaces = 0;
+    written = 0;
+    failed = false;
+
+    // Native byte order, section length unknown
+    uint8_t shb[28];
+    uint8_t* p = put32(shb, PCAPNG_BLOCK_SHB);
+    p = put32(p, sizeof(shb));
+    p = put32(p, PCAPNG_BYTE_ORDER_MAGIC);
+    p = put16(p, 1);
+    p = put16(p, 0);
+    p = put32(p, UINT32_MAX);
+    p = put32(p, UINT32_MAX);
+    put32(p, sizeof(shb));
+    return write(shb, sizeof(shb));
+}
+
+uint32_t PcapngFileWriter::add_interface(uint16_t linktype, uint32_t snaplen, const char* name) {
+    size_t name_len = name ? strlen(name) : 0;
+    if (name_len > 255) {
+        name_len = 255;
+    }
+    size_t name_option = name_len ? 4 + ((name_len + 3) & ~(size_t)3) : 0;
+    uint32_t total = (uint32_t)(20 + name_option + (name_option ? 4 : 0));
+
+    uint8_t block[20 + 4 + 256 + 4];
+    memset(block, 0, sizeof(block));
+    uint8_t* p = put32(block, PCAPNG_BLOCK_IDB);
+    p = put32(p, total);
+    p = put16(p, linktype);
+    p = put16(p, 0);
+    p = put32(p, snaplen);
+    if (name_option) {
+        p = put16(p, PCAPNG_OPTION_IF_NAME);
+        p = put16(p, (uint16_t)name_len);
+        memcpy(p, name, name_len);
+        p += name_option - 4;
+        p = put16(p, PCAPNG_OPTION_END);
+        p = put16(p, 0);
+    }
+    put32(p, total);
+    write(block, total);
+    return interfaces++;
+}
+
+bool PcapngFileWriter::write_packet(uint32_t interface_id, uint64_t timestamp_us, const uint8_t* data,
+                                    uint32_t captured, uint32_t orig_len) {
+    uint32_t padded = (captured + 3) & ~3u;
+    uint32_t total = 32 + padded;
+
+    uint8_t header[28];
+    uint8_t* p = put32(header, PCAPNG_BLOCK_EPB);
+    p = put32(p, total);
+    p = put32(p, interface_id);
+    p = put32(p, (uint32_t)(timestamp_us >> 32));
+    p = put32(p, (uint32_t)timestamp_us);
+    p = put32(p, captured);
+    put32(p, orig_len);
+
+    static const uint8_t zeros[4] = {};
+    return write(header, sizeof(header)) && write(data, captured) && write(zeros, padded - captured) &&
+           write(&total, sizeof(total));
+}
+
+bool PcapngFileWriter::close() {
+    if (file == nullptr) {
+        return !failed;
+    }
+    if (fclose(file) != 0) {
+        failed = true;
+    }
+    file = nullptr;
+    return !failed;
+}
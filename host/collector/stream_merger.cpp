@@ -0,0 +1,154 @@
+#include "stream_merger.h"
+
+MergerConfig merger_default_config() {
+    MergerConfig config;
+    config.reorder_us = 100000;
+    config.max_lag_us = 2000000;
+    config.max_buffered = 200000;
+    return config;
+}
+
+StreamMerger::StreamMerger(const MergerConfig& config)
+    : cfg(config), sequence(0), newest_us(0), emitted_us(0), any_emitted(false), stats() {
+}
+
+uint32_t StreamMerger::add_node(const char* name, uint64_t now_us) {
+    Node node;
+    node.name = name;
+    node.last_arrival_us = now_us;
+    node.seen = false;
+    node.stats = MergerNodeStats();
+    nodes.push_back(node);
+    return (uint32_t)(nodes.size() - 1);
+}
+
+void StreamMerger::close_node(uint32_t node) {
+    nodes[node].stats.closed = true;
+}
+
+bool StreamMerger::push(uint32_t node, uint64_t timestamp_us, uint32_t interface_id, const uint8_t* data,
+                        uint32_t captured, uint32_t orig_len, uint64_t now_us) {
+    Node& source = nodes[node];
+    MergerNodeStats& counters = source.stats;
+    counters.frames++;
+    counters.bytes += captured;
+    source.last_arrival_us = now_us;
+    counters.stalled = false;
+
+    if (source.seen && timestamp_us < counters.newest_us) {
+        counters.out_of_order++;
+    }
+    if (!source.seen || timestamp_us > counters.newest_us) {
+        counters.newest_us = timestamp_us;
+    }
+    source.seen = true;
+    if (timestamp_us > newest_us) {
+        newest_us = timestamp_us;
+    }
+    stats.pushed++;
+
+    if (any_emitted && timestamp_us < emitted_us) {
+        counters.late++;
+        stats.late++;
+        return false;
+    }
+
+    uint32_t slot;
+    if (free_slots.empty()) {
+        slot = (uint32_t)slots.size();
+        slots.emplace_back();
+    } else {
+        slot = free_slots.back();
+        free_slots.pop_back();
+    }
+    slots[slot].assign(data, data + captured);
+
+    Entry entry;
+    entry.timestamp_us = timestamp_us;
+    entry.sequence = sequence++;
+    entry.slot = slot;
+    entry.node = node;
+    entry.interface_id = interface_id;
+    entry.captured = captured;
+    entry.orig_len = orig_len;
+    heap.push(entry);
+
+    stats.buffered = heap.size();
+    if (stats.buffered > stats.peak_buffered) {
+        stats.peak_buffered = stats.buffered;
+    }
+    return true;
+}
+
+uint64_t StreamMerger::watermark(uint64_t now_us) {
+    // With every node closed or stalled nothing holds the merge back
+    uint64_t limit = UINT64_MAX;
+    for (Node& node : nodes) {
+        MergerNodeStats& counters = node.stats;
+        if (counters.closed) {
+            continue;
+        }
+        counters.stalled = now_us - node.last_arrival_us > cfg.max_lag_us;
+        if (node.seen) {
+            counters.lag_us = newest_us - counters.newest_us;
+            if (counters.lag_us > counters.max_lag_us) {
+                counters.max_lag_us = counters.lag_us;
+            }
+        }
+        if (counters.stalled) {
+            continue;
+        }
+        // A node yet to send anything could still send the oldest frame
+        uint64_t node_limit = 0;
+        if (node.seen && counters.newest_us > cfg.reorder_us) {
+            node_limit = counters.newest_us - cfg.reorder_us;
+        }
+        if (node_limit < limit) {
+            limit = node_limit;
+        }
+    }
+    return limit;
+}
+
+void StreamMerger::emit_top(merger_emit_t emit, void* ctx) {
+    Entry entry = heap.top();
+    heap.pop();
+
+    MergedFrame frame;
+    frame.timestamp_us = entry.timestamp_us;
+    frame.node = entry.node;
+    frame.interface_id = entry.interface_id;
+    frame.data = slots[entry.slot].data();
+    frame.captured = entry.captured;
+    frame.orig_len = entry.orig_len;
+    emit(frame, ctx);
+
+    free_slots.push_back(entry.slot);
+    emitted_us = entry.timestamp_us;
+    any_emitted = true;
+    stats.emitted++;
+}
+
+size_t StreamMerger::release(uint64_t now_us, merger_emit_t emit, void* ctx) {
+    uint64_t limit = watermark(now_us);
+    size_t count = 0;
+    while (!heap.empty() && (heap.top().timestamp_us <= limit || heap.size() > cfg.max_buffered)) {
+        if (heap.top().timestamp_us > limit) {
+            stats.forced++;
+        }
+        emit_top(emit, ctx);
+        count++;
+    }
+    stats.buffered = heap.size();
+    return count;
+}
+
+size_t StreamMerger::flush(merger_emit_t emit, void* ctx) {
+    size_t count = 0;
+    while (!heap.empty()) {
+        emit_top(emit, ctx);
+        count++;
+    }
+    stats.buffered = 0;
+    return count;
+}
@@ -0,0 +1,141 @@
+#include "frame_injector.h"
+#include <string.h>
+#include <time.h>
+
+// A frame handed over later than this after its slot counts as late
+#define INJECTOR_LATE_NS            1000000
+
+// Remaining waits shorter than this are spun instead of slept
+#define INJECTOR_SPIN_NS            200000
+
+static int64_t monotonic_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// IEEE 802.3 CRC-32, as used for the 802.11 FCS
+static uint32_t crc32(const uint8_t* data, size_t len) {
+    static uint32_t table[256];
+    static bool table_ready = false;
+    if (!table_ready) {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+            }
+            table[i] = c;
+        }
+        table_ready = true;
+    }
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < len; i++) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFF;
+}
+
+InjectorConfig injector_default_config() {
+    InjectorConfig config;
+    config.rate_fps = 2000;
+    config.realtime = false;
+    config.speed = 1.0f;
+    config.max_frames = 0;
+    config.duration_ms = 10000;
+    config.loop = false;
+    config.keep_channels = false;
+    return config;
+}
+
+FrameInjector::FrameInjector(FrameSource* source, const InjectorConfig& config)
+    : source(source), cfg(config), stop_requested(false) {
+    if (cfg.speed <= 0) {
+        cfg.speed = 1.0f;
+    }
+}
+
+void FrameInjector::wait_until(int64_t deadline_ns) {
+    int64_t remaining = deadline_ns - monotonic_ns();
+    if (remaining > INJECTOR_SPIN_NS) {
+        int64_t sleep_ns = remaining - INJECTOR_SPIN_NS / 2;
+        struct timespec ts = { (time_t)(sleep_ns / 1000000000), (long)(sleep_ns % 1000000000) };
+        nanosleep(&ts, nullptr);
+    }
+    while (monotonic_ns() < deadline_ns) {
+    }
+}
+
+InjectorStats FrameInjector::run() {
+    InjectorStats stats = {};
+    InjectorFrame frame;
+
+    int64_t start_ns = monotonic_ns();
+    int64_t end_ns = cfg.duration_ms ? start_ns + (int64_t)cfg.duration_ms * 1000000 : INT64_MAX;
+    uint64_t first_timestamp_us = 0;
+    int64_t loop_offset_ns = 0;
+    int64_t last_slot_ns = start_ns;
+    bool have_first = false;
+
+    while (!stop_requested && (cfg.max_frames == 0 || stats.frames < cfg.max_frames)) {
+        if (!source->next(&frame)) {
+            // Replays continue after the last frame's slot when looping
+            if (!cfg.loop || stats.frames == 0 || !source->rewind() || !source->next(&frame)) {
+                break;
+            }
+            loop_offset_ns = last_slot_ns - start_ns;
+            have_first = false;
+        }
+
+        // When this frame is due
+        int64_t slot_ns = start_ns;
+        if (cfg.realtime) {
+            if (!have_first) {
+                first_timestamp_us = frame.timestamp_us;
+                have_first = true;
+            }
+            uint64_t offset_us = frame.timestamp_us >= first_timestamp_us ? frame.timestamp_us - first_timestamp_us : 0;
+            slot_ns = start_ns + loop_offset_ns + (int64_t)(offset_us * 1000 / cfg.speed);
+        } else if (cfg.rate_fps) {
+            slot_ns = start_ns + (int64_t)(stats.frames * 1000000000ull / cfg.rate_fps);
+        }
+        if (slot_ns >= end_ns) {
+            break;
+        }
+        wait_until(slot_ns);
+        last_slot_ns = slot_ns;
+        if ((cfg.realtime || cfg.rate_fps) && monotonic_ns() - slot_ns > INJECTOR_LATE_NS) {
+            stats.late++;
+        }
+
+        // The driver hands over the frame with its FCS
+        const uint8_t* data = frame.data;
+        size_t len = frame.len;
+        if (!frame.has_fcs) {
+            if (len + 4 > sizeof(buffer)) {
+                continue;
+            }
+            memcpy(buffer, frame.data, len);
+            uint32_t fcs = crc32(buffer, len);
+            memcpy(buffer + len, &fcs, 4);
+            data = buffer;
+            len += 4;
+        }
+
+        wifi_pkt_rx_ctrl_t rx_ctrl = frame.rx_ctrl;
+        if (!cfg.keep_channels) {
+            rx_ctrl.channel = 0;
+        }
+        if (host_wifi_inject(data, (uint16_t)len, rx_ctrl)) {
+            stats.delivered++;
+        }
+        stats.frames++;
+        stats.bytes += len;
+
+        if (monotonic_ns() >= end_ns) {
+            break;
+        }
+    }
+
+    stats.elapsed_us = (monotonic_ns() - start_ns) / 1000;
+    return stats;
+}
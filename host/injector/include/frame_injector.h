@@ -0,0 +1,167 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+#include "esp_wifi.h"
+#include "host_wifi.h"
+
+// One frame as a source produces it
+struct InjectorFrame {
+    const uint8_t* data;            // 802.11 frame, valid until the next call to next()
+    uint16_t len;
+    bool has_fcs;                   // `data` ends with the 4-byte FCS
+    uint64_t timestamp_us;          // Capture time, used for paced replay
+    wifi_pkt_rx_ctrl_t rx_ctrl;     // rssi, rate or mcs, noise_floor and channel
+};
+
+// Producer of frames for the injector
+class FrameSource {
+public:
+    virtual ~FrameSource() {}
+
+    // Fill `frame` with the next frame. False at the end of the source.
+    virtual bool next(InjectorFrame* frame) = 0;
+
+    // Start again from the first frame; false if the source cannot
+    virtual bool rewind() = 0;
+};
+
+// Replays a pcap or pcapng capture with LINKTYPE_IEEE802_11 (105) or
+// LINKTYPE_IEEE802_11_RADIOTAP (127) frames. Radiotap fields fill in RSSI,
+// noise, rate/MCS and channel; frames of other link types are skipped.
+class PcapSource : public FrameSource {
+public:
+    PcapSource();
+    ~PcapSource() override;
+
+    // Open a capture; on failure `error` says why
+    bool open(const char* path, char* error, size_t error_size);
+
+    bool next(InjectorFrame* frame) override;
+    bool rewind() override;
+
+    // Records skipped for an unsupported link type or a bad radiotap header
+    uint32_t skipped() const { return skipped_count; }
+
+private:
+    struct Interface {
+        uint16_t linktype;
+        uint64_t ticks_per_second;
+    };
+
+    bool read_header();
+    bool next_pcap(InjectorFrame* frame);
+    bool next_pcapng(InjectorFrame* frame);
+
+    // Turn one captured record into a frame; false if it is skipped
+    bool decode(uint16_t linktype, const uint8_t* data, size_t len, uint64_t timestamp_us, InjectorFrame* frame);
+
+    uint16_t get16(const uint8_t* p) const;
+    uint32_t get32(const uint8_t* p) const;
+
+    FILE* file;
+    bool pcapng;
+    bool swapped;                   // File byte order differs from the host's
+    bool nanoseconds;               // Classic pcap with nanosecond timestamps
+    uint16_t pcap_linktype;
+    std::vector<Interface> interfaces;
+    std::vector<uint8_t> record;
+    uint32_t skipped_count;
+};
+
+// Synthetic traffic: a population of APs and associated stations exchanging
+// beacons, probes, control frames and QoS data, drawn from a seeded PRNG so
+// runs are repeatable.
+struct SyntheticConfig {
+    uint32_t seed;
+    uint16_t access_points;
+    uint16_t stations;
+    uint8_t beacon_percent;         // Share of beacons
+    uint8_t probe_percent;          // Share of probe requests and responses
+    uint8_t control_percent;        // Share of ACK, RTS and CTS frames; the rest is data
+    uint8_t retry_percent;          // Data frames with the retry bit set, resending the previous data frame if there was one
+    uint8_t deauth_percent;         // Broadcast deauthentications in an AP's name, on top of the mix
+    uint8_t rogue_percent;          // Open beacons from a fresh BSSID copying an AP's SSID, likewise
+    uint16_t min_payload;           // Data frame body length range
+    uint16_t max_payload;
+    int8_t min_rssi;
+    int8_t max_rssi;
+};
+
+// Default config: 8 APs on channels 1/6/11, 32 stations, 10% beacons,
+// 10% probes, 20% control, 60% data of 32-1500 bytes, no attacks
+SyntheticConfig synthetic_default_config();
+
+class SyntheticSource : public FrameSource {
+public:
+    explicit SyntheticSource(const SyntheticConfig& config = synthetic_default_config());
+
+    bool next(InjectorFrame* frame) override;
+    bool rewind() override;
+
+private:
+    uint32_t random();
+    uint32_t random_range(uint32_t low, uint32_t high);
+
+    void put_mac(uint8_t* out, uint8_t role, uint16_t index) const;
+    size_t build_beacon(uint16_t ap, uint8_t subtype, uint16_t station);
+    size_t build_deauth(uint16_t ap);
+    size_t build_rogue_beacon(uint16_t ap);
+    size_t build_probe_request(uint16_t station);
+    size_t build_control(uint16_t station, uint16_t ap);
+    size_t build_data(uint16_t station, uint16_t ap, bool uplink);
+
+    SyntheticConfig cfg;
+    uint32_t state;
+    uint16_t sequence;
+    uint64_t frames;
+    size_t data_len;                // Length of the previous frame if it was data, else 0
+    uint8_t buffer[2048];
+};
+
+struct InjectorConfig {
+    uint32_t rate_fps;              // Frames per second, 0 = as fast as possible
+    bool realtime;                  // Pace by the source's timestamps instead of rate_fps
+    float speed;                    // Realtime speed-up factor
+    uint64_t max_frames;            // Stop after this many frames, 0 = no limit
+    uint32_t duration_ms;           // Stop after this long, 0 = no limit
+    bool loop;                      // Rewind the source when it runs out
+    bool keep_channels;             // Deliver on the source's channel instead of the tuned one
+};
+
+// Default config: 2000 frames/s for 10 seconds on the tuned channel
+InjectorConfig injector_default_config();
+
+struct InjectorStats {
+    uint64_t frames;                // Frames handed to the simulated radio
+    uint64_t delivered;             // Frames that reached the RX callback
+    uint64_t bytes;                 // On-air bytes of the frames handed over
+    uint64_t late;                  // Frames sent more than 1 ms after their slot
+    int64_t elapsed_us;
+};
+
+// Replays a FrameSource into the promiscuous RX callback through
+// host_wifi_inject(), acting as the Wi-Fi driver task. Frames without an
+// FCS get one appended so sig_len and the payload match what the ESP32
+// driver delivers.
+class FrameInjector {
+public:
+    FrameInjector(FrameSource* source, const InjectorConfig& config = injector_default_config());
+
+    // Inject on the calling thread until the source, frame or time limit runs out
+    InjectorStats run();
+
+    // Make run() return after the current frame; callable from any thread
+    void stop() { stop_requested = true; }
+
+private:
+    // Sleep or spin until the monotonic clock reaches `deadline_ns`
+    static void wait_until(int64_t deadline_ns);
+
+    FrameSource* source;
+    InjectorConfig cfg;
+    std::atomic<bool> stop_requested;
+    uint8_t buffer[HOST_WIFI_MAX_FRAME];
+};
@@ -0,0 +1,361 @@
+#include "frame_injector.h"
+#include <string.h>
+
+#define PCAP_MAGIC_US               0xA1B2C3D4
+#define PCAP_MAGIC_NS               0xA1B23C4D
+#define PCAP_HEADER_SIZE            24
+#define PCAP_RECORD_HEADER_SIZE     16
+
+#define PCAPNG_BLOCK_SHB            0x0A0D0D0A
+#define PCAPNG_BLOCK_IDB            0x00000001
+#define PCAPNG_BLOCK_SPB            0x00000003
+#define PCAPNG_BLOCK_EPB            0x00000006
+#define PCAPNG_BYTE_ORDER_MAGIC     0x1A2B3C4D
+#define PCAPNG_OPTION_TSRESOL       9
+
+#define LINKTYPE_IEEE802_11         105
+#define LINKTYPE_IEEE802_11_RADIOTAP 127
+
+// Largest record accepted; anything bigger is treated as a corrupt file
+#define PCAP_MAX_RECORD             (256 * 1024)
+
+// Radiotap fields of the first present word: alignment and size
+static const struct {
+    uint8_t align;
+    uint8_t size;
+} radiotap_fields[] = {
+    { 8, 8 },   // 0  TSFT
+    { 1, 1 },   // 1  Flags
+    { 1, 1 },   // 2  Rate
+    { 2, 4 },   // 3  Channel
+    { 2, 2 },   // 4  FHSS
+    { 1, 1 },   // 5  dBm antenna signal
+    { 1, 1 },   // 6  dBm antenna noise
+    { 2, 2 },   // 7  Lock quality
+    { 2, 2 },   // 8  TX attenuation
+    { 2, 2 },   // 9  dB TX attenuation
+    { 1, 1 },   // 10 dBm TX power
+    { 1, 1 },   // 11 Antenna
+    { 1, 1 },   // 12 dB antenna signal
+    { 1, 1 },   // 13 dB antenna noise
+    { 2, 2 },   // 14 RX flags
+    { 2, 2 },   // 15 TX flags
+    { 1, 1 },   // 16 RTS retries
+    { 1, 1 },   // 17 Data retries
+    { 4, 8 },   // 18 XChannel
+    { 1, 3 },   // 19 MCS
+};
+
+#define RADIOTAP_FLAGS              1
+#define RADIOTAP_RATE               2
+#define RADIOTAP_CHANNEL            3
+#define RADIOTAP_DBM_ANTSIGNAL      5
+#define RADIOTAP_DBM_ANTNOISE       6
+#define RADIOTAP_MCS                19
+#define RADIOTAP_F_FCS              0x10
+#define RADIOTAP_F_BADFCS           0x40
+#define RADIOTAP_MCS_HAVE_BW        0x01
+#define RADIOTAP_MCS_HAVE_MCS       0x02
+#define RADIOTAP_MCS_HAVE_GI        0x04
+#define RADIOTAP_MCS_SGI            0x04
+#define RADIOTAP_PRESENT_EXT        (1u << 31)
+
+// wifi_phy_rate_t code of a legacy rate in 500 kbps units, 0xFF if none
+static uint8_t esp_rate_code(uint8_t rate_500kbps) {
+    static const uint8_t rates[16] = {
+        2, 4, 11, 22, 0, 4, 11, 22, 96, 48, 24, 12, 108, 72, 36, 18,
+    };
+    // Long preamble codes first, matching pcap_writer's table
+    for (uint8_t code = 0; code < 16; code++) {
+        if (code != 4 && rates[code] == rate_500kbps) {
+            return code;
+        }
+    }
+    return 0xFF;
+}
+
+static uint8_t frequency_channel(uint16_t mhz) {
+    if (mhz == 2484) {
+        return 14;
+    }
+    if (mhz >= 2412 && mhz <= 2472) {
+        return (uint8_t)((mhz - 2407) / 5);
+    }
+    return 0;
+}
+
+PcapSource::PcapSource()
+    : file(nullptr), pcapng(false), swapped(false), nanoseconds(false), pcap_linktype(0), skipped_count(0) {
+}
+
+PcapSource::~PcapSource() {
+    if (file) {
+        fclose(file);
+    }
+}
+
+uint16_t PcapSource::get16(const uint8_t* p) const {
+    uint16_t v;
+    memcpy(&v, p, 2);
+    return swapped ? __builtin_bswap16(v) : v;
+}
+
+uint32_t PcapSource::get32(const uint8_t* p) const {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return swapped ? __builtin_bswap32(v) : v;
+}
+
+bool PcapSource::open(const char* path, char* error, size_t error_size) {
+    file = fopen(path, "rb");
+    if (file == nullptr) {
+        snprintf(error, error_size, "cannot open %s", path);
+        return false;
+    }
+    if (!read_header()) {
+        snprintf(error, error_size, "%s is not a pcap or pcapng file", path);
+        fclose(file);
+        file = nullptr;
+        return false;
+    }
+    return true;
+}
+
+bool PcapSource::read_header() {
+    uint8_t header[PCAP_HEADER_SIZE];
+    if (fread(header, 1, 4, file) != 4) {
+        return false;
+    }
+    uint32_t magic;
+    memcpy(&magic, header, 4);
+
+    if (magic == PCAPNG_BLOCK_SHB) {
+        // Blocks are read as they come; the SHB sets the byte order
+        pcapng = true;
+        interfaces.clear();
+        return fseek(file, 0, SEEK_SET) == 0;
+    }
+
+    pcapng = false;
+    swapped = magic == __builtin_bswap32(PCAP_MAGIC_US) || magic == __builtin_bswap32(PCAP_MAGIC_NS);
+    uint32_t native = swapped ? __builtin_bswap32(magic) : magic;
+    if (native != PCAP_MAGIC_US && native != PCAP_MAGIC_NS) {
+        return false;
+    }
+    nanoseconds = native == PCAP_MAGIC_NS;
+    if (fread(header + 4, 1, PCAP_HEADER_SIZE - 4, file) != PCAP_HEADER_SIZE - 4) {
+        return false;
+    }
+    pcap_linktype = (uint16_t)get32(header + 20);
+    return true;
+}
+
+bool PcapSource::rewind() {
+    if (file == nullptr || fseek(file, 0, SEEK_SET) != 0) {
+        return false;
+    }
+    return read_header();
+}
+
+bool PcapSource::next(InjectorFrame* frame) {
+    if (file == nullptr) {
+        return false;
+    }
+    return pcapng ? next_pcapng(frame) : next_pcap(frame);
+}
+
+bool PcapSource::next_pcap(InjectorFrame* frame) {
+    uint8_t header[PCAP_RECORD_HEADER_SIZE];
+    while (fread(header, 1, sizeof(header), file) == sizeof(header)) {
+        uint32_t seconds = get32(header);
+        uint32_t fraction = get32(header + 4);
+        uint32_t captured = get32(header + 8);
+        if (captured > PCAP_MAX_RECORD) {
+            return false;
+        }
+        record.resize(captured);
+        if (fread(record.data(), 1, captured, file) != captured) {
+            return false;
+        }
+        uint64_t timestamp_us = (uint64_t)seconds * 1000000 + (nanoseconds ? fraction / 1000 : fraction);
+        if (decode(pcap_linktype, record.data(), captured, timestamp_us, frame)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool PcapSource::next_pcapng(InjectorFrame* frame) {
+    uint8_t header[8];
+    while (fread(header, 1, sizeof(header), file) == sizeof(header)) {
+        uint32_t type;
+        memcpy(&type, header, 4);
+        if (type == PCAPNG_BLOCK_SHB) {
+            // Byte order of this section, from the magic after the header
+            uint8_t magic[4];
+            if (fread(magic, 1, 4, file) != 4) {
+                return false;
+            }
+            uint32_t value;
+            memcpy(&value, magic, 4);
+            swapped = value != PCAPNG_BYTE_ORDER_MAGIC;
+            if (fseek(file, -4, SEEK_CUR) != 0) {
+                return false;
+            }
+            interfaces.clear();
+        } else {
+            type = get32(header);
+        }
+
+        uint32_t total = get32(header + 4);
+        if (total < 12 || total > PCAP_MAX_RECORD || (total & 3) != 0) {
+            return false;
+        }
+        uint32_t body_len = total - 12;
+        record.resize(body_len + 4);
+        if (fread(record.data(), 1, body_len + 4, file) != body_len + 4) {
+            return false;
+        }
+        const uint8_t* body = record.data();
+
+        if (type == PCAPNG_BLOCK_IDB && body_len >= 8) {
+            Interface iface;
+            iface.linktype = get16(body);
+            iface.ticks_per_second = 1000000;
+            // Options: code, length, value padded to 32 bits
+            size_t offset = 8;
+            while (offset + 4 <= body_len) {
+                uint16_t code = get16(body + offset);
+                uint16_t len = get16(body + offset + 2);
+                if (code == 0 || offset + 4 + len > body_len) {
+                    break;
+                }
+                if (code == PCAPNG_OPTION_TSRESOL && len >= 1) {
+                    uint8_t resol = body[offset + 4];
+                    uint64_t ticks = 1;
+                    for (uint8_t i = 0; i < (resol & 0x7F) && ticks < (1ull << 60); i++) {
+                        ticks *= (resol & 0x80) ? 2 : 10;
+                    }
+                    iface.ticks_per_second = ticks;
+                }
+                offset += 4 + ((len + 3) & ~3u);
+            }
+            interfaces.push_back(iface);
+        } else if (type == PCAPNG_BLOCK_EPB && body_len >= 20) {
+            uint32_t interface_id = get32(body);
+            uint64_t ticks = ((uint64_t)get32(body + 4) << 32) | get32(body + 8);
+            uint32_t captured = get32(body + 12);
+            if (interface_id >= interfaces.size() || 20 + captured > body_len) {
+                skipped_count++;
+                continue;
+            }
+            const Interface& iface = interfaces[interface_id];
+            uint64_t timestamp_us = ticks / iface.ticks_per_second * 1000000 +
+                                    ticks % iface.ticks_per_second * 1000000 / iface.ticks_per_second;
+            if (decode(iface.linktype, body + 20, captured, timestamp_us, frame)) {
+                return true;
+            }
+        } else if (type == PCAPNG_BLOCK_SPB && body_len >= 4 && !interfaces.empty()) {
+            uint32_t captured = get32(body);
+            if (captured > body_len - 4) {
+                captured = body_len - 4;
+            }
+            if (decode(interfaces[0].linktype, body + 4, captured, 0, frame)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool PcapSource::decode(uint16_t linktype, const uint8_t* data, size_t len, uint64_t timestamp_us,
+                        InjectorFrame* frame) {
+    memset(&frame->rx_ctrl, 0, sizeof(frame->rx_ctrl));
+    frame->rx_ctrl.rssi = -60;
+    frame->rx_ctrl.noise_floor = -95;
+    frame->rx_ctrl.rate = 0x0B;     // 6 Mbps
+    frame->has_fcs = false;
+    frame->timestamp_us = timestamp_us;
+
+    if (linktype == LINKTYPE_IEEE802_11) {
+        frame->data = data;
+        frame->len = (uint16_t)len;
+        return len >= 2 && len <= HOST_WIFI_MAX_FRAME;
+    }
+    if (linktype != LINKTYPE_IEEE802_11_RADIOTAP || len < 8) {
+        skipped_count++;
+        return false;
+    }
+
+    // Radiotap header (always little endian)
+    uint16_t header_len = data[2] | (data[3] << 8);
+    uint32_t present = data[4] | (data[5] << 8) | (data[6] << 16) | ((uint32_t)data[7] << 24);
+    if (header_len > len) {
+        skipped_count++;
+        return false;
+    }
+
+    // Skip extended present words; their fields follow the first word's
+    size_t offset = 8;
+    uint32_t word = present;
+    while ((word & RADIOTAP_PRESENT_EXT) && offset + 4 <= header_len) {
+        word = data[offset] | (data[offset + 1] << 8) | (data[offset + 2] << 16) | ((uint32_t)data[offset + 3] << 24);
+        offset += 4;
+    }
+
+    bool bad_fcs = false;
+    for (uint8_t bit = 0; bit < sizeof(radiotap_fields) / sizeof(radiotap_fields[0]); bit++) {
+        if (!(present & (1u << bit))) {
+            continue;
+        }
+        uint8_t align = radiotap_fields[bit].align;
+        offset = (offset + align - 1) & ~(size_t)(align - 1);
+        if (offset + radiotap_fields[bit].size > header_len) {
+            break;
+        }
+        const uint8_t* field = data + offset;
+        switch (bit) {
+            case RADIOTAP_FLAGS:
+                frame->has_fcs = (field[0] & RADIOTAP_F_FCS) != 0;
+                bad_fcs = (field[0] & RADIOTAP_F_BADFCS) != 0;
+                break;
+            case RADIOTAP_RATE: {
+                uint8_t code = esp_rate_code(field[0]);
+                if (code != 0xFF) {
+                    frame->rx_ctrl.rate = code;
+                }
+                break;
+            }
+            case RADIOTAP_CHANNEL:
+                frame->rx_ctrl.channel = frequency_channel(field[0] | (field[1] << 8));
+                break;
+            case RADIOTAP_DBM_ANTSIGNAL:
+                frame->rx_ctrl.rssi = (int8_t)field[0];
+                break;
+            case RADIOTAP_DBM_ANTNOISE:
+                frame->rx_ctrl.noise_floor = (int8_t)field[0];
+                break;
+            case RADIOTAP_MCS:
+                if (field[0] & RADIOTAP_MCS_HAVE_MCS) {
+                    frame->rx_ctrl.sig_mode = 1;
+                    frame->rx_ctrl.mcs = field[2] & 0x7F;
+                    frame->rx_ctrl.cwb = (field[0] & RADIOTAP_MCS_HAVE_BW) && (field[1] & 0x03) == 1;
+                    frame->rx_ctrl.sgi = (field[0] & RADIOTAP_MCS_HAVE_GI) && (field[1] & RADIOTAP_MCS_SGI);
+                }
+                break;
+            default:
+                break;
+        }
+        offset += radiotap_fields[bit].size;
+    }
+
+    // The ESP32 driver does not pass frames that failed the FCS check
+    size_t frame_len = len - header_len;
+    if (bad_fcs || frame_len < 2 || frame_len > HOST_WIFI_MAX_FRAME) {
+        skipped_count++;
+        return false;
+    }
+    frame->data = data + header_len;
+    frame->len = (uint16_t)frame_len;
+    return true;
+}
@@ -0,0 +1,286 @@
+#include "frame_injector.h"
+#include <string.h>
+
+// Fourth octet of the synthetic population's addresses, keeping roles apart
+#define SYNTHETIC_ROLE_AP           0x01
+#define SYNTHETIC_ROLE_STATION      0x02
+#define SYNTHETIC_ROLE_ROGUE        0x03
+
+// Registered OUIs (all in components/oui_lookup/oui_sample.csv) given to
+// APs and stations; every fourth station and every rogue AP uses a locally
+// administered address instead, as randomizing phones and spoofers do
+static const uint32_t ap_ouis[] = { 0x50C7BF, 0x00146C, 0x00180A, 0x000B86 };
+static const uint32_t station_ouis[] = { 0x0026BB, 0x001632, 0x0024D7, 0x3C5AB4, 0x240AC4, 0xB827EB };
+
+static const uint8_t broadcast[6] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+
+// Basic and extended rates IE of a 2.4 GHz AP
+static const uint8_t supported_rates[] = { 0x01, 0x08, 0x82, 0x84, 0x8B, 0x96, 0x0C, 0x12, 0x18, 0x24 };
+
+// OFDM legacy rates (wifi_phy_rate_t) used for data frames
+static const uint8_t ofdm_rates[] = { 0x0B, 0x0F, 0x0A, 0x0E, 0x09, 0x0D, 0x08, 0x0C };
+
+// Channels APs are spread over
+static const uint8_t ap_channels[] = { 1, 6, 11 };
+
+SyntheticConfig synthetic_default_config() {
+    SyntheticConfig config;
+    config.seed = 1;
+    config.access_points = 8;
+    config.stations = 32;
+    config.beacon_percent = 10;
+    config.probe_percent = 10;
+    config.control_percent = 20;
+    config.retry_percent = 5;
+    config.deauth_percent = 0;
+    config.rogue_percent = 0;
+    config.min_payload = 32;
+    config.max_payload = 1500;
+    config.min_rssi = -90;
+    config.max_rssi = -30;
+    return config;
+}
+
+SyntheticSource::SyntheticSource(const SyntheticConfig& config)
+    : cfg(config), state(0), sequence(0), frames(0), data_len(0) {
+    if (cfg.access_points == 0) {
+        cfg.access_points = 1;
+    }
+    if (cfg.max_payload > sizeof(buffer) - 64) {
+        cfg.max_payload = sizeof(buffer) - 64;
+    }
+    if (cfg.min_payload > cfg.max_payload) {
+        cfg.min_payload = cfg.max_payload;
+    }
+    rewind();
+}
+
+bool SyntheticSource::rewind() {
+    // xorshift32 must not start at zero
+    state = cfg.seed ? cfg.seed : 0x9E3779B9;
+    sequence = 0;
+    frames = 0;
+    data_len = 0;
+    return true;
+}
+
+uint32_t SyntheticSource::random() {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+uint32_t SyntheticSource::random_range(uint32_t low, uint32_t high) {
+    return low + random() % (high - low + 1);
+}
+
+void SyntheticSource::put_mac(uint8_t* out, uint8_t role, uint16_t index) const {
+    uint32_t oui = 0x020000;
+    if (role == SYNTHETIC_ROLE_AP) {
+        oui = ap_ouis[index % (sizeof(ap_ouis) / sizeof(ap_ouis[0]))];
+    } else if (role == SYNTHETIC_ROLE_STATION && index % 4 != 0) {
+        oui = station_ouis[index % (sizeof(station_ouis) / sizeof(station_ouis[0]))];
+    }
+    out[0] = (uint8_t)(oui >> 16);
+    out[1] = (uint8_t)(oui >> 8);
+    out[2] = (uint8_t)oui;
+    out[3] = role;
+    out[4] = (uint8_t)(index >> 8);
+    out[5] = (uint8_t)index;
+}
+
+// Frame control, duration and sequence control around three addresses
+static size_t put_header(uint8_t* out, uint8_t fc0, uint8_t fc1, const uint8_t* a1, const uint8_t* a2,
+                         const uint8_t* a3, uint16_t sequence) {
+    out[0] = fc0;
+    out[1] = fc1;
+    out[2] = 0x3A;
+    out[3] = 0x01;
+    memcpy(out + 4, a1, 6);
+    memcpy(out + 10, a2, 6);
+    memcpy(out + 16, a3, 6);
+    out[22] = (uint8_t)(sequence << 4);
+    out[23] = (uint8_t)(sequence >> 4);
+    return 24;
+}
+
+size_t SyntheticSource::build_beacon(uint16_t ap, uint8_t subtype, uint16_t station) {
+    uint8_t bssid[6];
+    uint8_t da[6];
+    put_mac(bssid, SYNTHETIC_ROLE_AP, ap);
+    if (subtype == 8) {
+        memcpy(da, broadcast, 6);
+    } else {
+        put_mac(da, SYNTHETIC_ROLE_STATION, station);
+    }
+    size_t len = put_header(buffer, (uint8_t)(subtype << 4), 0, da, bssid, bssid, sequence);
+
+    // Fixed fields: TSF, beacon interval (100 TU), capabilities (ESS, privacy, short preamble/slot)
+    uint64_t tsf = frames * 1024;
+    memcpy(buffer + len, &tsf, 8);
+    len += 8;
+    buffer[len++] = 0x64;
+    buffer[len++] = 0x00;
+    buffer[len++] = 0x31;
+    buffer[len++] = 0x04;
+
+    int ssid_len = snprintf((char*)buffer + len + 2, 33, "sim-ap-%u", ap);
+    buffer[len] = 0;
+    buffer[len + 1] = (uint8_t)ssid_len;
+    len += 2 + ssid_len;
+
+    memcpy(buffer + len, supported_rates, sizeof(supported_rates));
+    len += sizeof(supported_rates);
+
+    buffer[len++] = 3;
+    buffer[len++] = 1;
+    buffer[len++] = ap_channels[ap % sizeof(ap_channels)];
+    return len;
+}
+
+size_t SyntheticSource::build_deauth(uint16_t ap) {
+    uint8_t bssid[6];
+    put_mac(bssid, SYNTHETIC_ROLE_AP, ap);
+    size_t len = put_header(buffer, 0xC0, 0, broadcast, bssid, bssid, sequence);
+
+    // Reason 7: class 3 frame from a nonassociated station
+    buffer[len++] = 0x07;
+    buffer[len++] = 0x00;
+    return len;
+}
+
+size_t SyntheticSource::build_rogue_beacon(uint16_t ap) {
+    // A fresh BSSID every time, open instead of the AP's privacy
+    size_t len = build_beacon(ap, 8, 0);
+    uint8_t bssid[6];
+    put_mac(bssid, SYNTHETIC_ROLE_ROGUE, (uint16_t)random());
+    memcpy(buffer + 10, bssid, 6);
+    memcpy(buffer + 16, bssid, 6);
+    buffer[24 + 10] &= ~0x10;
+    return len;
+}
+
+size_t SyntheticSource::build_probe_request(uint16_t station) {
+    uint8_t sa[6];
+    put_mac(sa, SYNTHETIC_ROLE_STATION, station);
+    size_t len = put_header(buffer, 0x40, 0, broadcast, sa, broadcast, sequence);
+
+    // Wildcard SSID
+    buffer[len++] = 0;
+    buffer[len++] = 0;
+    memcpy(buffer + len, supported_rates, sizeof(supported_rates));
+    len += sizeof(supported_rates);
+    return len;
+}
+
+size_t SyntheticSource::build_control(uint16_t station, uint16_t ap) {
+    uint8_t sta_mac[6];
+    uint8_t ap_mac[6];
+    put_mac(sta_mac, SYNTHETIC_ROLE_STATION, station);
+    put_mac(ap_mac, SYNTHETIC_ROLE_AP, ap);
+
+    uint32_t pick = random() % 4;
+    buffer[2] = 0x2C;
+    buffer[3] = 0x00;
+    if (pick == 0) {
+        // RTS from the station to its AP
+        buffer[0] = 0xB4;
+        buffer[1] = 0;
+        memcpy(buffer + 4, ap_mac, 6);
+        memcpy(buffer + 10, sta_mac, 6);
+        return 16;
+    }
+    // CTS or ACK back to the station; only a receiver address
+    buffer[0] = pick == 1 ? 0xC4 : 0xD4;
+    buffer[1] = 0;
+    memcpy(buffer + 4, sta_mac, 6);
+    return 10;
+}
+
+size_t SyntheticSource::build_data(uint16_t station, uint16_t ap, bool uplink) {
+    uint8_t sta_mac[6];
+    uint8_t ap_mac[6];
+    put_mac(sta_mac, SYNTHETIC_ROLE_STATION, station);
+    put_mac(ap_mac, SYNTHETIC_ROLE_AP, ap);
+
+    // QoS data; uplink goes to the DS, downlink comes from it
+    uint8_t flags = uplink ? 0x01 : 0x02;
+    if (random() % 100 < cfg.retry_percent) {
+        // A missed ACK: the previous data frame, still in the buffer, goes out again
+        if (data_len) {
+            buffer[1] |= 0x08;
+            return data_len;
+        }
+        flags |= 0x08;
+    }
+    size_t len = uplink ? put_header(buffer, 0x88, flags, ap_mac, sta_mac, ap_mac, sequence)
+                        : put_header(buffer, 0x88, flags, sta_mac, ap_mac, ap_mac, sequence);
+    buffer[len++] = (uint8_t)(random() % 8);
+    buffer[len++] = 0;
+
+    // LLC/SNAP for IPv4 followed by filler
+    static const uint8_t snap[] = { 0xAA, 0xAA, 0x03, 0x00, 0x00, 0x00, 0x08, 0x00 };
+    uint32_t body = random_range(cfg.min_payload, cfg.max_payload);
+    if (body < sizeof(snap)) {
+        body = sizeof(snap);
+    }
+    memcpy(buffer + len, snap, sizeof(snap));
+    for (uint32_t i = sizeof(snap); i < body; i++) {
+        buffer[len + i] = (uint8_t)(i * 131 + frames);
+    }
+    return len + body;
+}
+
+bool SyntheticSource::next(InjectorFrame* frame) {
+    uint16_t ap = (uint16_t)(random() % cfg.access_points);
+    uint16_t station = cfg.stations ? (uint16_t)(random() % cfg.stations) : 0;
+    if (cfg.stations) {
+        // Stations stay associated to one AP
+        ap = station % cfg.access_points;
+    }
+
+    memset(&frame->rx_ctrl, 0, sizeof(frame->rx_ctrl));
+    frame->rx_ctrl.rssi = (int8_t)random_range(0, cfg.max_rssi - cfg.min_rssi) + cfg.min_rssi;
+    frame->rx_ctrl.noise_floor = -95;
+    frame->rx_ctrl.channel = ap_channels[ap % sizeof(ap_channels)];
+    frame->rx_ctrl.rate = 0x00;     // 1 Mbps for management frames
+
+    // Attack frames come on top of the mix; no draw when there are none, so
+    // that plain traffic stays the same for a seed
+    uint32_t attack = cfg.deauth_percent + cfg.rogue_percent ? random() % 100 : 100;
+    uint32_t pick = random() % 100;
+    size_t len;
+    bool data = false;
+    if (attack < cfg.deauth_percent) {
+        len = build_deauth(ap);
+    } else if (attack < (uint32_t)cfg.deauth_percent + cfg.rogue_percent) {
+        len = build_rogue_beacon(ap);
+    } else if (pick < cfg.beacon_percent || cfg.stations == 0) {
+        len = build_beacon(ap, 8, 0);
+    } else if (pick < (uint32_t)cfg.beacon_percent + cfg.probe_percent) {
+        len = (pick & 1) ? build_probe_request(station) : build_beacon(ap, 5, station);
+    } else if (pick < (uint32_t)cfg.beacon_percent + cfg.probe_percent + cfg.control_percent) {
+        len = build_control(station, ap);
+        frame->rx_ctrl.rate = 0x0B;
+    } else {
+        len = build_data(station, ap, (pick & 1) != 0);
+        data = true;
+        if (random() & 1) {
+            frame->rx_ctrl.sig_mode = 1;
+            frame->rx_ctrl.mcs = random() % 8;
+            frame->rx_ctrl.sgi = random() & 1;
+        } else {
+            frame->rx_ctrl.rate = ofdm_rates[random() % sizeof(ofdm_rates)];
+        }
+    }
+
+    data_len = data ? len : 0;
+    sequence = (sequence + 1) & 0x0FFF;
+    frame->data = buffer;
+    frame->len = (uint16_t)len;
+    frame->has_fcs = false;
+    frame->timestamp_us = frames * 100;
+    frames++;
+    return true;
+}
@@ -0,0 +1,242 @@
+// Host benchmark of the OUI lookup (components/oui_lookup).
+//
+// Times oui_find() on the built-in registry table and on a synthetic table
+// the size of the full IEEE MA-L registry, against a binary search over the
+// sorted keys and a std::map, and prints lookups/s and the table's flash
+// footprint. Before timing, every key and query is checked to give the
+// same vendor by all three; a mismatch exits with status 1.
+
+#include <algorithm>
+#include <chrono>
+#include <getopt.h>
+#include <map>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "oui_lookup.h"
+
+// Distinct queries, cycled through; larger than the caches so that the
+// query stream itself does not stay cached
+#define BENCH_QUERIES (1 << 20)
+
+struct BenchOptions {
+    uint32_t entries;
+    uint64_t lookups;
+    uint32_t hit_percent;
+    uint32_t seed;
+};
+
+static void usage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --entries N         Synthetic table size, 0 = built-in table only (default 40000)\n"
+            "  --lookups N         Lookups per method (default 20000000)\n"
+            "  --hit-percent N     Queries for a registered OUI (default 50)\n"
+            "  --seed N            Synthetic table and query seed (default 1)\n",
+            program);
+}
+
+static bool parse_options(int argc, char** argv, BenchOptions* options) {
+    static const struct option long_options[] = {
+        { "entries",     required_argument, nullptr, 'n' },
+        { "lookups",     required_argument, nullptr, 'l' },
+        { "hit-percent", required_argument, nullptr, 'p' },
+        { "seed",        required_argument, nullptr, 'e' },
+        { "help",        no_argument,       nullptr, 'h' },
+        { nullptr,       0,                 nullptr, 0 },
+    };
+
+    options->entries = 40000;
+    options->lookups = 20000000;
+    options->hit_percent = 50;
+    options->seed = 1;
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "h", long_options, nullptr)) != -1) {
+        switch (opt) {
+            case 'n': options->entries = strtoul(optarg, nullptr, 0); break;
+            case 'l': options->lookups = strtoull(optarg, nullptr, 0); break;
+            case 'p': options->hit_percent = strtoul(optarg, nullptr, 0); break;
+            case 'e': options->seed = strtoul(optarg, nullptr, 0); break;
+            default:
+                return false;
+        }
+    }
+    return optind == argc && options->lookups > 0 && options->hit_percent <= 100 &&
+           options->entries < 0x1000000 / 4;
+}
+
+static uint32_t xorshift(uint32_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+// Universal, individual OUI: both low bits of the first octet clear
+static uint32_t random_oui(uint32_t* state) {
+    return xorshift(state) & 0xFCFFFF;
+}
+
+// In-order fill of the implicit tree, as oui_gen.py does
+static void eytzinger_fill(const std::vector<uint32_t>& sorted, std::vector<uint32_t>& keys,
+                           size_t* next, size_t k) {
+    if (k < keys.size()) {
+        eytzinger_fill(sorted, keys, next, 2 * k);
+        keys[k] = sorted[(*next)++];
+        eytzinger_fill(sorted, keys, next, 2 * k + 1);
+    }
+}
+
+// A table and its keys in sorted order, for the baselines
+struct BenchTable {
+    OuiTable table;
+    std::vector<uint32_t> sorted;
+    std::vector<uint16_t> sorted_vendors;
+    std::vector<uint32_t> keys;
+    std::vector<uint16_t> vendors;
+};
+
+// The reference keys come from the table's arrays directly, not through
+// oui_find(), so that the check below compares independent answers
+static void load_registry(BenchTable* bench) {
+    bench->table = oui_registry;
+    std::vector<std::pair<uint32_t, uint16_t>> entries;
+    for (uint32_t i = 1; i <= oui_registry.count; i++) {
+        entries.emplace_back(oui_registry.keys[i], oui_registry.vendors[i]);
+    }
+    std::sort(entries.begin(), entries.end());
+    for (const auto& entry : entries) {
+        bench->sorted.push_back(entry.first);
+        bench->sorted_vendors.push_back(entry.second);
+    }
+}
+
+static void build_synthetic(BenchTable* bench, uint32_t entries, uint32_t* state) {
+    while (bench->sorted.size() < entries) {
+        bench->sorted.push_back(random_oui(state));
+        if (bench->sorted.size() == entries) {
+            std::sort(bench->sorted.begin(), bench->sorted.end());
+            bench->sorted.erase(std::unique(bench->sorted.begin(), bench->sorted.end()), bench->sorted.end());
+        }
+    }
+    // One vendor per three OUIs, about the registry's ratio
+    for (size_t i = 0; i < entries; i++) {
+        bench->sorted_vendors.push_back((uint16_t)(xorshift(state) % (entries / 3 + 1)));
+    }
+
+    bench->keys.assign(entries + 1, 0);
+    size_t next = 0;
+    eytzinger_fill(bench->sorted, bench->keys, &next, 1);
+    bench->vendors.assign(entries + 1, 0);
+    for (size_t k = 1; k <= entries; k++) {
+        size_t i = std::lower_bound(bench->sorted.begin(), bench->sorted.end(), bench->keys[k]) - bench->sorted.begin();
+        bench->vendors[k] = bench->sorted_vendors[i];
+    }
+
+    // Names are not synthesized, so the footprint covers the index only
+    bench->table = {};
+    bench->table.keys = bench->keys.data();
+    bench->table.vendors = bench->vendors.data();
+    bench->table.count = entries;
+}
+
+template <typename Lookup>
+static void run(const char* method, const std::vector<uint32_t>& queries, uint64_t lookups, Lookup lookup) {
+    uint64_t found = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < lookups; i++) {
+        found += lookup(queries[i & (BENCH_QUERIES - 1)]) != OUI_VENDOR_NONE;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("  %-12s %7.1f M lookups/s  %6.1f ns/lookup  hits=%.1f%%\n",
+           method, lookups / seconds / 1e6, seconds * 1e9 / lookups, 100.0 * found / lookups);
+}
+
+// Every key, its neighbours and every query against the three lookups
+template <typename Find, typename Binary, typename Map>
+static bool verify(const char* name, const BenchTable& bench, const std::vector<uint32_t>& queries,
+                   Find find, Binary binary, Map map) {
+    std::vector<uint32_t> checks(queries);
+    for (uint32_t key : bench.sorted) {
+        checks.push_back(key);
+        checks.push_back((key - 1) & 0xFFFFFF);
+        checks.push_back((key + 1) & 0xFFFFFF);
+    }
+    for (size_t i = 0; i < bench.sorted.size(); i++) {
+        if (find(bench.sorted[i]) != bench.sorted_vendors[i]) {
+            fprintf(stderr, "%s: OUI %06X: oui_find gives vendor %u, expected %u\n", name,
+                    (unsigned)bench.sorted[i], find(bench.sorted[i]), bench.sorted_vendors[i]);
+            return false;
+        }
+    }
+    for (uint32_t oui : checks) {
+        uint16_t expected = binary(oui);
+        if (find(oui) != expected || map(oui) != expected) {
+            fprintf(stderr, "%s: OUI %06X: eytzinger %u, binary %u, std::map %u\n", name,
+                    (unsigned)oui, find(oui), expected, map(oui));
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool bench_table(const char* name, const BenchTable& bench, const BenchOptions& options, uint32_t* state) {
+    std::vector<uint32_t> queries(BENCH_QUERIES);
+    for (uint32_t& query : queries) {
+        bool hit = !bench.sorted.empty() && xorshift(state) % 100 < options.hit_percent;
+        query = hit ? bench.sorted[xorshift(state) % bench.sorted.size()] : random_oui(state);
+    }
+
+    printf("%s: %u OUIs, %u vendors, %u bytes%s\n", name, bench.table.count, bench.table.vendor_count,
+           (unsigned)oui_table_bytes(bench.table), bench.table.names ? "" : " (index only)");
+
+    auto find = [&](uint32_t oui) {
+        return oui_find(bench.table, oui);
+    };
+    auto binary = [&](uint32_t oui) {
+        auto it = std::lower_bound(bench.sorted.begin(), bench.sorted.end(), oui);
+        return (it != bench.sorted.end() && *it == oui) ? bench.sorted_vendors[it - bench.sorted.begin()]
+                                                        : (uint16_t)OUI_VENDOR_NONE;
+    };
+    std::map<uint32_t, uint16_t> map;
+    for (size_t i = 0; i < bench.sorted.size(); i++) {
+        map[bench.sorted[i]] = bench.sorted_vendors[i];
+    }
+    auto map_find = [&](uint32_t oui) {
+        auto it = map.find(oui);
+        return it != map.end() ? it->second : (uint16_t)OUI_VENDOR_NONE;
+    };
+    if (!verify(name, bench, queries, find, binary, map_find)) {
+        return false;
+    }
+
+    run("eytzinger", queries, options.lookups, find);
+    run("binary", queries, options.lookups, binary);
+    run("std::map", queries, options.lookups, map_find);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    if (!parse_options(argc, argv, &options)) {
+        usage(argv[0]);
+        return 2;
+    }
+    uint32_t state = options.seed ? options.seed : 0x9E3779B9;
+
+    BenchTable registry;
+    load_registry(&registry);
+    if (!bench_table("Built-in", registry, options, &state)) {
+        return 1;
+    }
+
+    if (options.entries) {
+        BenchTable synthetic;
+        build_synthetic(&synthetic, options.entries, &state);
+        if (!bench_table("Synthetic", synthetic, options, &state)) {
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,191 @@
+// Host driver of the pipeline benchmark (components/pipeline_bench).
+//
+// Runs the load steps against the synthetic corpus, or against the first
+// frames of a capture, and writes one JSON line per step for regression
+// tracking. The same harness runs on the device as the `pipeline_bench`
+// console command.
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "frame_injector.h"
+#include "pipeline_bench.h"
+
+struct BenchOptions {
+    PipelineBenchConfig config;
+    const char* pcap_path;
+    const char* json_path;
+    size_t frames;
+    uint32_t seed;
+    esp_log_level_t log_level;
+};
+
+static void usage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --loads LIST        Comma-separated offered frames/s per step, 0 = unpaced\n"
+            "                      (default 1000,2000,5000,10000,20000,50000,100000,0)\n"
+            "  --step-ms MS        Duration of each step (default 2000)\n"
+            "  --all               Run every step even when drops exceed 50%%\n"
+            "  --filter EXPR       Filter stage expression (see packet_filter.h)\n"
+            "  --pcap FILE         Build the corpus from a pcap/pcapng capture\n"
+            "  --frames N          Corpus size (default %d)\n"
+            "  --seed N            Synthetic corpus seed (default 1)\n"
+            "  --json FILE         Write the JSON lines to FILE instead of stdout\n"
+            "  --log-level LEVEL   none, error, warn, info, debug or verbose (default info)\n",
+            program, BENCH_CORPUS_DEFAULT_FRAMES);
+}
+
+static bool parse_loads(const char* list, PipelineBenchConfig* config) {
+    config->load_count = 0;
+    while (*list) {
+        if (config->load_count == PIPELINE_BENCH_MAX_STEPS) {
+            return false;
+        }
+        char* end;
+        config->loads[config->load_count++] = strtoul(list, &end, 0);
+        if (end == list || (*end != ',' && *end != '\0')) {
+            return false;
+        }
+        list = *end ? end + 1 : end;
+    }
+    return config->load_count > 0;
+}
+
+static bool parse_options(int argc, char** argv, BenchOptions* options) {
+    static const struct option long_options[] = {
+        { "loads",     required_argument, nullptr, 'l' },
+        { "step-ms",   required_argument, nullptr, 't' },
+        { "all",       no_argument,       nullptr, 'a' },
+        { "filter",    required_argument, nullptr, 'f' },
+        { "pcap",      required_argument, nullptr, 'p' },
+        { "frames",    required_argument, nullptr, 'n' },
+        { "seed",      required_argument, nullptr, 'e' },
+        { "json",      required_argument, nullptr, 'j' },
+        { "log-level", required_argument, nullptr, 'L' },
+        { "help",      no_argument,       nullptr, 'h' },
+        { nullptr,     0,                 nullptr, 0 },
+    };
+    static const char* level_names[] = { "none", "error", "warn", "info", "debug", "verbose" };
+
+    options->config = pipeline_bench_default_config();
+    options->pcap_path = nullptr;
+    options->json_path = nullptr;
+    options->frames = BENCH_CORPUS_DEFAULT_FRAMES;
+    options->seed = 1;
+    options->log_level = ESP_LOG_INFO;
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "h", long_options, nullptr)) != -1) {
+        switch (opt) {
+            case 'l':
+                if (!parse_loads(optarg, &options->config)) {
+                    return false;
+                }
+                break;
+            case 't': options->config.step_ms = strtoul(optarg, nullptr, 0); break;
+            case 'a': options->config.stop_drop_rate = 0.0f; break;
+            case 'f': options->config.filter = optarg; break;
+            case 'p': options->pcap_path = optarg; break;
+            case 'n': options->frames = strtoul(optarg, nullptr, 0); break;
+            case 'e': options->seed = strtoul(optarg, nullptr, 0); break;
+            case 'j': options->json_path = optarg; break;
+            case 'L': {
+                bool found = false;
+                for (int i = 0; i <= ESP_LOG_VERBOSE; i++) {
+                    if (strcmp(optarg, level_names[i]) == 0) {
+                        options->log_level = (esp_log_level_t)i;
+                        found = true;
+                    }
+                }
+                if (!found) {
+                    return false;
+                }
+                break;
+            }
+            default:
+                return false;
+        }
+    }
+    return optind == argc && options->frames > 0 && options->config.step_ms > 0;
+}
+
+// Fill the corpus with the first `frames` frames of a capture
+static bool load_capture(const char* path, size_t frames, BenchCorpus* corpus) {
+    PcapSource pcap;
+    char error[128];
+    if (!pcap.open(path, error, sizeof(error))) {
+        fprintf(stderr, "%s\n", error);
+        return false;
+    }
+    if (!corpus->reserve(frames, frames * BENCH_CORPUS_MAX_FRAME)) {
+        fprintf(stderr, "Not enough memory for a %zu frame corpus\n", frames);
+        return false;
+    }
+
+    // Frames captured without an FCS get a zero one; it is never checked
+    uint8_t buffer[HOST_WIFI_MAX_FRAME + 4];
+    InjectorFrame frame;
+    while (corpus->size() < frames && pcap.next(&frame)) {
+        uint16_t len = frame.len;
+        memcpy(buffer, frame.data, len);
+        if (!frame.has_fcs) {
+            memset(buffer + len, 0, 4);
+            len += 4;
+        }
+        if (!corpus->add(buffer, len, frame.rx_ctrl.rssi, frame.rx_ctrl.channel)) {
+            break;
+        }
+    }
+    if (corpus->size() == 0) {
+        fprintf(stderr, "%s: no usable frames\n", path);
+        return false;
+    }
+    return true;
+}
+
+static void write_step(const BenchStepResult& result, void* ctx) {
+    FILE* out = static_cast<FILE*>(ctx);
+    pipeline_bench_print_json(result, out);
+    fflush(out);
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    if (!parse_options(argc, argv, &options)) {
+        usage(argv[0]);
+        return 2;
+    }
+    esp_log_level_set("*", options.log_level);
+
+    BenchCorpus corpus;
+    if (options.pcap_path) {
+        if (!load_capture(options.pcap_path, options.frames, &corpus)) {
+            return 1;
+        }
+    } else if (bench_corpus_generate(&corpus, options.frames, options.seed) == 0) {
+        fprintf(stderr, "Not enough memory for a %zu frame corpus\n", options.frames);
+        return 1;
+    }
+
+    FILE* out = stdout;
+    if (options.json_path) {
+        out = fopen(options.json_path, "w");
+        if (out == nullptr) {
+            perror(options.json_path);
+            return 1;
+        }
+    }
+
+    esp_err_t ret = pipeline_bench_run(options.config, corpus, write_step, out);
+    if (out != stdout) {
+        fclose(out);
+    }
+    if (ret != ESP_OK) {
+        fprintf(stderr, "Benchmark failed: %s\n", esp_err_to_name(ret));
+        return 1;
+    }
+    return 0;
+}
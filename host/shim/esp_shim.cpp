@@ -0,0 +1,281 @@
+#include <atomic>
+#include <malloc.h>
+#include <mutex>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+#include "esp_cpu.h"
+#include "esp_err.h"
+#include "esp_event.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_rom_sys.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+
+// esp_err
+
+const char* esp_err_to_name(esp_err_t code) {
+    static const struct {
+        esp_err_t code;
+        const char* name;
+    } names[] = {
+        { ESP_OK,                   "ESP_OK" },
+        { ESP_FAIL,                 "ESP_FAIL" },
+        { ESP_ERR_NO_MEM,           "ESP_ERR_NO_MEM" },
+        { ESP_ERR_INVALID_ARG,      "ESP_ERR_INVALID_ARG" },
+        { ESP_ERR_INVALID_STATE,    "ESP_ERR_INVALID_STATE" },
+        { ESP_ERR_INVALID_SIZE,     "ESP_ERR_INVALID_SIZE" },
+        { ESP_ERR_NOT_FOUND,        "ESP_ERR_NOT_FOUND" },
+        { ESP_ERR_NOT_SUPPORTED,    "ESP_ERR_NOT_SUPPORTED" },
+        { ESP_ERR_TIMEOUT,          "ESP_ERR_TIMEOUT" },
+        { ESP_ERR_INVALID_RESPONSE, "ESP_ERR_INVALID_RESPONSE" },
+        { ESP_ERR_INVALID_CRC,      "ESP_ERR_INVALID_CRC" },
+        { ESP_ERR_INVALID_VERSION,  "ESP_ERR_INVALID_VERSION" },
+        { ESP_ERR_INVALID_MAC,      "ESP_ERR_INVALID_MAC" },
+        { ESP_ERR_NOT_FINISHED,     "ESP_ERR_NOT_FINISHED" },
+        { ESP_ERR_WIFI_NOT_INIT,    "ESP_ERR_WIFI_NOT_INIT" },
+        { ESP_ERR_WIFI_NOT_STARTED, "ESP_ERR_WIFI_NOT_STARTED" },
+    };
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        if (names[i].code == code) {
+            return names[i].name;
+        }
+    }
+    return "UNKNOWN ERROR";
+}
+
+void _esp_error_check_failed(esp_err_t rc, const char* file, int line, const char* function,
+                             const char* expression) {
+    fprintf(stderr, "ESP_ERROR_CHECK failed: esp_err_t 0x%x (%s) at %s:%d\n"
+                    "function: %s\nexpression: %s\n",
+            rc, esp_err_to_name(rc), file, line, function, expression);
+    abort();
+}
+
+// esp_timer
+
+static int64_t monotonic_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+int64_t esp_timer_get_time(void) {
+    static const int64_t start_us = monotonic_us();
+    return monotonic_us() - start_us;
+}
+
+// esp_cpu, esp_rom_sys
+
+esp_cpu_cycle_count_t esp_cpu_get_cycle_count(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (esp_cpu_cycle_count_t)((uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec);
+}
+
+uint32_t esp_rom_get_cpu_ticks_per_us(void) {
+    return 1000;
+}
+
+// esp_log
+
+static std::mutex log_lock;
+static esp_log_level_t default_log_level = ESP_LOG_INFO;
+
+struct TagLevel {
+    const char* tag;
+    esp_log_level_t level;
+};
+static std::vector<TagLevel> tag_levels;
+
+void esp_log_level_set(const char* tag, esp_log_level_t level) {
+    std::lock_guard<std::mutex> guard(log_lock);
+    if (strcmp(tag, "*") == 0) {
+        default_log_level = level;
+        tag_levels.clear();
+        return;
+    }
+    for (TagLevel& entry : tag_levels) {
+        if (strcmp(entry.tag, tag) == 0) {
+            entry.level = level;
+            return;
+        }
+    }
+    tag_levels.push_back({ strdup(tag), level });
+}
+
+esp_log_level_t esp_log_level_get(const char* tag) {
+    std::lock_guard<std::mutex> guard(log_lock);
+    for (const TagLevel& entry : tag_levels) {
+        if (strcmp(entry.tag, tag) == 0) {
+            return entry.level;
+        }
+    }
+    return default_log_level;
+}
+
+uint32_t esp_log_timestamp(void) {
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+void esp_log_write(esp_log_level_t level, const char* tag, const char* format, ...) {
+    if (esp_log_level_get(tag) < level) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+}
+
+// esp_heap_caps
+
+void* heap_caps_malloc(size_t size, uint32_t caps) {
+    return malloc(size);
+}
+
+void* heap_caps_calloc(size_t n, size_t size, uint32_t caps) {
+    return calloc(n, size);
+}
+
+void* heap_caps_aligned_alloc(size_t alignment, size_t size, uint32_t caps) {
+    void* ptr = nullptr;
+    if (posix_memalign(&ptr, alignment < sizeof(void*) ? sizeof(void*) : alignment, size) != 0) {
+        return nullptr;
+    }
+    return ptr;
+}
+
+void heap_caps_free(void* ptr) {
+    free(ptr);
+}
+
+// The ESP32's usable DRAM
+#define HOST_HEAP_SIZE (300 * 1024)
+
+static std::atomic<size_t> host_heap_min_free(HOST_HEAP_SIZE);
+
+size_t heap_caps_get_free_size(uint32_t caps) {
+    if (caps & MALLOC_CAP_SPIRAM) {
+        return 0;
+    }
+    // Whatever the process had allocated by the first query is not charged;
+    // main-arena growth since then comes off HOST_HEAP_SIZE
+    static const size_t baseline = mallinfo2().uordblks;
+    size_t in_use = mallinfo2().uordblks;
+    size_t charged = in_use > baseline ? in_use - baseline : 0;
+    size_t free_size = charged < HOST_HEAP_SIZE ? HOST_HEAP_SIZE - charged : 0;
+
+    size_t min_free = host_heap_min_free.load();
+    while (free_size < min_free && !host_heap_min_free.compare_exchange_weak(min_free, free_size)) {
+    }
+    return free_size;
+}
+
+size_t heap_caps_get_total_size(uint32_t caps) {
+    return caps & MALLOC_CAP_SPIRAM ? 0 : HOST_HEAP_SIZE;
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps) {
+    if (caps & MALLOC_CAP_SPIRAM) {
+        return 0;
+    }
+    heap_caps_get_free_size(caps);
+    return host_heap_min_free.load();
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps) {
+    return heap_caps_get_free_size(caps);
+}
+
+// esp_system
+
+void esp_restart(void) {
+    fflush(stdout);
+    fflush(stderr);
+    _Exit(0);
+}
+
+uint32_t esp_get_free_heap_size(void) {
+    return (uint32_t)heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+}
+
+// esp_event
+
+struct EventHandler {
+    esp_event_base_t base;
+    int32_t id;
+    esp_event_handler_t handler;
+    void* arg;
+};
+
+static std::mutex event_lock;
+static std::vector<EventHandler*> event_handlers;
+static bool default_loop_created = false;
+
+esp_err_t esp_event_loop_create_default(void) {
+    std::lock_guard<std::mutex> guard(event_lock);
+    if (default_loop_created) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    default_loop_created = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_event_loop_delete_default(void) {
+    std::lock_guard<std::mutex> guard(event_lock);
+    default_loop_created = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_event_handler_instance_register(esp_event_base_t event_base, int32_t event_id,
+                                              esp_event_handler_t event_handler, void* event_handler_arg,
+                                              esp_event_handler_instance_t* instance) {
+    if (event_handler == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    EventHandler* entry = new EventHandler{ event_base, event_id, event_handler, event_handler_arg };
+    std::lock_guard<std::mutex> guard(event_lock);
+    event_handlers.push_back(entry);
+    if (instance) {
+        *instance = entry;
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_event_handler_instance_unregister(esp_event_base_t event_base, int32_t event_id,
+                                                esp_event_handler_instance_t instance) {
+    std::lock_guard<std::mutex> guard(event_lock);
+    for (size_t i = 0; i < event_handlers.size(); i++) {
+        if (event_handlers[i] == instance) {
+            delete event_handlers[i];
+            event_handlers.erase(event_handlers.begin() + i);
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t esp_event_post(esp_event_base_t event_base, int32_t event_id, const void* event_data,
+                         size_t event_data_size, TickType_t ticks_to_wait) {
+    // Copy the matching handlers so they may (un)register from the callback
+    std::vector<EventHandler> matching;
+    {
+        std::lock_guard<std::mutex> guard(event_lock);
+        for (const EventHandler* entry : event_handlers) {
+            bool base_match = entry->base == ESP_EVENT_ANY_BASE || entry->base == event_base;
+            bool id_match = entry->id == ESP_EVENT_ANY_ID || entry->id == event_id;
+            if (base_match && id_match) {
+                matching.push_back(*entry);
+            }
+        }
+    }
+    for (const EventHandler& entry : matching) {
+        entry.handler(entry.arg, event_base, event_id, const_cast<void*>(event_data));
+    }
+    return ESP_OK;
+}
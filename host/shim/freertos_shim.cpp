@@ -0,0 +1,411 @@
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <time.h>
+#include <vector>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+
+// One FreeRTOS task. Control blocks are never freed, so a stale handle
+// stays safe to use after its task has gone.
+struct HostTask {
+    int32_t id;
+    char name[16];
+    TaskFunction_t function;
+    void* parameters;
+    UBaseType_t priority;
+    BaseType_t core_id;
+    uint32_t stack_depth;           // As requested, 0 for threads not created as tasks
+
+    std::mutex lock;
+    std::condition_variable wake;
+    uint32_t notify_value;
+    bool deleted;
+
+    // CPU-time clock of the thread; guarded by task_list_lock
+    clockid_t cpu_clock;
+    bool exited;
+    uint32_t run_time_us;
+};
+
+// Thrown inside a task to unwind it when it is deleted
+struct TaskExit {};
+
+static std::atomic<int32_t> next_task_id(1);
+static thread_local HostTask* current_task = nullptr;
+
+// Every control block with a thread behind it, for uxTaskGetSystemState()
+static std::mutex task_list_lock;
+static std::vector<HostTask*> task_list;
+
+// Called on the task's own thread
+static void attach_thread(HostTask* task) {
+    std::lock_guard<std::mutex> guard(task_list_lock);
+    if (pthread_getcpuclockid(pthread_self(), &task->cpu_clock) != 0) {
+        task->cpu_clock = CLOCK_THREAD_CPUTIME_ID;
+    }
+    task->exited = false;
+    task->run_time_us = 0;
+    task_list.push_back(task);
+}
+
+static void detach_thread(HostTask* task) {
+    std::lock_guard<std::mutex> guard(task_list_lock);
+    task->exited = true;
+}
+
+// Threads adopted by self() have no FreeRTOS counterpart and no known stack
+// size, so the task list leaves them out; lock must be held
+static bool listed(const HostTask* task) {
+    return !task->exited && task->function != nullptr;
+}
+
+// Threads not created through xTaskCreate (main, injector threads) get a
+// control block on first use so they can block and be notified like tasks
+static HostTask* self() {
+    if (current_task == nullptr) {
+        HostTask* task = new HostTask();
+        task->id = next_task_id.fetch_add(1);
+        pthread_getname_np(pthread_self(), task->name, sizeof(task->name));
+        task->function = nullptr;
+        task->parameters = nullptr;
+        task->priority = 1;
+        task->core_id = tskNO_AFFINITY;
+        task->stack_depth = 0;
+        task->notify_value = 0;
+        task->deleted = false;
+        current_task = task;
+        attach_thread(task);
+    }
+    return current_task;
+}
+
+// Unwind the calling task if someone deleted it; lock must be held
+static void check_deleted(HostTask* task) {
+    if (task->deleted && task->function != nullptr) {
+        throw TaskExit();
+    }
+}
+
+static std::chrono::steady_clock::time_point deadline_after(TickType_t ticks) {
+    return std::chrono::steady_clock::now() + std::chrono::milliseconds(ticks * portTICK_PERIOD_MS);
+}
+
+static void task_entry(HostTask* task) {
+    current_task = task;
+    pthread_setname_np(pthread_self(), task->name);
+    attach_thread(task);
+    try {
+        task->function(task->parameters);
+        // Returning from a task function is a bug on FreeRTOS too
+        fprintf(stderr, "Task '%s' returned from its function\n", task->name);
+        abort();
+    } catch (const TaskExit&) {
+    }
+    detach_thread(task);
+}
+
+// Critical sections
+
+void vPortEnterCritical(portMUX_TYPE* mux) {
+    int32_t id = self()->id;
+    if (__atomic_load_n(&mux->owner, __ATOMIC_RELAXED) == id) {
+        mux->count++;
+        return;
+    }
+    int32_t expected = 0;
+    while (!__atomic_compare_exchange_n(&mux->owner, &expected, id, false,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        expected = 0;
+        sched_yield();
+    }
+    mux->count = 1;
+}
+
+void vPortExitCritical(portMUX_TYPE* mux) {
+    if (--mux->count == 0) {
+        __atomic_store_n(&mux->owner, 0, __ATOMIC_RELEASE);
+    }
+}
+
+void vPortYield(void) {
+    sched_yield();
+}
+
+BaseType_t xPortGetCoreID(void) {
+    HostTask* task = self();
+    if (task->core_id != tskNO_AFFINITY) {
+        return task->core_id;
+    }
+    int cpu = sched_getcpu();
+    return cpu < 0 ? 0 : cpu % portNUM_PROCESSORS;
+}
+
+// Tasks
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name, uint32_t stack_depth,
+                                   void* parameters, UBaseType_t priority, TaskHandle_t* created_task,
+                                   BaseType_t core_id) {
+    HostTask* task = new HostTask();
+    task->id = next_task_id.fetch_add(1);
+    snprintf(task->name, sizeof(task->name), "%s", name ? name : "");
+    task->function = function;
+    task->parameters = parameters;
+    task->priority = priority;
+    task->core_id = core_id;
+    task->stack_depth = stack_depth;
+    task->notify_value = 0;
+    task->deleted = false;
+    if (created_task) {
+        *created_task = task;
+    }
+
+    std::thread thread(task_entry, task);
+    if (core_id != tskNO_AFFINITY && (unsigned)core_id < std::thread::hardware_concurrency()) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(core_id, &cpus);
+        pthread_setaffinity_np(thread.native_handle(), sizeof(cpus), &cpus);
+    }
+    thread.detach();
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    if (task == nullptr || task == current_task) {
+        if (self()->function == nullptr) {
+            // Not a task thread, e.g. main() deleting itself like app_main
+            pthread_exit(nullptr);
+        }
+        throw TaskExit();
+    }
+    std::lock_guard<std::mutex> guard(task->lock);
+    task->deleted = true;
+    task->wake.notify_all();
+}
+
+void vTaskDelay(TickType_t ticks) {
+    HostTask* task = self();
+    std::unique_lock<std::mutex> guard(task->lock);
+    task->wake.wait_until(guard, deadline_after(ticks), [task] { return task->deleted; });
+    check_deleted(task);
+}
+
+TickType_t xTaskGetTickCount(void) {
+    return (TickType_t)(esp_timer_get_time() / (1000 * portTICK_PERIOD_MS));
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+    return self();
+}
+
+char* pcTaskGetName(TaskHandle_t task) {
+    return task ? task->name : self()->name;
+}
+
+void xTaskNotifyGive(TaskHandle_t task) {
+    std::lock_guard<std::mutex> guard(task->lock);
+    task->notify_value++;
+    task->wake.notify_one();
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks_to_wait) {
+    HostTask* task = self();
+    std::unique_lock<std::mutex> guard(task->lock);
+    auto ready = [task] { return task->notify_value != 0 || task->deleted; };
+    if (ticks_to_wait == portMAX_DELAY) {
+        task->wake.wait(guard, ready);
+    } else {
+        task->wake.wait_until(guard, deadline_after(ticks_to_wait), ready);
+    }
+    check_deleted(task);
+
+    uint32_t value = task->notify_value;
+    if (value != 0) {
+        task->notify_value = clear_on_exit ? 0 : value - 1;
+    }
+    return value;
+}
+
+UBaseType_t uxTaskGetNumberOfTasks(void) {
+    std::lock_guard<std::mutex> guard(task_list_lock);
+    UBaseType_t count = 0;
+    for (HostTask* task : task_list) {
+        count += listed(task) ? 1 : 0;
+    }
+    return count;
+}
+
+UBaseType_t uxTaskGetSystemState(TaskStatus_t* tasks, UBaseType_t array_size, uint32_t* total_run_time) {
+    std::lock_guard<std::mutex> guard(task_list_lock);
+    UBaseType_t count = 0;
+    for (HostTask* task : task_list) {
+        if (!listed(task)) {
+            continue;
+        }
+        if (count == array_size) {
+            // FreeRTOS fills nothing when the array is too small
+            return 0;
+        }
+        // The clock of a thread that exited without telling us stops reading
+        struct timespec ts;
+        if (clock_gettime(task->cpu_clock, &ts) == 0) {
+            task->run_time_us = (uint32_t)((uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000);
+        }
+
+        TaskStatus_t& status = tasks[count++];
+        status.xHandle = task;
+        status.pcTaskName = task->name;
+        status.xTaskNumber = (UBaseType_t)task->id;
+        status.eCurrentState = eRunning;
+        status.uxCurrentPriority = task->priority;
+        status.uxBasePriority = task->priority;
+        status.ulRunTimeCounter = task->run_time_us;
+        status.pxStackBase = nullptr;
+        // Stack use is not measured: report the whole stack as never touched
+        status.usStackHighWaterMark = task->stack_depth;
+        status.xCoreID = task->core_id;
+    }
+    if (total_run_time) {
+        *total_run_time = (uint32_t)esp_timer_get_time();
+    }
+    return count;
+}
+
+TaskHandle_t xTaskGetIdleTaskHandleForCore(BaseType_t core_id) {
+    return nullptr;
+}
+
+// Queues and semaphores
+
+struct HostQueue {
+    UBaseType_t length;
+    UBaseType_t item_size;
+    std::vector<uint8_t> storage;
+    UBaseType_t head;
+    UBaseType_t count;
+
+    std::mutex lock;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+};
+
+// Queue waits poll in slices so a deleted task notices promptly
+static const std::chrono::milliseconds QUEUE_WAIT_SLICE(10);
+
+// Wait on `cv` until `ready` or the ticks run out, unwinding if the calling
+// task is deleted meanwhile. Returns ready().
+template <typename Ready>
+static bool queue_wait(std::unique_lock<std::mutex>& guard, std::condition_variable& cv,
+                       TickType_t ticks_to_wait, Ready ready) {
+    HostTask* task = self();
+    auto deadline = deadline_after(ticks_to_wait);
+    while (!ready()) {
+        if (ticks_to_wait != portMAX_DELAY && std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+        cv.wait_for(guard, QUEUE_WAIT_SLICE);
+        std::lock_guard<std::mutex> task_guard(task->lock);
+        check_deleted(task);
+    }
+    return true;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+    if (length == 0) {
+        return nullptr;
+    }
+    HostQueue* queue = new HostQueue();
+    queue->length = length;
+    queue->item_size = item_size;
+    queue->storage.resize((size_t)length * item_size);
+    queue->head = 0;
+    queue->count = 0;
+    return queue;
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial_count) {
+    QueueHandle_t queue = xQueueCreate(max_count, 0);
+    if (queue) {
+        queue->count = initial_count;
+    }
+    return queue;
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+    delete queue;
+}
+
+BaseType_t xQueueGenericSend(QueueHandle_t queue, const void* item, TickType_t ticks_to_wait, BaseType_t to_front) {
+    std::unique_lock<std::mutex> guard(queue->lock);
+    if (!queue_wait(guard, queue->not_full, ticks_to_wait, [queue] { return queue->count < queue->length; })) {
+        return errQUEUE_FULL;
+    }
+
+    UBaseType_t slot;
+    if (to_front) {
+        queue->head = (queue->head + queue->length - 1) % queue->length;
+        slot = queue->head;
+    } else {
+        slot = (queue->head + queue->count) % queue->length;
+    }
+    if (queue->item_size) {
+        memcpy(&queue->storage[(size_t)slot * queue->item_size], item, queue->item_size);
+    }
+    queue->count++;
+    queue->not_empty.notify_one();
+    return pdPASS;
+}
+
+static BaseType_t queue_take(QueueHandle_t queue, void* buffer, TickType_t ticks_to_wait, bool remove) {
+    std::unique_lock<std::mutex> guard(queue->lock);
+    if (!queue_wait(guard, queue->not_empty, ticks_to_wait, [queue] { return queue->count != 0; })) {
+        return errQUEUE_EMPTY;
+    }
+
+    if (queue->item_size && buffer) {
+        memcpy(buffer, &queue->storage[(size_t)queue->head * queue->item_size], queue->item_size);
+    }
+    if (remove) {
+        queue->head = (queue->head + 1) % queue->length;
+        queue->count--;
+        queue->not_full.notify_one();
+    }
+    return pdPASS;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* buffer, TickType_t ticks_to_wait) {
+    return queue_take(queue, buffer, ticks_to_wait, true);
+}
+
+BaseType_t xQueuePeek(QueueHandle_t queue, void* buffer, TickType_t ticks_to_wait) {
+    return queue_take(queue, buffer, ticks_to_wait, false);
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue) {
+    std::lock_guard<std::mutex> guard(queue->lock);
+    queue->head = 0;
+    queue->count = 0;
+    queue->not_full.notify_all();
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    std::lock_guard<std::mutex> guard(queue->lock);
+    return queue->count;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue) {
+    std::lock_guard<std::mutex> guard(queue->lock);
+    return queue->length - queue->count;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stdint.h>
+
+// Host shim of ESP-IDF esp_cpu.h. The cycle counter counts nanoseconds of
+// CLOCK_MONOTONIC and wraps at 32 bits like CCOUNT; see esp_rom_sys.h for
+// the matching frequency.
+
+typedef uint32_t esp_cpu_cycle_count_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+esp_cpu_cycle_count_t esp_cpu_get_cycle_count(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Host shim of ESP-IDF esp_heap_caps.h. Capabilities are accepted and
+// ignored; everything comes from the C heap. Free sizes model the ESP32's
+// 300 KB of DRAM: growth of the main malloc arena since the first query is
+// subtracted from it. There is no PSRAM to report, so size queries for
+// MALLOC_CAP_SPIRAM return 0 even though such allocations succeed.
+
+#define MALLOC_CAP_EXEC         (1 << 0)
+#define MALLOC_CAP_32BIT        (1 << 1)
+#define MALLOC_CAP_8BIT         (1 << 2)
+#define MALLOC_CAP_DMA          (1 << 3)
+#define MALLOC_CAP_SPIRAM       (1 << 10)
+#define MALLOC_CAP_INTERNAL     (1 << 11)
+#define MALLOC_CAP_DEFAULT      (1 << 12)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void* heap_caps_malloc(size_t size, uint32_t caps);
+void* heap_caps_calloc(size_t n, size_t size, uint32_t caps);
+void* heap_caps_aligned_alloc(size_t alignment, size_t size, uint32_t caps);
+void heap_caps_free(void* ptr);
+size_t heap_caps_get_free_size(uint32_t caps);
+size_t heap_caps_get_total_size(uint32_t caps);
+
+// Lowest free size any query has seen, not every allocation
+size_t heap_caps_get_minimum_free_size(uint32_t caps);
+
+// The modelled heap never fragments: the free size
+size_t heap_caps_get_largest_free_block(uint32_t caps);
+
+#ifdef __cplusplus
+}
+#endif
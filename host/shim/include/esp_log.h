@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+
+// Host shim of ESP-IDF esp_log.h. Lines go to stderr in the device format,
+// without colours. Per-tag levels work as with esp_log_level_set().
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    ESP_LOG_NONE,
+    ESP_LOG_ERROR,
+    ESP_LOG_WARN,
+    ESP_LOG_INFO,
+    ESP_LOG_DEBUG,
+    ESP_LOG_VERBOSE
+} esp_log_level_t;
+
+void esp_log_level_set(const char* tag, esp_log_level_t level);
+esp_log_level_t esp_log_level_get(const char* tag);
+
+// Milliseconds since start, as printed in log lines
+uint32_t esp_log_timestamp(void);
+
+void esp_log_write(esp_log_level_t level, const char* tag, const char* format, ...);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define ESP_LOG_LEVEL(level, letter, tag, format, ...) do {                     \
+        if (esp_log_level_get(tag) >= (level)) {                                \
+            esp_log_write((level), (tag), "%c (%lu) %s: " format "\n", (letter), \
+                          (unsigned long)esp_log_timestamp(), (tag), ##__VA_ARGS__); \
+        }                                                                       \
+    } while (0)
+
+#define ESP_LOGE(tag, format, ...) ESP_LOG_LEVEL(ESP_LOG_ERROR, 'E', tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) ESP_LOG_LEVEL(ESP_LOG_WARN, 'W', tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) ESP_LOG_LEVEL(ESP_LOG_INFO, 'I', tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) ESP_LOG_LEVEL(ESP_LOG_DEBUG, 'D', tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) ESP_LOG_LEVEL(ESP_LOG_VERBOSE, 'V', tag, format, ##__VA_ARGS__)
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <stdint.h>
+
+// Host shim of ESP-IDF esp_rom_sys.h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Cycles of esp_cpu_get_cycle_count() per microsecond: 1000, one per ns
+uint32_t esp_rom_get_cpu_ticks_per_us(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+
+// Host shim of ESP-IDF esp_system.h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Exits the process; there is nothing to reboot into
+void esp_restart(void);
+
+uint32_t esp_get_free_heap_size(void);
+
+#ifdef __cplusplus
+}
+#endif
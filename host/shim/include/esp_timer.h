@@ -0,0 +1,15 @@
+#pragma once
+
+#include <stdint.h>
+
+// Host shim of ESP-IDF esp_timer.h: microseconds since process start
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int64_t esp_timer_get_time(void);
+
+#ifdef __cplusplus
+}
+#endif
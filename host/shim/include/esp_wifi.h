@@ -0,0 +1,129 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_event.h"
+
+// Host shim of the ESP-IDF v5 esp_wifi.h promiscuous API for the ESP32.
+// The radio is simulated by host_wifi.h: frames handed to
+// host_wifi_inject() reach the registered RX callback with the same packet
+// layout the driver produces.
+
+typedef enum {
+    WIFI_MODE_NULL = 0,
+    WIFI_MODE_STA,
+    WIFI_MODE_AP,
+    WIFI_MODE_APSTA,
+} wifi_mode_t;
+
+typedef enum {
+    WIFI_SECOND_CHAN_NONE = 0,
+    WIFI_SECOND_CHAN_ABOVE,
+    WIFI_SECOND_CHAN_BELOW,
+} wifi_second_chan_t;
+
+typedef enum {
+    WIFI_PKT_MGMT,
+    WIFI_PKT_CTRL,
+    WIFI_PKT_DATA,
+    WIFI_PKT_MISC,
+} wifi_promiscuous_pkt_type_t;
+
+// Receive control header as laid out by the ESP32 (not S2/S3/C3) driver
+typedef struct {
+    signed rssi:8;                  // dBm
+    unsigned rate:5;                // wifi_phy_rate_t of legacy frames
+    unsigned :1;
+    unsigned sig_mode:2;            // 0 legacy, 1 HT (802.11n), 3 VHT
+    unsigned :16;
+    unsigned mcs:7;                 // HT MCS index
+    unsigned cwb:1;                 // 0 20 MHz, 1 40 MHz
+    unsigned :16;
+    unsigned smoothing:1;
+    unsigned not_sounding:1;
+    unsigned :1;
+    unsigned aggregation:1;
+    unsigned stbc:2;
+    unsigned fec_coding:1;
+    unsigned sgi:1;                 // Short guard interval
+    signed noise_floor:8;           // dBm
+    unsigned ampdu_cnt:8;
+    unsigned channel:4;             // Primary channel
+    unsigned secondary_channel:4;
+    unsigned :8;
+    unsigned timestamp:32;          // Local receive time, us
+    unsigned :32;
+    unsigned :31;
+    unsigned ant:1;
+    unsigned sig_len:12;            // Frame length including the 4-byte FCS
+    unsigned :12;
+    unsigned rx_state:8;            // 0 unless the frame is in error
+} wifi_pkt_rx_ctrl_t;
+
+typedef struct {
+    wifi_pkt_rx_ctrl_t rx_ctrl;
+    uint8_t payload[0];             // 802.11 frame, sig_len bytes
+} wifi_promiscuous_pkt_t;
+
+typedef struct {
+    uint32_t filter_mask;
+} wifi_promiscuous_filter_t;
+
+#define WIFI_PROMIS_FILTER_MASK_ALL             0xFFFFFFFF
+#define WIFI_PROMIS_FILTER_MASK_MGMT            (1)
+#define WIFI_PROMIS_FILTER_MASK_CTRL            (1 << 1)
+#define WIFI_PROMIS_FILTER_MASK_DATA            (1 << 2)
+#define WIFI_PROMIS_FILTER_MASK_MISC            (1 << 3)
+#define WIFI_PROMIS_FILTER_MASK_DATA_MPDU       (1 << 4)
+#define WIFI_PROMIS_FILTER_MASK_DATA_AMPDU      (1 << 5)
+#define WIFI_PROMIS_FILTER_MASK_FCSFAIL         (1 << 6)
+
+#define WIFI_PROMIS_CTRL_FILTER_MASK_ALL        0xFF800000
+#define WIFI_PROMIS_CTRL_FILTER_MASK_WRAPPER    (1 << 23)
+#define WIFI_PROMIS_CTRL_FILTER_MASK_BAR        (1 << 24)
+#define WIFI_PROMIS_CTRL_FILTER_MASK_BA         (1 << 25)
+#define WIFI_PROMIS_CTRL_FILTER_MASK_PSPOLL     (1 << 26)
+#define WIFI_PROMIS_CTRL_FILTER_MASK_RTS        (1 << 27)
+#define WIFI_PROMIS_CTRL_FILTER_MASK_CTS        (1 << 28)
+#define WIFI_PROMIS_CTRL_FILTER_MASK_ACK        (1 << 29)
+#define WIFI_PROMIS_CTRL_FILTER_MASK_CFEND      (1 << 30)
+#define WIFI_PROMIS_CTRL_FILTER_MASK_CFENDACK   (1u << 31)
+
+typedef void (*wifi_promiscuous_cb_t)(void* buf, wifi_promiscuous_pkt_type_t type);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+ESP_EVENT_DECLARE_BASE(WIFI_EVENT);
+
+#ifdef __cplusplus
+}
+#endif
+
+typedef enum {
+    WIFI_EVENT_WIFI_READY = 0,
+    WIFI_EVENT_SCAN_DONE,
+    WIFI_EVENT_STA_START,
+    WIFI_EVENT_STA_STOP,
+} wifi_event_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+esp_err_t esp_wifi_set_mode(wifi_mode_t mode);
+esp_err_t esp_wifi_start(void);
+esp_err_t esp_wifi_stop(void);
+esp_err_t esp_wifi_set_channel(uint8_t primary, wifi_second_chan_t second);
+esp_err_t esp_wifi_get_channel(uint8_t* primary, wifi_second_chan_t* second);
+esp_err_t esp_wifi_set_promiscuous(bool enable);
+esp_err_t esp_wifi_get_promiscuous(bool* enable);
+esp_err_t esp_wifi_set_promiscuous_rx_cb(wifi_promiscuous_cb_t cb);
+esp_err_t esp_wifi_set_promiscuous_filter(const wifi_promiscuous_filter_t* filter);
+esp_err_t esp_wifi_set_promiscuous_ctrl_filter(const wifi_promiscuous_filter_t* filter);
+
+#ifdef __cplusplus
+}
+#endif
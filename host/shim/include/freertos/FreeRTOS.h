@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Host shim of the ESP-IDF FreeRTOS port. Tasks are POSIX threads; the tick
+// is 1 ms. Critical sections are recursive spinlocks per portMUX_TYPE, so
+// they serialize exactly what they serialize on the dual-core ESP32 but do
+// not mask anything else.
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t configSTACK_DEPTH_TYPE;
+
+#define configTICK_RATE_HZ          1000
+#define configMAX_PRIORITIES        25
+#define configUSE_TRACE_FACILITY    1
+#define configGENERATE_RUN_TIME_STATS 1
+#define configTASKLIST_INCLUDE_COREID 1
+#define portNUM_PROCESSORS          2
+#define portTICK_PERIOD_MS          ((TickType_t)1000 / configTICK_RATE_HZ)
+#define portMAX_DELAY               ((TickType_t)0xFFFFFFFF)
+#define pdMS_TO_TICKS(ms)           ((TickType_t)(((uint64_t)(ms) * configTICK_RATE_HZ) / 1000))
+
+#define pdFALSE                     ((BaseType_t)0)
+#define pdTRUE                      ((BaseType_t)1)
+#define pdFAIL                      pdFALSE
+#define pdPASS                      pdTRUE
+#define errQUEUE_EMPTY              ((BaseType_t)0)
+#define errQUEUE_FULL               ((BaseType_t)0)
+
+#define tskNO_AFFINITY              ((BaseType_t)0x7FFFFFFF)
+
+typedef struct {
+    int32_t owner;          // Host task id holding the lock, 0 if free
+    uint32_t count;         // Recursion depth
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED { 0, 0 }
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void vPortEnterCritical(portMUX_TYPE* mux);
+void vPortExitCritical(portMUX_TYPE* mux);
+void vPortYield(void);
+BaseType_t xPortGetCoreID(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define portENTER_CRITICAL(mux)         vPortEnterCritical(mux)
+#define portEXIT_CRITICAL(mux)          vPortExitCritical(mux)
+#define portENTER_CRITICAL_ISR(mux)     vPortEnterCritical(mux)
+#define portEXIT_CRITICAL_ISR(mux)      vPortExitCritical(mux)
+#define portYIELD()                     vPortYield()
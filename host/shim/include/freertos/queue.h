@@ -0,0 +1,30 @@
+#pragma once
+
+#include "FreeRTOS.h"
+
+// Host shim of FreeRTOS queue.h: fixed-size copies under a mutex
+
+typedef struct HostQueue* QueueHandle_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size);
+void vQueueDelete(QueueHandle_t queue);
+
+BaseType_t xQueueGenericSend(QueueHandle_t queue, const void* item, TickType_t ticks_to_wait, BaseType_t to_front);
+BaseType_t xQueueReceive(QueueHandle_t queue, void* buffer, TickType_t ticks_to_wait);
+BaseType_t xQueuePeek(QueueHandle_t queue, void* buffer, TickType_t ticks_to_wait);
+BaseType_t xQueueReset(QueueHandle_t queue);
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define xQueueSend(queue, item, ticks)          xQueueGenericSend((queue), (item), (ticks), pdFALSE)
+#define xQueueSendToBack(queue, item, ticks)    xQueueGenericSend((queue), (item), (ticks), pdFALSE)
+#define xQueueSendToFront(queue, item, ticks)   xQueueGenericSend((queue), (item), (ticks), pdTRUE)
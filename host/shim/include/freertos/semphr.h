@@ -0,0 +1,25 @@
+#pragma once
+
+#include "queue.h"
+
+// Host shim of FreeRTOS semphr.h. Semaphores are queues of empty items, as
+// in FreeRTOS; mutexes have no priority inheritance.
+
+typedef QueueHandle_t SemaphoreHandle_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial_count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define xSemaphoreCreateBinary()        xSemaphoreCreateCounting(1, 0)
+#define xSemaphoreCreateMutex()         xSemaphoreCreateCounting(1, 1)
+#define xSemaphoreTake(sem, ticks)      xQueueReceive((sem), NULL, (ticks))
+#define xSemaphoreGive(sem)             xQueueGenericSend((sem), NULL, 0, pdFALSE)
+#define vSemaphoreDelete(sem)           vQueueDelete(sem)
+#define uxSemaphoreGetCount(sem)        uxQueueMessagesWaiting(sem)
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "FreeRTOS.h"
+
+// Host shim of FreeRTOS task.h. Priorities are recorded but not enforced;
+// the host scheduler decides who runs. A task pinned to core N is pinned to
+// host CPU N where that CPU exists.
+
+typedef struct HostTask* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+typedef uint8_t StackType_t;
+
+typedef enum {
+    eRunning = 0,
+    eReady,
+    eBlocked,
+    eSuspended,
+    eDeleted,
+    eInvalid
+} eTaskState;
+
+// Run-time counters are the thread's CPU time in µs. Threads run wherever
+// the host puts them, so every live task reports eRunning. Stack use is
+// not tracked: the high-water mark is the whole stack depth requested.
+typedef struct {
+    TaskHandle_t xHandle;
+    const char* pcTaskName;
+    UBaseType_t xTaskNumber;
+    eTaskState eCurrentState;
+    UBaseType_t uxCurrentPriority;
+    UBaseType_t uxBasePriority;
+    uint32_t ulRunTimeCounter;
+    StackType_t* pxStackBase;
+    configSTACK_DEPTH_TYPE usStackHighWaterMark;
+    BaseType_t xCoreID;
+} TaskStatus_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name, uint32_t stack_depth,
+                                   void* parameters, UBaseType_t priority, TaskHandle_t* created_task,
+                                   BaseType_t core_id);
+
+// Deleting another task takes effect the next time it blocks
+void vTaskDelete(TaskHandle_t task);
+
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount(void);
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+char* pcTaskGetName(TaskHandle_t task);
+
+void xTaskNotifyGive(TaskHandle_t task);
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks_to_wait);
+
+// Live tasks, including threads that used the API without being created as tasks
+UBaseType_t uxTaskGetNumberOfTasks(void);
+
+// `total_run_time` is µs since start, like the ESP-IDF run-time clock
+UBaseType_t uxTaskGetSystemState(TaskStatus_t* tasks, UBaseType_t array_size, uint32_t* total_run_time);
+
+// There are no idle tasks on the host; always nullptr
+TaskHandle_t xTaskGetIdleTaskHandleForCore(BaseType_t core_id);
+
+#ifdef __cplusplus
+}
+#endif
+
+static inline BaseType_t xTaskCreate(TaskFunction_t function, const char* name, uint32_t stack_depth,
+                                     void* parameters, UBaseType_t priority, TaskHandle_t* created_task) {
+    return xTaskCreatePinnedToCore(function, name, stack_depth, parameters, priority, created_task,
+                                   tskNO_AFFINITY);
+}
+
+#define taskYIELD()     vPortYield()
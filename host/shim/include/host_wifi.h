@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdint.h>
+#include "esp_wifi.h"
+
+// Simulated radio behind the esp_wifi.h shim; host build only.
+//
+// host_wifi_inject() plays the part of the Wi-Fi driver task receiving one
+// frame: it classifies the frame from its frame control field, applies the
+// promiscuous type and control-subtype filters, stamps the receive time and
+// calls the registered RX callback on the calling thread with a
+// wifi_promiscuous_pkt_t built in a private buffer, which is only valid for
+// the duration of the call as on the device.
+
+// Largest frame (including FCS) sig_len can describe
+#define HOST_WIFI_MAX_FRAME     4095
+
+// The receive timer runs this far ahead of esp_timer_get_time(), so that it
+// wraps one second into a run as it eventually does on a device
+#define HOST_WIFI_RX_TIMER_OFFSET   (0xFFFFFFFFu - 1000000u + 1u)
+
+struct HostWifiStats {
+    uint32_t delivered;         // Frames handed to the RX callback
+    uint32_t filtered;          // Frames rejected by the promiscuous filters
+    uint32_t off_channel;       // Frames sent on another channel than the tuned one
+    uint32_t not_listening;     // Frames injected while promiscuous mode was off
+    uint32_t channel_changes;
+};
+
+// Deliver `frame` (`len` bytes, FCS included) with the given receive
+// control header. `rx_ctrl.channel` 0 means the tuned channel; sig_len and
+// timestamp are filled in. Returns true if the callback was called.
+bool host_wifi_inject(const uint8_t* frame, uint16_t len, const wifi_pkt_rx_ctrl_t& rx_ctrl);
+
+// Time esp_wifi_set_channel() blocks for, like the radio retuning (default 0)
+void host_wifi_set_retune_us(uint32_t retune_us);
+
+uint8_t host_wifi_get_channel();
+
+HostWifiStats host_wifi_get_stats();
@@ -0,0 +1,178 @@
+#include <atomic>
+#include <string.h>
+#include <time.h>
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "host_wifi.h"
+
+ESP_EVENT_DEFINE_BASE(WIFI_EVENT);
+
+static std::atomic<bool> started(false);
+static std::atomic<bool> promiscuous(false);
+static std::atomic<wifi_promiscuous_cb_t> rx_cb(nullptr);
+static std::atomic<uint8_t> channel(1);
+static std::atomic<uint32_t> retune_us(0);
+
+// The driver default when no filter is set: management and data frames
+static std::atomic<uint32_t> filter_mask(WIFI_PROMIS_FILTER_MASK_MGMT | WIFI_PROMIS_FILTER_MASK_DATA |
+                                         WIFI_PROMIS_FILTER_MASK_MISC);
+static std::atomic<uint32_t> ctrl_filter_mask(WIFI_PROMIS_CTRL_FILTER_MASK_ALL);
+
+static std::atomic<uint32_t> delivered_count(0);
+static std::atomic<uint32_t> filtered_count(0);
+static std::atomic<uint32_t> off_channel_count(0);
+static std::atomic<uint32_t> not_listening_count(0);
+static std::atomic<uint32_t> channel_change_count(0);
+
+esp_err_t esp_wifi_set_mode(wifi_mode_t mode) {
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_start(void) {
+    started = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_stop(void) {
+    started = false;
+    promiscuous = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_channel(uint8_t primary, wifi_second_chan_t second) {
+    if (primary < 1 || primary > 14) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uint32_t delay_us = retune_us.load();
+    if (delay_us) {
+        struct timespec ts = { (time_t)(delay_us / 1000000), (long)(delay_us % 1000000) * 1000 };
+        nanosleep(&ts, nullptr);
+    }
+    if (channel.exchange(primary) != primary) {
+        channel_change_count.fetch_add(1, std::memory_order_relaxed);
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_channel(uint8_t* primary, wifi_second_chan_t* second) {
+    if (primary == nullptr || second == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *primary = channel.load();
+    *second = WIFI_SECOND_CHAN_NONE;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_promiscuous(bool enable) {
+    promiscuous = enable;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_promiscuous(bool* enable) {
+    if (enable == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *enable = promiscuous.load();
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_promiscuous_rx_cb(wifi_promiscuous_cb_t cb) {
+    rx_cb = cb;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_promiscuous_filter(const wifi_promiscuous_filter_t* filter) {
+    if (filter == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    filter_mask = filter->filter_mask;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_promiscuous_ctrl_filter(const wifi_promiscuous_filter_t* filter) {
+    if (filter == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    ctrl_filter_mask = filter->filter_mask;
+    return ESP_OK;
+}
+
+// Driver packet type and whether the promiscuous filters let it through
+static bool classify(const uint8_t* frame, uint16_t len, wifi_promiscuous_pkt_type_t* type) {
+    if (len < 2) {
+        *type = WIFI_PKT_MISC;
+        return (filter_mask.load() & WIFI_PROMIS_FILTER_MASK_MISC) != 0;
+    }
+    uint8_t frame_type = (frame[0] >> 2) & 0x03;
+    uint8_t subtype = (frame[0] >> 4) & 0x0F;
+    switch (frame_type) {
+        case 0:
+            *type = WIFI_PKT_MGMT;
+            return (filter_mask.load() & WIFI_PROMIS_FILTER_MASK_MGMT) != 0;
+        case 1:
+            *type = WIFI_PKT_CTRL;
+            // Control subtypes 7-15 map to filter bits 23-31
+            return (filter_mask.load() & WIFI_PROMIS_FILTER_MASK_CTRL) != 0 &&
+                   (ctrl_filter_mask.load() & (1u << (subtype + 16))) != 0;
+        case 2:
+            *type = WIFI_PKT_DATA;
+            return (filter_mask.load() & WIFI_PROMIS_FILTER_MASK_DATA) != 0;
+        default:
+            *type = WIFI_PKT_MISC;
+            return (filter_mask.load() & WIFI_PROMIS_FILTER_MASK_MISC) != 0;
+    }
+}
+
+bool host_wifi_inject(const uint8_t* frame, uint16_t len, const wifi_pkt_rx_ctrl_t& rx_ctrl) {
+    if (len > HOST_WIFI_MAX_FRAME) {
+        return false;
+    }
+    wifi_promiscuous_cb_t cb = rx_cb.load();
+    if (!started || !promiscuous || cb == nullptr) {
+        not_listening_count.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    uint8_t tuned = channel.load();
+    if (rx_ctrl.channel != 0 && rx_ctrl.channel != tuned) {
+        off_channel_count.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    wifi_promiscuous_pkt_type_t type;
+    if (!classify(frame, len, &type)) {
+        filtered_count.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // The driver's RX buffer: header followed by the frame
+    alignas(4) static thread_local uint8_t buffer[sizeof(wifi_pkt_rx_ctrl_t) + HOST_WIFI_MAX_FRAME];
+    wifi_promiscuous_pkt_t* pkt = (wifi_promiscuous_pkt_t*)buffer;
+    pkt->rx_ctrl = rx_ctrl;
+    pkt->rx_ctrl.channel = tuned;
+    pkt->rx_ctrl.sig_len = len;
+    pkt->rx_ctrl.timestamp = (uint32_t)esp_timer_get_time() + HOST_WIFI_RX_TIMER_OFFSET;
+    memcpy(pkt->payload, frame, len);
+
+    cb(pkt, type);
+    delivered_count.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void host_wifi_set_retune_us(uint32_t delay_us) {
+    retune_us = delay_us;
+}
+
+uint8_t host_wifi_get_channel() {
+    return channel.load();
+}
+
+HostWifiStats host_wifi_get_stats() {
+    HostWifiStats stats;
+    stats.delivered = delivered_count.load(std::memory_order_relaxed);
+    stats.filtered = filtered_count.load(std::memory_order_relaxed);
+    stats.off_channel = off_channel_count.load(std::memory_order_relaxed);
+    stats.not_listening = not_listening_count.load(std::memory_order_relaxed);
+    stats.channel_changes = channel_change_count.load(std::memory_order_relaxed);
+    return stats;
+}
@@ -0,0 +1,585 @@
+// Host collector merging the captures of several sniffers.
+//
+// Each node is an ESP32 fixed on its own channel, streaming its capture
+// with PcapWriter in stream mode (components/pcap_writer) over a UART, or
+// anything else that delivers the same PCAPNG byte stream over TCP. The
+// collector reads every stream as it arrives, merges the frames by
+// timestamp with a StreamMerger and writes one PCAPNG file in which each
+// node has its own interface, named after the node. Once a second it
+// prints the merge and per-node counters: frames, out-of-order and late
+// frames, and how far each node lags the newest of all.
+//
+// --simulate N starts N node threads instead, each sending synthetic
+// traffic of one channel over a loopback TCP connection, so the whole
+// path can be exercised without hardware.
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <memory>
+#include <netinet/in.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <termios.h>
+#include <thread>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+#include "frame_injector.h"
+#include "pcap_writer.h"
+#include "pcapng_stream.h"
+#include "stream_merger.h"
+
+#define COLLECTOR_MAX_PATHS         16
+
+// Bytes read from a node per poll round
+#define COLLECTOR_READ_CHUNK        (64 * 1024)
+
+// A node timestamp this far behind its previous one means the node restarted its clock
+#define COLLECTOR_CLOCK_RESET_US    1000000
+
+// Time given to simulated nodes to send their last burst at the end of a run
+#define COLLECTOR_DRAIN_US          2000000
+
+// Simulated nodes: timestamp jitter, so that each stream is slightly out of order
+#define SIM_JITTER_US               500
+
+struct CollectorOptions {
+    const char* output;
+    const char* paths[COLLECTOR_MAX_PATHS];
+    size_t path_count;
+    int listen_port;                // -1 = no listening socket
+    uint32_t baud;
+    MergerConfig merger;
+    bool align;
+    uint32_t seconds;
+    uint32_t report_ms;
+    uint32_t simulate;
+    uint32_t sim_rate;
+    uint32_t sim_flush_ms;
+};
+
+struct NodeInput {
+    int fd;
+    uint32_t id;                    // Index in the merger
+    PcapngStreamReader reader;
+    // Output interface per link type the node has used, so that repeated
+    // section headers do not add interfaces
+    std::vector<std::pair<uint16_t, uint32_t>> interfaces;
+    // --align: node clock to collector wall clock
+    bool offset_known;
+    int64_t offset_us;
+    uint64_t last_timestamp_us;
+};
+
+struct Collector {
+    CollectorOptions options;
+    StreamMerger merger;
+    PcapngFileWriter output;
+    std::vector<std::unique_ptr<NodeInput>> nodes;
+    int listen_fd;
+    uint32_t accepted;
+};
+
+static volatile sig_atomic_t interrupted = 0;
+
+static void on_signal(int) {
+    interrupted = 1;
+}
+
+static uint64_t monotonic_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static uint64_t realtime_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void usage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [options] [--node PATH]...\n"
+            "  --node PATH         Read a node's stream from a serial port, FIFO or file (repeatable)\n"
+            "  --listen PORT       Accept nodes over TCP on PORT\n"
+            "  --baud N            Serial port speed (default 2000000)\n"
+            "  --output FILE, -o   Merged capture (default merged.pcapng)\n"
+            "  --reorder-ms N      Reorder window (default 100)\n"
+            "  --max-lag-ms N      A node silent this long stops holding back the merge (default 2000)\n"
+            "  --max-buffered N    Frames held at most (default 200000)\n"
+            "  --align             Align each node's clock to the collector's on arrival,\n"
+            "                      for nodes without a common time reference\n"
+            "  --seconds S         Stop after S seconds (default 0 = at Ctrl-C or when all nodes end)\n"
+            "  --report-ms N       Counter report interval, 0 = only at the end (default 1000)\n"
+            "  --simulate N        Run N simulated nodes on channels 1/6/11 over loopback TCP\n"
+            "  --sim-rate FPS      Frames per second per simulated node (default 2000)\n"
+            "  --sim-flush-ms N    Node N sends every N * (index + 1) ms (default 50)\n",
+            program);
+}
+
+static bool parse_options(int argc, char** argv, CollectorOptions* options) {
+    static const struct option long_options[] = {
+        { "node",         required_argument, nullptr, 'n' },
+        { "listen",       required_argument, nullptr, 'l' },
+        { "baud",         required_argument, nullptr, 'b' },
+        { "output",       required_argument, nullptr, 'o' },
+        { "reorder-ms",   required_argument, nullptr, 'r' },
+        { "max-lag-ms",   required_argument, nullptr, 'g' },
+        { "max-buffered", required_argument, nullptr, 'B' },
+        { "align",        no_argument,       nullptr, 'a' },
+        { "seconds",      required_argument, nullptr, 's' },
+        { "report-ms",    required_argument, nullptr, 'R' },
+        { "simulate",     required_argument, nullptr, 'S' },
+        { "sim-rate",     required_argument, nullptr, 'F' },
+        { "sim-flush-ms", required_argument, nullptr, 'f' },
+        { "help",         no_argument,       nullptr, 'h' },
+        { nullptr,        0,                 nullptr, 0 },
+    };
+
+    options->output = "merged.pcapng";
+    options->path_count = 0;
+    options->listen_port = -1;
+    options->baud = 2000000;
+    options->merger = merger_default_config();
+    options->align = false;
+    options->seconds = 0;
+    options->report_ms = 1000;
+    options->simulate = 0;
+    options->sim_rate = 2000;
+    options->sim_flush_ms = 50;
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "ho:", long_options, nullptr)) != -1) {
+        switch (opt) {
+            case 'n':
+                if (options->path_count == COLLECTOR_MAX_PATHS) {
+                    return false;
+                }
+                options->paths[options->path_count++] = optarg;
+                break;
+            case 'l': options->listen_port = (int)strtoul(optarg, nullptr, 0); break;
+            case 'b': options->baud = strtoul(optarg, nullptr, 0); break;
+            case 'o': options->output = optarg; break;
+            case 'r': options->merger.reorder_us = strtoul(optarg, nullptr, 0) * 1000; break;
+            case 'g': options->merger.max_lag_us = strtoul(optarg, nullptr, 0) * 1000; break;
+            case 'B': options->merger.max_buffered = strtoul(optarg, nullptr, 0); break;
+            case 'a': options->align = true; break;
+            case 's': options->seconds = strtoul(optarg, nullptr, 0); break;
+            case 'R': options->report_ms = strtoul(optarg, nullptr, 0); break;
+            case 'S': options->simulate = strtoul(optarg, nullptr, 0); break;
+            case 'F': options->sim_rate = strtoul(optarg, nullptr, 0); break;
+            case 'f': options->sim_flush_ms = strtoul(optarg, nullptr, 0); break;
+            default:
+                return false;
+        }
+    }
+    bool has_input = options->path_count || options->listen_port >= 0 || options->simulate;
+    return optind == argc && has_input && options->listen_port < 65536 && options->sim_rate > 0;
+}
+
+static speed_t baud_constant(uint32_t baud) {
+    switch (baud) {
+        case 115200: return B115200;
+        case 230400: return B230400;
+        case 460800: return B460800;
+        case 921600: return B921600;
+        case 1000000: return B1000000;
+        case 1500000: return B1500000;
+        case 2000000: return B2000000;
+        case 3000000: return B3000000;
+        default: return 0;
+    }
+}
+
+// Raw 8N1 at the given speed: no echo, no line editing, no CR/LF translation
+static bool configure_serial(int fd, uint32_t baud) {
+    struct termios tio;
+    speed_t speed = baud_constant(baud);
+    if (speed == 0 || tcgetattr(fd, &tio) != 0) {
+        return false;
+    }
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cflag &= ~CRTSCTS;
+    cfsetispeed(&tio, speed);
+    cfsetospeed(&tio, speed);
+    return tcsetattr(fd, TCSANOW, &tio) == 0;
+}
+
+static void add_node(Collector* collector, int fd, const char* name) {
+    std::unique_ptr<NodeInput> node(new NodeInput());
+    node->fd = fd;
+    node->id = collector->merger.add_node(name, monotonic_us());
+    node->offset_known = false;
+    node->offset_us = 0;
+    node->last_timestamp_us = 0;
+    collector->nodes.push_back(std::move(node));
+}
+
+static bool open_path(Collector* collector, const char* path) {
+    int fd = open(path, O_RDONLY | O_NONBLOCK | O_NOCTTY);
+    if (fd < 0) {
+        fprintf(stderr, "Cannot open %s: %s\n", path, strerror(errno));
+        return false;
+    }
+    if (isatty(fd) && !configure_serial(fd, collector->options.baud)) {
+        fprintf(stderr, "Cannot set %s to %lu baud\n", path, (unsigned long)collector->options.baud);
+        close(fd);
+        return false;
+    }
+    add_node(collector, fd, path);
+    return true;
+}
+
+static int listen_tcp(int port, bool loopback, uint16_t* bound_port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(loopback ? INADDR_LOOPBACK : INADDR_ANY);
+    addr.sin_port = htons((uint16_t)port);
+    socklen_t len = sizeof(addr);
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, 16) != 0 ||
+        getsockname(fd, (struct sockaddr*)&addr, &len) != 0) {
+        close(fd);
+        return -1;
+    }
+    *bound_port = ntohs(addr.sin_port);
+    return fd;
+}
+
+static void accept_node(Collector* collector) {
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    int fd = accept(collector->listen_fd, (struct sockaddr*)&addr, &len);
+    if (fd < 0) {
+        return;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    char name[64];
+    snprintf(name, sizeof(name), "tcp:%s:%u", inet_ntoa(addr.sin_addr), ntohs(addr.sin_port));
+    add_node(collector, fd, name);
+    collector->accepted++;
+}
+
+static uint32_t output_interface(Collector* collector, NodeInput* node, uint16_t linktype) {
+    for (const auto& entry : node->interfaces) {
+        if (entry.first == linktype) {
+            return entry.second;
+        }
+    }
+    // Named after the node; a node with several link types gets one interface each
+    std::string name = collector->merger.node_name(node->id);
+    if (!node->interfaces.empty()) {
+        name += "/" + std::to_string(linktype);
+    }
+    uint32_t id = collector->output.add_interface(linktype, 0, name.c_str());
+    node->interfaces.push_back(std::make_pair(linktype, id));
+    return id;
+}
+
+static void push_packets(Collector* collector, NodeInput* node) {
+    StreamPacket packet;
+    uint64_t now = monotonic_us();
+    while (node->reader.next(&packet)) {
+        uint64_t timestamp_us = packet.timestamp_us;
+        if (collector->options.align) {
+            // The smallest arrival delay seen is the best estimate of the offset
+            if (timestamp_us + COLLECTOR_CLOCK_RESET_US < node->last_timestamp_us) {
+                node->offset_known = false;
+            }
+            node->last_timestamp_us = timestamp_us;
+            int64_t offset = (int64_t)realtime_us() - (int64_t)timestamp_us;
+            if (!node->offset_known || offset < node->offset_us) {
+                node->offset_us = offset;
+                node->offset_known = true;
+            }
+            timestamp_us += node->offset_us;
+        }
+        uint32_t interface_id = output_interface(collector, node, packet.linktype);
+        collector->merger.push(node->id, timestamp_us, interface_id, packet.data, packet.captured,
+                               packet.orig_len, now);
+    }
+}
+
+// False at the end of the node's stream
+static bool read_node(Collector* collector, NodeInput* node) {
+    static uint8_t chunk[COLLECTOR_READ_CHUNK];
+    ssize_t len = read(node->fd, chunk, sizeof(chunk));
+    if (len < 0) {
+        return errno == EAGAIN || errno == EINTR;
+    }
+    if (len == 0) {
+        return false;
+    }
+    node->reader.feed(chunk, (size_t)len);
+    push_packets(collector, node);
+    return true;
+}
+
+static void emit_frame(const MergedFrame& frame, void* ctx) {
+    Collector* collector = (Collector*)ctx;
+    collector->output.write_packet(frame.interface_id, frame.timestamp_us, frame.data, frame.captured,
+                                   frame.orig_len);
+}
+
+static void report(const Collector& collector) {
+    const MergerStats& stats = collector.merger.get_stats();
+    printf("Merge:     pushed=%llu written=%llu late=%llu forced=%llu buffered=%zu peak=%zu bytes=%llu\n",
+           (unsigned long long)stats.pushed, (unsigned long long)stats.emitted, (unsigned long long)stats.late,
+           (unsigned long long)stats.forced, stats.buffered, stats.peak_buffered,
+           (unsigned long long)collector.output.bytes());
+    for (const auto& node : collector.nodes) {
+        const MergerNodeStats& counters = collector.merger.node_stats(node->id);
+        const StreamReaderStats& reader = node->reader.get_stats();
+        printf("Node %-4lu  %s: frames=%llu out_of_order=%llu late=%llu lag=%.1f ms max=%.1f ms "
+               "sections=%lu resyncs=%lu skipped=%llu%s%s\n",
+               (unsigned long)node->id, collector.merger.node_name(node->id),
+               (unsigned long long)counters.frames, (unsigned long long)counters.out_of_order,
+               (unsigned long long)counters.late, counters.lag_us / 1000.0, counters.max_lag_us / 1000.0,
+               (unsigned long)reader.sections, (unsigned long)reader.resyncs,
+               (unsigned long long)reader.skipped_bytes, counters.stalled ? " stalled" : "",
+               counters.closed ? " closed" : "");
+    }
+    fflush(stdout);
+}
+
+static bool send_all(int fd, const uint8_t* data, size_t len) {
+    while (len > 0) {
+        ssize_t sent = send(fd, data, len, MSG_NOSIGNAL);
+        if (sent <= 0) {
+            return false;
+        }
+        data += sent;
+        len -= (size_t)sent;
+    }
+    return true;
+}
+
+// One simulated node: synthetic traffic of one channel, encoded as
+// PcapWriter does and sent in bursts, as a UART drains a node's buffers
+static void simulate_node(uint32_t index, uint16_t port, const CollectorOptions* options,
+                          const std::atomic<bool>* stop) {
+    static const uint8_t channels[] = { 1, 6, 11 };
+    uint8_t channel = channels[index % sizeof(channels)];
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (fd < 0 || connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        fprintf(stderr, "Simulated node %lu cannot connect\n", (unsigned long)index);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return;
+    }
+
+    SyntheticConfig config = synthetic_default_config();
+    config.seed = index + 1;
+    SyntheticSource source(config);
+    uint32_t jitter_state = index * 2654435761u + 1;
+
+    // Boot log ahead of the stream, as on a UART, for the reader to skip
+    char banner[96];
+    int banner_len = snprintf(banner, sizeof(banner), "I (%lu) COLLECTOR_NODE: node %lu on channel %u\r\n",
+                              (unsigned long)(300 + index), (unsigned long)index, channel);
+    std::vector<uint8_t> buffer(banner, banner + banner_len);
+    buffer.resize(buffer.size() + PCAPNG_HEADER_SIZE);
+    pcapng_write_header(buffer.data() + banner_len, PCAPNG_HEADER_SIZE, SNIFFER_SNAPLEN);
+
+    // Without --align the nodes share the wall clock as their reference;
+    // with it each counts from its own boot, seconds apart
+    uint64_t start_us = monotonic_us();
+    uint64_t boot_us = options->align ? start_us - (uint64_t)(index + 1) * 7000000 : 0;
+    uint64_t flush_us = (uint64_t)options->sim_flush_ms * 1000 * (index + 1);
+    uint64_t last_flush_us = start_us;
+    uint64_t sent = 0;
+
+    while (!stop->load()) {
+        uint64_t now = monotonic_us();
+        uint64_t due = (now - start_us) * options->sim_rate / 1000000;
+        uint64_t clock_us = options->align ? now - boot_us : realtime_us();
+        for (; sent < due; sent++) {
+            InjectorFrame frame;
+            do {
+                source.next(&frame);
+            } while (frame.rx_ctrl.channel != channel);
+
+            jitter_state ^= jitter_state << 13;
+            jitter_state ^= jitter_state >> 17;
+            jitter_state ^= jitter_state << 5;
+
+            FrameView view = {};
+            view.payload = frame.data;
+            view.len = frame.len;
+            view.orig_len = (uint16_t)(frame.len + 4);
+            view.rx_ctrl = &frame.rx_ctrl;
+            view.reference_us = (int64_t)(clock_us - jitter_state % SIM_JITTER_US);
+            PcapngFrame record;
+            pcap_writer_fill_frame(view, &record);
+            // Synthetic frames come without the FCS the driver would include
+            record.has_fcs = false;
+
+            size_t offset = buffer.size();
+            buffer.resize(offset + pcapng_frame_size(record));
+            pcapng_write_frame(buffer.data() + offset, buffer.size() - offset, record);
+        }
+        if (now - last_flush_us >= flush_us) {
+            if (!send_all(fd, buffer.data(), buffer.size())) {
+                break;
+            }
+            buffer.clear();
+            last_flush_us = now;
+        }
+        usleep(1000);
+    }
+    send_all(fd, buffer.data(), buffer.size());
+    close(fd);
+}
+
+int main(int argc, char** argv) {
+    Collector collector;
+    if (!parse_options(argc, argv, &collector.options)) {
+        usage(argv[0]);
+        return 2;
+    }
+    const CollectorOptions& options = collector.options;
+    collector.merger = StreamMerger(options.merger);
+    collector.listen_fd = -1;
+    collector.accepted = 0;
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    if (!collector.output.open(options.output)) {
+        fprintf(stderr, "Cannot create %s: %s\n", options.output, strerror(errno));
+        return 1;
+    }
+    for (size_t i = 0; i < options.path_count; i++) {
+        if (!open_path(&collector, options.paths[i])) {
+            return 1;
+        }
+    }
+
+    uint16_t port = 0;
+    if (options.listen_port >= 0 || options.simulate) {
+        // Simulated nodes alone need only an ephemeral loopback port
+        bool loopback = options.listen_port < 0;
+        collector.listen_fd = listen_tcp(loopback ? 0 : options.listen_port, loopback, &port);
+        if (collector.listen_fd < 0) {
+            fprintf(stderr, "Cannot listen on port %d: %s\n", options.listen_port, strerror(errno));
+            return 1;
+        }
+        printf("Listening on port %u\n", port);
+    }
+
+    std::atomic<bool> stop_nodes(false);
+    std::vector<std::thread> simulated;
+    for (uint32_t i = 0; i < options.simulate; i++) {
+        simulated.emplace_back(simulate_node, i, port, &options, &stop_nodes);
+    }
+
+    uint64_t start = monotonic_us();
+    uint64_t next_report = start + (uint64_t)options.report_ms * 1000;
+    uint64_t stopping_since = 0;
+    std::vector<struct pollfd> fds;
+    std::vector<NodeInput*> polled;
+    while (true) {
+        uint64_t now = monotonic_us();
+        bool time_up = options.seconds && now - start >= (uint64_t)options.seconds * 1000000;
+        if ((time_up || interrupted) && stopping_since == 0) {
+            if (!options.simulate) {
+                break;
+            }
+            // Simulated nodes send their last burst and disconnect; wait for it
+            stop_nodes.store(true);
+            stopping_since = now;
+        }
+        if (stopping_since && now - stopping_since > COLLECTOR_DRAIN_US) {
+            break;
+        }
+
+        fds.clear();
+        polled.clear();
+        if (collector.listen_fd >= 0 && !stopping_since) {
+            fds.push_back({ collector.listen_fd, POLLIN, 0 });
+            polled.push_back(nullptr);
+        }
+        size_t open_nodes = 0;
+        for (auto& node : collector.nodes) {
+            if (node->fd >= 0) {
+                fds.push_back({ node->fd, POLLIN, 0 });
+                polled.push_back(node.get());
+                open_nodes++;
+            }
+        }
+        // Unless it listens for more, the run ends with its last node
+        bool expecting = !stopping_since && (options.listen_port >= 0 || collector.accepted < options.simulate);
+        if (open_nodes == 0 && !expecting) {
+            break;
+        }
+
+        if (poll(fds.data(), fds.size(), 10) > 0) {
+            for (size_t i = 0; i < fds.size(); i++) {
+                if (!(fds[i].revents & (POLLIN | POLLHUP | POLLERR))) {
+                    continue;
+                }
+                if (polled[i] == nullptr) {
+                    accept_node(&collector);
+                } else if (!read_node(&collector, polled[i])) {
+                    close(polled[i]->fd);
+                    polled[i]->fd = -1;
+                    collector.merger.close_node(polled[i]->id);
+                }
+            }
+        }
+
+        now = monotonic_us();
+        collector.merger.release(now, emit_frame, &collector);
+        if (options.report_ms && now >= next_report) {
+            report(collector);
+            next_report = now + (uint64_t)options.report_ms * 1000;
+        }
+    }
+
+    stop_nodes.store(true);
+    for (std::thread& thread : simulated) {
+        thread.join();
+    }
+    for (auto& node : collector.nodes) {
+        if (node->fd >= 0) {
+            close(node->fd);
+        }
+    }
+    if (collector.listen_fd >= 0) {
+        close(collector.listen_fd);
+    }
+
+    collector.merger.flush(emit_frame, &collector);
+    bool written = collector.output.close();
+    report(collector);
+    if (!written) {
+        fprintf(stderr, "Failed to write %s\n", options.output);
+        return 1;
+    }
+    printf("Wrote %s\n", options.output);
+    return 0;
+}
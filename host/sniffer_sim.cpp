@@ -0,0 +1,721 @@
+// Host simulation of the sniffer pipeline.
+//
+// Builds the same capture path as main/main.cpp (NetworkSniffer with the
+// frame statistics, channel scheduler, device table, AP inventory, attack
+// detector and flight recorder sinks, retransmission dedup, vendor labels, runtime settings and metrics;
+// Bluetooth is left out) on top of the host shim, replays a capture or synthetic traffic
+// into the promiscuous callback and reports throughput, drops and latency.
+
+#include <atomic>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "host_wifi.h"
+#include "frame_injector.h"
+#include "network_sniffer.h"
+#include "channel_scheduler.h"
+#include "ap_inventory.h"
+#include "attack_detector.h"
+#include "burst_trigger.h"
+#include "device_tracker.h"
+#include "flight_recorder.h"
+#include "frame_stats.h"
+#include "inventory_codec.h"
+#include "oui_lookup.h"
+#include "pipeline_runtime.h"
+#include "sniffer_config.h"
+#include "sniffer_metrics.h"
+#include "sniffer_trace.h"
+
+static const char* TAG = "SNIFFER_SIM";
+
+#define STATS_SHARD_PROCESSING 0
+
+// Receive-to-dispatch latency in power-of-two microsecond buckets
+#define LATENCY_BUCKETS 24
+
+// Written by the processing task only, read by main
+struct LatencyStats {
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> total_us;
+    std::atomic<uint32_t> min_us;
+    std::atomic<uint32_t> max_us;
+    std::atomic<uint64_t> buckets[LATENCY_BUCKETS];
+};
+
+// Single-writer update without a locked read-modify-write
+template <typename T>
+static void add_relaxed(std::atomic<T>& counter, T value) {
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+static FrameStats frame_stats;
+
+// New devices by what their address says about the vendor
+struct VendorCounts {
+    std::atomic<uint32_t> labeled;
+    std::atomic<uint32_t> randomized;
+    std::atomic<uint32_t> unknown;
+};
+static VendorCounts vendor_counts;
+
+// Sinks as registered by main/main.cpp
+
+static void stats_sink(const FrameView& frame, void* ctx) {
+    FrameStats* stats = static_cast<FrameStats*>(ctx);
+    if (frame.duplicate) {
+        return;
+    }
+    bool retry = frame.parsed && (frame.parsed->flags & IEEE80211_FC_RETRY) != 0;
+    stats->record(STATS_SHARD_PROCESSING, frame.type, frame.orig_len,
+                  frame.rx_ctrl->rssi, frame.rx_ctrl->channel, retry);
+}
+
+static void scheduler_sink(const FrameView& frame, void* ctx) {
+    ChannelScheduler* scheduler = static_cast<ChannelScheduler*>(ctx);
+    scheduler->record_frame(frame.rx_ctrl->channel, frame.parsed ? frame.parsed->bssid : nullptr);
+}
+
+static void device_sink(const FrameView& frame, void* ctx) {
+    DeviceTracker* devices = static_cast<DeviceTracker*>(ctx);
+    const ParsedFrame* parsed = frame.parsed;
+    if (!parsed || !parsed->transmitter) {
+        return;
+    }
+
+    DeviceObservation obs = {};
+    obs.mac = parsed->transmitter;
+    obs.bssid = parsed->bssid;
+    obs.timestamp_us = esp_timer_get_time();
+    obs.rssi = frame.rx_ctrl->rssi;
+    obs.channel = frame.rx_ctrl->channel;
+    obs.type = parsed->type;
+    obs.duplicate = frame.duplicate;
+    obs.is_ap = ieee80211_is_mgmt(*parsed, IEEE80211_MGMT_BEACON) ||
+                ieee80211_is_mgmt(*parsed, IEEE80211_MGMT_PROBE_RESP) ||
+                (parsed->bssid && memcmp(parsed->bssid, parsed->transmitter, 6) == 0);
+    bool inserted;
+    devices->update(obs, &inserted);
+    if (inserted) {
+        std::atomic<uint32_t>& counter = oui_lookup(obs.mac) != OUI_VENDOR_NONE ? vendor_counts.labeled
+                                       : mac_kind(obs.mac) == MAC_LOCAL ? vendor_counts.randomized
+                                       : vendor_counts.unknown;
+        add_relaxed<uint32_t>(counter, 1);
+    }
+}
+
+// Tracked devices per vendor id, for the most common one
+static void tally_vendor(const DeviceRecord& record, void* ctx) {
+    uint16_t vendor = oui_lookup(record.mac);
+    if (vendor != OUI_VENDOR_NONE) {
+        (*static_cast<std::vector<uint32_t>*>(ctx))[vendor]++;
+    }
+}
+
+// Station with the highest retry rate among those with enough frames to tell
+#define WORST_RETRY_MIN_FRAMES 20
+
+struct WorstRetry {
+    const DeviceRecord* record;
+};
+
+static void find_worst_retry(const DeviceRecord& record, void* ctx) {
+    WorstRetry* worst = static_cast<WorstRetry*>(ctx);
+    uint32_t sent = record.frames[0] + record.frames[1] + record.frames[2] + record.retries;
+    if (sent >= WORST_RETRY_MIN_FRAMES &&
+        (!worst->record || record.retry_rate() > worst->record->retry_rate())) {
+        worst->record = &record;
+    }
+}
+
+// Inventory deltas encoded as for the Bluetooth link, counted instead of sent.
+// Reports every second so that short runs show some.
+struct InventorySim {
+    InventorySim() : inventory(sim_inventory_config()), batches(0), bytes(0) {}
+
+    static InventoryConfig sim_inventory_config() {
+        InventoryConfig config = ap_inventory_default_config();
+        config.report_interval_ms = 1000;
+        return config;
+    }
+
+    ApInventory inventory;
+    InventoryEncoder encoder;
+    std::atomic<uint32_t> batches;
+    std::atomic<uint32_t> bytes;
+};
+
+static void count_inventory_batch(InventorySim* sim) {
+    const uint8_t* batch;
+    size_t len = sim->encoder.finish(&batch);
+    if (len) {
+        add_relaxed<uint32_t>(sim->batches, 1);
+        add_relaxed<uint32_t>(sim->bytes, (uint32_t)len);
+    }
+}
+
+static void inventory_delta(const InventoryDelta& delta, void* ctx) {
+    InventorySim* sim = static_cast<InventorySim*>(ctx);
+    if (!sim->encoder.append(delta)) {
+        count_inventory_batch(sim);
+        sim->encoder.append(delta);
+    }
+}
+
+static void inventory_sink(const FrameView& frame, void* ctx) {
+    InventorySim* sim = static_cast<InventorySim*>(ctx);
+    int64_t now = esp_timer_get_time();
+    if (frame.parsed && !frame.duplicate) {
+        sim->inventory.update(*frame.parsed, frame.rx_ctrl->rssi, frame.rx_ctrl->channel, frame.timestamp_us);
+    }
+    if (sim->inventory.poll(now, inventory_delta, sim)) {
+        count_inventory_batch(sim);
+    }
+}
+
+// Flight recorder snapshots, counted instead of sent. Short windows so
+// that short runs show some.
+struct RecorderSim {
+    RecorderSim() : snapshots(0), frames(0) {}
+
+    static FlightRecorderConfig sim_recorder_config() {
+        FlightRecorderConfig config = flight_recorder_default_config();
+        config.pre_trigger_ms = 500;
+        config.post_trigger_ms = 200;
+        config.holdoff_ms = 1000;
+        return config;
+    }
+
+    FlightRecorder recorder;
+    BurstTrigger trigger;
+    std::atomic<uint32_t> snapshots;
+    std::atomic<uint32_t> frames;
+};
+
+static bool count_snapshot_frame(const FrameView& frame, void* ctx) {
+    RecorderSim* sim = static_cast<RecorderSim*>(ctx);
+    add_relaxed<uint32_t>(sim->frames, 1);
+    return true;
+}
+
+static void count_snapshot(const RecorderSnapshot& snapshot, uint32_t frames, void* ctx) {
+    RecorderSim* sim = static_cast<RecorderSim*>(ctx);
+    add_relaxed<uint32_t>(sim->snapshots, 1);
+    ESP_LOGI(TAG, "Snapshot %u (%s): %u frames", snapshot.id, snapshot.reason, frames);
+}
+
+// Attack alerts encoded as for the Bluetooth link, counted instead of sent;
+// each one also asks the recorder for a snapshot
+struct AttackSim {
+    AttackSim() : recorder(nullptr), bytes(0) {}
+
+    AttackDetector detector;
+    FlightRecorder* recorder;
+    std::atomic<uint32_t> bytes;
+};
+
+static void attack_alert(const AttackAlert& alert, void* ctx) {
+    AttackSim* sim = static_cast<AttackSim*>(ctx);
+    uint8_t record[ATTACK_ALERT_SIZE];
+    add_relaxed<uint32_t>(sim->bytes, (uint32_t)attack_alert_encode(alert, record, sizeof(record)));
+    sim->recorder->trigger(attack_kind_name(alert.kind));
+    ESP_LOGI(TAG, "Alert: %s from %02x:%02x:%02x:%02x:%02x:%02x, count=%u",
+             attack_kind_name(alert.kind), alert.mac[0], alert.mac[1], alert.mac[2],
+             alert.mac[3], alert.mac[4], alert.mac[5], alert.count);
+}
+
+static void attack_sink(const FrameView& frame, void* ctx) {
+    AttackSim* sim = static_cast<AttackSim*>(ctx);
+    if (frame.parsed && !frame.duplicate) {
+        sim->detector.update(*frame.parsed, frame.rx_ctrl->rssi, frame.rx_ctrl->channel, frame.timestamp_us,
+                             attack_alert, sim);
+    }
+}
+
+// Registered last: time from the driver's receive stamp until every other sink has run
+static void latency_sink(const FrameView& frame, void* ctx) {
+    LatencyStats* latency = static_cast<LatencyStats*>(ctx);
+    uint32_t us = (uint32_t)(esp_timer_get_time() - frame.timestamp_us);
+
+    add_relaxed<uint64_t>(latency->count, 1);
+    add_relaxed<uint64_t>(latency->total_us, us);
+    if (us < latency->min_us.load(std::memory_order_relaxed)) {
+        latency->min_us.store(us, std::memory_order_relaxed);
+    }
+    if (us > latency->max_us.load(std::memory_order_relaxed)) {
+        latency->max_us.store(us, std::memory_order_relaxed);
+    }
+    size_t bucket = 0;
+    while (bucket < LATENCY_BUCKETS - 1 && us >= (1u << bucket)) {
+        bucket++;
+    }
+    add_relaxed<uint64_t>(latency->buckets[bucket], 1);
+}
+
+// Most --set options
+#define SIM_MAX_SETS 8
+
+// Runtime settings applied by the main loop, as in main/main.cpp
+struct ConfigSim {
+    SnifferConfig* config;
+    SnifferSettings applied;
+    uint32_t generation;
+    uint32_t changes;       // Generations applied
+};
+
+static SchedulerConfig scheduler_config_from(const SnifferSettings& settings) {
+    SchedulerConfig config = channel_scheduler_default_config();
+    config.first_channel = settings.hop_first;
+    config.last_channel = settings.hop_last;
+    config.round_ms = settings.hop_round_ms;
+    config.min_dwell_ms = settings.hop_min_dwell_ms;
+    config.exploration = settings.hop_explore_pct / 100.0f;
+    return config;
+}
+
+// Apply what changed since the last call; true when the channel policy did
+static bool apply_settings(ConfigSim* sim, NetworkSniffer& sniffer, ChannelScheduler& scheduler) {
+    if (sim->config->generation() == sim->generation) {
+        return false;
+    }
+    sim->generation = sim->config->generation();
+    SnifferSettings next;
+    sim->config->get(&next);
+    SnifferSettings& applied = sim->applied;
+
+    if (next.log_level != applied.log_level) {
+        esp_log_level_set("*", (esp_log_level_t)next.log_level);
+    }
+    if (strcmp(next.filter, applied.filter) != 0) {
+        sniffer.set_filter(next.filter);
+    }
+    bool hop_changed = next.channel != applied.channel || next.hop_first != applied.hop_first ||
+                       next.hop_last != applied.hop_last || next.hop_explore_pct != applied.hop_explore_pct ||
+                       next.hop_round_ms != applied.hop_round_ms ||
+                       next.hop_min_dwell_ms != applied.hop_min_dwell_ms;
+    if (hop_changed) {
+        scheduler.set_config(scheduler_config_from(next));
+    }
+    applied = next;
+    sim->changes++;
+    return hop_changed;
+}
+
+// Publish the --set options, from a thread of their own like a console command
+static void publish_sets(SnifferConfig* config, const char* const* sets, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        char key[32];
+        const char* value = strchr(sets[i], '=');
+        size_t key_len = value ? (size_t)(value - sets[i]) : strlen(sets[i]);
+        snprintf(key, sizeof(key), "%.*s", (int)key_len, sets[i]);
+        char error[96];
+        if (config->set(key, value ? value + 1 : "", error, sizeof(error)) != ESP_OK) {
+            fprintf(stderr, "--set %s: %s\n", sets[i], error);
+        }
+    }
+}
+
+// Queue sources of the metrics sampler, as registered by main/main.cpp
+static void frame_ring_metrics(MetricsQueue* queue, void* ctx) {
+    SnifferStats stats = static_cast<NetworkSniffer*>(ctx)->get_stats();
+    uint32_t queued = stats.captured - stats.processed;
+    queue->used = queued < stats.ring_capacity ? queued : stats.ring_capacity;
+    queue->capacity = stats.ring_capacity;
+    queue->high_water = stats.ring_high_water;
+    queue->drops = stats.dropped;
+}
+
+static void recorder_metrics(MetricsQueue* queue, void* ctx) {
+    FlightRecorderStats stats = static_cast<FlightRecorder*>(ctx)->get_stats();
+    queue->used = stats.ring_used;
+    queue->capacity = stats.ring_bytes;
+    queue->drops = stats.dropped;
+}
+
+// Exclusive upper bound of the bucket holding the given fraction of samples
+static uint32_t latency_percentile(const LatencyStats& latency, double fraction) {
+    uint64_t target = (uint64_t)(latency.count.load() * fraction);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += latency.buckets[i];
+        if (seen > target) {
+            return 1u << i;
+        }
+    }
+    return latency.max_us;
+}
+
+struct SimOptions {
+    const char* pcap_path;
+    const char* filter;
+    const char* trigger;
+    const char* sets[SIM_MAX_SETS];
+    size_t set_count;
+    uint8_t channel;
+    bool hop;
+    bool metrics;
+    esp_log_level_t log_level;
+    InjectorConfig injector;
+    SyntheticConfig synthetic;
+};
+
+static void usage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --pcap FILE         Replay a pcap/pcapng capture (802.11 or radiotap)\n"
+            "                      instead of synthetic traffic\n"
+            "  --rate FPS          Injection rate, 0 = as fast as possible (default 2000)\n"
+            "  --realtime          Pace a capture by its own timestamps\n"
+            "  --speed X           Realtime speed-up factor (default 1)\n"
+            "  --frames N          Stop after N frames\n"
+            "  --seconds S         Stop after S seconds (default 10, 0 = no limit)\n"
+            "  --loop              Replay the capture until a limit is reached\n"
+            "  --keep-channels     Drop frames sent on other channels than the tuned one\n"
+            "  --channel N         Channel to listen on (default 1)\n"
+            "  --hop               Hop channels with the adaptive scheduler\n"
+            "  --filter EXPR       Capture filter (see packet_filter.h)\n"
+            "  --trigger EXPR      Flight recorder trigger: 10 matching frames within 1 s\n"
+            "                      (default \"subtype deauth or subtype disassoc\")\n"
+            "  --set KEY=VALUE     Change a runtime setting 1 s into the run (repeatable;\n"
+            "                      channel, hop.*, filter and log.level take effect)\n"
+            "  --metrics           Print the heap, task and queue metrics sampled at the end\n"
+            "  --aps N             Synthetic access points (default 8)\n"
+            "  --stations N        Synthetic stations (default 32)\n"
+            "  --seed N            Synthetic traffic seed (default 1)\n"
+            "  --deauth PCT        Add broadcast deauthentications in APs' names\n"
+            "  --rogue PCT         Add open beacons from fresh BSSIDs with APs' SSIDs\n"
+            "  --log-level LEVEL   none, error, warn, info, debug or verbose (default warn)\n",
+            program);
+}
+
+static bool parse_options(int argc, char** argv, SimOptions* options) {
+    static const struct option long_options[] = {
+        { "pcap",          required_argument, nullptr, 'p' },
+        { "rate",          required_argument, nullptr, 'r' },
+        { "realtime",      no_argument,       nullptr, 'R' },
+        { "speed",         required_argument, nullptr, 'x' },
+        { "frames",        required_argument, nullptr, 'n' },
+        { "seconds",       required_argument, nullptr, 's' },
+        { "loop",          no_argument,       nullptr, 'l' },
+        { "keep-channels", no_argument,       nullptr, 'k' },
+        { "channel",       required_argument, nullptr, 'c' },
+        { "hop",           no_argument,       nullptr, 'H' },
+        { "filter",        required_argument, nullptr, 'f' },
+        { "trigger",       required_argument, nullptr, 't' },
+        { "set",           required_argument, nullptr, 'C' },
+        { "metrics",       no_argument,       nullptr, 'M' },
+        { "aps",           required_argument, nullptr, 'a' },
+        { "stations",      required_argument, nullptr, 'S' },
+        { "seed",          required_argument, nullptr, 'e' },
+        { "deauth",        required_argument, nullptr, 'd' },
+        { "rogue",         required_argument, nullptr, 'g' },
+        { "log-level",     required_argument, nullptr, 'L' },
+        { "help",          no_argument,       nullptr, 'h' },
+        { nullptr,         0,                 nullptr, 0 },
+    };
+    static const char* level_names[] = { "none", "error", "warn", "info", "debug", "verbose" };
+
+    options->pcap_path = nullptr;
+    options->filter = nullptr;
+    options->trigger = "subtype deauth or subtype disassoc";
+    options->set_count = 0;
+    options->channel = 1;
+    options->hop = false;
+    options->metrics = false;
+    options->log_level = ESP_LOG_WARN;
+    options->injector = injector_default_config();
+    options->synthetic = synthetic_default_config();
+
+    bool frame_limit = false;
+    bool time_limit = false;
+    int opt;
+    while ((opt = getopt_long(argc, argv, "h", long_options, nullptr)) != -1) {
+        switch (opt) {
+            case 'p': options->pcap_path = optarg; break;
+            case 'r': options->injector.rate_fps = strtoul(optarg, nullptr, 0); break;
+            case 'R': options->injector.realtime = true; break;
+            case 'x': options->injector.speed = strtof(optarg, nullptr); break;
+            case 'n': options->injector.max_frames = strtoull(optarg, nullptr, 0); frame_limit = true; break;
+            case 's': options->injector.duration_ms = strtoul(optarg, nullptr, 0) * 1000; time_limit = true; break;
+            case 'l': options->injector.loop = true; break;
+            case 'k': options->injector.keep_channels = true; break;
+            case 'c': options->channel = (uint8_t)strtoul(optarg, nullptr, 0); break;
+            case 'H': options->hop = true; break;
+            case 'f': options->filter = optarg; break;
+            case 't': options->trigger = optarg; break;
+            case 'C':
+                if (options->set_count == SIM_MAX_SETS) {
+                    return false;
+                }
+                options->sets[options->set_count++] = optarg;
+                break;
+            case 'M': options->metrics = true; break;
+            case 'a': options->synthetic.access_points = (uint16_t)strtoul(optarg, nullptr, 0); break;
+            case 'S': options->synthetic.stations = (uint16_t)strtoul(optarg, nullptr, 0); break;
+            case 'e': options->synthetic.seed = strtoul(optarg, nullptr, 0); break;
+            case 'd': options->synthetic.deauth_percent = (uint8_t)strtoul(optarg, nullptr, 0); break;
+            case 'g': options->synthetic.rogue_percent = (uint8_t)strtoul(optarg, nullptr, 0); break;
+            case 'L': {
+                bool found = false;
+                for (int i = 0; i <= ESP_LOG_VERBOSE; i++) {
+                    if (strcmp(optarg, level_names[i]) == 0) {
+                        options->log_level = (esp_log_level_t)i;
+                        found = true;
+                    }
+                }
+                if (!found) {
+                    return false;
+                }
+                break;
+            }
+            default:
+                return false;
+        }
+    }
+
+    // A frame limit alone runs until it is reached
+    if (frame_limit && !time_limit) {
+        options->injector.duration_ms = 0;
+    }
+    return optind == argc && options->channel >= 1 && options->channel <= SNIFFER_MAX_CHANNEL;
+}
+
+// Wait until every delivered frame has been filtered, dropped or processed
+static void wait_for_drain(NetworkSniffer& sniffer, uint32_t delivered) {
+    int64_t deadline = esp_timer_get_time() + 2000000;
+    while (esp_timer_get_time() < deadline) {
+        SnifferStats stats = sniffer.get_stats();
+        if (stats.filtered + stats.dropped + stats.processed >= delivered) {
+            return;
+        }
+        vTaskDelay(pdMS_TO_TICKS(1));
+    }
+    ESP_LOGW(TAG, "Pipeline did not drain within 2 s");
+}
+
+int main(int argc, char** argv) {
+    SimOptions options;
+    if (!parse_options(argc, argv, &options)) {
+        usage(argv[0]);
+        return 2;
+    }
+    esp_log_level_set("*", options.log_level);
+
+    PcapSource pcap;
+    SyntheticSource synthetic(options.synthetic);
+    FrameSource* source = &synthetic;
+    if (options.pcap_path) {
+        char error[128];
+        if (!pcap.open(options.pcap_path, error, sizeof(error))) {
+            fprintf(stderr, "%s\n", error);
+            return 1;
+        }
+        source = &pcap;
+    }
+
+    ESP_ERROR_CHECK(esp_event_loop_create_default());
+
+    NetworkSniffer sniffer;
+    ESP_ERROR_CHECK(sniffer.init());
+    if (options.filter) {
+        ESP_ERROR_CHECK(sniffer.set_filter(options.filter));
+    }
+
+    // Runtime settings, seeded from the options and the scheduler defaults
+    SnifferSettings settings = sniffer_config_default_settings();
+    SchedulerConfig hop_defaults = channel_scheduler_default_config();
+    settings.channel = options.hop ? 0 : options.channel;
+    settings.hop_round_ms = hop_defaults.round_ms;
+    settings.hop_min_dwell_ms = hop_defaults.min_dwell_ms;
+    settings.log_level = (uint8_t)options.log_level;
+    snprintf(settings.filter, sizeof(settings.filter), "%s", options.filter ? options.filter : "");
+    SnifferConfig config(settings);
+    ConfigSim config_sim = { &config, settings, config.generation(), 0 };
+
+    ChannelScheduler scheduler(scheduler_config_from(settings));
+    FrameDedup* dedup = new FrameDedup();
+    sniffer.set_dedup(dedup);
+    DeviceTracker* devices = new DeviceTracker();
+    InventorySim* inventory = new InventorySim();
+    RecorderSim* recorder = new RecorderSim();
+    char error[128];
+    if (!recorder->trigger.configure(options.trigger, 10, 1000, error, sizeof(error))) {
+        fprintf(stderr, "Bad trigger: %s\n", error);
+        return 2;
+    }
+    RecorderExporter exporter = {};
+    exporter.frame = count_snapshot_frame;
+    exporter.end = count_snapshot;
+    exporter.ctx = recorder;
+    recorder->recorder.set_exporter(exporter);
+    ESP_ERROR_CHECK(recorder->recorder.add_trigger(&recorder->trigger, "burst"));
+    ESP_ERROR_CHECK(recorder->recorder.start(RecorderSim::sim_recorder_config()));
+    AttackSim* attacks = new AttackSim();
+    attacks->recorder = &recorder->recorder;
+    static LatencyStats latency;
+    latency.min_us = UINT32_MAX;
+    ESP_ERROR_CHECK(sniffer.add_frame_sink(stats_sink, &frame_stats));
+    ESP_ERROR_CHECK(sniffer.add_frame_sink(scheduler_sink, &scheduler));
+    ESP_ERROR_CHECK(sniffer.add_frame_sink(device_sink, devices));
+    ESP_ERROR_CHECK(sniffer.add_frame_sink(inventory_sink, inventory));
+    ESP_ERROR_CHECK(sniffer.add_frame_sink(attack_sink, attacks));
+    ESP_ERROR_CHECK(sniffer.add_frame_sink(&recorder->recorder));
+    ESP_ERROR_CHECK(sniffer.add_frame_sink(latency_sink, &latency));
+
+    MetricsSampler sampler;
+    ESP_ERROR_CHECK(sampler.add_queue("frame_ring", frame_ring_metrics, &sniffer));
+    ESP_ERROR_CHECK(sampler.add_queue("recorder", recorder_metrics, &recorder->recorder));
+    static MetricsSnapshot metrics;
+
+    HopDecision hop = { options.channel, 0 };
+    if (options.hop) {
+        hop = scheduler.next_hop(0);
+    }
+    ESP_ERROR_CHECK(sniffer.start_sniffing(hop.channel));
+
+    // The injector thread plays the Wi-Fi driver task. CPU use and metrics
+    // are sampled over the injection, before the thread (and its CPU clock)
+    // goes away.
+    FrameInjector injector(source, options.injector);
+    InjectorStats injected = {};
+    PipelineCpuUsage cpu = {};
+    std::atomic<bool> injecting(true);
+    pipeline_get_cpu_usage(&cpu);
+    sampler.sample(&metrics);
+    std::thread wifi_thread([&] {
+        injected = injector.run();
+        pipeline_get_cpu_usage(&cpu);
+        sampler.sample(&metrics);
+        injecting = false;
+    });
+
+    // Hop, and apply settings changed by --set while frames keep flowing
+    std::thread config_thread([&] {
+        vTaskDelay(pdMS_TO_TICKS(1000));
+        publish_sets(&config, options.sets, options.set_count);
+    });
+    uint32_t waited = 0;
+    while (injecting) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+        waited += 10;
+        bool hop_changed = apply_settings(&config_sim, sniffer, scheduler);
+        uint8_t fixed = config_sim.applied.channel;
+        if (fixed == 0 && (hop_changed || waited >= hop.dwell_ms)) {
+            hop = scheduler.next_hop(waited);
+            sniffer.set_channel(hop.channel);
+            waited = 0;
+        } else if (fixed != 0 && hop_changed) {
+            sniffer.set_channel(fixed);
+        }
+    }
+    wifi_thread.join();
+    config_thread.join();
+
+    HostWifiStats radio = host_wifi_get_stats();
+    wait_for_drain(sniffer, radio.delivered);
+    sniffer.stop_sniffing();
+
+    SnifferStats capture = sniffer.get_stats();
+    CaptureClockStats clock = sniffer.get_clock_stats();
+    StatsSnapshot stats;
+    frame_stats.snapshot(&stats);
+    TraceStats trace = sniffer_trace_get_stats();
+    InventoryStats aps = inventory->inventory.get_stats();
+    FlightRecorderStats recorded = recorder->recorder.get_stats();
+    AttackDetectorStats detected = attacks->detector.get_stats();
+    double seconds = injected.elapsed_us / 1e6;
+
+    printf("Injected:  %llu frames, %llu bytes in %.3f s (%.0f frames/s, %.2f Mbit/s), %llu late\n",
+           (unsigned long long)injected.frames, (unsigned long long)injected.bytes, seconds,
+           seconds > 0 ? injected.frames / seconds : 0.0,
+           seconds > 0 ? injected.bytes * 8 / seconds / 1e6 : 0.0,
+           (unsigned long long)injected.late);
+    printf("Radio:     delivered=%u driver_filtered=%u off_channel=%u hops=%u\n",
+           radio.delivered, radio.filtered, radio.off_channel, radio.channel_changes);
+    printf("Sniffer:   captured=%u filtered=%u dropped=%u processed=%u ring_peak=%u/%u\n",
+           capture.captured, capture.filtered, capture.dropped, capture.processed,
+           capture.ring_high_water, capture.ring_capacity);
+    printf("Drop rate: %.3f%%\n",
+           radio.delivered ? 100.0 * capture.dropped / radio.delivered : 0.0);
+    if (latency.count) {
+        printf("Latency:   min=%u avg=%.1f p50<%u p99<%u max=%u us\n",
+               latency.min_us.load(), (double)latency.total_us / latency.count,
+               latency_percentile(latency, 0.50), latency_percentile(latency, 0.99), latency.max_us.load());
+    }
+    printf("Clock:     offset=%lld us wraps=%u resyncs=%u clamped=%u\n",
+           (long long)clock.offset_us, clock.wraps, clock.resyncs, clock.clamped);
+    printf("Frames:    mgmt=%u ctrl=%u data=%u retries=%u\n",
+           stats.by_type[IEEE80211_TYPE_MGMT], stats.by_type[IEEE80211_TYPE_CTRL],
+           stats.by_type[IEEE80211_TYPE_DATA], stats.retries);
+    FrameDedupStats deduped = dedup->get_stats();
+    WorstRetry worst = {};
+    devices->for_each(find_worst_retry, &worst);
+    printf("Dedup:     checked=%u duplicates=%u retries=%u streams=%u evicted=%u bytes=%u",
+           deduped.checked, deduped.duplicates, deduped.retries, deduped.streams, deduped.evictions,
+           (unsigned)FrameDedup::footprint());
+    if (worst.record) {
+        const uint8_t* mac = worst.record->mac;
+        printf(" worst=%02x:%02x:%02x:%02x:%02x:%02x (%.1f%%)",
+               mac[0], mac[1], mac[2], mac[3], mac[4], mac[5], 100.0f * worst.record->retry_rate());
+    }
+    printf("\n");
+    printf("Devices:   tracked=%u/%u evicted=%u\n",
+           (unsigned)devices->size(), (unsigned)devices->capacity(), devices->evictions());
+    std::vector<uint32_t> tally(oui_registry.vendor_count + 1);
+    devices->for_each(tally_vendor, &tally);
+    uint16_t top = 0;
+    for (uint16_t vendor = 1; vendor < oui_registry.vendor_count; vendor++) {
+        if (tally[vendor] > tally[top]) {
+            top = vendor;
+        }
+    }
+    printf("Vendors:   labeled=%u randomized=%u unknown=%u table=%u/%u bytes=%u",
+           vendor_counts.labeled.load(), vendor_counts.randomized.load(), vendor_counts.unknown.load(),
+           oui_registry.count, (unsigned)oui_registry.vendor_count, (unsigned)oui_table_bytes(oui_registry));
+    if (tally[top]) {
+        printf(" top=%s (%u)", oui_vendor_name(top), tally[top]);
+    }
+    printf("\n");
+    printf("Inventory: aps=%u probes=%u ssids=%u frames=%u deltas=%u batches=%u bytes=%u\n",
+           aps.aps, aps.probes, aps.ssids, aps.frames, aps.deltas,
+           inventory->batches.load(), inventory->bytes.load());
+    printf("Attacks:   deauth=%u beacon=%u twin=%u probe=%u suppressed=%u evicted=%u bytes=%u\n",
+           detected.alerts[ATTACK_DEAUTH_FLOOD], detected.alerts[ATTACK_BEACON_FLOOD],
+           detected.alerts[ATTACK_EVIL_TWIN], detected.alerts[ATTACK_PROBE_STORM],
+           detected.suppressed, detected.evictions, attacks->bytes.load());
+    printf("Recorder:  recorded=%u overwritten=%u dropped=%u used=%u/%u triggers=%u suppressed=%u snapshots=%u exported=%u\n",
+           recorded.recorded, recorded.overwritten, recorded.dropped, recorded.ring_used, recorded.ring_bytes,
+           recorded.triggers, recorded.suppressed, recorder->snapshots.load(), recorder->frames.load());
+    printf("Config:    generation=%u applied=%u channel=%u filter=\"%s\"\n",
+           config.generation(), config_sim.changes, config_sim.applied.channel, config_sim.applied.filter);
+    printf("CPU:       ingest=%.1f%% analysis=%.1f%% export=%.1f%% (of one core)\n",
+           cpu.stage_percent[PIPELINE_STAGE_INGEST], cpu.stage_percent[PIPELINE_STAGE_ANALYSIS],
+           cpu.stage_percent[PIPELINE_STAGE_EXPORT]);
+    static uint8_t metrics_frame[METRICS_MAX_FRAME];
+    const MetricsHeap& heap = metrics.heap[METRICS_HEAP_INTERNAL];
+    printf("Metrics:   heap_free=%u min=%u tasks=%u queues=%u frame=%u bytes\n",
+           heap.free_bytes, heap.min_free_bytes, metrics.task_count, metrics.queue_count,
+           (unsigned)metrics_encode(metrics, metrics_frame, sizeof(metrics_frame)));
+    printf("Trace:     written=%u dropped=%u\n", trace.written, trace.dropped);
+    if (options.metrics) {
+        static char text[4096];
+        metrics_format(metrics, text, sizeof(text));
+        printf("%s\n", text);
+    }
+    if (options.pcap_path && pcap.skipped()) {
+        printf("Skipped:   %u capture records\n", pcap.skipped());
+    }
+
+    // Tasks never return, as on the device; leave without tearing them down
+    fflush(stdout);
+    fflush(stderr);
+    _exit(0);
+}
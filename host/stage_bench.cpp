@@ -0,0 +1,269 @@
+// Host micro-benchmarks of the per-frame stages.
+//
+// Runs each stage alone, back to back over the synthetic corpus of
+// components/pipeline_bench, and prints its throughput. Unlike
+// pipeline_bench there are no tasks, queues or pacing, so the numbers are
+// the stage's own cost and comparable between runs of the same build.
+
+#include <chrono>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "bench_corpus.h"
+#include "device_tracker.h"
+#include "ieee80211_parser.h"
+#include "telemetry_codec.h"
+
+struct BenchOptions {
+    size_t frames;
+    uint64_t iterations;
+    size_t batch_limit;
+    uint32_t seed;
+};
+
+static void usage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --frames N          Corpus size (default 4096)\n"
+            "  --iterations N      Operations per stage (default 10000000)\n"
+            "  --batch-limit N     Telemetry batch size, normally MTU - 3 (default 244)\n"
+            "  --seed N            Synthetic corpus seed (default 1)\n",
+            program);
+}
+
+static bool parse_options(int argc, char** argv, BenchOptions* options) {
+    static const struct option long_options[] = {
+        { "frames",     required_argument, nullptr, 'n' },
+        { "iterations", required_argument, nullptr, 'i' },
+        { "batch-limit", required_argument, nullptr, 'b' },
+        { "seed",       required_argument, nullptr, 'e' },
+        { "help",       no_argument,       nullptr, 'h' },
+        { nullptr,      0,                 nullptr, 0 },
+    };
+
+    options->frames = 4096;
+    options->iterations = 10000000;
+    options->batch_limit = 244;
+    options->seed = 1;
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "h", long_options, nullptr)) != -1) {
+        switch (opt) {
+            case 'n': options->frames = strtoul(optarg, nullptr, 0); break;
+            case 'i': options->iterations = strtoull(optarg, nullptr, 0); break;
+            case 'b': options->batch_limit = strtoul(optarg, nullptr, 0); break;
+            case 'e': options->seed = strtoul(optarg, nullptr, 0); break;
+            default:
+                return false;
+        }
+    }
+    return optind == argc && options->frames > 0 && options->iterations > 0 &&
+           options->batch_limit >= TELEMETRY_HEADER_SIZE + TELEMETRY_MAX_RECORD_SIZE &&
+           options->batch_limit <= TELEMETRY_MAX_BATCH;
+}
+
+// Call `op(i, &checksum)` with i = 0, 1, ... until it has processed
+// `count` units, and print units/s. `op` returns the units each call
+// processed and folds its results into the checksum, which is printed so
+// that the compiler cannot drop the work.
+template <typename Op>
+static void run(const char* stage, const char* unit, uint64_t count, Op op) {
+    uint64_t checksum = 0;
+    uint64_t done = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; done < count; i++) {
+        done += op(i, &checksum);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("  %-14s %7.2f M %s/s  %7.1f ns each  (checksum %llx)\n",
+           stage, done / seconds / 1e6, unit, seconds * 1e9 / done, (unsigned long long)checksum);
+}
+
+static void bench_parser(const BenchCorpus& corpus, const BenchOptions& options) {
+    size_t frames = corpus.size();
+    uint64_t parsed_ok = 0;
+    run("parser", "frames", options.iterations, [&](uint64_t i, uint64_t* checksum) {
+        const BenchFrame& frame = corpus.frame(i % frames);
+        ParsedFrame parsed;
+        if (ieee80211_parse(frame.data, frame.len, frame.len == frame.orig_len, &parsed)) {
+            *checksum += parsed.header_len;
+            parsed_ok++;
+        }
+        return 1;
+    });
+    printf("  %-14s %.1f%% of frames parsed\n", "", 100.0 * parsed_ok / options.iterations);
+}
+
+static uint32_t xorshift(uint32_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+static void count_record(const TelemetryRecord& record, void* ctx) {
+    *static_cast<uint64_t*>(ctx) += record.length;
+}
+
+static void bench_codec(const BenchCorpus& corpus, const BenchOptions& options) {
+    // Records as the telemetry sink builds them, parsed up front. Frames are
+    // 20-275 us apart, about 7000 frames/s; the gap sets the varint size.
+    size_t frames = corpus.size();
+    std::vector<TelemetryRecord> records(frames);
+    std::vector<uint32_t> gaps(frames);
+    uint32_t state = options.seed ? options.seed : 0x9E3779B9;
+    for (size_t i = 0; i < frames; i++) {
+        const BenchFrame& frame = corpus.frame(i);
+        ParsedFrame parsed;
+        TelemetryRecord& record = records[i];
+        record = {};
+        record.length = frame.orig_len;
+        record.rssi = frame.rssi;
+        record.channel = frame.channel;
+        if (ieee80211_parse(frame.data, frame.len, frame.len == frame.orig_len, &parsed)) {
+            record.type = parsed.type;
+            record.subtype = parsed.subtype;
+            record.retry = (parsed.flags & IEEE80211_FC_RETRY) != 0;
+        }
+        gaps[i] = 20 + xorshift(&state) % 256;
+    }
+
+    TelemetryEncoder encoder(options.batch_limit);
+    uint32_t timestamp_us = 0;
+    uint64_t batches = 0;
+    uint64_t batch_bytes = 0;
+    run("encode", "records", options.iterations, [&](uint64_t i, uint64_t* checksum) {
+        TelemetryRecord& record = records[i % frames];
+        timestamp_us += gaps[i % frames];
+        record.timestamp_us = timestamp_us;
+        if (!encoder.append(record)) {
+            const uint8_t* batch;
+            size_t len = encoder.finish(&batch);
+            *checksum += batch[len - 1];
+            batch_bytes += len;
+            batches++;
+            encoder.append(record);
+        }
+        return 1;
+    });
+    uint64_t batched_records = options.iterations - encoder.record_count();
+    printf("  %-14s %.2f bytes/record with headers, %.1f records/batch of at most %zu bytes\n", "",
+           (double)batch_bytes / batched_records, (double)batched_records / batches, options.batch_limit);
+
+    // Decode batches of one pass over the corpus, over and over. The decoder
+    // counts the repeats as lost batches, which costs nothing.
+    std::vector<std::vector<uint8_t>> encoded;
+    encoder.reset();
+    timestamp_us = 0;
+    for (size_t i = 0; i <= frames; i++) {
+        if (i < frames) {
+            timestamp_us += gaps[i];
+            records[i].timestamp_us = timestamp_us;
+        }
+        if (i == frames || !encoder.append(records[i])) {
+            const uint8_t* batch;
+            size_t len = encoder.finish(&batch);
+            encoded.emplace_back(batch, batch + len);
+            if (i < frames) {
+                encoder.append(records[i]);
+            }
+        }
+    }
+    TelemetryDecoder decoder;
+    run("decode", "records", options.iterations, [&](uint64_t i, uint64_t* checksum) {
+        const std::vector<uint8_t>& batch = encoded[i % encoded.size()];
+        uint32_t before = decoder.records();
+        decoder.decode(batch.data(), batch.size(), count_record, checksum);
+        return decoder.records() - before;
+    });
+}
+
+static void bench_tracker(const BenchCorpus& corpus, const BenchOptions& options) {
+    // Observations as the device sink builds them, parsed up front
+    size_t frames = corpus.size();
+    std::vector<DeviceObservation> observations;
+    for (size_t i = 0; i < frames; i++) {
+        const BenchFrame& frame = corpus.frame(i);
+        ParsedFrame parsed;
+        if (!ieee80211_parse(frame.data, frame.len, frame.len == frame.orig_len, &parsed) || !parsed.transmitter) {
+            continue;
+        }
+        DeviceObservation obs = {};
+        obs.mac = parsed.transmitter;
+        obs.bssid = parsed.bssid;
+        obs.rssi = frame.rssi;
+        obs.channel = frame.channel;
+        obs.type = parsed.type;
+        obs.is_ap = ieee80211_is_mgmt(parsed, IEEE80211_MGMT_BEACON) ||
+                    ieee80211_is_mgmt(parsed, IEEE80211_MGMT_PROBE_RESP) ||
+                    (parsed.bssid && memcmp(parsed.bssid, parsed.transmitter, 6) == 0);
+        observations.push_back(obs);
+    }
+
+    // The corpus' 40 devices all fit, so every update finds its record
+    DeviceTracker* tracker = new DeviceTracker();
+    run("tracker", "updates", options.iterations, [&](uint64_t i, uint64_t* checksum) {
+        DeviceObservation& obs = observations[i % observations.size()];
+        obs.timestamp_us = (int64_t)i;
+        *checksum += tracker->update(obs)->channel;
+        return 1;
+    });
+    printf("  %-14s %zu devices, %lu evictions\n", "", tracker->size(), (unsigned long)tracker->evictions());
+
+    // Four times as many transmitters as the table holds, picked at random:
+    // most updates insert and evict
+    tracker->clear();
+    uint32_t population = DEVICE_TRACKER_CAPACITY * 4;
+    std::vector<uint8_t> macs(population * 6);
+    uint32_t state = options.seed ? options.seed : 0x9E3779B9;
+    for (uint32_t d = 0; d < population; d++) {
+        uint32_t random = xorshift(&state);
+        uint8_t* mac = &macs[d * 6];
+        mac[0] = 0x02;
+        mac[1] = (uint8_t)(random >> 24);
+        mac[2] = (uint8_t)(random >> 16);
+        mac[3] = (uint8_t)(random >> 8);
+        mac[4] = (uint8_t)(d >> 8);
+        mac[5] = (uint8_t)d;
+    }
+    std::vector<uint32_t> picks(1 << 16);
+    for (uint32_t& pick : picks) {
+        pick = xorshift(&state) % population;
+    }
+    uint64_t inserts = 0;
+    run("tracker-churn", "updates", options.iterations, [&](uint64_t i, uint64_t* checksum) {
+        DeviceObservation& obs = observations[i % observations.size()];
+        DeviceObservation churn = obs;
+        churn.mac = &macs[picks[i & (picks.size() - 1)] * 6];
+        churn.timestamp_us = (int64_t)i;
+        bool inserted;
+        *checksum += tracker->update(churn, &inserted)->channel;
+        inserts += inserted;
+        return 1;
+    });
+    printf("  %-14s %zu of %lu devices, %.1f%% inserts, %lu evictions\n", "", tracker->size(),
+           (unsigned long)population, 100.0 * inserts / options.iterations, (unsigned long)tracker->evictions());
+    delete tracker;
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    if (!parse_options(argc, argv, &options)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    BenchCorpus corpus;
+    if (bench_corpus_generate(&corpus, options.frames, options.seed) == 0) {
+        fprintf(stderr, "Cannot build the corpus\n");
+        return 1;
+    }
+    printf("Corpus: %zu frames, %zu bytes\n", corpus.size(), corpus.bytes());
+
+    bench_parser(corpus, options);
+    bench_codec(corpus, options);
+    bench_tracker(corpus, options);
+    return 0;
+}
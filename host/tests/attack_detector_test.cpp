@@ -0,0 +1,155 @@
+// AttackDetector (components/attack_detector) on synthetic traffic with and
+// without crafted attacks, and its evil twin check on SSIDs whose hashes
+// collide.
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "attack_detector.h"
+#include "frame_injector.h"
+#include "test_check.h"
+
+// Frames fed per run, 20 us apart: two seconds of traffic
+#define TEST_FRAMES     100000
+#define TEST_GAP_US     20
+
+static void collect(const AttackAlert& alert, void* ctx) {
+    static_cast<std::vector<AttackAlert>*>(ctx)->push_back(alert);
+}
+
+// Feed `config`'s traffic to `detector`; returns the alerts raised
+static std::vector<AttackAlert> run(const SyntheticConfig& config, AttackDetector* detector) {
+    std::vector<AttackAlert> alerts;
+    SyntheticSource source(config);
+    InjectorFrame frame;
+    for (int64_t i = 0; i < TEST_FRAMES && source.next(&frame); i++) {
+        ParsedFrame parsed;
+        if (ieee80211_parse(frame.data, frame.len, frame.has_fcs, &parsed)) {
+            detector->update(parsed, frame.rx_ctrl.rssi, frame.rx_ctrl.channel, i * TEST_GAP_US, collect, &alerts);
+        }
+    }
+    return alerts;
+}
+
+static size_t count(const std::vector<AttackAlert>& alerts, AttackKind kind) {
+    size_t n = 0;
+    for (const AttackAlert& alert : alerts) {
+        n += alert.kind == kind;
+    }
+    return n;
+}
+
+static void test_synthetic() {
+    // Plain traffic raises neither deauth floods nor evil twins
+    AttackDetector* detector = new AttackDetector();
+    SyntheticConfig config = synthetic_default_config();
+    std::vector<AttackAlert> alerts = run(config, detector);
+    CHECK_EQ(count(alerts, ATTACK_DEAUTH_FLOOD), 0);
+    CHECK_EQ(count(alerts, ATTACK_EVIL_TWIN), 0);
+
+    // 2% deauthentications in the APs' names: a flood per AP and one overall
+    detector->clear();
+    config.deauth_percent = 2;
+    config.rogue_percent = 2;
+    alerts = run(config, detector);
+    size_t per_bssid = 0;
+    size_t overall = 0;
+    for (const AttackAlert& alert : alerts) {
+        if (alert.kind != ATTACK_DEAUTH_FLOOD) {
+            continue;
+        }
+        static const uint8_t zero[6] = { 0 };
+        if (memcmp(alert.mac, zero, 6) == 0) {
+            overall++;
+        } else {
+            // The AP's own address, reason 7
+            CHECK_EQ(alert.mac[3], 0x01);
+            CHECK(memcmp(alert.mac, alert.bssid, 6) == 0);
+            CHECK_EQ(alert.detail, 7);
+            CHECK(alert.count >= attack_detector_default_config().deauth_threshold);
+            per_bssid++;
+        }
+    }
+    CHECK_EQ(per_bssid, config.access_points);
+    CHECK_EQ(overall, 1);
+
+    // 2% open beacons copying the APs' SSIDs from fresh BSSIDs: each AP and
+    // a rogue are twins of each other, whichever was heard first
+    size_t twins = 0;
+    uint32_t twinned = 0;
+    for (const AttackAlert& alert : alerts) {
+        if (alert.kind != ATTACK_EVIL_TWIN) {
+            continue;
+        }
+        const uint8_t* ap = alert.mac[3] == 0x01 ? alert.mac : alert.bssid;
+        const uint8_t* rogue = alert.mac[3] == 0x01 ? alert.bssid : alert.mac;
+        CHECK_EQ(ap[3], 0x01);
+        CHECK_EQ(rogue[3], 0x03);
+        if (ap == alert.mac) {
+            CHECK_EQ(alert.detail, ATTACK_SECURITY_WEP << 8 | ATTACK_SECURITY_OPEN);
+        } else {
+            CHECK_EQ(alert.detail, ATTACK_SECURITY_OPEN << 8 | ATTACK_SECURITY_WEP);
+        }
+        twinned |= 1u << ap[5];
+        twins++;
+    }
+    CHECK_EQ(twinned, (1u << config.access_points) - 1);
+
+    AttackDetectorStats stats = detector->get_stats();
+    CHECK_EQ(stats.alerts[ATTACK_DEAUTH_FLOOD], per_bssid + overall);
+    CHECK_EQ(stats.alerts[ATTACK_EVIL_TWIN], twins);
+    CHECK(stats.suppressed > 0);
+    delete detector;
+}
+
+// Beacon of `bssid` advertising `ssid`, with or without privacy
+static void beacon(AttackDetector* detector, const uint8_t* bssid, const char* ssid, bool privacy,
+                   int64_t now_us, std::vector<AttackAlert>* alerts) {
+    ParsedFrame frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.type = IEEE80211_TYPE_MGMT;
+    frame.subtype = IEEE80211_MGMT_BEACON;
+    frame.transmitter = bssid;
+    frame.bssid = bssid;
+    frame.capability = privacy ? 0x0011 : 0x0001;
+    frame.ssid.data = (const uint8_t*)ssid;
+    frame.ssid.len = strlen(ssid);
+    detector->update(frame, -50, 6, now_us, collect, alerts);
+}
+
+static void test_ssid_collision() {
+    // Two SSIDs with the same FNV-1a hash
+    const char* ssid = "ssid-1162789";
+    const char* other = "ssid-1379192";
+    const uint8_t original[6] = { 0x02, 0x00, 0x00, 0x01, 0x00, 0x01 };
+    const uint8_t neighbour[6] = { 0x02, 0x00, 0x00, 0x01, 0x00, 0x02 };
+    const uint8_t twin[6] = { 0x02, 0x00, 0x00, 0x03, 0x00, 0x01 };
+    AttackDetector* detector = new AttackDetector();
+    std::vector<AttackAlert> alerts;
+
+    // An open network whose SSID only shares the hash is not a twin
+    beacon(detector, original, ssid, true, 0, &alerts);
+    beacon(detector, neighbour, other, false, 1000, &alerts);
+    CHECK(alerts.empty());
+
+    // Nor is a prefix of the SSID
+    beacon(detector, twin, "ssid-116278", false, 2000, &alerts);
+    CHECK(alerts.empty());
+
+    // Each original is still held and compared by its own bytes
+    beacon(detector, twin, ssid, false, 3000, &alerts);
+    beacon(detector, twin, other, true, 4000, &alerts);
+    CHECK_EQ(alerts.size(), 2);
+    CHECK(alerts[0].kind == ATTACK_EVIL_TWIN && memcmp(alerts[0].bssid, original, 6) == 0);
+    CHECK_EQ(alerts[0].detail, ATTACK_SECURITY_OPEN << 8 | ATTACK_SECURITY_WEP);
+    CHECK(alerts[1].kind == ATTACK_EVIL_TWIN && memcmp(alerts[1].bssid, neighbour, 6) == 0);
+    CHECK_EQ(alerts[1].detail, ATTACK_SECURITY_WEP << 8 | ATTACK_SECURITY_OPEN);
+    delete detector;
+}
+
+int main() {
+    test_synthetic();
+    test_ssid_collision();
+    printf("attack_detector_test: ok\n");
+    return 0;
+}
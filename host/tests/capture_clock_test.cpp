@@ -0,0 +1,142 @@
+// CaptureClock and ReferenceClock (components/network_sniffer) on simulated
+// receive timers and references: 32-bit wraparound, timer jumps, queueing
+// delay, reference steps and a reference running 100 ppm fast.
+
+#include <stdio.h>
+#include "capture_clock.h"
+#include "host_wifi.h"
+#include "test_check.h"
+
+// One frame every millisecond
+#define TEST_FRAME_US   1000
+
+static uint32_t xorshift(uint32_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+// Frames received at local times [start_us, end_us) with the receive timer
+// reading `rx_base` + local time, each processed after up to 2 ms of
+// queueing. Once two alignment windows have passed since `settled_us`, every
+// timestamp must be at most 60 us after the true receive time, the least
+// queueing delay of a window.
+static void receive(CaptureClock* clock, const ReferenceClock& reference, int64_t start_us, int64_t end_us,
+                    uint32_t rx_base, int64_t settled_us, uint32_t* state) {
+    for (int64_t t = start_us; t < end_us; t += TEST_FRAME_US) {
+        int64_t delay = xorshift(state) % 2000;
+        CaptureTime time = clock->capture((uint32_t)(rx_base + t), t + delay, reference);
+        if (t >= settled_us + 2 * CAPTURE_CLOCK_WINDOW_US) {
+            CHECK(time.local_us >= t && time.local_us <= t + 60);
+        }
+    }
+}
+
+static void test_wrap_and_resync() {
+    CaptureClock clock;
+    ReferenceClock reference;
+    CaptureClockStats stats = {};
+    uint32_t state = 1;
+
+    // The shim's timer wraps one second in, as the device's does after ~71 minutes
+    receive(&clock, reference, 0, 5000000, HOST_WIFI_RX_TIMER_OFFSET, 0, &state);
+    clock.get_stats(&stats);
+    CHECK_EQ(stats.frames, 5000);
+    CHECK_EQ(stats.wraps, 1);
+    CHECK_EQ(stats.resyncs, 0);
+    int64_t error = stats.offset_us + HOST_WIFI_RX_TIMER_OFFSET;
+    CHECK(error >= 0 && error <= 60);
+
+    // The driver restarts with its timer at 2^30: far beyond
+    // CAPTURE_CLOCK_RESYNC_US from the estimate, so the alignment restarts
+    const uint32_t restarted = (1u << 30) - 5000000;
+    receive(&clock, reference, 5000000, 10000000, restarted, 5000000, &state);
+    clock.get_stats(&stats);
+    CHECK_EQ(stats.resyncs, 1);
+    CHECK_EQ(stats.wraps, 1);
+    error = stats.offset_us + restarted;
+    CHECK(error >= 0 && error <= 60);
+
+    // A pause in traffic is not a jump
+    receive(&clock, reference, 13000000, 14000000, restarted, 0, &state);
+    clock.get_stats(&stats);
+    CHECK_EQ(stats.resyncs, 1);
+    CHECK_EQ(stats.frames, 11000);
+}
+
+static void test_monotonic() {
+    CaptureClock clock;
+    ReferenceClock reference;
+    CaptureClockStats stats = {};
+
+    CHECK(reference.add_reference(0, 1000000000));
+    CHECK_EQ(reference.generation(), 1);
+    CaptureTime first = clock.capture(1000, 1000, reference);
+    CHECK_EQ(first.reference_us, first.local_us + 1000000000);
+
+    // A frame stamped before the previous one is held at its time
+    CaptureTime second = clock.capture(900, 1100, reference);
+    clock.get_stats(&stats);
+    CHECK_EQ(stats.clamped, 1);
+    CHECK_EQ(second.local_us, first.local_us);
+    CHECK_EQ(second.reference_us, first.reference_us);
+
+    // The reference steps back 500 s: three outliers, then a new mapping
+    for (int i = 1; i <= CAPTURE_CLOCK_MAX_OUTLIERS; i++) {
+        CHECK(!reference.add_reference(i * 1000000, 500000000 + i * 1000000));
+        CHECK(reference.has_reference() == (i < CAPTURE_CLOCK_MAX_OUTLIERS));
+    }
+    CHECK(reference.add_reference(4000000, 504000000));
+    CHECK_EQ(reference.generation(), 2);
+    reference.get_stats(&stats);
+    CHECK_EQ(stats.references, 2);
+    CHECK_EQ(stats.outliers, CAPTURE_CLOCK_MAX_OUTLIERS);
+    CHECK_EQ(stats.reference_offset_us, 500000000);
+
+    // Reference time follows it back instead of being clamped to the old one,
+    // and is monotonic again from there
+    CaptureTime stepped = clock.capture(4001000, 4001000, reference);
+    clock.get_stats(&stats);
+    CHECK_EQ(stats.clamped, 1);
+    CHECK_EQ(stepped.reference_us, 504001000);
+    CaptureTime late = clock.capture(4000500, 4001200, reference);
+    clock.get_stats(&stats);
+    CHECK_EQ(stats.clamped, 2);
+    CHECK_EQ(late.reference_us, stepped.reference_us);
+}
+
+static void test_skew() {
+    ReferenceClock reference;
+    CaptureClockStats stats = {};
+
+    // A reference 100 ppm fast, read once a second. The skew is measured
+    // every CAPTURE_CLOCK_SKEW_INTERVAL_US; truncation to 32 fractional bits
+    // leaves it a few ppb under.
+    for (int64_t local = 0; local <= 600000000; local += 1000000) {
+        CHECK(reference.add_reference(local, 7000000 + local + local / 10000));
+    }
+    reference.get_stats(&stats);
+    CHECK(stats.skew_ppb >= 99990 && stats.skew_ppb <= 100000);
+    CHECK_EQ(stats.references, 601);
+    CHECK_EQ(stats.outliers, 0);
+
+    // Between pairs, reference time is extrapolated at the measured rate
+    int64_t predicted = reference.to_reference(600500000);
+    int64_t actual = 7000000 + 600500000 + 600500000 / 10000;
+    CHECK(predicted - actual >= -1 && predicted - actual <= 1);
+
+    // Restarting the mapping drops the skew
+    reference.reset();
+    reference.get_stats(&stats);
+    CHECK_EQ(stats.skew_ppb, 0);
+    CHECK_EQ(reference.to_reference(1234), 1234);
+}
+
+int main() {
+    test_wrap_and_resync();
+    test_monotonic();
+    test_skew();
+    printf("capture_clock_test: ok\n");
+    return 0;
+}
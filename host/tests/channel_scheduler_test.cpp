@@ -0,0 +1,153 @@
+// Capture coverage of the adaptive ChannelScheduler against fixed
+// round-robin hopping, on a simulated band where a few channels carry
+// most of the traffic.
+//
+// Each visit captures the channel's frame rate times the dwell and feeds
+// those frames, with their BSSIDs, back to the scheduler. Both strategies
+// get the same total time and the same hop set.
+
+#include <stdio.h>
+#include "channel_scheduler.h"
+#include "test_check.h"
+
+// Simulated rounds per phase; the default config makes a round 65 s
+#define TEST_ROUNDS     20
+
+struct Band {
+    uint32_t rate[CHANNEL_SCHEDULER_MAX_CHANNEL + 1];   // Frames/s while listening
+    uint8_t aps[CHANNEL_SCHEDULER_MAX_CHANNEL + 1];     // BSSIDs the frames come from
+};
+
+// Three busy channels (1, 6, 11) and ten quiet ones
+static Band busy_band() {
+    Band band = {};
+    for (uint8_t ch = 1; ch <= 13; ch++) {
+        band.rate[ch] = 5;
+        band.aps[ch] = 1;
+    }
+    band.rate[1] = 800;
+    band.aps[1] = 6;
+    band.rate[6] = 600;
+    band.aps[6] = 4;
+    band.rate[11] = 400;
+    band.aps[11] = 3;
+    return band;
+}
+
+// Frames a visit of `dwell_ms` captures, fed to `scheduler` if given
+static uint64_t listen(const Band& band, uint8_t channel, uint32_t dwell_ms, ChannelScheduler* scheduler) {
+    uint64_t frames = (uint64_t)band.rate[channel] * dwell_ms / 1000;
+    if (scheduler) {
+        for (uint64_t i = 0; i < frames; i++) {
+            uint8_t bssid[6] = { 0x02, 0x00, 0x00, channel, 0x00, (uint8_t)(i % band.aps[channel]) };
+            scheduler->record_frame(channel, bssid);
+        }
+    }
+    return frames;
+}
+
+// Round-robin with the scheduler's hop set and average dwell
+static uint64_t round_robin(const Band& band, const SchedulerConfig& config, uint64_t duration_ms) {
+    uint32_t count = config.last_channel - config.first_channel + 1;
+    uint32_t dwell_ms = config.round_ms / count;
+    uint64_t frames = 0;
+    uint64_t elapsed_ms = 0;
+    for (uint8_t ch = config.first_channel; elapsed_ms < duration_ms;
+         ch = ch == config.last_channel ? config.first_channel : ch + 1) {
+        uint32_t dwell = duration_ms - elapsed_ms < dwell_ms ? (uint32_t)(duration_ms - elapsed_ms) : dwell_ms;
+        frames += listen(band, ch, dwell, nullptr);
+        elapsed_ms += dwell;
+    }
+    return frames;
+}
+
+// Hop with `scheduler` for `rounds` whole rounds, checking that each
+// visits every channel once for at least the minimum dwell and stays within
+// the round budget. `elapsed` carries the last visit over to the next call.
+static uint64_t adaptive(const Band& band, ChannelScheduler* scheduler, uint32_t rounds, uint32_t* elapsed,
+                         uint64_t* duration_ms, uint32_t* dwell) {
+    const SchedulerConfig& config = scheduler->config();
+    uint64_t frames = 0;
+    *duration_ms = 0;
+    for (uint32_t round = 0; round < rounds; round++) {
+        uint64_t round_ms = 0;
+        for (uint8_t ch = config.first_channel; ch <= config.last_channel; ch++) {
+            HopDecision hop = scheduler->next_hop(*elapsed);
+            CHECK_EQ(hop.channel, ch);
+            CHECK(hop.dwell_ms >= config.min_dwell_ms);
+            round_ms += hop.dwell_ms;
+            frames += listen(band, hop.channel, hop.dwell_ms, scheduler);
+            *elapsed = hop.dwell_ms;
+            dwell[ch] = hop.dwell_ms;
+        }
+        CHECK(round_ms <= config.round_ms);
+        *duration_ms += round_ms;
+    }
+    return frames;
+}
+
+// Hop sets outside 1..CHANNEL_SCHEDULER_MAX_CHANNEL are clamped into it
+static void check_sanitize() {
+    SchedulerConfig config = channel_scheduler_default_config();
+    config.first_channel = 20;
+    config.last_channel = 30;
+    ChannelScheduler scheduler(config);
+    CHECK_EQ(scheduler.config().first_channel, CHANNEL_SCHEDULER_MAX_CHANNEL);
+    CHECK_EQ(scheduler.config().last_channel, CHANNEL_SCHEDULER_MAX_CHANNEL);
+    for (int i = 0; i < 3; i++) {
+        CHECK_EQ(scheduler.next_hop(1000).channel, CHANNEL_SCHEDULER_MAX_CHANNEL);
+    }
+
+    config.first_channel = 0;
+    config.last_channel = 0;
+    scheduler.set_config(config);
+    CHECK_EQ(scheduler.config().first_channel, 1);
+    CHECK_EQ(scheduler.config().last_channel, 1);
+    CHECK_EQ(scheduler.next_hop(1000).channel, 1);
+    CHECK_EQ(scheduler.planned_dwell(20), 0);
+}
+
+static void report(const char* name, uint64_t baseline, uint64_t captured) {
+    printf("%-12s round-robin %9llu frames, adaptive %9llu frames (%.2fx)\n", name,
+           (unsigned long long)baseline, (unsigned long long)captured, (double)captured / baseline);
+}
+
+int main() {
+    SchedulerConfig config = channel_scheduler_default_config();
+    ChannelScheduler scheduler(config);
+    uint32_t elapsed = 0;
+    uint64_t duration_ms;
+    uint32_t dwell[CHANNEL_SCHEDULER_MAX_CHANNEL + 1] = {};
+
+    // Busy channels 1, 6 and 11
+    Band band = busy_band();
+    uint64_t captured = adaptive(band, &scheduler, TEST_ROUNDS, &elapsed, &duration_ms, dwell);
+    uint64_t baseline = round_robin(band, config, duration_ms);
+    report("busy 1/6/11", baseline, captured);
+    CHECK(captured * 2 > baseline * 3);
+    CHECK(dwell[1] > dwell[6] && dwell[6] > dwell[11] && dwell[11] > dwell[2]);
+
+    // The traffic moves from channel 1 to 3; the scheduler follows
+    band.rate[1] = 5;
+    band.aps[1] = 1;
+    band.rate[3] = 800;
+    band.aps[3] = 6;
+    captured = adaptive(band, &scheduler, TEST_ROUNDS, &elapsed, &duration_ms, dwell);
+    baseline = round_robin(band, config, duration_ms);
+    report("busy 3/6/11", baseline, captured);
+    CHECK(captured * 2 > baseline * 3);
+    CHECK(dwell[3] > dwell[6] && dwell[1] < dwell[11]);
+
+    // With every channel alike it does no worse than round-robin
+    for (uint8_t ch = 1; ch <= 13; ch++) {
+        band.rate[ch] = 100;
+        band.aps[ch] = 2;
+    }
+    captured = adaptive(band, &scheduler, TEST_ROUNDS, &elapsed, &duration_ms, dwell);
+    baseline = round_robin(band, config, duration_ms);
+    report("uniform", baseline, captured);
+    CHECK(captured * 100 >= baseline * 99);
+
+    check_sanitize();
+    return 0;
+}
@@ -0,0 +1,143 @@
+// FixedTable (components/fixed_table) against std::unordered_map under
+// random inserts, evictions and removals, with a hash that makes long,
+// wrapping probe runs.
+
+#include <stdio.h>
+#include <unordered_map>
+#include "fixed_table.h"
+#include "table_hash.h"
+#include "test_check.h"
+
+#define TEST_CAPACITY   64
+#define TEST_OPERATIONS 200000
+
+struct Entry {
+    uint32_t key;
+    uint32_t value;
+    uint8_t referenced;
+};
+
+// Only 16 distinct hashes, so probe runs are long and wrap past the index end
+struct WeakHash {
+    uint32_t operator()(const Entry& entry) const { return hash_of(entry.key); }
+    static uint32_t hash_of(uint32_t key) { return (key % 16) * 0x10000001u; }
+};
+
+typedef FixedTable<Entry, TEST_CAPACITY, WeakHash> Table;
+
+static size_t find(const Table& table, uint32_t key) {
+    return table.find(WeakHash::hash_of(key), [key](const Entry& entry) { return entry.key == key; });
+}
+
+// Every model key is found with its value, and nothing else is stored
+static void check_model(const Table& table, const std::unordered_map<uint32_t, uint32_t>& model) {
+    CHECK_EQ(table.size(), model.size());
+    for (const auto& item : model) {
+        size_t slot = find(table, item.first);
+        CHECK(table.occupied(slot));
+        CHECK_EQ(table.at_slot(slot).value, item.second);
+    }
+    for (size_t i = 0; i < table.size(); i++) {
+        CHECK(model.count(table[i].key) == 1);
+    }
+}
+
+static uint32_t xorshift(uint32_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+static void test_random() {
+    Table* table = new Table();
+    std::unordered_map<uint32_t, uint32_t> model;
+    uint32_t state = 1;
+    uint32_t evictions = 0;
+    for (uint32_t op = 0; op < TEST_OPERATIONS; op++) {
+        uint32_t key = xorshift(&state) % (TEST_CAPACITY * 3);
+        uint32_t action = xorshift(&state) % 4;
+        size_t slot = find(*table, key);
+        if (table->occupied(slot)) {
+            Entry& entry = table->at_slot(slot);
+            CHECK_EQ(entry.key, key);
+            if (action == 0) {
+                table->remove(&entry);
+                model.erase(key);
+            } else {
+                entry.value = op;
+                entry.referenced = 1;
+                model[key] = op;
+            }
+        } else if (action != 0) {
+            // Half the inserts stop at a full table, the others evict
+            Entry* entry;
+            if (action == 1) {
+                entry = table->insert(slot);
+                CHECK((entry == nullptr) == (model.size() == TEST_CAPACITY));
+                if (entry == nullptr) {
+                    continue;
+                }
+            } else {
+                bool evicted;
+                entry = table->insert_evict(slot, WeakHash::hash_of(key), &evicted);
+                CHECK(entry != nullptr);
+                CHECK_EQ(evicted, model.size() == TEST_CAPACITY);
+                if (evicted) {
+                    CHECK_EQ(entry->referenced, 0);
+                    CHECK_EQ(model.erase(entry->key), 1);
+                    evictions++;
+                }
+            }
+            entry->key = key;
+            entry->value = op;
+            entry->referenced = 1;
+            model[key] = op;
+        }
+        check_model(*table, model);
+    }
+    CHECK(evictions > 1000);
+
+    // Removing while walking [0, size()) still visits every record
+    for (size_t i = 0; i < table->size();) {
+        if ((*table)[i].key % 2) {
+            model.erase((*table)[i].key);
+            table->remove(&(*table)[i]);
+        } else {
+            i++;
+        }
+        check_model(*table, model);
+    }
+    for (size_t i = 0; i < table->size(); i++) {
+        CHECK_EQ((*table)[i].key % 2, 0);
+    }
+
+    table->clear();
+    model.clear();
+    check_model(*table, model);
+    delete table;
+}
+
+static void test_hashes() {
+    // Keys differing in one octet or only in the tag hash apart
+    const uint8_t a[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+    const uint8_t b[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x02 };
+    CHECK(mac_hash(a) != mac_hash(b));
+    CHECK(mac_hash(a, 1) != mac_hash(a, 2));
+    CHECK(mac_equal(a, a) && !mac_equal(a, b));
+    const uint8_t group[6] = { 0x01, 0x00, 0x5E, 0x00, 0x00, 0x01 };
+    CHECK(mac_unicast(a) && !mac_unicast(group));
+
+    // FNV-1a reference values, and continuing a hash equals hashing the whole
+    CHECK_EQ(fnv1a(nullptr, 0), 0x811C9DC5u);
+    CHECK_EQ(fnv1a((const uint8_t*)"a", 1), 0xE40C292Cu);
+    CHECK_EQ(fnv1a((const uint8_t*)"foobar", 6), 0xBF9CF968u);
+    CHECK_EQ(fnv1a((const uint8_t*)"bar", 3, fnv1a((const uint8_t*)"foo", 3)), 0xBF9CF968u);
+}
+
+int main() {
+    test_random();
+    test_hashes();
+    printf("fixed_table_test: ok\n");
+    return 0;
+}
@@ -0,0 +1,172 @@
+// FrameDedup (components/network_sniffer) on hand-built frames: retries,
+// fragments, sequence wraparound, the per-stream window, eviction at
+// FRAME_DEDUP_CAPACITY streams, and the counters.
+
+#include <stdio.h>
+#include "frame_dedup.h"
+#include "test_check.h"
+
+// Expected counter values, kept beside the filter's own
+struct Tally {
+    uint32_t checked;
+    uint32_t duplicates;
+    uint32_t retries;
+};
+
+static uint8_t g_macs[FRAME_DEDUP_CAPACITY + 2][6];
+
+static const uint8_t* station(uint32_t n) {
+    uint8_t* mac = g_macs[n];
+    mac[0] = 0x02;
+    mac[1] = 0x00;
+    mac[2] = (uint8_t)(n >> 24);
+    mac[3] = (uint8_t)(n >> 16);
+    mac[4] = (uint8_t)(n >> 8);
+    mac[5] = (uint8_t)n;
+    return mac;
+}
+
+// A QoS data frame of `tid`, or a non-QoS one with tid 0xFF
+static ParsedFrame data_frame(const uint8_t* transmitter, uint16_t sequence, uint8_t fragment, bool retry,
+                              uint8_t tid = 0xFF) {
+    ParsedFrame frame = {};
+    frame.type = IEEE80211_TYPE_DATA;
+    frame.flags = retry ? IEEE80211_FC_RETRY : 0;
+    frame.transmitter = transmitter;
+    frame.has_sequence = true;
+    frame.sequence_number = sequence;
+    frame.fragment_number = fragment;
+    frame.has_qos = tid != 0xFF;
+    frame.tid = frame.has_qos ? tid : 0;
+    return frame;
+}
+
+static DedupVerdict check(FrameDedup* dedup, Tally* tally, const ParsedFrame& frame) {
+    DedupVerdict verdict = dedup->check(frame);
+    if (frame.transmitter && frame.has_sequence) {
+        tally->checked++;
+        tally->retries += (frame.flags & IEEE80211_FC_RETRY) != 0;
+        tally->duplicates += verdict == DEDUP_DUPLICATE;
+    }
+    return verdict;
+}
+
+static void check_stats(const FrameDedup& dedup, const Tally& tally, uint32_t evictions, uint32_t streams) {
+    FrameDedupStats stats = dedup.get_stats();
+    CHECK_EQ(stats.checked, tally.checked);
+    CHECK_EQ(stats.duplicates, tally.duplicates);
+    CHECK_EQ(stats.retries, tally.retries);
+    CHECK_EQ(stats.evictions, evictions);
+    CHECK_EQ(stats.streams, streams);
+}
+
+static void test_sequences() {
+    FrameDedup* dedup = new FrameDedup();
+    Tally tally = {};
+    const uint8_t* a = station(1);
+
+    // A retry with the same sequence and fragment number is a duplicate;
+    // without the Retry bit it is taken for a new frame
+    CHECK_EQ(check(dedup, &tally, data_frame(a, 100, 0, false)), DEDUP_NEW);
+    CHECK_EQ(check(dedup, &tally, data_frame(a, 100, 0, true)), DEDUP_DUPLICATE);
+    CHECK_EQ(check(dedup, &tally, data_frame(a, 100, 0, true)), DEDUP_DUPLICATE);
+    CHECK_EQ(check(dedup, &tally, data_frame(a, 100, 0, false)), DEDUP_NEW);
+
+    // Later fragments of the same frame are new, retries of any of them are not
+    CHECK_EQ(check(dedup, &tally, data_frame(a, 100, 1, true)), DEDUP_NEW);
+    CHECK_EQ(check(dedup, &tally, data_frame(a, 100, 2, false)), DEDUP_NEW);
+    CHECK_EQ(check(dedup, &tally, data_frame(a, 100, 1, true)), DEDUP_DUPLICATE);
+    CHECK_EQ(check(dedup, &tally, data_frame(a, 100, 2, true)), DEDUP_DUPLICATE);
+
+    // A first copy with the Retry bit (the original was missed) is new, then
+    // remembered within the window behind the newest frame
+    CHECK_EQ(check(dedup, &tally, data_frame(a, 101, 0, false)), DEDUP_NEW);
+    CHECK_EQ(check(dedup, &tally, data_frame(a, 105, 0, true)), DEDUP_NEW);
+    CHECK_EQ(check(dedup, &tally, data_frame(a, 103, 0, true)), DEDUP_NEW);
+    CHECK_EQ(check(dedup, &tally, data_frame(a, 103, 0, true)), DEDUP_DUPLICATE);
+    CHECK_EQ(check(dedup, &tally, data_frame(a, 101, 0, true)), DEDUP_DUPLICATE);
+    CHECK_EQ(check(dedup, &tally, data_frame(a, 105, 0, true)), DEDUP_DUPLICATE);
+
+    // Sequence numbers wrap from 4095 to 0
+    CHECK_EQ(check(dedup, &tally, data_frame(a, 4094, 0, false)), DEDUP_NEW);
+    CHECK_EQ(check(dedup, &tally, data_frame(a, 4095, 0, false)), DEDUP_NEW);
+    CHECK_EQ(check(dedup, &tally, data_frame(a, 0, 0, true)), DEDUP_NEW);
+    CHECK_EQ(check(dedup, &tally, data_frame(a, 1, 0, false)), DEDUP_NEW);
+    CHECK_EQ(check(dedup, &tally, data_frame(a, 4095, 0, true)), DEDUP_DUPLICATE);
+    CHECK_EQ(check(dedup, &tally, data_frame(a, 0, 0, true)), DEDUP_DUPLICATE);
+    CHECK_EQ(check(dedup, &tally, data_frame(a, 1, 0, true)), DEDUP_DUPLICATE);
+
+    // A retry from before the window is taken for a new frame
+    CHECK_EQ(check(dedup, &tally, data_frame(a, 1 + FRAME_DEDUP_WINDOW, 0, false)), DEDUP_NEW);
+    CHECK_EQ(check(dedup, &tally, data_frame(a, 0, 0, true)), DEDUP_NEW);
+
+    // Each TID, non-QoS data and management are separate streams
+    const uint8_t* b = station(2);
+    CHECK_EQ(check(dedup, &tally, data_frame(b, 7, 0, false, 0)), DEDUP_NEW);
+    CHECK_EQ(check(dedup, &tally, data_frame(b, 7, 0, true, 5)), DEDUP_NEW);
+    CHECK_EQ(check(dedup, &tally, data_frame(b, 7, 0, true)), DEDUP_NEW);
+    ParsedFrame mgmt = data_frame(b, 7, 0, true);
+    mgmt.type = IEEE80211_TYPE_MGMT;
+    CHECK_EQ(check(dedup, &tally, mgmt), DEDUP_NEW);
+    CHECK_EQ(check(dedup, &tally, mgmt), DEDUP_DUPLICATE);
+    CHECK_EQ(check(dedup, &tally, data_frame(b, 7, 0, true, 0)), DEDUP_DUPLICATE);
+    CHECK_EQ(check(dedup, &tally, data_frame(b, 7, 0, true, 5)), DEDUP_DUPLICATE);
+
+    // Frames without a transmitter or sequence number are not tracked or counted
+    ParsedFrame ack = data_frame(nullptr, 0, 0, true);
+    ack.type = IEEE80211_TYPE_CTRL;
+    CHECK_EQ(check(dedup, &tally, ack), DEDUP_UNTRACKED);
+    ParsedFrame unsequenced = data_frame(b, 0, 0, true);
+    unsequenced.has_sequence = false;
+    CHECK_EQ(check(dedup, &tally, unsequenced), DEDUP_UNTRACKED);
+
+    // Streams: a, and b's TID 0, TID 5, non-QoS data and management
+    check_stats(*dedup, tally, 0, 5);
+
+    // Clearing forgets the streams but keeps the counters
+    dedup->clear();
+    check_stats(*dedup, tally, 0, 0);
+    CHECK_EQ(check(dedup, &tally, mgmt), DEDUP_NEW);
+    check_stats(*dedup, tally, 0, 1);
+    delete dedup;
+}
+
+static void test_eviction() {
+    FrameDedup* dedup = new FrameDedup();
+    Tally tally = {};
+
+    for (uint32_t n = 0; n < FRAME_DEDUP_CAPACITY; n++) {
+        CHECK_EQ(check(dedup, &tally, data_frame(station(n), 10, 0, false)), DEDUP_NEW);
+    }
+    check_stats(*dedup, tally, 0, FRAME_DEDUP_CAPACITY);
+    for (uint32_t n = 0; n < FRAME_DEDUP_CAPACITY; n++) {
+        CHECK_EQ(check(dedup, &tally, data_frame(station(n), 10, 0, true)), DEDUP_DUPLICATE);
+    }
+
+    // One more stream: every stream was seen since the clock hand started,
+    // so it sweeps all of them once and evicts the first
+    const uint8_t* extra = station(FRAME_DEDUP_CAPACITY);
+    CHECK_EQ(check(dedup, &tally, data_frame(extra, 10, 0, false)), DEDUP_NEW);
+    check_stats(*dedup, tally, 1, FRAME_DEDUP_CAPACITY);
+    CHECK_EQ(check(dedup, &tally, data_frame(extra, 10, 0, true)), DEDUP_DUPLICATE);
+
+    // Station 1, seen again, gets a second chance; station 2 is evicted next
+    CHECK_EQ(check(dedup, &tally, data_frame(station(1), 10, 0, true)), DEDUP_DUPLICATE);
+    CHECK_EQ(check(dedup, &tally, data_frame(station(FRAME_DEDUP_CAPACITY + 1), 10, 0, false)), DEDUP_NEW);
+    check_stats(*dedup, tally, 2, FRAME_DEDUP_CAPACITY);
+    CHECK_EQ(check(dedup, &tally, data_frame(station(1), 10, 0, true)), DEDUP_DUPLICATE);
+    CHECK_EQ(check(dedup, &tally, data_frame(station(3), 10, 0, true)), DEDUP_DUPLICATE);
+
+    // An evicted stream starts over: its retry is taken for a first copy
+    CHECK_EQ(check(dedup, &tally, data_frame(station(2), 10, 0, true)), DEDUP_NEW);
+    check_stats(*dedup, tally, 3, FRAME_DEDUP_CAPACITY);
+    CHECK_EQ(check(dedup, &tally, data_frame(station(2), 10, 0, true)), DEDUP_DUPLICATE);
+    delete dedup;
+}
+
+int main() {
+    test_sequences();
+    test_eviction();
+    printf("frame_dedup_test: ok\n");
+    return 0;
+}
@@ -0,0 +1,293 @@
+// FramePool (components/frame_pool): the order requests spill through tiers
+// and classes, and a multi-thread stress test of the lock-free free lists
+// and shared FrameHandles.
+//
+// Producer threads allocate or copy frames of random sizes, fill them with
+// a pattern and share each one with two consumer threads while keeping a
+// reference themselves. Every holder checks the pattern before dropping its
+// reference. A block handed out again while any reference is alive shows
+// up in the set of live blocks, or as a corrupted pattern.
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <set>
+#include <stdint.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+#include "frame_pool.h"
+#include "test_check.h"
+
+#define PRODUCERS           4
+#define FRAMES_PER_PRODUCER 50000
+#define HELD_FRAMES         4       // References each thread keeps before dropping the oldest
+
+static FramePoolConfig make_config(uint16_t small, uint16_t medium, uint16_t large,
+                                   uint16_t psram_small, uint16_t psram_medium, uint16_t psram_large) {
+    FramePoolConfig config = {};
+    config.blocks[FRAME_POOL_TIER_INTERNAL][0] = small;
+    config.blocks[FRAME_POOL_TIER_INTERNAL][1] = medium;
+    config.blocks[FRAME_POOL_TIER_INTERNAL][2] = large;
+    config.blocks[FRAME_POOL_TIER_PSRAM][0] = psram_small;
+    config.blocks[FRAME_POOL_TIER_PSRAM][1] = psram_medium;
+    config.blocks[FRAME_POOL_TIER_PSRAM][2] = psram_large;
+    return config;
+}
+
+static void check_idle(const FramePool& pool) {
+    FramePoolStats stats = pool.get_stats();
+    for (size_t cls = 0; cls < FRAME_POOL_CLASS_COUNT; cls++) {
+        for (size_t tier = 0; tier < FRAME_POOL_TIER_COUNT; tier++) {
+            CHECK_EQ(stats.classes[cls].in_use[tier], 0);
+        }
+    }
+}
+
+// Small requests go to internal small blocks, then PSRAM small blocks, then
+// internal medium, PSRAM medium, internal large and PSRAM large
+static void test_spill_order() {
+    FramePool pool;
+    CHECK_EQ(pool.init(make_config(2, 1, 1, 1, 1, 1)), ESP_OK);
+
+    struct Step {
+        uint8_t tier;
+        uint8_t cls;
+    };
+    const Step order[] = {
+        { FRAME_POOL_TIER_INTERNAL, 0 }, { FRAME_POOL_TIER_INTERNAL, 0 }, { FRAME_POOL_TIER_PSRAM, 0 },
+        { FRAME_POOL_TIER_INTERNAL, 1 }, { FRAME_POOL_TIER_PSRAM, 1 },
+        { FRAME_POOL_TIER_INTERNAL, 2 }, { FRAME_POOL_TIER_PSRAM, 2 },
+    };
+    std::vector<FrameHandle> handles;
+    for (size_t i = 0; i < sizeof(order) / sizeof(order[0]); i++) {
+        FramePoolStats before = pool.get_stats();
+        FrameHandle handle = pool.alloc(100);
+        CHECK(handle.valid());
+        CHECK_EQ(handle.size(), 100);
+        CHECK_EQ(handle.capacity(), before.classes[order[i].cls].block_size);
+        FramePoolStats after = pool.get_stats();
+        CHECK_EQ(after.classes[order[i].cls].in_use[order[i].tier],
+                 before.classes[order[i].cls].in_use[order[i].tier] + 1);
+        // Only the first two are the best fit
+        CHECK_EQ(after.spills, i < 2 ? 0 : i - 1);
+        handles.push_back(handle);
+    }
+
+    // Everything is taken
+    CHECK(!pool.alloc(1).valid());
+    CHECK(!pool.alloc(FRAME_POOL_LARGE + 1).valid());
+    FramePoolStats stats = pool.get_stats();
+    CHECK_EQ(stats.allocs, 7);
+    CHECK_EQ(stats.failures, 2);
+
+    // A freed internal block is preferred again, and a medium request never
+    // takes a small block
+    handles[1].reset();
+    CHECK(!pool.alloc(FRAME_POOL_SMALL + 1).valid());
+    FrameHandle again = pool.alloc(FRAME_POOL_SMALL);
+    CHECK_EQ(again.capacity(), FRAME_POOL_SMALL);
+    stats = pool.get_stats();
+    CHECK_EQ(stats.classes[0].in_use[FRAME_POOL_TIER_INTERNAL], 2);
+    CHECK_EQ(stats.classes[0].peak[FRAME_POOL_TIER_INTERNAL], 2);
+
+    again.reset();
+    handles.clear();
+    check_idle(pool);
+}
+
+// One frame and the count of threads still holding it
+struct Shared {
+    std::atomic<int> holders;
+    uint8_t* data;
+    uint32_t tag;
+};
+
+struct Item {
+    FrameHandle handle;
+    Shared* shared;
+};
+
+// A mutex-guarded queue of items for one consumer
+struct ItemQueue {
+    std::mutex lock;
+    std::deque<Item> items;
+
+    void push(Item item) {
+        std::lock_guard<std::mutex> guard(lock);
+        items.push_back(std::move(item));
+    }
+
+    bool pop(Item* item) {
+        std::lock_guard<std::mutex> guard(lock);
+        if (items.empty()) {
+            return false;
+        }
+        *item = std::move(items.front());
+        items.pop_front();
+        return true;
+    }
+
+    bool empty() {
+        std::lock_guard<std::mutex> guard(lock);
+        return items.empty();
+    }
+};
+
+static std::mutex g_live_lock;
+static std::set<const uint8_t*> g_live;
+
+static uint32_t xorshift(uint32_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+static void verify(const Item& item) {
+    const FrameHandle& handle = item.handle;
+    CHECK(handle.data() == item.shared->data);
+    CHECK_EQ(handle.size(), item.shared->tag % FRAME_POOL_LARGE + 1);
+    for (uint16_t i = 0; i < handle.size(); i++) {
+        CHECK_EQ(handle.data()[i], (uint8_t)(item.shared->tag + i));
+    }
+}
+
+// Drop one reference; the last holder takes the block off the live set
+// before its reference, the block's last, goes away
+static void drop(Item* item) {
+    verify(*item);
+    Shared* shared = item->shared;
+    if (shared->holders.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        {
+            std::lock_guard<std::mutex> guard(g_live_lock);
+            CHECK_EQ(g_live.erase(shared->data), 1);
+        }
+        delete shared;
+    }
+    item->handle.reset();
+}
+
+static void hold(std::deque<Item>* held, Item item) {
+    held->push_back(std::move(item));
+    if (held->size() > HELD_FRAMES) {
+        drop(&held->front());
+        held->pop_front();
+    }
+}
+
+static void test_threads() {
+    FramePool pool;
+    CHECK_EQ(pool.init(make_config(4, 4, 2, 8, 8, 2)), ESP_OK);
+
+    ItemQueue queues[2];
+    std::atomic<int> producing(PRODUCERS);
+    std::atomic<uint32_t> allocated(0);
+    std::atomic<uint32_t> consumed(0);
+
+    std::vector<std::thread> threads;
+    for (uint32_t p = 0; p < PRODUCERS; p++) {
+        threads.emplace_back([&, p] {
+            uint32_t state = p + 1;
+            uint8_t source[FRAME_POOL_LARGE];
+            std::deque<Item> held;
+            for (uint32_t n = 0; n < FRAMES_PER_PRODUCER;) {
+                uint32_t tag = xorshift(&state);
+                uint16_t size = tag % FRAME_POOL_LARGE + 1;
+                FrameHandle handle;
+                if (n & 1) {
+                    for (uint16_t i = 0; i < size; i++) {
+                        source[i] = (uint8_t)(tag + i);
+                    }
+                    handle = pool.copy(source, size);
+                } else {
+                    handle = pool.alloc(size);
+                    if (handle) {
+                        for (uint16_t i = 0; i < size; i++) {
+                            handle.data()[i] = (uint8_t)(tag + i);
+                        }
+                    }
+                }
+                if (!handle) {
+                    // Exhausted: let go of what this thread holds and retry
+                    while (!held.empty()) {
+                        drop(&held.front());
+                        held.pop_front();
+                    }
+                    std::this_thread::yield();
+                    continue;
+                }
+                CHECK(handle.capacity() >= size);
+                {
+                    std::lock_guard<std::mutex> guard(g_live_lock);
+                    CHECK(g_live.insert(handle.data()).second);
+                }
+
+                Shared* shared = new Shared();
+                shared->holders.store(3, std::memory_order_relaxed);
+                shared->data = handle.data();
+                shared->tag = tag;
+                Item a = { handle, shared };
+                Item b = { handle, shared };
+                CHECK_EQ(handle.use_count(), 3);
+                queues[0].push(std::move(a));
+                queues[1].push(std::move(b));
+                hold(&held, Item{ std::move(handle), shared });
+                allocated.fetch_add(1, std::memory_order_relaxed);
+                n++;
+            }
+            while (!held.empty()) {
+                drop(&held.front());
+                held.pop_front();
+            }
+            producing.fetch_sub(1, std::memory_order_release);
+        });
+    }
+    for (int c = 0; c < 2; c++) {
+        threads.emplace_back([&, c] {
+            std::deque<Item> held;
+            for (;;) {
+                Item item;
+                if (queues[c].pop(&item)) {
+                    CHECK(item.handle.use_count() >= 1);
+                    hold(&held, std::move(item));
+                    consumed.fetch_add(1, std::memory_order_relaxed);
+                } else if (producing.load(std::memory_order_acquire) == 0 && queues[c].empty()) {
+                    break;
+                } else {
+                    // Nothing queued: free what is held so producers are not starved
+                    while (!held.empty()) {
+                        drop(&held.front());
+                        held.pop_front();
+                    }
+                    std::this_thread::yield();
+                }
+            }
+            while (!held.empty()) {
+                drop(&held.front());
+                held.pop_front();
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    CHECK_EQ(allocated.load(), PRODUCERS * FRAMES_PER_PRODUCER);
+    CHECK_EQ(consumed.load(), 2 * PRODUCERS * FRAMES_PER_PRODUCER);
+    CHECK(g_live.empty());
+    check_idle(pool);
+
+    FramePoolStats stats = pool.get_stats();
+    CHECK_EQ(stats.allocs, PRODUCERS * FRAMES_PER_PRODUCER);
+    CHECK(stats.spills > 0 && stats.failures > 0);
+    printf("allocs=%u spills=%u failures=%u\n", (unsigned)stats.allocs, (unsigned)stats.spills,
+           (unsigned)stats.failures);
+}
+
+int main() {
+    test_spill_order();
+    test_threads();
+    printf("frame_pool_test: ok\n");
+    return 0;
+}
@@ -0,0 +1,213 @@
+// PacketFilter (components/network_sniffer): operator precedence, negation,
+// numeric comparisons and ranges, address primitives, compile errors and
+// the frame types pushed down to the driver.
+
+#include <stdio.h>
+#include <string.h>
+#include "ieee80211_parser.h"
+#include "packet_filter.h"
+#include "test_check.h"
+
+#define MGMT_BIT    (1u << IEEE80211_TYPE_MGMT)
+#define CTRL_BIT    (1u << IEEE80211_TYPE_CTRL)
+#define DATA_BIT    (1u << IEEE80211_TYPE_DATA)
+
+static const uint8_t MAC_1[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+static const uint8_t MAC_2[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x02 };
+static const uint8_t MAC_3[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x03 };
+
+// A 24-byte header with addresses 1-3, and its filter summary
+struct TestFrame {
+    uint8_t header[24];
+    FilterInput input;
+};
+
+static TestFrame make_frame(uint8_t type, uint8_t subtype, uint8_t flags = 0, int8_t rssi = -60,
+                            uint16_t frame_len = 100, uint8_t channel = 6) {
+    TestFrame frame;
+    memset(frame.header, 0, sizeof(frame.header));
+    frame.header[0] = (uint8_t)(type << 2 | subtype << 4);
+    frame.header[1] = flags;
+    memcpy(frame.header + 4, MAC_1, 6);
+    memcpy(frame.header + 10, MAC_2, 6);
+    memcpy(frame.header + 16, MAC_3, 6);
+    frame.input.payload = frame.header;
+    frame.input.len = sizeof(frame.header);
+    frame.input.frame_len = frame_len;
+    frame.input.rssi = rssi;
+    frame.input.channel = channel;
+    return frame;
+}
+
+static bool matches(const char* expression, const TestFrame& frame) {
+    PacketFilter filter;
+    char error[64] = "";
+    if (!filter.compile(expression, error, sizeof(error))) {
+        fprintf(stderr, "'%s': %s\n", expression, error);
+        CHECK(false);
+    }
+    return filter.matches(frame.input);
+}
+
+static void test_logic() {
+    TestFrame beacon = make_frame(IEEE80211_TYPE_MGMT, 8, 0, -80);
+    TestFrame weak_data = make_frame(IEEE80211_TYPE_DATA, 0, 0, -80);
+    TestFrame strong_data = make_frame(IEEE80211_TYPE_DATA, 0, 0, -40);
+    TestFrame rts = make_frame(IEEE80211_TYPE_CTRL, 11);
+
+    // "and" binds tighter than "or": mgmt or (data and rssi > -50)
+    const char* precedence = "type mgmt or type data and rssi > -50";
+    CHECK(matches(precedence, beacon));
+    CHECK(!matches(precedence, weak_data));
+    CHECK(matches(precedence, strong_data));
+    CHECK(matches("rssi > -50 and type data or type mgmt", beacon));
+
+    // "not" applies to the next primitive only, and twice cancels out
+    CHECK(!matches("not type mgmt", beacon));
+    CHECK(matches("not type mgmt", weak_data));
+    CHECK(matches("not type mgmt", rts));
+    CHECK(matches("not type mgmt and rssi < -50", weak_data));
+    CHECK(!matches("not type mgmt and rssi < -50", strong_data));
+    CHECK(matches("not not type mgmt", beacon));
+    CHECK(matches("type data and not subtype qos-data", weak_data));
+
+    // Subtypes, upper case accepted
+    CHECK(matches("subtype BEACON", beacon));
+    CHECK(!matches("subtype probe-req", beacon));
+    CHECK(matches("type ctrl and subtype rts", rts));
+
+    // An empty expression passes management and data frames
+    CHECK(matches("", beacon) && matches("", weak_data) && !matches("", rts));
+}
+
+static void test_numbers() {
+    TestFrame frame = make_frame(IEEE80211_TYPE_DATA, 0, 0, -70, 150, 6);
+
+    // Inclusive length ranges
+    CHECK(matches("len 100-200", frame));
+    CHECK(matches("len 150-150", frame));
+    CHECK(!matches("len 151-200", frame));
+    CHECK(!matches("len 100-149", frame));
+
+    // Operators as their own token, glued to the number or to the keyword
+    CHECK(matches("len 150", frame));
+    CHECK(matches("len == 150", frame));
+    CHECK(!matches("len != 150", frame));
+    CHECK(matches("len >= 150", frame) && !matches("len > 150", frame));
+    CHECK(matches("len <= 150", frame) && !matches("len < 150", frame));
+    CHECK(matches("rssi >=-70", frame) && !matches("rssi >-70", frame));
+    CHECK(matches("rssi<=-70", frame) && matches("rssi<-60", frame));
+    CHECK(matches("channel=6", frame) && matches("channel != 1", frame));
+    CHECK(!matches("channel 1", frame));
+}
+
+static void test_addresses() {
+    TestFrame beacon = make_frame(IEEE80211_TYPE_MGMT, 8);
+    TestFrame to_ds = make_frame(IEEE80211_TYPE_DATA, 0, IEEE80211_FC_TO_DS);
+    TestFrame from_ds = make_frame(IEEE80211_TYPE_DATA, 0, IEEE80211_FC_FROM_DS);
+    TestFrame wds = make_frame(IEEE80211_TYPE_DATA, 0, IEEE80211_FC_TO_DS | IEEE80211_FC_FROM_DS);
+    TestFrame rts = make_frame(IEEE80211_TYPE_CTRL, 11);
+
+    // The BSSID's position follows the type and the To/From DS bits
+    CHECK(matches("bssid 02:00:00:00:00:03", beacon));
+    CHECK(matches("bssid 02:00:00:00:00:01", to_ds));
+    CHECK(matches("bssid 02:00:00:00:00:02", from_ds));
+    CHECK(!matches("bssid 02:00:00:00:00:01", wds) && !matches("bssid 02:00:00:00:00:03", wds));
+
+    // src is address 2, dst address 1, addr any of 1-3 (1-2 for control frames)
+    CHECK(matches("src 02:00:00:00:00:02", beacon) && !matches("src 02:00:00:00:00:01", beacon));
+    CHECK(matches("dst 02:00:00:00:00:01", beacon) && !matches("dst 02:00:00:00:00:02", beacon));
+    CHECK(matches("addr 02:00:00:00:00:01", beacon));
+    CHECK(matches("addr 02:00:00:00:00:02", beacon));
+    CHECK(matches("addr 02:00:00:00:00:03", beacon));
+    CHECK(!matches("addr 02:00:00:00:00:04", beacon));
+    CHECK(matches("type ctrl and addr 02:00:00:00:00:02", rts));
+    CHECK(!matches("type ctrl and addr 02:00:00:00:00:03", rts));
+    CHECK(matches("not src 02:00:00:00:00:01", beacon));
+
+    // Upper case hex, and frames too short to hold the address
+    CHECK(matches("src 02:00:00:00:00:02", beacon) == matches("SRC 02:00:00:00:00:02", beacon));
+    beacon.input.len = 12;
+    CHECK(!matches("src 02:00:00:00:00:02", beacon));
+    CHECK(matches("dst 02:00:00:00:00:01", beacon));
+    beacon.input.len = 1;
+    CHECK(!matches("", beacon));
+}
+
+static void check_error(const char* expression, const char* message) {
+    PacketFilter filter;
+    CHECK(filter.compile("type ctrl"));
+    char error[64] = "";
+    CHECK(!filter.compile(expression, error, sizeof(error)));
+    if (strcmp(error, message) != 0) {
+        fprintf(stderr, "'%s': got \"%s\", expected \"%s\"\n", expression, error, message);
+        CHECK(false);
+    }
+    // A failed compile leaves the match-everything filter
+    CHECK_EQ(filter.term_count(), 0);
+    CHECK_EQ(filter.type_mask(), MGMT_BIT | DATA_BIT);
+}
+
+static void test_errors() {
+    check_error("type foo", "unknown frame type 'foo'");
+    check_error("subtype nope", "unknown subtype 'nope'");
+    check_error("bssid 02:00:00", "bad MAC address '02:00:00'");
+    check_error("src 02:00:00:00:00:zz", "bad MAC address '02:00:00:00:00:zz'");
+    check_error("rssi", "missing value after 'rssi'");
+    check_error("rssi >=", "missing number after 'rssi'");
+    check_error("rssi strong", "bad number 'strong'");
+    check_error("len 200-100", "bad range '200-100'");
+    check_error("speed 10", "unknown keyword 'speed'");
+    check_error("type mgmt type data", "expected 'and' or 'or' before 'type'");
+    check_error("type mgmt and", "expression ends with an operator");
+    check_error("type mgmt or not", "expression ends with an operator");
+    check_error("not", "expression ends with an operator");
+
+    char too_many[256] = "channel 1";
+    for (int i = 1; i < PACKET_FILTER_MAX_TERMS; i++) {
+        strcat(too_many, " or channel 1");
+    }
+    PacketFilter filter;
+    CHECK(filter.compile(too_many));
+    CHECK_EQ(filter.term_count(), PACKET_FILTER_MAX_TERMS);
+    strcat(too_many, " or channel 1");
+    check_error(too_many, "too many terms (max 16)");
+}
+
+static void check_masks(const char* expression, uint32_t types, uint16_t ctrl_subtypes) {
+    PacketFilter filter;
+    CHECK(filter.compile(expression));
+    if (filter.type_mask() != types || filter.ctrl_subtype_mask() != ctrl_subtypes) {
+        fprintf(stderr, "'%s': types 0x%x ctrl 0x%04x, expected 0x%x 0x%04x\n", expression,
+                (unsigned)filter.type_mask(), filter.ctrl_subtype_mask(), (unsigned)types, ctrl_subtypes);
+        CHECK(false);
+    }
+}
+
+static void test_pushdown() {
+    // Control frames only when a clause asks for them by type or subtype
+    check_masks("", MGMT_BIT | DATA_BIT, 0);
+    check_masks("rssi > -70", MGMT_BIT | DATA_BIT, 0);
+    check_masks("type mgmt", MGMT_BIT, 0);
+    check_masks("subtype beacon or subtype qos-data", MGMT_BIT | DATA_BIT, 0);
+    check_masks("type ctrl", CTRL_BIT, 0xFFFF);
+    check_masks("type ctrl and subtype rts", CTRL_BIT, 1u << 11);
+    check_masks("subtype rts or subtype cts or type mgmt", MGMT_BIT | CTRL_BIT, 1u << 11 | 1u << 12);
+    check_masks("type mgmt and type data", 0, 0);
+
+    // Excluding a type keeps every other one
+    check_masks("not type mgmt", CTRL_BIT | DATA_BIT, 0xFFFF);
+    check_masks("not type ctrl", MGMT_BIT | DATA_BIT, 0);
+    check_masks("not type data and rssi > -70", MGMT_BIT | CTRL_BIT, 0xFFFF);
+    check_masks("not subtype beacon", MGMT_BIT | DATA_BIT, 0);
+}
+
+int main() {
+    test_logic();
+    test_numbers();
+    test_addresses();
+    test_errors();
+    test_pushdown();
+    printf("packet_filter_test: ok\n");
+    return 0;
+}
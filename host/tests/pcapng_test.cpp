@@ -0,0 +1,289 @@
+// PCAPNG output of components/pcap_writer.
+//
+// The block builder: every block and radiotap field of legacy, HT and
+// truncated frames is checked byte by byte, and the collector's
+// PcapngStreamReader must read the same frames back. PcapWriter: two
+// threads write frames at once into a stream with small buffers, so that
+// buffers change hands while blocks are still being built; every frame
+// must come out whole, once and in each thread's order.
+
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "pcap_writer.h"
+#include "pcapng.h"
+#include "pcapng_stream.h"
+#include "test_check.h"
+
+#define WRITER_THREADS      2
+#define WRITER_FRAMES       20000
+
+static uint16_t get16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get32(const uint8_t* p) {
+    return (uint32_t)get16(p) | ((uint32_t)get16(p + 2) << 16);
+}
+
+static uint64_t get64(const uint8_t* p) {
+    return (uint64_t)get32(p) | ((uint64_t)get32(p + 4) << 32);
+}
+
+// Walk one Enhanced Packet Block at `p` and check it against `frame`;
+// returns the block length
+static size_t check_epb(const uint8_t* p, const PcapngFrame& frame) {
+    uint32_t total = get32(p + 4);
+    CHECK_EQ(get32(p), 6);
+    CHECK_EQ(total % 4, 0);
+    CHECK_EQ(total, pcapng_frame_size(frame));
+    CHECK_EQ(get32(p + total - 4), total);
+    CHECK_EQ(get32(p + 8), 0);
+    CHECK_EQ(((uint64_t)get32(p + 12) << 32) | get32(p + 16), frame.timestamp_us);
+    uint32_t captured = get32(p + 20);
+    CHECK_EQ(captured, PCAPNG_RADIOTAP_SIZE + frame.len);
+    uint32_t on_air = frame.orig_len > frame.len ? frame.orig_len : frame.len;
+    CHECK_EQ(get32(p + 24), PCAPNG_RADIOTAP_SIZE + on_air);
+
+    // Radiotap: version 0, fixed length, TSFT, flags, rate, channel, signal, noise, MCS
+    const uint8_t* rt = p + 28;
+    CHECK_EQ(rt[0], 0);
+    CHECK_EQ(get16(rt + 2), PCAPNG_RADIOTAP_SIZE);
+    CHECK_EQ(get32(rt + 4), 0x0008006F);
+    CHECK_EQ(get64(rt + 8), frame.timestamp_us);
+    CHECK_EQ(rt[16], frame.has_fcs ? 0x10 : 0);
+    CHECK_EQ(rt[17], frame.is_ht ? 0 : frame.rate_500kbps);
+    CHECK_EQ(get16(rt + 18), pcapng_channel_frequency(frame.channel));
+    bool cck = !frame.is_ht && (frame.rate_500kbps == 2 || frame.rate_500kbps == 4 ||
+                                frame.rate_500kbps == 11 || frame.rate_500kbps == 22);
+    CHECK_EQ(get16(rt + 20), 0x0080 | (cck ? 0x0020 : 0x0040));
+    CHECK_EQ((int8_t)rt[22], frame.rssi);
+    CHECK_EQ((int8_t)rt[23], frame.noise);
+    if (frame.is_ht) {
+        CHECK_EQ(rt[24], 0x07);
+        CHECK_EQ(rt[25], (frame.ht40 ? 0x01 : 0) | (frame.short_gi ? 0x04 : 0));
+        CHECK_EQ(rt[26], frame.mcs);
+    } else {
+        CHECK(rt[24] == 0 && rt[25] == 0 && rt[26] == 0);
+    }
+
+    // Frame bytes, then zero padding to 32 bits
+    CHECK(memcmp(rt + PCAPNG_RADIOTAP_SIZE, frame.data, frame.len) == 0);
+    for (size_t i = 28 + captured; i < total - 4; i++) {
+        CHECK_EQ(p[i], 0);
+    }
+    return total;
+}
+
+static void test_builder() {
+    uint8_t payload[600];
+    for (size_t i = 0; i < sizeof(payload); i++) {
+        payload[i] = (uint8_t)(i * 7 + 1);
+    }
+
+    std::vector<PcapngFrame> frames;
+    PcapngFrame frame = {};
+    frame.data = payload;
+
+    // CCK beacon with its FCS, channel 1
+    frame.timestamp_us = 1700000000123456ull;
+    frame.len = 101;
+    frame.orig_len = 101;
+    frame.channel = 1;
+    frame.rssi = -40;
+    frame.noise = -95;
+    frame.has_fcs = true;
+    frame.rate_500kbps = 2;
+    frames.push_back(frame);
+
+    // OFDM frame without FCS, channel 14, length already aligned
+    frame.timestamp_us += 1000;
+    frame.len = 64;
+    frame.orig_len = 64;
+    frame.channel = 14;
+    frame.has_fcs = false;
+    frame.rate_500kbps = 108;
+    frames.push_back(frame);
+
+    // HT40 MCS 7 short GI, truncated to the snap length
+    frame.timestamp_us += 1;
+    frame.len = SNIFFER_SNAPLEN;
+    frame.orig_len = 1500;
+    frame.channel = 6;
+    frame.rssi = -88;
+    frame.has_fcs = true;
+    frame.is_ht = true;
+    frame.mcs = 7;
+    frame.ht40 = true;
+    frame.short_gi = true;
+    frames.push_back(frame);
+
+    // HT20 with every padding length
+    for (uint32_t len = 10; len < 14; len++) {
+        frame.timestamp_us += 1;
+        frame.len = len;
+        frame.orig_len = len;
+        frame.ht40 = false;
+        frame.short_gi = false;
+        frame.mcs = (uint8_t)len;
+        frames.push_back(frame);
+    }
+
+    std::vector<uint8_t> file(PCAPNG_HEADER_SIZE);
+    CHECK_EQ(pcapng_header_size(), PCAPNG_HEADER_SIZE);
+    CHECK_EQ(pcapng_write_header(file.data(), file.size() - 1, SNIFFER_SNAPLEN), 0);
+    CHECK_EQ(pcapng_write_header(file.data(), file.size(), SNIFFER_SNAPLEN), PCAPNG_HEADER_SIZE);
+    for (const PcapngFrame& f : frames) {
+        size_t offset = file.size();
+        size_t need = pcapng_frame_size(f);
+        file.resize(offset + need);
+        CHECK_EQ(pcapng_write_frame(file.data() + offset, need - 1, f), 0);
+        CHECK_EQ(pcapng_write_frame(file.data() + offset, need, f), need);
+    }
+
+    // Section header: byte-order magic, version 1.0, unknown length
+    const uint8_t* p = file.data();
+    CHECK_EQ(get32(p), 0x0A0D0D0A);
+    CHECK_EQ(get32(p + 4), 28);
+    CHECK_EQ(get32(p + 8), 0x1A2B3C4D);
+    CHECK_EQ(get16(p + 12), 1);
+    CHECK_EQ(get16(p + 14), 0);
+    CHECK_EQ(get64(p + 16), UINT64_MAX);
+    CHECK_EQ(get32(p + 24), 28);
+
+    // Interface: radiotap link type, snaplen covering the radiotap header
+    p += 28;
+    CHECK_EQ(get32(p), 1);
+    CHECK_EQ(get32(p + 4), 20);
+    CHECK_EQ(get16(p + 8), PCAPNG_LINKTYPE_IEEE802_11_RADIOTAP);
+    CHECK_EQ(get32(p + 12), SNIFFER_SNAPLEN + PCAPNG_RADIOTAP_SIZE);
+    CHECK_EQ(get32(p + 16), 20);
+
+    size_t offset = PCAPNG_HEADER_SIZE;
+    for (const PcapngFrame& f : frames) {
+        offset += check_epb(file.data() + offset, f);
+    }
+    CHECK_EQ(offset, file.size());
+
+    // The collector reads the same frames back
+    PcapngStreamReader reader;
+    reader.feed(file.data(), file.size());
+    StreamPacket packet;
+    for (const PcapngFrame& f : frames) {
+        CHECK(reader.next(&packet));
+        CHECK_EQ(packet.linktype, PCAPNG_LINKTYPE_IEEE802_11_RADIOTAP);
+        CHECK_EQ(packet.timestamp_us, f.timestamp_us);
+        CHECK_EQ(packet.captured, PCAPNG_RADIOTAP_SIZE + f.len);
+        CHECK(memcmp(packet.data + PCAPNG_RADIOTAP_SIZE, f.data, f.len) == 0);
+    }
+    CHECK(!reader.next(&packet));
+    CHECK_EQ(reader.get_stats().skipped_bytes, 0);
+
+    CHECK_EQ(pcapng_channel_frequency(0), 0);
+    CHECK_EQ(pcapng_channel_frequency(6), 2437);
+    CHECK_EQ(pcapng_channel_frequency(15), 0);
+}
+
+// Frame payload: writer thread, sequence number, then bytes derived from both
+static size_t make_payload(uint8_t* out, uint32_t thread, uint32_t seq) {
+    size_t len = 24 + (seq * 37 + thread * 101) % (SNIFFER_SNAPLEN - 24);
+    out[0] = (uint8_t)thread;
+    memcpy(out + 1, &seq, 4);
+    for (size_t i = 5; i < len; i++) {
+        out[i] = (uint8_t)(seq * 31 + thread * 7 + i);
+    }
+    return len;
+}
+
+static void writer_thread(PcapWriter* writer, uint32_t thread) {
+    uint8_t payload[SNIFFER_SNAPLEN];
+    wifi_pkt_rx_ctrl_t rx_ctrl = {};
+    rx_ctrl.channel = 6;
+    rx_ctrl.rssi = -50;
+    for (uint32_t seq = 0; seq < WRITER_FRAMES; seq++) {
+        FrameView view = {};
+        view.payload = payload;
+        view.len = (uint16_t)make_payload(payload, thread, seq);
+        view.orig_len = view.len;
+        view.rx_ctrl = &rx_ctrl;
+        view.reference_us = seq;
+        // Retry while both buffers are full, as a FlightRecorder exporter does
+        while (!writer->write_frame(view)) {
+            usleep(100);
+        }
+    }
+}
+
+static void test_writer() {
+    char path[] = "/tmp/pcapng_test_XXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0);
+    close(fd);
+
+    PcapWriterConfig config = pcap_writer_default_config();
+    config.path_prefix = path;
+    config.extension = nullptr;
+    config.buffer_size = 4096;
+    config.max_file_bytes = 0;
+    config.flush_ms = 5;
+
+    PcapWriter writer;
+    CHECK_EQ(writer.start(config), ESP_OK);
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < WRITER_THREADS; t++) {
+        threads.emplace_back(writer_thread, &writer, t);
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    CHECK_EQ(writer.stop(), ESP_OK);
+    PcapWriterStats stats = writer.get_stats();
+    CHECK_EQ(stats.frames, WRITER_THREADS * WRITER_FRAMES);
+    CHECK_EQ(stats.dropped, 0);
+    CHECK_EQ(stats.write_errors, 0);
+    printf("writer: %lu frames in %lu buffer writes, %llu bytes\n", (unsigned long)stats.frames,
+           (unsigned long)stats.writes, (unsigned long long)stats.bytes);
+
+    FILE* file = fopen(path, "rb");
+    CHECK(file != nullptr);
+    PcapngStreamReader reader;
+    uint8_t chunk[8192];
+    size_t got;
+    uint32_t next_seq[WRITER_THREADS] = {};
+    uint8_t expected[SNIFFER_SNAPLEN];
+    StreamPacket packet;
+    while ((got = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        reader.feed(chunk, got);
+        while (reader.next(&packet)) {
+            const uint8_t* data = packet.data + PCAPNG_RADIOTAP_SIZE;
+            uint32_t thread = data[0];
+            uint32_t seq;
+            memcpy(&seq, data + 1, 4);
+            CHECK(thread < WRITER_THREADS);
+            CHECK_EQ(seq, next_seq[thread]);
+            size_t len = make_payload(expected, thread, seq);
+            CHECK_EQ(packet.captured, PCAPNG_RADIOTAP_SIZE + len);
+            CHECK(memcmp(data, expected, len) == 0);
+            CHECK_EQ(packet.timestamp_us, seq);
+            next_seq[thread]++;
+        }
+    }
+    fclose(file);
+    unlink(path);
+
+    for (uint32_t t = 0; t < WRITER_THREADS; t++) {
+        CHECK_EQ(next_seq[t], WRITER_FRAMES);
+    }
+    CHECK_EQ(reader.get_stats().resyncs, 0);
+    CHECK_EQ(reader.get_stats().skipped_bytes, 0);
+    CHECK_EQ(stats.bytes, reader.get_stats().bytes);
+}
+
+int main() {
+    test_builder();
+    test_writer();
+    printf("pcapng_test: ok\n");
+    return 0;
+}
@@ -0,0 +1,142 @@
+// Two-thread stress test of SpscRing (components/network_sniffer).
+//
+// A producer thread pushes numbered items through a small ring while the
+// consumer thread checks that they arrive complete, in order and without
+// gaps, over tens of thousands of laps of the ring. A second pass lets
+// the producer drop on a full ring and checks that every item is either
+// received or counted as dropped.
+
+#include <atomic>
+#include <stdint.h>
+#include <string.h>
+#include <thread>
+#include "spsc_ring.h"
+#include "test_check.h"
+
+#define RING_SLOTS          64
+#define LOSSLESS_ITEMS      (1u << 20)
+#define LOSSY_ITEMS         (1u << 20)
+
+// A slot larger than a cache line, so that a torn read shows up as a bad check word
+struct Item {
+    uint64_t sequence;
+    uint8_t payload[48];
+    uint64_t check;
+};
+
+static uint64_t item_check(uint64_t sequence) {
+    return sequence * 0x9E3779B97F4A7C15ull ^ 0xA5A5A5A5A5A5A5A5ull;
+}
+
+static void fill(Item* item, uint64_t sequence) {
+    item->sequence = sequence;
+    memset(item->payload, (uint8_t)sequence, sizeof(item->payload));
+    item->check = item_check(sequence);
+}
+
+static void verify(const Item& item) {
+    CHECK(item.check == item_check(item.sequence));
+    for (size_t i = 0; i < sizeof(item.payload); i++) {
+        CHECK_EQ(item.payload[i], (uint8_t)item.sequence);
+    }
+}
+
+// Producer retries on a full ring: every item must arrive, in order
+static void lossless() {
+    static SpscRing<Item, RING_SLOTS> ring;
+
+    std::thread producer([] {
+        for (uint64_t sequence = 0; sequence < LOSSLESS_ITEMS; sequence++) {
+            // Alternate between the two producer APIs
+            if (sequence & 1) {
+                Item* slot;
+                while ((slot = ring.claim()) == nullptr) {
+                    std::this_thread::yield();
+                }
+                fill(slot, sequence);
+                ring.publish();
+            } else {
+                Item item;
+                fill(&item, sequence);
+                while (!ring.push(item)) {
+                    std::this_thread::yield();
+                }
+            }
+        }
+    });
+
+    uint64_t expected = 0;
+    while (expected < LOSSLESS_ITEMS) {
+        if (expected & 2) {
+            Item* slot = ring.peek();
+            if (slot == nullptr) {
+                std::this_thread::yield();
+                continue;
+            }
+            verify(*slot);
+            CHECK_EQ(slot->sequence, expected);
+            ring.release();
+        } else {
+            Item item;
+            if (!ring.pop(item)) {
+                std::this_thread::yield();
+                continue;
+            }
+            verify(item);
+            CHECK_EQ(item.sequence, expected);
+        }
+        expected++;
+    }
+    producer.join();
+
+    CHECK(ring.empty());
+    CHECK(ring.high_water() <= RING_SLOTS);
+    printf("lossless: %u items through %d slots, high water %lu, %lu full claims retried\n",
+           LOSSLESS_ITEMS, RING_SLOTS, (unsigned long)ring.high_water(), (unsigned long)ring.dropped());
+}
+
+// Producer never waits: items are received in increasing order, and received plus dropped is all of them
+static void lossy() {
+    static SpscRing<Item, RING_SLOTS> ring;
+    std::atomic<bool> done(false);
+
+    std::thread producer([&done] {
+        for (uint64_t sequence = 0; sequence < LOSSY_ITEMS; sequence++) {
+            Item item;
+            fill(&item, sequence);
+            ring.push(item);
+            // Give a consumer sharing the core a chance, so that both outcomes occur
+            if ((sequence & 255) == 0) {
+                std::this_thread::yield();
+            }
+        }
+        done.store(true, std::memory_order_release);
+    });
+
+    uint64_t received = 0;
+    uint64_t last = 0;
+    while (true) {
+        bool finished = done.load(std::memory_order_acquire);
+        Item item;
+        if (ring.pop(item)) {
+            verify(item);
+            CHECK(received == 0 || item.sequence > last);
+            last = item.sequence;
+            received++;
+        } else if (finished) {
+            break;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+
+    CHECK_EQ(received + ring.dropped(), LOSSY_ITEMS);
+    printf("lossy: %lu received, %lu dropped\n", (unsigned long)received, (unsigned long)ring.dropped());
+}
+
+int main() {
+    lossless();
+    lossy();
+    return 0;
+}
@@ -0,0 +1,194 @@
+// TelemetryEncoder/TelemetryDecoder (components/bluetooth_comm): records
+// round-trip unchanged across the 32-bit timestamp wrap and out-of-order
+// timestamps, batches split at the batch limit, and dropped batches are
+// counted by the decoder.
+
+#include <stdio.h>
+#include <vector>
+#include "telemetry_codec.h"
+#include "test_check.h"
+
+#define TEST_RECORDS    200000
+
+static uint32_t xorshift(uint32_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+static void collect(const TelemetryRecord& record, void* ctx) {
+    static_cast<std::vector<TelemetryRecord>*>(ctx)->push_back(record);
+}
+
+static void check_record(const TelemetryRecord& got, const TelemetryRecord& sent) {
+    CHECK_EQ(got.timestamp_us, sent.timestamp_us);
+    CHECK_EQ(got.length, sent.length);
+    CHECK_EQ(got.rssi, sent.rssi);
+    CHECK_EQ(got.channel, sent.channel);
+    CHECK_EQ(got.type, sent.type);
+    CHECK_EQ(got.subtype, sent.subtype);
+    CHECK_EQ(got.retry, sent.retry);
+}
+
+static TelemetryRecord make_record(uint32_t timestamp_us, uint16_t length, int8_t rssi = -60) {
+    TelemetryRecord record = {};
+    record.timestamp_us = timestamp_us;
+    record.length = length;
+    record.rssi = rssi;
+    record.channel = 6;
+    record.type = 2;
+    record.subtype = 8;
+    return record;
+}
+
+static void test_wrap() {
+    TelemetryEncoder encoder;
+    TelemetryDecoder decoder;
+    const TelemetryRecord sent[] = {
+        make_record(0xFFFFFFF0u, 100),
+        make_record(0x00000010u, 120),      // +32 us across the wrap
+        make_record(0x00000005u, 80),       // -11 us, reordered
+        make_record(0xFFFFFFFFu, 60000),    // -6 us back across the wrap
+    };
+    for (const TelemetryRecord& record : sent) {
+        CHECK(encoder.append(record));
+    }
+
+    // Small deltas stay one varint byte each way across the wrap
+    const uint8_t* batch;
+    size_t len = encoder.finish(&batch);
+    CHECK_EQ(len, TELEMETRY_HEADER_SIZE + 3 * (3 + 1 + 1) + (3 + 1 + 3));
+    CHECK_EQ(batch[4], 4);
+
+    std::vector<TelemetryRecord> got;
+    CHECK(decoder.decode(batch, len, collect, &got));
+    CHECK_EQ(got.size(), 4);
+    for (size_t i = 0; i < got.size(); i++) {
+        check_record(got[i], sent[i]);
+    }
+
+    // RSSI outside 0..-127 is clamped
+    CHECK(encoder.append(make_record(0, 10, 5)));
+    CHECK(encoder.append(make_record(0, 10, -128)));
+    len = encoder.finish(&batch);
+    got.clear();
+    CHECK(decoder.decode(batch, len, collect, &got));
+    CHECK_EQ(got[0].rssi, 0);
+    CHECK_EQ(got[1].rssi, -127);
+    CHECK_EQ(decoder.lost_batches(), 0);
+
+    // Truncated or foreign batches are rejected
+    CHECK(!decoder.decode(batch, len - 1, collect, &got));
+    CHECK(!decoder.decode(batch, TELEMETRY_HEADER_SIZE - 1, collect, &got));
+    uint8_t foreign[TELEMETRY_HEADER_SIZE] = { 0x00, TELEMETRY_VERSION };
+    CHECK(!decoder.decode(foreign, sizeof(foreign), collect, &got));
+}
+
+static void test_round_trip() {
+    TelemetryEncoder encoder(64);
+    TelemetryDecoder decoder;
+    std::vector<TelemetryRecord> sent;
+    std::vector<TelemetryRecord> got;
+    uint32_t state = 1;
+    uint32_t timestamp = 0xFFFFFFFFu - 5000000;
+    uint64_t elapsed = 0;
+    uint32_t batches = 0;
+    size_t largest[2] = {};
+
+    auto send = [&]() {
+        size_t limit = encoder.batch_limit();
+        const uint8_t* batch;
+        size_t len = encoder.finish(&batch);
+        CHECK(len > TELEMETRY_HEADER_SIZE && len <= limit);
+        size_t& largest_len = largest[limit == 64 ? 0 : 1];
+        largest_len = len > largest_len ? len : largest_len;
+        CHECK(decoder.decode(batch, len, collect, &got));
+        batches++;
+    };
+
+    for (uint32_t i = 0; i < TEST_RECORDS; i++) {
+        // Mostly increasing, sometimes a little behind, now and then a long gap
+        uint32_t r = xorshift(&state);
+        int32_t step = r % 64 == 0 ? (int32_t)(r % 3000000)
+                     : r % 8 == 0 ? -(int32_t)(r % 500) : (int32_t)(r % 2000);
+        timestamp += (uint32_t)step;
+        elapsed += step;
+        TelemetryRecord record;
+        record.timestamp_us = timestamp;
+        record.length = (uint16_t)xorshift(&state);
+        record.rssi = (int8_t)-(int)(xorshift(&state) % 128);
+        record.channel = xorshift(&state) % 16;
+        record.type = xorshift(&state) % 4;
+        record.subtype = xorshift(&state) % 16;
+        record.retry = xorshift(&state) % 2;
+        sent.push_back(record);
+
+        // A record that does not fit closes the batch and starts the next one
+        if (!encoder.append(record)) {
+            CHECK(!encoder.empty());
+            send();
+            CHECK(encoder.append(record));
+        }
+        CHECK(encoder.size() <= encoder.batch_limit());
+
+        // An MTU change applies from the next batch on
+        if (i == TEST_RECORDS / 2) {
+            encoder.set_batch_limit(247 - 3);
+            CHECK_EQ(encoder.batch_limit(), 64);
+        }
+    }
+    send();
+    // Batches fill up to the limit in force when they were started
+    CHECK(largest[0] > 64 - TELEMETRY_MAX_RECORD_SIZE && largest[1] > 64);
+
+    CHECK_EQ(got.size(), sent.size());
+    for (size_t i = 0; i < sent.size(); i++) {
+        check_record(got[i], sent[i]);
+    }
+    CHECK(elapsed > 5000000);
+    CHECK_EQ(decoder.batches(), batches);
+    CHECK_EQ(decoder.records(), TEST_RECORDS);
+    CHECK_EQ(decoder.lost_batches(), 0);
+    CHECK_EQ(encoder.next_sequence(), (uint16_t)batches);
+}
+
+static void test_lost_batches() {
+    TelemetryEncoder encoder;
+    TelemetryDecoder decoder;
+    const uint8_t* batch;
+    size_t len;
+
+    for (uint32_t i = 0; i < 6; i++) {
+        CHECK(encoder.append(make_record(i * 1000, 100)));
+        len = encoder.finish(&batch);
+        // Batches 2, 4 and 5 never arrive
+        if (i != 2 && i != 4 && i != 5) {
+            CHECK(decoder.decode(batch, len, nullptr, nullptr));
+        }
+    }
+    CHECK_EQ(decoder.batches(), 3);
+    CHECK_EQ(decoder.lost_batches(), 1);
+    CHECK(encoder.append(make_record(6000, 100)));
+    len = encoder.finish(&batch);
+    CHECK(decoder.decode(batch, len, nullptr, nullptr));
+    CHECK_EQ(decoder.lost_batches(), 3);
+
+    // A reset batch does not use up a sequence number
+    CHECK(encoder.append(make_record(7000, 100)));
+    encoder.reset();
+    CHECK_EQ(encoder.finish(&batch), 0);
+    CHECK(encoder.append(make_record(8000, 100)));
+    len = encoder.finish(&batch);
+    CHECK(decoder.decode(batch, len, nullptr, nullptr));
+    CHECK_EQ(decoder.lost_batches(), 3);
+    CHECK_EQ(decoder.records(), 5);
+}
+
+int main() {
+    test_wrap();
+    test_round_trip();
+    test_lost_batches();
+    printf("telemetry_codec_test: ok\n");
+    return 0;
+}
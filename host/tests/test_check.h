@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// Minimal assertions for the host tests. A failed check prints where it
+// failed and exits with status 1, which ctest reports as a failure.
+#define CHECK(cond)                                                                 \
+    do {                                                                            \
+        if (!(cond)) {                                                              \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            exit(1);                                                                \
+        }                                                                           \
+    } while (0)
+
+#define CHECK_EQ(a, b)                                                              \
+    do {                                                                            \
+        long long check_a = (long long)(a);                                         \
+        long long check_b = (long long)(b);                                         \
+        if (check_a != check_b) {                                                   \
+            fprintf(stderr, "%s:%d: check failed: %s == %s (%lld != %lld)\n",       \
+                    __FILE__, __LINE__, #a, #b, check_a, check_b);                  \
+            exit(1);                                                                \
+        }                                                                           \
+    } while (0)
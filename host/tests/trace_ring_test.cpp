@@ -0,0 +1,188 @@
+// Multi-producer stress test of TraceRing (components/sniffer_trace).
+//
+// Several producer threads push numbered records through a small ring while
+// one consumer checks that each producer's records arrive intact, in order,
+// once and without gaps. A second pass lets the producers drop on a full
+// ring and checks that every record is either received or counted in
+// dropped(), and a single-thread pass checks which records a full ring keeps.
+
+#include <atomic>
+#include <stdint.h>
+#include <stdio.h>
+#include <thread>
+#include <vector>
+#include "trace_ring.h"
+#include "test_check.h"
+
+#define RING_SLOTS          64
+#define PRODUCERS           4
+#define LOSSLESS_RECORDS    (1u << 18)      // Per producer
+#define LOSSY_RECORDS       (1u << 18)      // Per producer
+
+// Larger than a cache line, so that a torn read shows up as a bad check word
+struct Record {
+    uint32_t producer;
+    uint32_t sequence;
+    uint8_t payload[56];
+    uint64_t check;
+};
+
+static uint64_t record_check(uint32_t producer, uint32_t sequence) {
+    return ((uint64_t)producer << 32 | sequence) * 0x9E3779B97F4A7C15ull ^ 0xA5A5A5A5A5A5A5A5ull;
+}
+
+static Record make_record(uint32_t producer, uint32_t sequence) {
+    Record record;
+    record.producer = producer;
+    record.sequence = sequence;
+    for (size_t i = 0; i < sizeof(record.payload); i++) {
+        record.payload[i] = (uint8_t)(sequence + i);
+    }
+    record.check = record_check(producer, sequence);
+    return record;
+}
+
+static void verify(const Record& record) {
+    CHECK(record.producer < PRODUCERS);
+    CHECK(record.check == record_check(record.producer, record.sequence));
+    for (size_t i = 0; i < sizeof(record.payload); i++) {
+        CHECK_EQ(record.payload[i], (uint8_t)(record.sequence + i));
+    }
+}
+
+// Producers retry on a full ring: every record arrives once, in order per producer
+static void lossless() {
+    static TraceRing<Record, RING_SLOTS> ring;
+    std::atomic<uint32_t> retries(0);
+
+    std::vector<std::thread> producers;
+    for (uint32_t p = 0; p < PRODUCERS; p++) {
+        producers.emplace_back([p, &retries] {
+            for (uint32_t sequence = 0; sequence < LOSSLESS_RECORDS; sequence++) {
+                Record record = make_record(p, sequence);
+                while (!ring.push(record)) {
+                    retries.fetch_add(1, std::memory_order_relaxed);
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    uint32_t expected[PRODUCERS] = {};
+    uint64_t received = 0;
+    while (received < (uint64_t)PRODUCERS * LOSSLESS_RECORDS) {
+        Record record;
+        if (!ring.pop(&record)) {
+            std::this_thread::yield();
+            continue;
+        }
+        verify(record);
+        CHECK_EQ(record.sequence, expected[record.producer]);
+        expected[record.producer]++;
+        received++;
+    }
+    for (std::thread& producer : producers) {
+        producer.join();
+    }
+
+    Record extra;
+    CHECK(!ring.pop(&extra));
+    for (uint32_t p = 0; p < PRODUCERS; p++) {
+        CHECK_EQ(expected[p], LOSSLESS_RECORDS);
+    }
+    // Every failed push is a drop
+    CHECK_EQ(ring.dropped(), retries.load());
+    printf("lossless: %d x %u records through %d slots, %u full pushes retried\n",
+           PRODUCERS, LOSSLESS_RECORDS, RING_SLOTS, (unsigned)ring.dropped());
+}
+
+// Producers never wait: records arrive in increasing order per producer, and
+// received plus dropped is all of them
+static void lossy() {
+    static TraceRing<Record, RING_SLOTS> ring;
+    std::atomic<int> producing(PRODUCERS);
+    std::atomic<uint32_t> failed(0);
+
+    std::vector<std::thread> producers;
+    for (uint32_t p = 0; p < PRODUCERS; p++) {
+        producers.emplace_back([p, &producing, &failed] {
+            for (uint32_t sequence = 0; sequence < LOSSY_RECORDS; sequence++) {
+                if (!ring.push(make_record(p, sequence))) {
+                    failed.fetch_add(1, std::memory_order_relaxed);
+                }
+                // Give a consumer sharing the core a chance, so that both outcomes occur
+                if ((sequence & 255) == 0) {
+                    std::this_thread::yield();
+                }
+            }
+            producing.fetch_sub(1, std::memory_order_release);
+        });
+    }
+
+    uint64_t received[PRODUCERS] = {};
+    int64_t last[PRODUCERS];
+    for (uint32_t p = 0; p < PRODUCERS; p++) {
+        last[p] = -1;
+    }
+    while (true) {
+        bool finished = producing.load(std::memory_order_acquire) == 0;
+        Record record;
+        if (ring.pop(&record)) {
+            verify(record);
+            CHECK((int64_t)record.sequence > last[record.producer]);
+            last[record.producer] = record.sequence;
+            received[record.producer]++;
+        } else if (finished) {
+            break;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    for (std::thread& producer : producers) {
+        producer.join();
+    }
+
+    uint64_t total = 0;
+    for (uint32_t p = 0; p < PRODUCERS; p++) {
+        total += received[p];
+    }
+    CHECK_EQ(ring.dropped(), failed.load());
+    CHECK_EQ(total + ring.dropped(), (uint64_t)PRODUCERS * LOSSY_RECORDS);
+    CHECK(ring.dropped() > 0);
+    printf("lossy: %lu received, %u dropped\n", (unsigned long)total, (unsigned)ring.dropped());
+}
+
+// A full ring keeps the oldest records and counts each rejected one
+static void full() {
+    static TraceRing<Record, RING_SLOTS> ring;
+    for (uint32_t sequence = 0; sequence < RING_SLOTS; sequence++) {
+        CHECK(ring.push(make_record(0, sequence)));
+    }
+    CHECK(!ring.push(make_record(0, RING_SLOTS)));
+    CHECK(!ring.push(make_record(0, RING_SLOTS + 1)));
+    CHECK_EQ(ring.dropped(), 2);
+
+    // Popping one frees one slot
+    Record record;
+    CHECK(ring.pop(&record));
+    CHECK_EQ(record.sequence, 0);
+    CHECK(ring.push(make_record(0, RING_SLOTS + 2)));
+    CHECK(!ring.push(make_record(0, RING_SLOTS + 3)));
+    CHECK_EQ(ring.dropped(), 3);
+
+    for (uint32_t sequence = 1; sequence < RING_SLOTS; sequence++) {
+        CHECK(ring.pop(&record));
+        verify(record);
+        CHECK_EQ(record.sequence, sequence);
+    }
+    CHECK(ring.pop(&record));
+    CHECK_EQ(record.sequence, RING_SLOTS + 2);
+    CHECK(!ring.pop(&record));
+}
+
+int main() {
+    full();
+    lossless();
+    lossy();
+    return 0;
+}
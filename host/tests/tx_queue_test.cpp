@@ -0,0 +1,259 @@
+// TxQueue and TxPump (components/bluetooth_comm) against a mock transport:
+// ordering within and across priority classes, shedding and rejection
+// under the byte budget, all-or-nothing split pushes, and the pump's
+// handling of a busy, failing and congested link.
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "tx_queue.h"
+#include "test_check.h"
+
+// Bytes TxQueue stores per message besides its payload
+#define MESSAGE_HEADER  2
+
+// Records what is sent; answers with the scripted results, then TX_SENT
+class MockTransport : public TxTransport {
+public:
+    tx_result_t send(const uint8_t* data, size_t len) override {
+        attempts++;
+        tx_result_t result = TX_SENT;
+        if (!script.empty()) {
+            result = script.front();
+            script.erase(script.begin());
+        }
+        if (result == TX_SENT) {
+            sent.push_back(std::string((const char*)data, len));
+        }
+        return result;
+    }
+
+    std::vector<tx_result_t> script;
+    std::vector<std::string> sent;
+    size_t attempts = 0;
+};
+
+static bool push(TxQueue& queue, const char* text, uint8_t priority) {
+    return queue.push((const uint8_t*)text, strlen(text), priority);
+}
+
+// Message of `len` bytes whose content tells it apart
+static std::string message(char tag, size_t len) {
+    return std::string(len, tag);
+}
+
+static void test_ordering() {
+    TxQueue queue(1024);
+    MockTransport transport;
+    TxPump pump(queue, transport);
+
+    CHECK(push(queue, "t1", TX_PRIORITY_TELEMETRY));
+    CHECK(push(queue, "c1", TX_PRIORITY_CONTROL));
+    CHECK(push(queue, "t2", TX_PRIORITY_TELEMETRY));
+    CHECK(push(queue, "c2", TX_PRIORITY_CONTROL));
+    CHECK_EQ(queue.stats().messages, 4);
+
+    // Control first, then telemetry, each oldest first
+    CHECK_EQ(pump.pump(SIZE_MAX), 4);
+    CHECK_EQ(transport.sent.size(), 4);
+    CHECK(transport.sent[0] == "c1" && transport.sent[1] == "c2");
+    CHECK(transport.sent[2] == "t1" && transport.sent[3] == "t2");
+    CHECK_EQ(queue.stats().messages, 0);
+    CHECK_EQ(queue.stats().bytes_used, 0);
+
+    // max_messages bounds one call
+    for (int i = 0; i < 3; i++) {
+        CHECK(push(queue, "x", TX_PRIORITY_CONTROL));
+    }
+    CHECK_EQ(pump.pump(2), 2);
+    CHECK_EQ(pump.pump(SIZE_MAX), 1);
+    CHECK_EQ(pump.stats().sent, 7);
+}
+
+static void test_wraparound() {
+    // Rings wrap many times; every message comes out intact
+    TxQueue queue(100);
+    uint8_t out[TX_QUEUE_MAX_MESSAGE];
+    for (int i = 0; i < 1000; i++) {
+        std::string msg = message((char)('a' + i % 26), 1 + i % 40);
+        CHECK(queue.push((const uint8_t*)msg.data(), msg.size(), i % 2));
+        size_t len = queue.pop(out, sizeof(out));
+        CHECK_EQ(len, msg.size());
+        CHECK(memcmp(out, msg.data(), len) == 0);
+    }
+    CHECK_EQ(queue.pop(out, sizeof(out)), 0);
+}
+
+static void test_budget() {
+    // Room for four 98-byte messages
+    const size_t budget = 4 * (98 + MESSAGE_HEADER);
+    TxQueue queue(budget);
+    std::string t = message('t', 98);
+    std::string c = message('c', 98);
+
+    for (int i = 0; i < 4; i++) {
+        std::string msg = message((char)('0' + i), 98);
+        CHECK(queue.push((const uint8_t*)msg.data(), msg.size(), TX_PRIORITY_TELEMETRY));
+    }
+    CHECK_EQ(queue.stats().bytes_used, budget);
+    CHECK_EQ(queue.stats().bytes_high_water, budget);
+
+    // A control message sheds the oldest telemetry
+    CHECK(queue.push((const uint8_t*)c.data(), c.size(), TX_PRIORITY_CONTROL));
+    TxQueueStats stats = queue.stats();
+    CHECK_EQ(stats.shed, 1);
+    CHECK_EQ(stats.messages, 4);
+
+    // So does new telemetry; control is never shed
+    CHECK(queue.push((const uint8_t*)c.data(), c.size(), TX_PRIORITY_CONTROL));
+    CHECK(queue.push((const uint8_t*)c.data(), c.size(), TX_PRIORITY_CONTROL));
+    CHECK(queue.push((const uint8_t*)t.data(), t.size(), TX_PRIORITY_TELEMETRY));
+    stats = queue.stats();
+    CHECK_EQ(stats.shed, 4);
+    CHECK_EQ(stats.rejected, 0);
+
+    // With control filling the budget, any push is rejected
+    CHECK(queue.push((const uint8_t*)c.data(), c.size(), TX_PRIORITY_CONTROL));
+    CHECK(!queue.push((const uint8_t*)c.data(), c.size(), TX_PRIORITY_CONTROL));
+    CHECK(!queue.push((const uint8_t*)t.data(), t.size(), TX_PRIORITY_TELEMETRY));
+    stats = queue.stats();
+    CHECK_EQ(stats.shed, 5);
+    CHECK_EQ(stats.rejected, 2);
+    CHECK_EQ(stats.pushed, 9);
+    CHECK_EQ(stats.messages, 4);
+
+    // What is left is the four control messages, in order
+    uint8_t out[TX_QUEUE_MAX_MESSAGE];
+    for (int i = 0; i < 4; i++) {
+        CHECK_EQ(queue.pop(out, sizeof(out)), 98);
+        CHECK_EQ(out[0], 'c');
+    }
+
+    // Invalid pushes count as rejections
+    CHECK(!queue.push(out, 0, TX_PRIORITY_CONTROL));
+    CHECK(!queue.push(out, TX_QUEUE_MAX_MESSAGE + 1, TX_PRIORITY_CONTROL));
+    CHECK(!queue.push(out, 1, TX_PRIORITY_COUNT));
+    CHECK_EQ(queue.stats().rejected, 5);
+
+    // A lowered budget applies to pushes; it never drops below one largest message
+    TxQueue large(4096);
+    large.set_byte_budget(0);
+    CHECK_EQ(large.stats().byte_budget, TX_QUEUE_MAX_MESSAGE + MESSAGE_HEADER);
+    large.set_byte_budget(1 << 20);
+    CHECK_EQ(large.stats().byte_budget, 4096);
+}
+
+static void test_split() {
+    TxQueue queue(1024);
+    MockTransport transport;
+    TxPump pump(queue, transport);
+
+    // 50 bytes in pieces of 20: 20, 20, 10, back to back even with other
+    // control messages queued around them
+    std::string text;
+    for (int i = 0; i < 50; i++) {
+        text += (char)('A' + i % 26);
+    }
+    CHECK(push(queue, "before", TX_PRIORITY_CONTROL));
+    CHECK(push(queue, "telemetry", TX_PRIORITY_TELEMETRY));
+    CHECK(queue.push_split((const uint8_t*)text.data(), text.size(), 20, TX_PRIORITY_CONTROL));
+    CHECK(push(queue, "after", TX_PRIORITY_CONTROL));
+    CHECK_EQ(queue.stats().pushed, 6);
+    CHECK_EQ(queue.stats().bytes_used, 6 + 9 + 50 + 5 + 6 * MESSAGE_HEADER);
+
+    pump.pump(SIZE_MAX);
+    CHECK_EQ(transport.sent.size(), 6);
+    CHECK(transport.sent[0] == "before");
+    CHECK(transport.sent[1] == text.substr(0, 20));
+    CHECK(transport.sent[2] == text.substr(20, 20));
+    CHECK(transport.sent[3] == text.substr(40));
+    CHECK(transport.sent[4] == "after");
+    CHECK(transport.sent[5] == "telemetry");
+
+    // Not enough room for every piece: nothing is queued
+    TxQueue small(600);
+    std::string big = message('b', 500);
+    CHECK(small.push((const uint8_t*)big.data(), big.size(), TX_PRIORITY_CONTROL));
+    std::string split = message('s', 90);
+    CHECK(!small.push_split((const uint8_t*)split.data(), split.size(), 20, TX_PRIORITY_CONTROL));
+    TxQueueStats stats = small.stats();
+    CHECK_EQ(stats.messages, 1);
+    CHECK_EQ(stats.rejected, 1);
+    CHECK_EQ(stats.bytes_used, 500 + MESSAGE_HEADER);
+
+    // Room only after shedding telemetry: pieces go in, telemetry goes out
+    TxQueue shed(600);
+    CHECK(shed.push((const uint8_t*)big.data(), big.size(), TX_PRIORITY_TELEMETRY));
+    CHECK(shed.push_split((const uint8_t*)split.data(), split.size(), 20, TX_PRIORITY_CONTROL));
+    stats = shed.stats();
+    CHECK_EQ(stats.shed, 1);
+    CHECK_EQ(stats.messages, 5);
+
+    // Pieces must fit a notification
+    CHECK(!queue.push_split((const uint8_t*)text.data(), text.size(), 0, TX_PRIORITY_CONTROL));
+    CHECK(!queue.push_split((const uint8_t*)text.data(), text.size(), TX_QUEUE_MAX_MESSAGE + 1,
+                            TX_PRIORITY_CONTROL));
+}
+
+static void test_pump() {
+    TxQueue queue(1024);
+    MockTransport transport;
+    TxPump pump(queue, transport);
+
+    // A busy link keeps the message and retries the same one later
+    CHECK(push(queue, "m1", TX_PRIORITY_CONTROL));
+    CHECK(push(queue, "m2", TX_PRIORITY_CONTROL));
+    transport.script = { TX_BUSY };
+    CHECK_EQ(pump.pump(SIZE_MAX), 0);
+    CHECK_EQ(pump.stats().busy, 1);
+    CHECK_EQ(queue.stats().messages, 1);
+    CHECK(push(queue, "c0", TX_PRIORITY_CONTROL));
+    CHECK_EQ(pump.pump(SIZE_MAX), 3);
+    CHECK(transport.sent[0] == "m1" && transport.sent[1] == "m2" && transport.sent[2] == "c0");
+
+    // A failed message is dropped and counted, and the next one goes out
+    CHECK(push(queue, "bad", TX_PRIORITY_TELEMETRY));
+    CHECK(push(queue, "good", TX_PRIORITY_TELEMETRY));
+    transport.script = { TX_FAILED };
+    CHECK_EQ(pump.pump(SIZE_MAX), 1);
+    CHECK_EQ(pump.stats().failed, 1);
+    CHECK(transport.sent.back() == "good");
+
+    // Nothing is sent while congested, and the attempt counts as deferred
+    CHECK(push(queue, "wait", TX_PRIORITY_CONTROL));
+    pump.set_congested(true);
+    size_t attempts = transport.attempts;
+    CHECK_EQ(pump.pump(SIZE_MAX), 0);
+    CHECK_EQ(transport.attempts, attempts);
+    CHECK_EQ(pump.stats().busy, 2);
+    pump.set_congested(false);
+    CHECK_EQ(pump.pump(SIZE_MAX), 1);
+    CHECK(transport.sent.back() == "wait");
+
+    // A message in flight when the link drops is discarded, not resent
+    CHECK(push(queue, "stale", TX_PRIORITY_CONTROL));
+    transport.script = { TX_BUSY };
+    CHECK_EQ(pump.pump(SIZE_MAX), 0);
+    pump.discard_pending();
+    queue.clear();
+    CHECK(push(queue, "fresh", TX_PRIORITY_CONTROL));
+    CHECK_EQ(pump.pump(SIZE_MAX), 1);
+    CHECK(transport.sent.back() == "fresh");
+
+    TxPumpStats stats = pump.stats();
+    CHECK_EQ(stats.sent, 6);
+    CHECK_EQ(stats.failed, 1);
+    CHECK_EQ(stats.busy, 3);
+    CHECK_EQ(transport.sent.size(), 6);
+}
+
+int main() {
+    test_ordering();
+    test_wraparound();
+    test_budget();
+    test_split();
+    test_pump();
+    printf("tx_queue_test: ok\n");
+    return 0;
+}
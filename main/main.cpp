@@ -1,3 +1,4 @@
+#include <atomic>
 #include <stdio.h>
 #include <string.h>
 #include "freertos/FreeRTOS.h"
@@ -6,33 +7,82 @@
 #include "esp_system.h"
 #include "esp_wifi.h"
 #include "esp_event.h"
+#include "esp_console.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "nvs_flash.h"
 #include "esp_netif.h"
 #include "network_sniffer.h"
+#include "ap_inventory.h"
+#include "attack_detector.h"
 #include "bluetooth_comm.h"
+#include "burst_trigger.h"
+#include "channel_scheduler.h"
+#include "device_tracker.h"
+#include "flight_recorder.h"
+#include "frame_stats.h"
+#include "inventory_codec.h"
+#include "oui_lookup.h"
+#include "pcap_writer.h"
+#include "pipeline_runtime.h"
+#include "sniffer_config.h"
+#include "sniffer_metrics.h"
+#include "sniffer_trace.h"
 
 static const char *TAG = "ESP32_NETWORK_SNIFFER";
 
 // Global instances
 NetworkSniffer* g_sniffer = nullptr;
 BluetoothComm* g_bluetooth = nullptr;
+ChannelScheduler* g_scheduler = nullptr;
+DeviceTracker* g_devices = nullptr;
+ApInventory* g_inventory = nullptr;
+FlightRecorder* g_recorder = nullptr;
+AttackDetector* g_detector = nullptr;
+FrameDedup* g_dedup = nullptr;
+SnifferConfig* g_config = nullptr;
+MetricsSampler* g_metrics = nullptr;
 
-// Packet statistics
-static struct {
-    uint32_t total_packets;
-    uint32_t management_packets;
-    uint32_t data_packets;
-    uint32_t bytes_received;
-} packet_stats = {0};
+// Status log period while listening on a fixed channel
+#define FIXED_CHANNEL_REPORT_MS 30000
+
+// Frame statistics; the processing task is the only producer
+static FrameStats frame_stats;
+#define STATS_SHARD_PROCESSING 0
+
+// New devices by what their address says about the vendor; the processing task is the only writer
+struct VendorCounts {
+    std::atomic<uint32_t> labeled;      // Registered OUI
+    std::atomic<uint32_t> randomized;   // Locally administered address
+    std::atomic<uint32_t> unknown;      // Universal address missing from the OUI table
+};
+static VendorCounts vendor_counts;
+
+// Inventory deltas on their way to the Bluetooth link, only touched by the inventory sink
+struct InventoryLink {
+    ApInventory* inventory;
+    BluetoothComm* bluetooth;
+    InventoryEncoder encoder;
+    bool connected;
+    uint16_t mtu;           // MTU the encoder's batch limit was last sized for
+};
+static InventoryLink inventory_link;
+
+// Flight recorder snapshots streamed to the app as a PCAPNG file, only
+// touched by the recorder's export task. A block that the transmit queue
+// cannot take whole is kept and offered again.
+struct SnapshotLink {
+    BluetoothComm* bluetooth;
+    uint8_t block[PCAPNG_HEADER_SIZE + 64 + PCAPNG_RADIOTAP_SIZE + SNIFFER_SNAPLEN];
+    size_t len;
+    bool framed;            // block holds the frame being offered
+};
+static SnapshotLink snapshot_link;
+static BurstTrigger deauth_trigger;
 
 // Custom packet processing callback
 void packet_processor(const uint8_t* data, size_t len) {
-    ESP_LOGI(TAG, "Processing packet of length %d bytes", len);
-    
-    // Update statistics
-    packet_stats.total_packets++;
-    packet_stats.bytes_received += len;
+    SNIFFER_TRACE_D(TAG, "Processing packet of length %lu bytes", len);
     
     // TODO: Add your custom packet processing logic here
     // - Parse specific packet types
@@ -41,67 +91,352 @@ void packet_processor(const uint8_t* data, size_t len) {
     // - Send data to external systems
 }
 
-// Enhanced packet handler for Bluetooth transmission
-void enhanced_packet_handler(void* buf, wifi_promiscuous_pkt_type_t type) {
-    if (type != WIFI_PKT_MGMT && type != WIFI_PKT_DATA) {
+// Frame sink forwarding packet info via Bluetooth
+void enhanced_packet_handler(const FrameView& frame, void* ctx) {
+    BluetoothComm* bluetooth = static_cast<BluetoothComm*>(ctx);
+    
+    // A retransmission was sent with its first copy
+    if (frame.duplicate) {
         return;
     }
     
-    wifi_promiscuous_pkt_t* pkt = (wifi_promiscuous_pkt_t*)buf;
-    
-    // Update statistics
-    if (type == WIFI_PKT_MGMT) {
-        packet_stats.management_packets++;
-    } else if (type == WIFI_PKT_DATA) {
-        packet_stats.data_packets++;
+    // Beacons and probes reach the app as inventory deltas instead
+    const ParsedFrame* parsed = frame.parsed;
+    if (parsed && (ieee80211_is_mgmt(*parsed, IEEE80211_MGMT_BEACON) ||
+                   ieee80211_is_mgmt(*parsed, IEEE80211_MGMT_PROBE_REQ) ||
+                   ieee80211_is_mgmt(*parsed, IEEE80211_MGMT_PROBE_RESP))) {
+        return;
     }
     
-    // Log packet information
-    ESP_LOGI(TAG, "Packet received - Type: %d, Length: %d, Channel: %d, RSSI: %d",
-             type, pkt->rx_ctrl.sig_len, pkt->rx_ctrl.channel, pkt->rx_ctrl.rssi);
-    
-    // Send packet info via Bluetooth if connected
-    if (g_bluetooth && g_bluetooth->is_connected()) {
-        esp_err_t ret = g_bluetooth->send_packet_info(
-            pkt->rx_ctrl.channel,
-            pkt->rx_ctrl.rssi,
-            pkt->rx_ctrl.sig_len,
-            type
-        );
+    // Queue a telemetry record via Bluetooth if connected
+    if (bluetooth && bluetooth->is_connected()) {
+        TelemetryRecord record = {};
+        record.timestamp_us = (uint32_t)frame.timestamp_us;
+        record.length = frame.orig_len;
+        record.rssi = frame.rx_ctrl->rssi;
+        record.channel = frame.rx_ctrl->channel;
+        record.type = frame.type;
+        if (frame.parsed) {
+            record.subtype = frame.parsed->subtype;
+            record.retry = (frame.parsed->flags & IEEE80211_FC_RETRY) != 0;
+        }
+        esp_err_t ret = bluetooth->send_packet_record(record);
         
         if (ret != ESP_OK) {
-            ESP_LOGW(TAG, "Failed to send packet info via Bluetooth: %s", esp_err_to_name(ret));
+            SNIFFER_TRACE_W(TAG, "Failed to send packet info via Bluetooth: %s", esp_err_to_name(ret));
         }
     }
+}
+
+// Frame sink updating the frame statistics
+void stats_sink(const FrameView& frame, void* ctx) {
+    FrameStats* stats = static_cast<FrameStats*>(ctx);
+    if (frame.duplicate) {
+        return;
+    }
+    bool retry = frame.parsed && (frame.parsed->flags & IEEE80211_FC_RETRY) != 0;
+    stats->record(STATS_SHARD_PROCESSING, frame.type, frame.orig_len,
+                  frame.rx_ctrl->rssi, frame.rx_ctrl->channel, retry);
+}
+
+// Frame sink feeding channel activity to the hop scheduler
+void scheduler_sink(const FrameView& frame, void* ctx) {
+    ChannelScheduler* scheduler = static_cast<ChannelScheduler*>(ctx);
+    scheduler->record_frame(frame.rx_ctrl->channel, frame.parsed ? frame.parsed->bssid : nullptr);
+}
+
+// Frame sink updating the per-device table
+void device_sink(const FrameView& frame, void* ctx) {
+    DeviceTracker* devices = static_cast<DeviceTracker*>(ctx);
+    const ParsedFrame* parsed = frame.parsed;
     
-    // Print first few bytes of the packet for debugging
-    if (pkt->rx_ctrl.sig_len > 0) {
-        ESP_LOG_BUFFER_HEX(TAG, pkt->payload, 
-                          pkt->rx_ctrl.sig_len > 32 ? 32 : pkt->rx_ctrl.sig_len);
+    // ACK and CTS frames carry no transmitter address
+    if (!parsed || !parsed->transmitter) {
+        return;
+    }
+    
+    DeviceObservation obs = {};
+    obs.mac = parsed->transmitter;
+    obs.bssid = parsed->bssid;
+    obs.timestamp_us = frame.timestamp_us;
+    obs.rssi = frame.rx_ctrl->rssi;
+    obs.channel = frame.rx_ctrl->channel;
+    obs.type = parsed->type;
+    obs.duplicate = frame.duplicate;
+    obs.is_ap = ieee80211_is_mgmt(*parsed, IEEE80211_MGMT_BEACON) ||
+                ieee80211_is_mgmt(*parsed, IEEE80211_MGMT_PROBE_RESP) ||
+                (parsed->bssid && memcmp(parsed->bssid, parsed->transmitter, 6) == 0);
+    bool inserted;
+    devices->update(obs, &inserted);
+    
+    // Label each device with its vendor once, when it is first heard
+    if (inserted) {
+        const uint8_t* mac = parsed->transmitter;
+        std::atomic<uint32_t>& counter = oui_lookup(mac) != OUI_VENDOR_NONE ? vendor_counts.labeled
+                                       : mac_kind(mac) == MAC_LOCAL ? vendor_counts.randomized
+                                       : vendor_counts.unknown;
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        SNIFFER_TRACE_I(TAG, "New device %06lx%06lx: %s",
+                        (uint32_t)(mac[0] << 16 | mac[1] << 8 | mac[2]),
+                        (uint32_t)(mac[3] << 16 | mac[4] << 8 | mac[5]), oui_label(mac));
+    }
+}
+
+// Send the pending inventory batch, or drop it while nobody is connected
+static void send_inventory_batch(InventoryLink* link) {
+    const uint8_t* batch;
+    size_t len = link->encoder.finish(&batch);
+    if (len && link->connected && link->bluetooth->send_data(batch, len) != ESP_OK) {
+        SNIFFER_TRACE_W(TAG, "Failed to send inventory batch of %lu bytes", (uint32_t)len);
+    }
+}
+
+static void inventory_delta(const InventoryDelta& delta, void* ctx) {
+    InventoryLink* link = static_cast<InventoryLink*>(ctx);
+    if (!link->encoder.append(delta)) {
+        send_inventory_batch(link);
+        link->encoder.append(delta);
+    }
+}
+
+// Frame sink folding beacons and probes into the AP/SSID inventory and
+// sending its deltas at the report interval
+void inventory_sink(const FrameView& frame, void* ctx) {
+    InventoryLink* link = static_cast<InventoryLink*>(ctx);
+    int64_t now = esp_timer_get_time();
+    if (frame.parsed && !frame.duplicate) {
+        link->inventory->update(*frame.parsed, frame.rx_ctrl->rssi, frame.rx_ctrl->channel, frame.timestamp_us);
+    }
+
+    // A client that just connected gets the whole inventory first
+    bool connected = link->bluetooth->is_connected();
+    if (connected && !link->connected) {
+        link->inventory->report_all();
+    }
+    link->connected = connected;
+
+    // Connections start at the default MTU and grow after the exchange;
+    // batches follow it so that each one fits a single notification
+    uint16_t mtu = link->bluetooth->get_mtu();
+    if (mtu != link->mtu) {
+        link->encoder.set_batch_limit(mtu - 3);
+        link->mtu = mtu;
+    }
+
+    if (link->inventory->poll(now, inventory_delta, link)) {
+        send_inventory_batch(link);
+    }
+}
+
+// Alerts go to the app as they are raised, and each one saves a recorder snapshot
+static void attack_alert(const AttackAlert& alert, void* ctx) {
+    ESP_LOGW(TAG, "Alert: %s from %02x:%02x:%02x:%02x:%02x:%02x on channel %d, %d frames",
+             attack_kind_name(alert.kind), alert.mac[0], alert.mac[1], alert.mac[2],
+             alert.mac[3], alert.mac[4], alert.mac[5], alert.channel, alert.count);
+    if (g_bluetooth->is_connected()) {
+        uint8_t record[ATTACK_ALERT_SIZE];
+        size_t len = attack_alert_encode(alert, record, sizeof(record));
+        g_bluetooth->send_data(record, len);
+    }
+    g_recorder->trigger(attack_kind_name(alert.kind));
+}
+
+// Frame sink running the attack detector on the management stream
+void attack_sink(const FrameView& frame, void* ctx) {
+    AttackDetector* detector = static_cast<AttackDetector*>(ctx);
+    // A retried deauthentication is one frame, not two
+    if (frame.parsed && !frame.duplicate) {
+        detector->update(*frame.parsed, frame.rx_ctrl->rssi, frame.rx_ctrl->channel, frame.timestamp_us,
+                         attack_alert, nullptr);
+    }
+}
+
+// Queue the pending block. Its notifications are queued together or not at
+// all, so nothing else lands between them. False while the transmit queue is full.
+static bool send_snapshot_block(SnapshotLink* link) {
+    if (link->bluetooth->send_data(link->block, link->len) == ESP_ERR_NO_MEM) {
+        return false;
     }
+    // Sent, or disconnected and dropped
+    link->len = 0;
+    link->framed = false;
+    return true;
 }
 
+static bool snapshot_begin(const RecorderSnapshot& snapshot, void* ctx) {
+    SnapshotLink* link = static_cast<SnapshotLink*>(ctx);
+    if (!link->bluetooth->is_connected()) {
+        return false;
+    }
+    char msg[96];
+    snprintf(msg, sizeof(msg), "SNAPSHOT: Id=%lu, Reason=%s, Start=%lld, End=%lld",
+             snapshot.id, snapshot.reason, snapshot.start_us, snapshot.end_us);
+    link->bluetooth->send_data((uint8_t*)msg, strlen(msg));
+
+    // The section header goes out with the first frame
+    link->len = pcapng_write_header(link->block, sizeof(link->block), SNIFFER_SNAPLEN);
+    link->framed = false;
+    return true;
+}
+
+static bool snapshot_frame(const FrameView& frame, void* ctx) {
+    SnapshotLink* link = static_cast<SnapshotLink*>(ctx);
+    if (!link->framed) {
+        PcapngFrame record;
+        pcap_writer_fill_frame(frame, &record);
+        link->len += pcapng_write_frame(link->block + link->len, sizeof(link->block) - link->len, record);
+        link->framed = true;
+    }
+    return send_snapshot_block(link);
+}
+
+static void snapshot_end(const RecorderSnapshot& snapshot, uint32_t frames, void* ctx) {
+    SnapshotLink* link = static_cast<SnapshotLink*>(ctx);
+    // A block the queue never took would corrupt the next stream
+    link->len = 0;
+    link->framed = false;
+    ESP_LOGI(TAG, "Snapshot %lu sent: %lu frames", snapshot.id, frames);
+}
+
+// Queue sources of the metrics sampler: fill level and losses between the stages
+static void frame_ring_metrics(MetricsQueue* queue, void* ctx) {
+    SnifferStats stats = static_cast<NetworkSniffer*>(ctx)->get_stats();
+    uint32_t queued = stats.captured - stats.processed;
+    queue->used = queued < stats.ring_capacity ? queued : stats.ring_capacity;
+    queue->capacity = stats.ring_capacity;
+    queue->high_water = stats.ring_high_water;
+    queue->drops = stats.dropped;
+}
+
+static void tx_queue_metrics(MetricsQueue* queue, void* ctx) {
+    TxQueueStats stats = static_cast<BluetoothComm*>(ctx)->get_tx_stats().queue;
+    queue->used = stats.bytes_used;
+    queue->capacity = stats.byte_budget;
+    queue->high_water = stats.bytes_high_water;
+    queue->drops = stats.shed + stats.rejected;
+}
+
+static void recorder_metrics(MetricsQueue* queue, void* ctx) {
+    FlightRecorderStats stats = static_cast<FlightRecorder*>(ctx)->get_stats();
+    queue->used = stats.ring_used;
+    queue->capacity = stats.ring_bytes;
+    queue->drops = stats.dropped;
+}
+
+// Kept off the stats task's stack
+static MetricsSnapshot stats_metrics;
+static uint8_t stats_metrics_frame[METRICS_MAX_FRAME];
+
 // Task to send statistics periodically
 void stats_task(void* parameter) {
+    SnifferSettings settings;
     while (1) {
+        // Sampled whether or not the app listens, for the console and the status log
+        g_metrics->sample(&stats_metrics);
+
         if (g_bluetooth && g_bluetooth->is_connected()) {
+            StatsSnapshot stats;
+            frame_stats.snapshot(&stats);
+            
             // Create statistics message
             char stats_msg[128];
             snprintf(stats_msg, sizeof(stats_msg), 
                     "STATS: Total=%lu, Mgmt=%lu, Data=%lu, Bytes=%lu",
-                    packet_stats.total_packets,
-                    packet_stats.management_packets,
-                    packet_stats.data_packets,
-                    packet_stats.bytes_received);
+                    stats.frames,
+                    stats.by_type[IEEE80211_TYPE_MGMT],
+                    stats.by_type[IEEE80211_TYPE_DATA],
+                    stats.bytes);
             
             // Send via Bluetooth
             g_bluetooth->send_data((uint8_t*)stats_msg, strlen(stats_msg));
+
+            // Queued whole, so its notifications stay contiguous on the link
+            size_t len = metrics_encode(stats_metrics, stats_metrics_frame, sizeof(stats_metrics_frame));
+            if (len) {
+                g_bluetooth->send_data(stats_metrics_frame, len);
+            }
         }
         
-        vTaskDelay(pdMS_TO_TICKS(30000)); // Send stats every 30 seconds
+        // The interval is read every time, so a change applies from the next report
+        g_config->get(&settings);
+        vTaskDelay(pdMS_TO_TICKS(settings.stats_interval_ms));
     }
 }
 
+// Wake the main loop to apply a published configuration change
+static void config_changed(uint32_t generation, void* ctx) {
+    xTaskNotifyGive(static_cast<TaskHandle_t>(ctx));
+}
+
+// Configuration commands written by the app, run in the Bluetooth host task
+static void config_command(const uint8_t* data, size_t len, void* ctx) {
+    SnifferConfig* config = static_cast<SnifferConfig*>(ctx);
+    char line[SNIFFER_CONFIG_FILTER_LEN + 64];
+    len = len < sizeof(line) - 1 ? len : sizeof(line) - 1;
+    memcpy(line, data, len);
+    line[len] = '\0';
+
+    char reply[640] = "CONFIG: ";
+    sniffer_config_execute(*config, line, reply + 8, sizeof(reply) - 8);
+    ESP_LOGI(TAG, "Config command '%s': %s", line, reply + 8);
+    g_bluetooth->send_data((uint8_t*)reply, strlen(reply));
+}
+
+static SchedulerConfig scheduler_config_from(const SnifferSettings& settings) {
+    SchedulerConfig config = channel_scheduler_default_config();
+    config.first_channel = settings.hop_first;
+    config.last_channel = settings.hop_last;
+    config.round_ms = settings.hop_round_ms;
+    config.min_dwell_ms = settings.hop_min_dwell_ms;
+    config.exploration = settings.hop_explore_pct / 100.0f;
+    return config;
+}
+
+static void apply_link_settings(const SnifferSettings& settings) {
+    g_bluetooth->set_telemetry_batch_limit(settings.ble_batch_bytes);
+    g_bluetooth->set_telemetry_flush_ms(settings.ble_flush_ms);
+    g_bluetooth->set_tx_queue_budget(settings.ble_queue_bytes);
+}
+
+// Bring the running pipeline in line with the latest published settings.
+// Only what changed is touched: the filter is swapped by the sniffer's own
+// double buffer and capture never stops. Returns true when the channel
+// policy changed, so that the dwell in progress is cut short.
+static bool apply_settings(SnifferSettings* applied, uint32_t* generation) {
+    if (g_config->generation() == *generation) {
+        return false;
+    }
+    // A change published in between is applied on the next call
+    *generation = g_config->generation();
+    SnifferSettings next;
+    g_config->get(&next);
+
+    if (next.log_level != applied->log_level) {
+        esp_log_level_set("*", (esp_log_level_t)next.log_level);
+    }
+    if (strcmp(next.filter, applied->filter) != 0) {
+        g_sniffer->set_filter(next.filter);
+    }
+    if (strcmp(next.device_name, applied->device_name) != 0) {
+        g_bluetooth->set_device_name(next.device_name);
+    }
+    if (next.ble_batch_bytes != applied->ble_batch_bytes || next.ble_flush_ms != applied->ble_flush_ms ||
+        next.ble_queue_bytes != applied->ble_queue_bytes) {
+        apply_link_settings(next);
+    }
+
+    bool hop_changed = next.channel != applied->channel || next.hop_first != applied->hop_first ||
+                       next.hop_last != applied->hop_last || next.hop_explore_pct != applied->hop_explore_pct ||
+                       next.hop_round_ms != applied->hop_round_ms ||
+                       next.hop_min_dwell_ms != applied->hop_min_dwell_ms;
+    if (hop_changed) {
+        g_scheduler->set_config(scheduler_config_from(next));
+    }
+    *applied = next;
+    ESP_LOGI(TAG, "Configuration %lu applied", *generation);
+    return hop_changed;
+}
+
 extern "C" void app_main(void)
 {
     ESP_LOGI(TAG, "ESP32 Network Sniffer with Bluetooth Starting...");
@@ -114,6 +449,19 @@ extern "C" void app_main(void)
     }
     ESP_ERROR_CHECK(ret);
 
+    // Runtime settings: the defaults, replaced by the ones saved over
+    // Bluetooth or the console if there are any
+    g_config = new SnifferConfig();
+    ret = sniffer_config_load(*g_config);
+    if (ret != ESP_OK && ret != ESP_ERR_NVS_NOT_FOUND) {
+        ESP_LOGW(TAG, "Stored settings not loaded: %s", esp_err_to_name(ret));
+    }
+    g_config->set_change_callback(config_changed, xTaskGetCurrentTaskHandle());
+    uint32_t config_generation = g_config->generation();
+    SnifferSettings settings;
+    g_config->get(&settings);
+    esp_log_level_set("*", (esp_log_level_t)settings.log_level);
+
     // Initialize ESP-NETIF
     ESP_ERROR_CHECK(esp_netif_init());
     ESP_ERROR_CHECK(esp_event_loop_create_default());
@@ -121,7 +469,9 @@ extern "C" void app_main(void)
     // Initialize Bluetooth communication
     g_bluetooth = new BluetoothComm();
     ESP_ERROR_CHECK(g_bluetooth->init());
-    g_bluetooth->set_device_name("ESP32_Sniffer");
+    g_bluetooth->set_device_name(settings.device_name);
+    g_bluetooth->set_command_handler(config_command, g_config);
+    apply_link_settings(settings);
     ESP_ERROR_CHECK(g_bluetooth->start_advertising());
     ESP_LOGI(TAG, "Bluetooth advertising started");
 
@@ -129,33 +479,210 @@ extern "C" void app_main(void)
     g_sniffer = new NetworkSniffer();
     ESP_ERROR_CHECK(g_sniffer->init());
     
+    if (settings.filter[0]) {
+        ESP_ERROR_CHECK(g_sniffer->set_filter(settings.filter));
+    }
+    
+    // Retransmissions are flagged once and skipped by the counting sinks
+    g_dedup = new FrameDedup();
+    ESP_LOGI(TAG, "Dedup: %d streams, %d bytes", FRAME_DEDUP_CAPACITY, (int)FrameDedup::footprint());
+    g_sniffer->set_dedup(g_dedup);
+    
     // Set packet processing callback
     g_sniffer->set_packet_callback(packet_processor);
+    ESP_ERROR_CHECK(g_sniffer->add_frame_sink(stats_sink, &frame_stats));
+    ESP_ERROR_CHECK(g_sniffer->add_frame_sink(enhanced_packet_handler, g_bluetooth));
+    
+    // Adaptive channel hopping, by default 30 seconds per channel on average, at least 5
+    g_scheduler = new ChannelScheduler(scheduler_config_from(settings));
+    ESP_ERROR_CHECK(g_sniffer->add_frame_sink(scheduler_sink, g_scheduler));
     
-    // Start statistics task
-    xTaskCreate(stats_task, "stats_task", 4096, NULL, 5, NULL);
+    // Device table; large enough that CONFIG_SPIRAM_USE_MALLOC places it in PSRAM
+    g_devices = new DeviceTracker();
+    ESP_LOGI(TAG, "Device table: %d devices, %d bytes",
+            (int)g_devices->capacity(), (int)DeviceTracker::footprint());
+    ESP_LOGI(TAG, "OUI table: %lu OUIs, %d vendors, %d bytes of flash",
+            oui_registry.count, oui_registry.vendor_count, (int)oui_table_bytes(oui_registry));
+    ESP_ERROR_CHECK(g_sniffer->add_frame_sink(device_sink, g_devices));
     
-    ESP_LOGI(TAG, "Starting network sniffing on channel 1");
-    ESP_ERROR_CHECK(g_sniffer->start_sniffing(1));
+    // AP/SSID inventory, reported to the app as deltas every 5 seconds
+    g_inventory = new ApInventory();
+    ESP_LOGI(TAG, "AP inventory: %d APs, %d probes, %d bytes",
+            INVENTORY_AP_CAPACITY, INVENTORY_PROBE_CAPACITY, (int)ApInventory::footprint());
+    inventory_link.inventory = g_inventory;
+    inventory_link.bluetooth = g_bluetooth;
+    inventory_link.connected = false;
+    inventory_link.mtu = 0;
+    ESP_ERROR_CHECK(g_sniffer->add_frame_sink(inventory_sink, &inventory_link));
+    
+    // Flight recorder: the last 10 seconds of frames, sent to the app when
+    // a deauthentication or disassociation burst starts
+    g_recorder = new FlightRecorder();
+    char error[64];
+    if (deauth_trigger.configure("subtype deauth or subtype disassoc", 10, 1000, error, sizeof(error))) {
+        ESP_ERROR_CHECK(g_recorder->add_trigger(&deauth_trigger, "deauth burst"));
+    } else {
+        ESP_LOGE(TAG, "Invalid recorder trigger: %s", error);
+    }
+    snapshot_link.bluetooth = g_bluetooth;
+    RecorderExporter exporter = {};
+    exporter.begin = snapshot_begin;
+    exporter.frame = snapshot_frame;
+    exporter.end = snapshot_end;
+    exporter.ctx = &snapshot_link;
+    g_recorder->set_exporter(exporter);
+    ESP_ERROR_CHECK(g_recorder->start());
+    ESP_ERROR_CHECK(g_sniffer->add_frame_sink(g_recorder));
+    
+    // Attack detection; alerts are sent to the app and snapshot by the recorder
+    g_detector = new AttackDetector();
+    ESP_LOGI(TAG, "Attack detector: %d bytes", (int)AttackDetector::footprint());
+    ESP_ERROR_CHECK(g_sniffer->add_frame_sink(attack_sink, g_detector));
+    
+    // Heap, stack, CPU and queue metrics, sampled and sent by the statistics task
+    g_metrics = new MetricsSampler();
+    ESP_ERROR_CHECK(g_metrics->add_queue("frame_ring", frame_ring_metrics, g_sniffer));
+    ESP_ERROR_CHECK(g_metrics->add_queue("ble_tx", tx_queue_metrics, g_bluetooth));
+    ESP_ERROR_CHECK(g_metrics->add_queue("recorder", recorder_metrics, g_recorder));
+    
+    // Start statistics task; it only talks to the BLE link, like the other export tasks
+    ESP_ERROR_CHECK(pipeline_create_task(PIPELINE_STAGE_EXPORT, stats_task, "stats_task", 4096, NULL, 5, NULL));
+    
+    // Configuration commands from the console; Bluetooth ones arrive through the command handler
+    esp_console_repl_t* repl = nullptr;
+    esp_console_repl_config_t repl_config = ESP_CONSOLE_REPL_CONFIG_DEFAULT();
+    repl_config.prompt = "sniffer>";
+    esp_console_dev_uart_config_t uart_config = ESP_CONSOLE_DEV_UART_CONFIG_DEFAULT();
+    ESP_ERROR_CHECK(esp_console_new_repl_uart(&uart_config, &repl_config, &repl));
+    ESP_ERROR_CHECK(esp_console_register_help_command());
+    ESP_ERROR_CHECK(sniffer_config_register_console(g_config));
+    ESP_ERROR_CHECK(sniffer_metrics_register_console(g_metrics));
+    ESP_ERROR_CHECK(esp_console_start_repl(repl));
+    
+    // A fixed channel is listened on until the settings change; the dwell
+    // only paces the status log
+    HopDecision hop = { settings.channel, FIXED_CHANNEL_REPORT_MS };
+    if (settings.channel == 0) {
+        hop = g_scheduler->next_hop(0);
+    }
+    ESP_LOGI(TAG, "Starting network sniffing on channel %d", hop.channel);
+    ESP_ERROR_CHECK(g_sniffer->start_sniffing(hop.channel));
     
     // Main application loop
     while (1) {
         ESP_LOGI(TAG, "Network sniffer running on channel %d", g_sniffer->get_current_channel());
         ESP_LOGI(TAG, "Bluetooth connected: %s", g_bluetooth->is_connected() ? "Yes" : "No");
-        ESP_LOGI(TAG, "Packets: Total=%lu, Mgmt=%lu, Data=%lu, Bytes=%lu",
-                packet_stats.total_packets,
-                packet_stats.management_packets,
-                packet_stats.data_packets,
-                packet_stats.bytes_received);
+        StatsSnapshot stats;
+        frame_stats.snapshot(&stats);
+        ESP_LOGI(TAG, "Packets: Total=%lu, Mgmt=%lu, Data=%lu, Bytes=%lu, Retries=%lu",
+                stats.frames,
+                stats.by_type[IEEE80211_TYPE_MGMT],
+                stats.by_type[IEEE80211_TYPE_DATA],
+                stats.bytes,
+                stats.retries);
+        SnifferStats sniffer_stats = g_sniffer->get_stats();
+        ESP_LOGI(TAG, "Capture: Captured=%lu, Filtered=%lu, Processed=%lu, Dropped=%lu, Ring peak=%lu/%lu",
+                sniffer_stats.captured,
+                sniffer_stats.filtered,
+                sniffer_stats.processed,
+                sniffer_stats.dropped,
+                sniffer_stats.ring_high_water,
+                sniffer_stats.ring_capacity);
+        CaptureClockStats clock = g_sniffer->get_clock_stats();
+        ESP_LOGI(TAG, "Clock: Offset=%lld us, Wraps=%lu, Resyncs=%lu, References=%lu, Skew=%ld ppb",
+                clock.offset_us,
+                clock.wraps,
+                clock.resyncs,
+                clock.references,
+                clock.skew_ppb);
+        FrameDedupStats dedup = g_dedup->get_stats();
+        ESP_LOGI(TAG, "Dedup: Checked=%lu, Duplicates=%lu, Retries=%lu, Streams=%lu, Evicted=%lu",
+                dedup.checked,
+                dedup.duplicates,
+                dedup.retries,
+                dedup.streams,
+                dedup.evictions);
+        ESP_LOGI(TAG, "Devices: Tracked=%d/%d, Evicted=%lu",
+                (int)g_devices->size(),
+                (int)g_devices->capacity(),
+                g_devices->evictions());
+        ESP_LOGI(TAG, "Vendors: Labeled=%lu, Randomized=%lu, Unknown=%lu",
+                vendor_counts.labeled.load(std::memory_order_relaxed),
+                vendor_counts.randomized.load(std::memory_order_relaxed),
+                vendor_counts.unknown.load(std::memory_order_relaxed));
+        InventoryStats inventory = g_inventory->get_stats();
+        ESP_LOGI(TAG, "Inventory: APs=%lu, Probes=%lu, SSIDs=%lu, Frames=%lu, Deltas=%lu",
+                inventory.aps,
+                inventory.probes,
+                inventory.ssids,
+                inventory.frames,
+                inventory.deltas);
+        FlightRecorderStats recorder = g_recorder->get_stats();
+        ESP_LOGI(TAG, "Recorder: Recorded=%lu, Used=%lu/%lu, Triggers=%lu, Snapshots=%lu, Exported=%lu, Lost=%lu",
+                recorder.recorded,
+                recorder.ring_used,
+                recorder.ring_bytes,
+                recorder.triggers,
+                recorder.snapshots,
+                recorder.exported,
+                recorder.export_lost);
+        AttackDetectorStats attacks = g_detector->get_stats();
+        ESP_LOGI(TAG, "Attacks: Deauth=%lu, Beacon=%lu, Twin=%lu, Probe=%lu, Suppressed=%lu",
+                attacks.alerts[ATTACK_DEAUTH_FLOOD],
+                attacks.alerts[ATTACK_BEACON_FLOOD],
+                attacks.alerts[ATTACK_EVIL_TWIN],
+                attacks.alerts[ATTACK_PROBE_STORM],
+                attacks.suppressed);
+        PipelineCpuUsage cpu;
+        if (pipeline_get_cpu_usage(&cpu) == ESP_OK) {
+            ESP_LOGI(TAG, "CPU: Ingest=%.1f%%, Analysis=%.1f%%, Export=%.1f%%, Core0=%.1f%%, Core1=%.1f%%",
+                    cpu.stage_percent[PIPELINE_STAGE_INGEST],
+                    cpu.stage_percent[PIPELINE_STAGE_ANALYSIS],
+                    cpu.stage_percent[PIPELINE_STAGE_EXPORT],
+                    cpu.core_busy_percent[0],
+                    cpu.core_busy_percent[portNUM_PROCESSORS - 1]);
+        }
+        static MetricsSnapshot metrics;
+        if (g_metrics->latest(&metrics)) {
+            const MetricsHeap& internal = metrics.heap[METRICS_HEAP_INTERNAL];
+            const MetricsHeap& spiram = metrics.heap[METRICS_HEAP_SPIRAM];
+            ESP_LOGI(TAG, "Heap: Internal=%lu (min %lu, largest %lu), SPIRAM=%lu (min %lu)",
+                    internal.free_bytes,
+                    internal.min_free_bytes,
+                    internal.largest_block,
+                    spiram.free_bytes,
+                    spiram.min_free_bytes);
+            if (metrics.task_count) {
+                // Tasks are sorted by free stack, least first
+                ESP_LOGI(TAG, "Stack: Least free=%lu bytes (%s)",
+                        metrics.tasks[0].stack_free_min,
+                        metrics.tasks[0].name);
+            }
+        }
         
-        // Example: Channel hopping every 30 seconds
-        static uint8_t current_channel = 1;
-        vTaskDelay(pdMS_TO_TICKS(30000)); // Wait 30 seconds
+        // Stay for the dwell the scheduler planned for this channel. Published
+        // settings are applied as they come; a new channel policy ends the dwell.
+        TickType_t dwell_start = xTaskGetTickCount();
+        TickType_t dwell = pdMS_TO_TICKS(hop.dwell_ms);
+        TickType_t waited = 0;
+        while (waited < dwell) {
+            ulTaskNotifyTake(pdTRUE, dwell - waited);
+            waited = xTaskGetTickCount() - dwell_start;
+            if (apply_settings(&settings, &config_generation)) {
+                break;
+            }
+        }
         
         // Switch to next channel (1-13 for 2.4GHz)
-        current_channel = (current_channel % 13) + 1;
-        ESP_LOGI(TAG, "Switching to channel %d", current_channel);
-        g_sniffer->stop_sniffing();
-        g_sniffer->start_sniffing(current_channel);
+        if (settings.channel != 0) {
+            hop.channel = settings.channel;
+            hop.dwell_ms = FIXED_CHANNEL_REPORT_MS;
+        } else {
+            hop = g_scheduler->next_hop(pdTICKS_TO_MS(waited));
+            ESP_LOGI(TAG, "Switching to channel %d for %lu ms", hop.channel, hop.dwell_ms);
+        }
+        if (hop.channel != g_sniffer->get_current_channel()) {
+            g_sniffer->set_channel(hop.channel);
+        }
     }
 } 
\ No newline at end of file